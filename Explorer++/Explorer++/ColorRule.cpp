@@ -10,6 +10,7 @@ ColorRule::ColorRule(const std::wstring &description, const std::wstring &filter
 	m_description(description),
 	m_filterPattern(filterPattern),
 	m_filterPatternCaseInsensitive(filterPatternCaseInsensitive),
+	m_compiledFilterPattern(filterPattern, !filterPatternCaseInsensitive),
 	m_filterAttributes(filterAttributes),
 	m_color(color)
 {
@@ -45,6 +46,7 @@ void ColorRule::SetFilterPattern(const std::wstring &filterPattern)
 	}
 
 	m_filterPattern = filterPattern;
+	m_compiledFilterPattern = WildcardPattern(m_filterPattern, !m_filterPatternCaseInsensitive);
 
 	m_updatedSignal(this);
 }
@@ -62,10 +64,16 @@ void ColorRule::SetFilterPatternCaseInsensitive(bool caseInsensitive)
 	}
 
 	m_filterPatternCaseInsensitive = caseInsensitive;
+	m_compiledFilterPattern = WildcardPattern(m_filterPattern, !m_filterPatternCaseInsensitive);
 
 	m_updatedSignal(this);
 }
 
+const WildcardPattern &ColorRule::GetCompiledFilterPattern() const
+{
+	return m_compiledFilterPattern;
+}
+
 DWORD ColorRule::GetFilterAttributes() const
 {
 	return m_filterAttributes;
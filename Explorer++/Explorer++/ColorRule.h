@@ -4,6 +4,8 @@
 
 #pragma once
 
+#include "../Helper/WildcardPattern.h"
+
 class ColorRule
 {
 public:
@@ -18,6 +20,11 @@ public:
 	void SetFilterPattern(const std::wstring &filterPattern);
 	bool GetFilterPatternCaseInsensitive() const;
 	void SetFilterPatternCaseInsensitive(bool caseInsensitive);
+
+	// Returns the compiled form of the filter pattern, which is kept in sync with the pattern and
+	// case sensitivity above.
+	const WildcardPattern &GetCompiledFilterPattern() const;
+
 	DWORD GetFilterAttributes() const;
 	void SetFilterAttributes(DWORD attributes);
 	COLORREF GetColor() const;
@@ -29,6 +36,7 @@ private:
 	std::wstring m_description;
 	std::wstring m_filterPattern;
 	bool m_filterPatternCaseInsensitive;
+	WildcardPattern m_compiledFilterPattern;
 	DWORD m_filterAttributes;
 	COLORREF m_color;
 
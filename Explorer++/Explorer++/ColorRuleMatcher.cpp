@@ -0,0 +1,210 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "ColorRuleMatcher.h"
+#include "ColorRule.h"
+#include <algorithm>
+
+namespace
+{
+
+bool IsAscii(std::wstring_view str)
+{
+	return std::all_of(str.begin(), str.end(),
+		[](wchar_t c)
+		{
+			return c < 0x80;
+		});
+}
+
+std::wstring ToLowerAscii(std::wstring_view str)
+{
+	std::wstring output(str);
+
+	for (auto &c : output)
+	{
+		if (c >= 'A' && c <= 'Z')
+		{
+			c = static_cast<wchar_t>(c + ('a' - 'A'));
+		}
+	}
+
+	return output;
+}
+
+}
+
+ColorRuleMatcher::ColorRuleMatcher(const std::vector<std::unique_ptr<ColorRule>> &colorRules)
+{
+	for (const auto &colorRule : colorRules)
+	{
+		size_t index = m_rules.size();
+
+		CompiledRule rule;
+		rule.filterAttributes = colorRule->GetFilterAttributes();
+		rule.color = colorRule->GetColor();
+
+		if (colorRule->GetFilterPattern().empty())
+		{
+			m_rules.push_back(std::move(rule));
+			m_otherRules.push_back(index);
+			continue;
+		}
+
+		const auto &pattern = colorRule->GetCompiledFilterPattern();
+		rule.filterPattern = pattern;
+		m_rules.push_back(std::move(rule));
+
+		auto extensions = pattern.GetExtensions();
+
+		if (!extensions
+			|| !std::all_of(extensions->begin(), extensions->end(),
+				[](const std::wstring &extension)
+				{
+					return IsAscii(extension);
+				}))
+		{
+			m_otherRules.push_back(index);
+			continue;
+		}
+
+		auto &extensionRules = pattern.IsCaseSensitive() ? m_caseSensitiveExtensionRules
+														 : m_caseInsensitiveExtensionRules;
+
+		for (const auto &extension : *extensions)
+		{
+			auto &indexes = extensionRules[extension];
+
+			// A pattern like "*.txt: *.txt" would otherwise result in the same rule being added
+			// twice.
+			if (indexes.empty() || indexes.back() != index)
+			{
+				indexes.push_back(index);
+			}
+		}
+	}
+}
+
+std::optional<COLORREF> ColorRuleMatcher::GetColor(std::wstring_view displayName,
+	std::optional<DWORD> attributes) const
+{
+	auto index = FindFirstMatchingRule(displayName, attributes);
+
+	if (!index)
+	{
+		return std::nullopt;
+	}
+
+	return m_rules[*index].color;
+}
+
+std::optional<size_t> ColorRuleMatcher::FindFirstMatchingRule(std::wstring_view displayName,
+	std::optional<DWORD> attributes) const
+{
+	std::wstring_view extension;
+	auto dotPosition = displayName.rfind('.');
+
+	if (dotPosition != std::wstring_view::npos)
+	{
+		extension = displayName.substr(dotPosition + 1);
+	}
+
+	// Folding a non-ASCII character can result in an ASCII character, so an extension like that
+	// can't be looked up in the index. Every rule is checked in that case.
+	if (!IsAscii(extension))
+	{
+		for (size_t i = 0; i < m_rules.size(); i++)
+		{
+			if (MatchRule(m_rules[i], displayName, attributes))
+			{
+				return i;
+			}
+		}
+
+		return std::nullopt;
+	}
+
+	size_t firstMatch = m_rules.size();
+
+	if (!extension.empty())
+	{
+		std::wstring extensionText(extension);
+		CheckExtensionRules(m_caseSensitiveExtensionRules, extensionText, m_rules, attributes,
+			firstMatch);
+		CheckExtensionRules(m_caseInsensitiveExtensionRules, ToLowerAscii(extensionText), m_rules,
+			attributes, firstMatch);
+	}
+
+	// Only the rules that appear before the first matching extension rule need to be checked.
+	for (size_t index : m_otherRules)
+	{
+		if (index >= firstMatch)
+		{
+			break;
+		}
+
+		if (MatchRule(m_rules[index], displayName, attributes))
+		{
+			firstMatch = index;
+			break;
+		}
+	}
+
+	if (firstMatch == m_rules.size())
+	{
+		return std::nullopt;
+	}
+
+	return firstMatch;
+}
+
+// The rules in the map have already been matched against the extension, so only their attributes
+// need to be checked.
+void ColorRuleMatcher::CheckExtensionRules(const ExtensionRuleMap &extensionRules,
+	const std::wstring &extension, const std::vector<CompiledRule> &rules,
+	std::optional<DWORD> attributes, size_t &firstMatch)
+{
+	auto itr = extensionRules.find(extension);
+
+	if (itr == extensionRules.end())
+	{
+		return;
+	}
+
+	for (size_t index : itr->second)
+	{
+		if (index >= firstMatch)
+		{
+			break;
+		}
+
+		if (MatchAttributes(rules[index], attributes))
+		{
+			firstMatch = index;
+			break;
+		}
+	}
+}
+
+bool ColorRuleMatcher::MatchRule(const CompiledRule &rule, std::wstring_view displayName,
+	std::optional<DWORD> attributes)
+{
+	if (!MatchAttributes(rule, attributes))
+	{
+		return false;
+	}
+
+	return !rule.filterPattern || rule.filterPattern->Match(displayName);
+}
+
+bool ColorRuleMatcher::MatchAttributes(const CompiledRule &rule, std::optional<DWORD> attributes)
+{
+	if (rule.filterAttributes == 0)
+	{
+		return true;
+	}
+
+	return attributes && WI_IsAnyFlagSet(*attributes, rule.filterAttributes);
+}
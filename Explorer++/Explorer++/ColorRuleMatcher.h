@@ -0,0 +1,67 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include "../Helper/WildcardPattern.h"
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+class ColorRule;
+
+// A compiled form of a set of color rules, used to determine which color (if any) an item should be
+// drawn in. As with the rules themselves, the first rule that matches determines the color.
+//
+// Rules that match on a single extension (e.g. "*.txt") are indexed by that extension, so only the
+// rules that could actually match an item need to be checked. The attributes for a rule are checked
+// before its filename pattern, since that check is cheap.
+class ColorRuleMatcher
+{
+public:
+	// The default matcher doesn't contain any rules.
+	ColorRuleMatcher() = default;
+	explicit ColorRuleMatcher(const std::vector<std::unique_ptr<ColorRule>> &colorRules);
+
+	// The attributes should be std::nullopt if they aren't known, in which case any rules that
+	// filter on attributes won't match.
+	std::optional<COLORREF> GetColor(std::wstring_view displayName,
+		std::optional<DWORD> attributes) const;
+
+private:
+	struct CompiledRule
+	{
+		// Only set if the rule filters on the filename.
+		std::optional<WildcardPattern> filterPattern;
+
+		DWORD filterAttributes;
+		COLORREF color;
+	};
+
+	// Indexes into m_rules. Each vector is kept in rule order.
+	using ExtensionRuleMap = std::unordered_map<std::wstring, std::vector<size_t>>;
+
+	static bool MatchRule(const CompiledRule &rule, std::wstring_view displayName,
+		std::optional<DWORD> attributes);
+	static bool MatchAttributes(const CompiledRule &rule, std::optional<DWORD> attributes);
+	static void CheckExtensionRules(const ExtensionRuleMap &extensionRules,
+		const std::wstring &extension, const std::vector<CompiledRule> &rules,
+		std::optional<DWORD> attributes, size_t &firstMatch);
+
+	std::optional<size_t> FindFirstMatchingRule(std::wstring_view displayName,
+		std::optional<DWORD> attributes) const;
+
+	std::vector<CompiledRule> m_rules;
+
+	// Extensions are only indexed if they consist solely of ASCII characters. The keys in the
+	// case-insensitive map are lowercase.
+	ExtensionRuleMap m_caseSensitiveExtensionRules;
+	ExtensionRuleMap m_caseInsensitiveExtensionRules;
+
+	// Rules that aren't indexed by extension, in rule order.
+	std::vector<size_t> m_otherRules;
+};
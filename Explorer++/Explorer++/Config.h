@@ -13,6 +13,8 @@
 #include "../Helper/SetDefaultFileManager.h"
 #include "../Helper/ShellHelper.h"
 #include "../Helper/StringHelper.h"
+#include <algorithm>
+#include <thread>
 
 static const int DEFAULT_LISTVIEW_HOVER_TIME = 500;
 
@@ -85,6 +87,9 @@ struct Config
 		treeViewWidth = DEFAULT_TREEVIEW_WIDTH;
 		checkPinnedToNamespaceTreeProperty = false;
 		shellChangeNotificationType = ShellChangeNotificationType::Disabled;
+		useVirtualListView = FALSE;
+		columnRetrievalThreads = 2;
+		thumbnailMemoryBudget = 64;
 
 		replaceExplorerMode = DefaultFileManager::ReplaceExplorerMode::None;
 
@@ -193,6 +198,21 @@ struct Config
 	bool checkPinnedToNamespaceTreeProperty;
 	ShellChangeNotificationType shellChangeNotificationType;
 
+	// When set, tabs use an owner data listview, which only requests information on the items
+	// that are visible. This reduces the time and memory needed to display very large folders,
+	// though items won't be shown in groups (items are still ordered by group). This is only
+	// read when a tab is created, since the style can't be changed once the listview exists.
+	BOOL useVirtualListView;
+
+	// The number of worker threads each tab uses to retrieve column text in details view. This is
+	// only read when a tab is created.
+	int columnRetrievalThreads;
+
+	// The amount of memory (in MB) each tab can use to hold extracted thumbnails in thumbnails
+	// view. Once this limit has been reached, the least recently used thumbnails are discarded.
+	// This is only read when a tab is created.
+	int thumbnailMemoryBudget;
+
 	DefaultFileManager::ReplaceExplorerMode replaceExplorerMode;
 
 	BOOL showInfoTips;
@@ -222,6 +242,14 @@ struct Config
 
 	FolderSettings defaultFolderSettings;
 
+	// The number of column retrieval threads is loaded from the saved settings, so it's limited
+	// here to a range the task scheduler can actually use.
+	static int ClampColumnRetrievalThreads(int numThreads)
+	{
+		int maxThreads = max(static_cast<int>(std::thread::hardware_concurrency()), 1);
+		return std::clamp(numThreads, 1, maxThreads);
+	}
+
 private:
 	static std::wstring GetComputerFolderPath()
 	{
@@ -30,6 +30,9 @@ using FocusChangedSignal = boost::signals2::signal<void(WindowFocusSource window
 using ApplicationShuttingDownSignal = boost::signals2::signal<void()>;
 
 class CachedIcons;
+class ExtensionIconCache;
+class IconService;
+class PersistentImageCache;
 struct Config;
 class IconResourceLoader;
 __interface IDirectoryMonitor;
@@ -61,6 +64,9 @@ public:
 
 	virtual IconResourceLoader *GetIconResourceLoader() const = 0;
 	virtual CachedIcons *GetCachedIcons() = 0;
+	virtual ExtensionIconCache *GetExtensionIconCache() = 0;
+	virtual IconService *GetIconService() = 0;
+	virtual PersistentImageCache *GetPersistentImageCache() = 0;
 
 	virtual HWND GetTreeView() const = 0;
 
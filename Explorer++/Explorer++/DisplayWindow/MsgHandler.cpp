@@ -4,6 +4,7 @@
 
 #include "stdafx.h"
 #include "DisplayWindow.h"
+#include "../Helper/ImageHelper.h"
 #include "../Helper/Macros.h"
 #include "../Helper/ShellHelper.h"
 #include "../Helper/WindowHelper.h"
@@ -201,10 +202,12 @@ void DisplayWindow::ExtractThumbnailImageInternal(ThumbnailEntry_t *pte)
 				GetClientRect(m_hDisplayWindow, &rc);
 
 				/* First, query the thumbnail so that its actual aspect
-				ratio can be calculated. */
+				ratio can be calculated. The image is requested at a larger
+				size than will be displayed, so that it can be scaled down
+				directly, without having to be extracted a second time. */
 				dwFlags = IEIFLAG_OFFLINE | IEIFLAG_QUALITY | IEIFLAG_ORIGSIZE;
-				size.cx = GetRectHeight(&rc) - THUMB_HEIGHT_DELTA;
-				size.cy = GetRectHeight(&rc) - THUMB_HEIGHT_DELTA;
+				size.cx = 2 * (GetRectHeight(&rc) - THUMB_HEIGHT_DELTA);
+				size.cy = 2 * (GetRectHeight(&rc) - THUMB_HEIGHT_DELTA);
 
 				hr = pExtractImage->GetLocation(szImage, SIZEOF_ARRAY(szImage), &dwPriority, &size,
 					32, &dwFlags);
@@ -218,22 +221,42 @@ void DisplayWindow::ExtractThumbnailImageInternal(ThumbnailEntry_t *pte)
 						/* Get bitmap information (including height and width). */
 						GetObject(hBitmap, sizeof(BITMAP), &bm);
 
-						/* Delete the original bitmap. */
-						DeleteObject(hBitmap);
-
-						/* ...now query the thumbnail again, this time adjusting
-						the width of the suggested area based on the actual aspect
-						ratio. */
-						dwFlags =
-							IEIFLAG_OFFLINE | IEIFLAG_QUALITY | IEIFLAG_ASPECT | IEIFLAG_ORIGSIZE;
 						size.cy = GetRectHeight(&rc) - THUMB_HEIGHT_DELTA;
 						size.cx = (LONG) ((double) size.cy
 							* ((double) bm.bmWidth / (double) bm.bmHeight));
 						m_iImageWidth = size.cx;
 						m_iImageHeight = size.cy;
-						pExtractImage->GetLocation(szImage, SIZEOF_ARRAY(szImage), &dwPriority,
-							&size, 32, &dwFlags);
-						hr = pExtractImage->Extract(&m_hbmThumbnail);
+
+						/* If the extracted image is at least as large as the
+						area it will be displayed in, it can be scaled down
+						directly. */
+						wil::unique_hbitmap resizedBitmap;
+
+						if (size.cx > 0 && size.cy > 0 && bm.bmWidth >= size.cx
+							&& bm.bmHeight >= size.cy)
+						{
+							resizedBitmap = ImageHelper::ResizeBitmap(hBitmap, size.cx, size.cy,
+								ImageResampler::Filter::Lanczos3);
+						}
+
+						/* Delete the original bitmap. */
+						DeleteObject(hBitmap);
+
+						if (resizedBitmap)
+						{
+							m_hbmThumbnail = resizedBitmap.release();
+						}
+						else
+						{
+							/* ...otherwise, query the thumbnail again, this time
+							adjusting the width of the suggested area based on the
+							actual aspect ratio. */
+							dwFlags = IEIFLAG_OFFLINE | IEIFLAG_QUALITY | IEIFLAG_ASPECT
+								| IEIFLAG_ORIGSIZE;
+							pExtractImage->GetLocation(szImage, SIZEOF_ARRAY(szImage),
+								&dwPriority, &size, 32, &dwFlags);
+							hr = pExtractImage->Extract(&m_hbmThumbnail);
+						}
 
 						if (SUCCEEDED(hr))
 						{
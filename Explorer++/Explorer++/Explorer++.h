@@ -17,10 +17,12 @@
 #include "TabNavigationInterface.h"
 #include "ValueWrapper.h"
 #include "../Helper/CachedIcons.h"
+#include "../Helper/ExtensionIconCache.h"
 #include "../Helper/DropHandler.h"
 #include "../Helper/FileActionHandler.h"
 #include "../Helper/FileContextMenuManager.h"
 #include "../Helper/IconFetcher.h"
+#include "../Helper/PersistentImageCache.h"
 #include <boost/signals2.hpp>
 #include <wil/resource.h>
 #include <optional>
@@ -120,6 +122,13 @@ private:
 	// shared between various components in the application.
 	static const int MAX_CACHED_ICONS = 1000;
 
+	// The number of threads used to retrieve icons, for the whole application.
+	static const int NUM_ICON_THREADS = 4;
+
+	// The maximum size of the image cache that's saved to disk. Once this limit is reached, the
+	// least recently used thumbnails are dropped when the cache is saved.
+	static const size_t IMAGE_CACHE_BYTE_BUDGET = 128 * 1024 * 1024;
+
 	static inline constexpr COLORREF TAB_BAR_DARK_MODE_BACKGROUND_COLOR = RGB(25, 25, 25);
 
 	static inline const int CLOSE_TOOLBAR_WIDTH = 24;
@@ -338,6 +347,7 @@ private:
 	/* Settings. */
 	void SaveAllSettings() override;
 	void LoadAllSettings(ILoadSave **pLoadSave);
+	std::wstring GetImageCacheFilePath() const;
 	void ValidateLoadedSettings();
 	void ValidateColumns(FolderColumns &folderColumns);
 	void ValidateSingleColumnSet(int iColumnSet, std::vector<Column_t> &columns);
@@ -482,6 +492,9 @@ private:
 	IDirectoryMonitor *GetDirectoryMonitor() const override;
 	IconResourceLoader *GetIconResourceLoader() const override;
 	CachedIcons *GetCachedIcons() override;
+	ExtensionIconCache *GetExtensionIconCache() override;
+	IconService *GetIconService() override;
+	PersistentImageCache *GetPersistentImageCache() override;
 	BOOL GetSavePreferencesToXmlFile() const override;
 	void SetSavePreferencesToXmlFile(BOOL savePreferencesToXmlFile) override;
 	void FocusChanged(WindowFocusSource windowFocusSource) override;
@@ -566,6 +579,8 @@ private:
 	std::unique_ptr<IconResourceLoader> m_iconResourceLoader;
 
 	CachedIcons m_cachedIcons;
+	ExtensionIconCache m_extensionIconCache;
+	std::unique_ptr<PersistentImageCache> m_persistentImageCache;
 
 	MainMenuPreShowSignal m_mainMenuPreShowSignal;
 	FocusChangedSignal m_focusChangedSignal;
@@ -609,22 +624,13 @@ private:
 	std::unique_ptr<BookmarksMainMenu> m_bookmarksMainMenu;
 	BookmarksToolbar *m_bookmarksToolbar;
 
-	// IconFetcher retrieves file icons in a background thread. A queue of requests is maintained
-	// and that queue is cleared when the instance is destroyed. However, any current request that's
-	// running in the background thread will continue to run and the main thread will wait for it to
-	// finish.
-	// This, however, could cause problems if the IconFetcher instance is held by an object that
-	// only exists for a specific period of time. For example, if the instance were being managed by
-	// the manage bookmark dialog, and the dialog was closed, the instance would be destroyed and
-	// the main thread would wait for any operation in the background thread to finish. That could
-	// then cause the application to appear to hang.
-	// Since this class exists for the entire lifetime of the application, it means that the
-	// IconFetcher instance will only be destroyed at application shutdown and that's the only point
-	// at which the main thread will wait. While the application is running, the most that would
-	// happen is that the process of retrieving other icons would be delayed.
-	// Ideally, it would be better to cancel operations that are running in the background thread,
-	// but as far as I'm aware, it's not possible to cancel SHGetFileInfo (which is what's
-	// ultimately used to retrieve the icons).
+	// Icons are retrieved on a set of background threads that's shared by the entire application.
+	// It's not possible to cancel SHGetFileInfo (which is what's ultimately used to retrieve the
+	// icons), so when the service is destroyed, the main thread will wait for any running lookups
+	// to finish. Since this class exists for the entire lifetime of the application, that will
+	// only happen at application shutdown. Individual IconFetcher instances, on the other hand, can
+	// be created and destroyed at any time, without blocking.
+	IconService m_iconService;
 	IconFetcher m_bookmarkIconFetcher;
 
 	/* Undo support. */
@@ -23,6 +23,9 @@ const TCHAR XML_FILENAME[] = _T("config.xml");
 
 const TCHAR LOG_FILENAME[] = _T("Explorer++.log");
 
+// Thumbnails and overlay information that are persisted between sessions.
+const TCHAR IMAGE_CACHE_FILENAME[] = _T("ImageCache.dat");
+
 // Internal command line arguments.
 const TCHAR JUMPLIST_TASK_NEWTAB_ARGUMENT[] = _T("--open-new-tab");
 const TCHAR APPLICATION_CRASHED_ARGUMENT[] = _T("--application-crashed");
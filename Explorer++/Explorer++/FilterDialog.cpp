@@ -38,7 +38,14 @@ INT_PTR FilterDialog::OnInitDialog()
 			reinterpret_cast<LPARAM>(strFilter.c_str()));
 	}
 
-	std::wstring filter = m_coreInterface->GetActiveShellBrowser()->GetFilterText();
+	auto *shellBrowser = m_coreInterface->GetActiveShellBrowser();
+
+	// The filter is applied as it's typed. These values are restored if the dialog is cancelled.
+	m_originalFilter = shellBrowser->GetFilterText();
+	m_originalFilterApplied = shellBrowser->IsFilterApplied();
+	m_originalFilterCaseSensitive = shellBrowser->GetFilterCaseSensitive();
+
+	std::wstring filter = m_originalFilter;
 
 	ComboBox_SelectString(hComboBox, -1, filter.c_str());
 
@@ -92,6 +99,25 @@ INT_PTR FilterDialog::OnCommand(WPARAM wParam, LPARAM lParam)
 
 	switch (LOWORD(wParam))
 	{
+	case IDC_FILTER_COMBOBOX:
+		switch (HIWORD(wParam))
+		{
+		case CBN_EDITCHANGE:
+			PreviewFilter(GetWindowString(GetDlgItem(m_hDlg, IDC_FILTER_COMBOBOX)));
+			break;
+
+		case CBN_SELCHANGE:
+			// The text in the edit control hasn't been updated at this point, so the text of the
+			// selected item needs to be retrieved directly.
+			PreviewFilter(GetSelectedFilter());
+			break;
+		}
+		break;
+
+	case IDC_FILTERS_CASESENSITIVE:
+		PreviewFilter(GetWindowString(GetDlgItem(m_hDlg, IDC_FILTER_COMBOBOX)));
+		break;
+
 	case IDOK:
 		OnOk();
 		break;
@@ -106,10 +132,43 @@ INT_PTR FilterDialog::OnCommand(WPARAM wParam, LPARAM lParam)
 
 INT_PTR FilterDialog::OnClose()
 {
-	EndDialog(m_hDlg, 0);
+	OnCancel();
 	return 0;
 }
 
+std::wstring FilterDialog::GetSelectedFilter() const
+{
+	HWND hComboBox = GetDlgItem(m_hDlg, IDC_FILTER_COMBOBOX);
+	int index = ComboBox_GetCurSel(hComboBox);
+
+	if (index == CB_ERR)
+	{
+		return GetWindowString(hComboBox);
+	}
+
+	std::wstring filter;
+	filter.resize(ComboBox_GetLBTextLen(hComboBox, index) + 1);
+	ComboBox_GetLBText(hComboBox, index, filter.data());
+	filter.resize(lstrlen(filter.c_str()));
+	return filter;
+}
+
+// Each change to the filter is applied to the active tab immediately. Since the filter is
+// typically extended a character at a time, the tab only has to re-check the items that are
+// affected by each change.
+void FilterDialog::PreviewFilter(const std::wstring &filter)
+{
+	auto *shellBrowser = m_coreInterface->GetActiveShellBrowser();
+
+	shellBrowser->SetFilterCaseSensitive(
+		IsDlgButtonChecked(m_hDlg, IDC_FILTERS_CASESENSITIVE) == BST_CHECKED);
+	shellBrowser->SetFilterText(filter);
+
+	// An empty filter won't match any files, so while the filter is being typed, an empty filter
+	// simply results in all items being shown.
+	shellBrowser->SetFilterApplied(!filter.empty());
+}
+
 void FilterDialog::OnOk()
 {
 	HWND hComboBox = GetDlgItem(m_hDlg, IDC_FILTER_COMBOBOX);
@@ -153,6 +212,11 @@ void FilterDialog::OnOk()
 
 void FilterDialog::OnCancel()
 {
+	auto *shellBrowser = m_coreInterface->GetActiveShellBrowser();
+	shellBrowser->SetFilterCaseSensitive(m_originalFilterCaseSensitive);
+	shellBrowser->SetFilterText(m_originalFilter);
+	shellBrowser->SetFilterApplied(m_originalFilterApplied);
+
 	EndDialog(m_hDlg, 0);
 }
 
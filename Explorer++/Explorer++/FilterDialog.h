@@ -56,10 +56,16 @@ private:
 		std::list<ResizableDialog::Control> &ControlList) override;
 	void SaveState() override;
 
+	std::wstring GetSelectedFilter() const;
+	void PreviewFilter(const std::wstring &filter);
 	void OnOk();
 	void OnCancel();
 
 	CoreInterface *m_coreInterface;
 
+	std::wstring m_originalFilter;
+	BOOL m_originalFilterApplied;
+	BOOL m_originalFilterCaseSensitive;
+
 	FilterDialogPersistentSettings *m_persistentSettings;
 };
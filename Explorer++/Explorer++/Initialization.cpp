@@ -48,6 +48,10 @@ void Explorerplusplus::OnCreate()
 
 	m_iconResourceLoader = std::make_unique<IconResourceLoader>(m_config->iconSet);
 
+	// This needs to be created before any tabs are, since each tab will use the cache.
+	m_persistentImageCache =
+		std::make_unique<PersistentImageCache>(GetImageCacheFilePath(), IMAGE_CACHE_BYTE_BUDGET);
+
 	SetLanguageModule();
 
 	if (ShouldEnableDarkMode(m_config->theme))
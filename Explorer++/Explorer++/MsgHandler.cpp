@@ -705,6 +705,7 @@ int Explorerplusplus::CloseApplication()
 	KillTimer(m_hContainer, AUTOSAVE_TIMER_ID);
 
 	SaveAllSettings();
+	m_persistentImageCache->Save();
 
 	DestroyWindow(m_hContainer);
 
@@ -1101,6 +1102,7 @@ void Explorerplusplus::OnAssocChanged()
 	/* When the system image list is refresh, ALL previous
 	icons will be discarded. This means that SHGetFileInfo()
 	needs to be called to get each files icon again. */
+	m_extensionIconCache.Clear();
 
 	/* Now, go through each tab, and refresh each icon. */
 	for (auto &tab : m_tabContainer->GetAllTabs() | boost::adaptors::map_values)
@@ -1304,6 +1306,54 @@ CachedIcons *Explorerplusplus::GetCachedIcons()
 	return &m_cachedIcons;
 }
 
+ExtensionIconCache *Explorerplusplus::GetExtensionIconCache()
+{
+	return &m_extensionIconCache;
+}
+
+IconService *Explorerplusplus::GetIconService()
+{
+	return &m_iconService;
+}
+
+PersistentImageCache *Explorerplusplus::GetPersistentImageCache()
+{
+	return m_persistentImageCache.get();
+}
+
+// When settings are being saved to the XML file, the application is running in portable mode, so
+// the cache is stored alongside the executable, just as the config file is. Otherwise, it's stored
+// in the local application data folder.
+std::wstring Explorerplusplus::GetImageCacheFilePath() const
+{
+	TCHAR cacheDirectory[MAX_PATH];
+
+	if (m_bSavePreferencesToXMLFile)
+	{
+		GetProcessImageName(GetCurrentProcessId(), cacheDirectory, SIZEOF_ARRAY(cacheDirectory));
+		PathRemoveFileSpec(cacheDirectory);
+	}
+	else
+	{
+		wil::unique_cotaskmem_string localAppData;
+		HRESULT hr =
+			SHGetKnownFolderPath(FOLDERID_LocalAppData, KF_FLAG_DEFAULT, nullptr, &localAppData);
+
+		if (FAILED(hr))
+		{
+			return {};
+		}
+
+		StringCchCopy(cacheDirectory, SIZEOF_ARRAY(cacheDirectory), localAppData.get());
+		PathAppend(cacheDirectory, NExplorerplusplus::APP_NAME);
+		SHCreateDirectoryEx(nullptr, cacheDirectory, nullptr);
+	}
+
+	PathAppend(cacheDirectory, NExplorerplusplus::IMAGE_CACHE_FILENAME);
+
+	return cacheDirectory;
+}
+
 BOOL Explorerplusplus::GetSavePreferencesToXmlFile() const
 {
 	return m_bSavePreferencesToXMLFile;
@@ -180,6 +180,12 @@ LONG Explorerplusplus::SaveGenericSettingsToRegistry()
 		RegistrySettings::SaveDword(hSettingsKey, _T("Language"), m_config->language);
 		RegistrySettings::SaveDword(hSettingsKey, _T("OpenTabsInForeground"),
 			m_config->openTabsInForeground);
+		RegistrySettings::SaveDword(hSettingsKey, _T("UseVirtualListView"),
+			m_config->useVirtualListView);
+		RegistrySettings::SaveDword(hSettingsKey, _T("ColumnRetrievalThreads"),
+			m_config->columnRetrievalThreads);
+		RegistrySettings::SaveDword(hSettingsKey, _T("ThumbnailMemoryBudget"),
+			m_config->thumbnailMemoryBudget);
 
 		RegistrySettings::SaveDword(hSettingsKey, _T("DisplayMixedFilesAndFolders"),
 			m_config->globalFolderSettings.displayMixedFilesAndFolders);
@@ -460,6 +466,14 @@ LONG Explorerplusplus::LoadGenericSettingsFromRegistry()
 
 		RegistrySettings::Read32BitValueFromRegistry(hSettingsKey, _T("OpenTabsInForeground"),
 			m_config->openTabsInForeground);
+		RegistrySettings::Read32BitValueFromRegistry(hSettingsKey, _T("UseVirtualListView"),
+			m_config->useVirtualListView);
+		RegistrySettings::Read32BitValueFromRegistry(hSettingsKey, _T("ColumnRetrievalThreads"),
+			m_config->columnRetrievalThreads);
+		m_config->columnRetrievalThreads =
+			Config::ClampColumnRetrievalThreads(m_config->columnRetrievalThreads);
+		RegistrySettings::Read32BitValueFromRegistry(hSettingsKey, _T("ThumbnailMemoryBudget"),
+			m_config->thumbnailMemoryBudget);
 
 		RegistrySettings::Read32BitValueFromRegistry(hSettingsKey,
 			_T("DisplayMixedFilesAndFolders"),
@@ -605,6 +619,14 @@ void Explorerplusplus::SaveTabSettingsToRegistry()
 				sortMode = tab.GetShellBrowser()->GetSortMode();
 				RegistrySettings::SaveDword(hTabKey, _T("SortMode"), sortMode);
 
+				auto secondarySortMode = tab.GetShellBrowser()->GetSecondarySortMode();
+
+				if (secondarySortMode)
+				{
+					RegistrySettings::SaveDword(hTabKey, _T("SecondarySortMode"),
+						*secondarySortMode);
+				}
+
 				RegistrySettings::SaveDword(hTabKey, _T("SortAscending"),
 					tab.GetShellBrowser()->GetSortAscending());
 				RegistrySettings::SaveDword(hTabKey, _T("ShowInGroups"),
@@ -752,6 +774,18 @@ int Explorerplusplus::LoadTabSettingsFromRegistry()
 					folderSettings.sortMode = SortMode::_from_integral(value);
 				});
 
+			RegistrySettings::ReadDword(hTabKey, _T("SecondarySortMode"),
+				[&folderSettings](DWORD value)
+				{
+					// The secondary sort mode is optional, so an invalid value is simply ignored.
+					auto secondarySortMode = SortMode::_from_integral_nothrow(value);
+
+					if (secondarySortMode)
+					{
+						folderSettings.secondarySortMode = *secondarySortMode;
+					}
+				});
+
 			RegistrySettings::Read32BitValueFromRegistry(hTabKey, _T("SortAscending"),
 				folderSettings.sortAscending);
 			RegistrySettings::Read32BitValueFromRegistry(hTabKey, _T("ShowInGroups"),
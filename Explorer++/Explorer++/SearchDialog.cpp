@@ -1026,6 +1026,7 @@ Search::Search(HWND hDlg, TCHAR *szBaseDirectory, TCHAR *szPattern, DWORD dwAttr
 
 	StringCchCopy(m_szBaseDirectory, SIZEOF_ARRAY(m_szBaseDirectory), szBaseDirectory);
 	StringCchCopy(m_szSearchPattern, SIZEOF_ARRAY(m_szSearchPattern), szPattern);
+	m_wildcardPattern = WildcardPattern(m_szSearchPattern, !m_bCaseInsensitive);
 
 	InitializeCriticalSection(&m_csStop);
 	m_bStopSearching = FALSE;
@@ -1139,8 +1140,7 @@ void Search::SearchDirectoryInternal(const TCHAR *szSearchDirectory,
 					}
 					else
 					{
-						if (CheckWildcardMatch(m_szSearchPattern, wfd.cFileName,
-								!m_bCaseInsensitive))
+						if (m_wildcardPattern.Match(wfd.cFileName))
 						{
 							bMatchFileName = TRUE;
 						}
@@ -8,6 +8,7 @@
 #include "../Helper/DialogSettings.h"
 #include "../Helper/FileContextMenuManager.h"
 #include "../Helper/ReferenceCount.h"
+#include "../Helper/WildcardPattern.h"
 #include <boost/circular_buffer.hpp>
 #include <MsXml2.h>
 #include <objbase.h>
@@ -125,6 +126,7 @@ private:
 	BOOL m_bSearchSubFolders;
 
 	std::wregex m_rxPattern;
+	WildcardPattern m_wildcardPattern;
 
 	CRITICAL_SECTION m_csStop;
 	BOOL m_bStopSearching;
@@ -15,6 +15,7 @@
 #include "WebBrowserApp.h"
 #include "../Helper/IconFetcher.h"
 #include "../Helper/ListViewHelper.h"
+#include "../Helper/Logging.h"
 #include "../Helper/Macros.h"
 #include "../Helper/ShellHelper.h"
 #include "../Helper/WinRTBaseWrapper.h"
@@ -48,8 +49,7 @@ HRESULT ShellBrowser::BrowseFolder(PCIDLIST_ABSOLUTE pidlDirectory, bool addHist
 
 	m_navigationStartedSignal(pidlDirectory);
 
-	std::vector<ItemInfo_t> items;
-	HRESULT hr = EnumerateFolder(pidlDirectory, addHistoryEntry, items);
+	HRESULT hr = EnumerateFolder(pidlDirectory, addHistoryEntry);
 
 	if (FAILED(hr))
 	{
@@ -57,8 +57,6 @@ HRESULT ShellBrowser::BrowseFolder(PCIDLIST_ABSOLUTE pidlDirectory, bool addHist
 		return hr;
 	}
 
-	OnEnumerationCompleted(std::move(items));
-
 	return hr;
 }
 
@@ -90,20 +88,41 @@ void ShellBrowser::PrepareToChangeFolders()
 	{
 		ResetFolderState();
 	}
+
+	ResetGroups();
 }
 
 void ShellBrowser::ClearPendingResults()
 {
-	m_columnThreadPool.clear_queue();
-	m_columnResults.clear();
+	CancelEnumeration();
+
+	auto columnTaskStats = m_columnTaskScheduler.GetStats();
+	LOG(debug) << L"Column tasks: " << columnTaskStats.numTasksRun << L" run, "
+			   << columnTaskStats.numTasksDropped << L" dropped, "
+			   << columnTaskStats.numTasksWasted << L" wasted, peak queue depth "
+			   << columnTaskStats.peakQueueDepth;
+
+	CancelColumnTasks();
 
 	m_iconFetcher->ClearQueue();
 
-	m_thumbnailThreadPool.clear_queue();
-	m_thumbnailResults.clear();
+	auto thumbnailTaskStats = m_thumbnailTaskScheduler.GetStats();
+	LOG(debug) << L"Thumbnail tasks: " << thumbnailTaskStats.numTasksRun << L" run, "
+			   << thumbnailTaskStats.numTasksDropped << L" dropped, "
+			   << thumbnailTaskStats.numTasksWasted << L" wasted, peak queue depth "
+			   << thumbnailTaskStats.peakQueueDepth;
+
+	CancelThumbnailTasks();
+
+	LOG(debug) << L"Thumbnails: " << m_thumbnailImageStore.GetNumItemThumbnails() << L" held, "
+			   << m_thumbnailImageStore.GetMemoryUsage() / 1024 << L" KB used, "
+			   << m_thumbnailImageStore.GetNumEvictions() << L" evicted";
 
 	m_infoTipsThreadPool.clear_queue();
 	m_infoTipResults.clear();
+
+	CancelGroupTasks();
+	CancelFolderSizeTasks();
 }
 
 void ShellBrowser::ResetFolderState()
@@ -114,11 +133,8 @@ void ShellBrowser::ResetFolderState()
 	{
 		auto himlOld = ListView_GetImageList(m_hListView, LVSIL_NORMAL);
 
-		int nItems = ListView_GetItemCount(m_hListView);
-
 		/* Create and set the new imagelist. */
-		HIMAGELIST himl = ImageList_Create(THUMBNAIL_ITEM_WIDTH, THUMBNAIL_ITEM_HEIGHT, ILC_COLOR32,
-			nItems, nItems + 100);
+		HIMAGELIST himl = CreateThumbnailsImageList();
 		ListView_SetImageList(m_hListView, himl, LVSIL_NORMAL);
 
 		ImageList_Destroy(himlOld);
@@ -130,7 +146,7 @@ void ShellBrowser::ResetFolderState()
 	m_AlteredList.clear();
 	LeaveCriticalSection(&m_csDirectoryAltered);
 
-	m_itemInfoMap.clear();
+	m_itemStore.Clear();
 
 	m_renamedItemOldPidl.reset();
 }
@@ -148,8 +164,7 @@ void ShellBrowser::StoreCurrentlySelectedItems()
 	entry->SetSelectedItems(selectedItems);
 }
 
-HRESULT ShellBrowser::EnumerateFolder(PCIDLIST_ABSOLUTE pidlDirectory, bool addHistoryEntry,
-	std::vector<ShellBrowser::ItemInfo_t> &items)
+HRESULT ShellBrowser::EnumerateFolder(PCIDLIST_ABSOLUTE pidlDirectory, bool addHistoryEntry)
 {
 	wil::com_ptr_nothrow<IShellFolder> parent;
 	PCITEMID_CHILD child;
@@ -184,13 +199,13 @@ HRESULT ShellBrowser::EnumerateFolder(PCIDLIST_ABSOLUTE pidlDirectory, bool addH
 		return hr;
 	}
 
-	SHCONTF enumFlags = SHCONTF_FOLDERS | SHCONTF_NONFOLDERS;
-
-	if (m_folderSettings.showHidden)
-	{
-		WI_SetAllFlags(enumFlags, SHCONTF_INCLUDEHIDDEN | SHCONTF_INCLUDESUPERHIDDEN);
-	}
+	SHCONTF enumFlags = GetEnumerationFlags();
 
+	// The enumeration itself is performed on a background thread. However, the enumerator is
+	// created here as well, since doing so allows the shell to display any UI it needs (e.g. to
+	// request credentials for a network location) and means that a folder that can't be
+	// enumerated will result in the navigation failing, rather than silently showing no items.
+	// The background thread will then create its own enumerator, without an owner window.
 	wil::com_ptr_nothrow<IEnumIDList> enumerator;
 	hr = shellFolder->EnumObjects(m_hOwner, enumFlags, &enumerator);
 
@@ -199,6 +214,8 @@ HRESULT ShellBrowser::EnumerateFolder(PCIDLIST_ABSOLUTE pidlDirectory, bool addH
 		return hr;
 	}
 
+	enumerator.reset();
+
 	PrepareToChangeFolders();
 
 	m_directoryState.pidlDirectory.reset(ILCloneFull(pidlDirectory));
@@ -214,22 +231,202 @@ HRESULT ShellBrowser::EnumerateFolder(PCIDLIST_ABSOLUTE pidlDirectory, bool addH
 	// otherwise requests could still come in for the previous directory.
 	NotifyShellOfNavigation(pidlDirectory);
 
+	m_bFolderVisited = TRUE;
+
 	m_navigationCommittedSignal(pidlDirectory, addHistoryEntry);
 
+	auto context = std::make_shared<EnumerationContext>();
+	context->pidlDirectory.reset(ILCloneFull(pidlDirectory));
+	context->enumFlags = enumFlags;
+	context->isRecycleBin = IsRecycleBin(pidlDirectory);
+	m_enumerationContext = context;
+
+	m_enumerationThreadPool.push(
+		[listView = m_hListView, folderId = m_uniqueFolderId, context](int id)
+		{
+			UNREFERENCED_PARAMETER(id);
+
+			EnumerateFolderAsync(listView, folderId, context);
+		});
+
+	return hr;
+}
+
+SHCONTF ShellBrowser::GetEnumerationFlags() const
+{
+	SHCONTF enumFlags = SHCONTF_FOLDERS | SHCONTF_NONFOLDERS;
+
+	if (m_folderSettings.showHidden)
+	{
+		WI_SetAllFlags(enumFlags, SHCONTF_INCLUDEHIDDEN | SHCONTF_INCLUDESUPERHIDDEN);
+	}
+
+	return enumFlags;
+}
+
+void ShellBrowser::EnumerateFolderAsync(HWND listView, int folderId,
+	std::shared_ptr<EnumerationContext> context)
+{
+	std::vector<ItemInfo_t> items;
+
+	// Regardless of how the enumeration finishes, the UI thread needs to be told, so that the
+	// navigation can be completed.
+	auto sendRemainingItems = wil::scope_exit(
+		[listView, folderId, &context, &items]
+		{
+			SendEnumeratedItems(listView, folderId, *context, items, true);
+		});
+
+	wil::com_ptr_nothrow<IShellFolder> shellFolder;
+	HRESULT hr = BindToIdl(context->pidlDirectory.get(), IID_PPV_ARGS(&shellFolder));
+
+	if (FAILED(hr))
+	{
+		return;
+	}
+
+	wil::com_ptr_nothrow<IEnumIDList> enumerator;
+	hr = shellFolder->EnumObjects(nullptr, context->enumFlags, &enumerator);
+
+	if (FAILED(hr) || !enumerator)
+	{
+		return;
+	}
+
+	auto stopToken = context->stopSource.get_token();
+	size_t batchSize = ENUMERATION_INITIAL_BATCH_SIZE;
+	auto lastSendTime = std::chrono::steady_clock::now();
+
 	ULONG numFetched = 1;
 	unique_pidl_child pidlItem;
 
-	while (enumerator->Next(1, wil::out_param(pidlItem), &numFetched) == S_OK && (numFetched == 1))
+	while (!stopToken.stop_requested())
 	{
-		auto item = GetItemInformation(shellFolder.get(), pidlDirectory, pidlItem.get());
+		hr = enumerator->Next(1, wil::out_param(pidlItem), &numFetched);
+
+		if (hr != S_OK || numFetched != 1)
+		{
+			break;
+		}
+
+		auto item = GetItemInformation(shellFolder.get(), context->pidlDirectory.get(),
+			pidlItem.get(), context->isRecycleBin);
 
 		if (item)
 		{
 			items.push_back(std::move(*item));
 		}
+
+		auto now = std::chrono::steady_clock::now();
+
+		if (items.size() >= batchSize
+			|| (!items.empty() && (now - lastSendTime) >= ENUMERATION_BATCH_INTERVAL))
+		{
+			SendEnumeratedItems(listView, folderId, *context, items, false);
+
+			batchSize *= 2;
+			lastSendTime = now;
+		}
 	}
 
-	return hr;
+	if (hr == S_FALSE && !stopToken.stop_requested())
+	{
+		std::scoped_lock lock(context->mutex);
+		context->enumeratedAllItems = true;
+	}
+}
+
+void ShellBrowser::SendEnumeratedItems(HWND listView, int folderId, EnumerationContext &context,
+	std::vector<ItemInfo_t> &items, bool completed)
+{
+	bool postNotification;
+
+	{
+		std::scoped_lock lock(context.mutex);
+
+		std::move(items.begin(), items.end(), std::back_inserter(context.items));
+		context.completed = completed;
+
+		// If the UI thread hasn't yet processed the last notification, there's no need to post
+		// another one. When the last notification is processed, all available items will be
+		// retrieved.
+		postNotification = !context.notificationPending;
+		context.notificationPending = true;
+	}
+
+	items.clear();
+
+	if (postNotification)
+	{
+		PostMessage(listView, WM_APP_ENUMERATION_RESULT_READY, folderId, 0);
+	}
+}
+
+void ShellBrowser::ProcessEnumerationResult(int folderId)
+{
+	if (folderId != m_uniqueFolderId)
+	{
+		// This result is for a previous folder. It can be ignored.
+		return;
+	}
+
+	if (m_resyncContext)
+	{
+		ProcessResyncResult();
+		return;
+	}
+
+	if (!m_enumerationContext)
+	{
+		return;
+	}
+
+	std::vector<ItemInfo_t> items;
+	bool completed;
+
+	{
+		std::scoped_lock lock(m_enumerationContext->mutex);
+
+		items.swap(m_enumerationContext->items);
+		completed = m_enumerationContext->completed;
+		m_enumerationContext->notificationPending = false;
+	}
+
+	InsertEnumeratedItems(std::move(items));
+
+	if (completed)
+	{
+		m_enumerationContext.reset();
+
+		OnEnumerationCompleted();
+	}
+}
+
+void ShellBrowser::CancelEnumeration()
+{
+	if (!m_enumerationContext && !m_resyncContext)
+	{
+		return;
+	}
+
+	// The background thread only holds a reference to the context, so it can safely continue to
+	// run until it notices the stop request. Any results it sends after this point will be
+	// ignored.
+	for (auto *context : { &m_enumerationContext, &m_resyncContext })
+	{
+		if (*context)
+		{
+			(*context)->stopSource.request_stop();
+			context->reset();
+		}
+	}
+
+	m_enumerationThreadPool.clear_queue();
+}
+
+bool ShellBrowser::IsEnumerationInProgress() const
+{
+	return m_enumerationContext != nullptr;
 }
 
 void ShellBrowser::NotifyShellOfNavigation(PCIDLIST_ABSOLUTE pidl)
@@ -379,7 +576,7 @@ std::optional<int> ShellBrowser::AddItemInternal(IShellFolder *shellFolder,
 int ShellBrowser::AddItemInternal(int itemIndex, ItemInfo_t itemInfo, BOOL setPosition)
 {
 	int itemId = GenerateUniqueItemId();
-	m_itemInfoMap.insert({ itemId, std::move(itemInfo) });
+	m_itemStore.Insert(itemId, std::move(itemInfo));
 
 	AwaitingAdd_t awaitingAdd;
 
@@ -396,14 +593,29 @@ int ShellBrowser::AddItemInternal(int itemIndex, ItemInfo_t itemInfo, BOOL setPo
 	awaitingAdd.iItemInternal = itemId;
 	awaitingAdd.bPosition = setPosition;
 	awaitingAdd.iAfter = itemIndex - 1;
+	awaitingAdd.insertSorted = false;
 
 	m_directoryState.awaitingAddList.push_back(awaitingAdd);
 
 	return itemId;
 }
 
-std::optional<ShellBrowser::ItemInfo_t> ShellBrowser::GetItemInformation(IShellFolder *shellFolder,
+std::optional<ItemInfo_t> ShellBrowser::GetItemInformation(IShellFolder *shellFolder,
 	PCIDLIST_ABSOLUTE pidlDirectory, PCITEMID_CHILD pidlChild)
+{
+	return GetItemInformation(shellFolder, pidlDirectory, pidlChild, IsRecycleBin(pidlDirectory));
+}
+
+bool ShellBrowser::IsRecycleBin(PCIDLIST_ABSOLUTE pidl) const
+{
+	return m_recycleBinPidl
+		&& m_desktopFolder->CompareIDs(SHCIDS_CANONICALONLY, pidl, m_recycleBinPidl.get()) == 0;
+}
+
+// Note that this function may be called from a background thread, so it shouldn't access any
+// instance state.
+std::optional<ItemInfo_t> ShellBrowser::GetItemInformation(IShellFolder *shellFolder,
+	PCIDLIST_ABSOLUTE pidlDirectory, PCITEMID_CHILD pidlChild, bool isRecycleBin)
 {
 	ItemInfo_t itemInfo;
 
@@ -433,10 +645,6 @@ std::optional<ShellBrowser::ItemInfo_t> ShellBrowser::GetItemInformation(IShellF
 
 	SHGDNF displayNameFlags = SHGDN_INFOLDER;
 
-	bool isRecycleBin = m_recycleBinPidl
-		&& m_desktopFolder->CompareIDs(SHCIDS_CANONICALONLY, pidlDirectory, m_recycleBinPidl.get())
-			== 0;
-
 	// SHGDN_INFOLDER | SHGDN_FORPARSING is used to ensure that the name retrieved for a filesystem
 	// file contains an extension, even if extensions are hidden in Windows Explorer. When using
 	// SHGDN_INFOLDER by itself, the resulting name won't contain an extension if extensions are
@@ -472,7 +680,6 @@ std::optional<ShellBrowser::ItemInfo_t> ShellBrowser::GetItemInformation(IShellF
 	if (PathIsRoot(parsingName.c_str()))
 	{
 		itemInfo.bDrive = TRUE;
-		StringCchCopy(itemInfo.szDrive, SIZEOF_ARRAY(itemInfo.szDrive), parsingName.c_str());
 	}
 	else
 	{
@@ -553,8 +760,15 @@ HRESULT ShellBrowser::ExtractFindDataUsingPropertyStore(IShellFolder *shellFolde
 	return hr;
 }
 
-void ShellBrowser::OnEnumerationCompleted(std::vector<ShellBrowser::ItemInfo_t> &&items)
+void ShellBrowser::InsertEnumeratedItems(std::vector<ItemInfo_t> &&items)
 {
+	if (items.empty())
+	{
+		return;
+	}
+
+	bool firstBatch = (m_directoryState.numItems == 0);
+
 	for (auto &item : items)
 	{
 		AddItemInternal(-1, std::move(item), FALSE);
@@ -565,17 +779,35 @@ void ShellBrowser::OnEnumerationCompleted(std::vector<ShellBrowser::ItemInfo_t>
 	(reduces lag when a large number of items are going to be inserted). */
 	SendMessage(m_hListView, WM_SETREDRAW, FALSE, NULL);
 
-	InsertAwaitingItems(FALSE);
+	// The groups were reset when navigating to the folder, so each item can be placed directly
+	// into its group here. The existing items then won't have to be regrouped when the folder is
+	// sorted below.
+	InsertAwaitingItems(m_folderSettings.showInGroups);
 
 	SortFolder(m_folderSettings.sortMode);
 
-	ListView_EnsureVisible(m_hListView, 0, FALSE);
+	if (firstBatch)
+	{
+		ListView_EnsureVisible(m_hListView, 0, FALSE);
+	}
 
 	/* Allow the listview to redraw itself once again. */
 	SendMessage(m_hListView, WM_SETREDRAW, TRUE, NULL);
 
-	/* Set the focus back to the first item. */
-	ListView_SetItemState(m_hListView, 0, LVIS_FOCUSED, LVIS_FOCUSED);
+	if (firstBatch)
+	{
+		/* Set the focus back to the first item. */
+		ListView_SetItemState(m_hListView, 0, LVIS_FOCUSED, LVIS_FOCUSED);
+	}
+
+	SelectPendingItems();
+
+	directoryModified.m_signal();
+}
+
+void ShellBrowser::OnEnumerationCompleted()
+{
+	m_directoryState.pendingSelection.clear();
 
 	if (m_config->shellChangeNotificationType == ShellChangeNotificationType::All
 		|| (m_config->shellChangeNotificationType == ShellChangeNotificationType::NonFilesystem
@@ -584,8 +816,6 @@ void ShellBrowser::OnEnumerationCompleted(std::vector<ShellBrowser::ItemInfo_t>
 		StartDirectoryMonitoring(m_directoryState.pidlDirectory.get());
 	}
 
-	m_bFolderVisited = TRUE;
-
 	m_navigationCompletedSignal(m_directoryState.pidlDirectory.get());
 }
 
@@ -600,6 +830,14 @@ void ShellBrowser::InsertAwaitingItems(BOOL bInsertIntoGroup)
 		return;
 	}
 
+	auto sortedItems = DetermineSortedPositionsForAwaitingItems();
+
+	if (m_virtualListView)
+	{
+		InsertAwaitingItemsIntoVirtualList(bInsertIntoGroup, std::move(sortedItems));
+		return;
+	}
+
 	/* Make the listview allocate space (for internal data structures)
 	for all the items at once, rather than individually.
 	Acts as a speed optimization. */
@@ -615,15 +853,14 @@ void ShellBrowser::InsertAwaitingItems(BOOL bInsertIntoGroup)
 
 	for (const auto &awaitingItem : m_directoryState.awaitingAddList)
 	{
-		const auto &itemInfo = m_itemInfoMap.at(awaitingItem.iItemInternal);
-
-		if (IsFileFiltered(itemInfo))
+		if (IsFileFiltered(awaitingItem.iItemInternal))
 		{
 			m_directoryState.filteredItemsList.insert(awaitingItem.iItemInternal);
 			continue;
 		}
 
-		BasicItemInfo_t basicItemInfo = getBasicItemInfo(awaitingItem.iItemInternal);
+		BasicItemInfo_t basicItemInfo =
+			m_itemStore.GetBasicItemInfo(awaitingItem.iItemInternal, false);
 		std::wstring filename = ProcessItemFileName(basicItemInfo, m_config->globalFolderSettings);
 
 		LVITEM lv;
@@ -660,6 +897,13 @@ void ShellBrowser::InsertAwaitingItems(BOOL bInsertIntoGroup)
 		/* Insert the item into the list view control. */
 		int iItemIndex = ListView_InsertItem(m_hListView, &lv);
 
+		// Items that are inserted in their sorted position will be added to the index below.
+		// Inserting any other item means that the index no longer reflects the order of the items.
+		if (!awaitingItem.insertSorted)
+		{
+			m_directoryState.sortedItemIndex.Invalidate();
+		}
+
 		if (awaitingItem.bPosition && m_folderSettings.viewMode != +ViewMode::Details)
 		{
 			POINT ptItem;
@@ -684,13 +928,14 @@ void ShellBrowser::InsertAwaitingItems(BOOL bInsertIntoGroup)
 		}
 
 		if (m_queuedRenameItem
-			&& ArePidlsEquivalent(itemInfo.pidlComplete.get(), m_queuedRenameItem.get()))
+			&& ArePidlsEquivalent(m_itemStore.GetPidlComplete(awaitingItem.iItemInternal),
+				m_queuedRenameItem.get()))
 		{
 			itemToRename = iItemIndex;
 		}
 
 		/* If the file is marked as hidden, ghost it out. */
-		if (itemInfo.wfd.dwFileAttributes & FILE_ATTRIBUTE_HIDDEN)
+		if (m_itemStore.GetAttributes(awaitingItem.iItemInternal) & FILE_ATTRIBUTE_HIDDEN)
 		{
 			ListView_SetItemState(m_hListView, iItemIndex, LVIS_CUT, LVIS_CUT);
 		}
@@ -698,11 +943,7 @@ void ShellBrowser::InsertAwaitingItems(BOOL bInsertIntoGroup)
 		/* Add the current file's size to the running size of the current directory. */
 		/* A folder may or may not have 0 in its high file size member.
 		It should either be zeroed, or never counted. */
-		ULARGE_INTEGER ulFileSize;
-		ulFileSize.LowPart = itemInfo.wfd.nFileSizeLow;
-		ulFileSize.HighPart = itemInfo.wfd.nFileSizeHigh;
-
-		m_directoryState.totalDirSize += ulFileSize.QuadPart;
+		m_directoryState.totalDirSize += m_itemStore.GetFileSize(awaitingItem.iItemInternal);
 
 		nAdded++;
 	}
@@ -714,6 +955,8 @@ void ShellBrowser::InsertAwaitingItems(BOOL bInsertIntoGroup)
 
 	m_directoryState.numItems = nPrevItems + nAdded;
 
+	m_directoryState.sortedItemIndex.Insert(std::move(sortedItems));
+
 	PositionDroppedItems();
 
 	m_directoryState.awaitingAddList.clear();
@@ -725,21 +968,112 @@ void ShellBrowser::InsertAwaitingItems(BOOL bInsertIntoGroup)
 	}
 }
 
-BOOL ShellBrowser::IsFileFiltered(const ItemInfo_t &itemInfo) const
+// In owner data mode, nothing is inserted into the listview itself. Instead, the items are added
+// to the list of displayed items and the listview is simply told how many items there are.
+void ShellBrowser::InsertAwaitingItemsIntoVirtualList(BOOL bInsertIntoGroup,
+	std::vector<SortedItemIndex::NewItem> sortedItems)
+{
+	std::vector<int> items = m_directoryState.virtualList.items;
+	items.reserve(items.size() + m_directoryState.awaitingAddList.size());
+
+	int nAdded = 0;
+	std::optional<int> itemToRename;
+
+	for (const auto &awaitingItem : m_directoryState.awaitingAddList)
+	{
+		if (IsFileFiltered(awaitingItem.iItemInternal))
+		{
+			m_directoryState.filteredItemsList.insert(awaitingItem.iItemInternal);
+			continue;
+		}
+
+		// Items that are inserted in their sorted position are merged in below.
+		if (!awaitingItem.insertSorted)
+		{
+			auto position = min(static_cast<size_t>(max(awaitingItem.iItem, 0)), items.size());
+			items.insert(items.begin() + position, awaitingItem.iItemInternal);
+
+			m_directoryState.sortedItemIndex.Invalidate();
+		}
+
+		if (m_queuedRenameItem
+			&& ArePidlsEquivalent(m_itemStore.GetPidlComplete(awaitingItem.iItemInternal),
+				m_queuedRenameItem.get()))
+		{
+			itemToRename = awaitingItem.iItemInternal;
+		}
+
+		m_directoryState.totalDirSize += m_itemStore.GetFileSize(awaitingItem.iItemInternal);
+
+		nAdded++;
+	}
+
+	m_directoryState.numItems += nAdded;
+	m_directoryState.awaitingAddList.clear();
+
+	// The positions of the sorted items are in ascending order, so they can all be merged in a
+	// single pass, rather than being inserted individually.
+	if (!sortedItems.empty())
+	{
+		std::vector<int> mergedItems;
+		mergedItems.reserve(items.size() + sortedItems.size());
+
+		auto itr = items.begin();
+
+		for (const auto &sortedItem : sortedItems)
+		{
+			while (mergedItems.size() < sortedItem.position && itr != items.end())
+			{
+				mergedItems.push_back(*itr);
+				++itr;
+			}
+
+			mergedItems.push_back(sortedItem.item);
+		}
+
+		mergedItems.insert(mergedItems.end(), itr, items.end());
+		items = std::move(mergedItems);
+	}
+
+	m_directoryState.sortedItemIndex.Insert(std::move(sortedItems));
+
+	SetVirtualListItems(std::move(items));
+
+	// Groups can't be displayed in owner data mode. However, the items are still ordered by group,
+	// which requires the list to be sorted again.
+	if (bInsertIntoGroup)
+	{
+		SortListViewItems();
+	}
+
+	if (itemToRename)
+	{
+		m_queuedRenameItem.reset();
+
+		auto index = LocateItemByInternalIndex(*itemToRename);
+
+		if (index)
+		{
+			ListView_EditLabel(m_hListView, *index);
+		}
+	}
+}
+
+BOOL ShellBrowser::IsFileFiltered(int internalIndex) const
 {
 	BOOL bHideSystemFile = FALSE;
 	BOOL bFilenameFiltered = FALSE;
+	DWORD attributes = m_itemStore.GetAttributes(internalIndex);
 
 	if (m_folderSettings.applyFilter
-		&& ((itemInfo.wfd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != FILE_ATTRIBUTE_DIRECTORY))
+		&& ((attributes & FILE_ATTRIBUTE_DIRECTORY) != FILE_ATTRIBUTE_DIRECTORY))
 	{
-		bFilenameFiltered = IsFilenameFiltered(itemInfo.displayName.c_str());
+		bFilenameFiltered = IsFilenameFiltered(m_itemStore.GetDisplayName(internalIndex).data());
 	}
 
 	if (m_config->globalFolderSettings.hideSystemFiles)
 	{
-		bHideSystemFile =
-			(itemInfo.wfd.dwFileAttributes & FILE_ATTRIBUTE_SYSTEM) == FILE_ATTRIBUTE_SYSTEM;
+		bHideSystemFile = (attributes & FILE_ATTRIBUTE_SYSTEM) == FILE_ATTRIBUTE_SYSTEM;
 	}
 
 	return bFilenameFiltered || bHideSystemFile;
@@ -747,52 +1081,96 @@ BOOL ShellBrowser::IsFileFiltered(const ItemInfo_t &itemInfo) const
 
 void ShellBrowser::RemoveItem(int iItemInternal)
 {
-	ULARGE_INTEGER ulFileSize;
-	LVFINDINFO lvfi;
-	int iItem;
-	int nItems;
-
 	if (iItemInternal == -1)
 	{
 		return;
 	}
 
-	/* Take the file size of the removed file away from the total
-	directory size. */
-	ulFileSize.LowPart = m_itemInfoMap.at(iItemInternal).wfd.nFileSizeLow;
-	ulFileSize.HighPart = m_itemInfoMap.at(iItemInternal).wfd.nFileSizeHigh;
+	RemoveItems({ iItemInternal });
+}
 
-	m_directoryState.totalDirSize -= ulFileSize.QuadPart;
+// In owner data mode, the list of displayed items is only rebuilt once, after all the items have
+// been located, rather than once per item.
+void ShellBrowser::RemoveItems(const std::vector<int> &internalIndexes)
+{
+	if (internalIndexes.empty())
+	{
+		return;
+	}
 
-	/* Locate the item within the listview.
-	Could use filename, providing removed
-	items are always deleted before new
-	items are inserted. */
-	lvfi.flags = LVFI_PARAM;
-	lvfi.lParam = iItemInternal;
-	iItem = ListView_FindItem(m_hListView, -1, &lvfi);
+	InsertAddedItems();
 
-	if (iItem != -1)
+	std::unordered_set<int> removedItems;
+
+	for (int iItemInternal : internalIndexes)
 	{
-		if (m_folderSettings.showInGroups)
+		/* Take the file size of the removed file away from the total
+		directory size. */
+		m_directoryState.totalDirSize -= m_itemStore.GetFileSize(iItemInternal);
+
+		if (m_virtualListView)
 		{
-			auto groupId = GetItemGroupId(iItem);
+			if (GetVirtualListItemPosition(iItemInternal))
+			{
+				removedItems.insert(iItemInternal);
+			}
 
-			if (groupId)
+			continue;
+		}
+
+		/* Locate the item within the listview.
+		Could use filename, providing removed
+		items are always deleted before new
+		items are inserted. */
+		LVFINDINFO lvfi;
+		lvfi.flags = LVFI_PARAM;
+		lvfi.lParam = iItemInternal;
+		int iItem = ListView_FindItem(m_hListView, -1, &lvfi);
+
+		if (iItem != -1)
+		{
+			if (m_folderSettings.showInGroups)
 			{
-				OnItemRemovedFromGroup(*groupId);
+				auto groupId = GetItemGroupId(iItem);
+
+				if (groupId)
+				{
+					OnItemRemovedFromGroup(*groupId);
+				}
 			}
+
+			removedItems.insert(iItemInternal);
+
+			/* Remove the item from the listview. */
+			ListView_DeleteItem(m_hListView, iItem);
 		}
+	}
+
+	m_directoryState.sortedItemIndex.Remove(removedItems);
 
-		/* Remove the item from the listview. */
-		ListView_DeleteItem(m_hListView, iItem);
+	if (m_virtualListView && !removedItems.empty())
+	{
+		RemoveVirtualListItems(removedItems);
 	}
 
-	m_itemInfoMap.erase(iItemInternal);
+	for (int iItemInternal : internalIndexes)
+	{
+		if (m_virtualListView)
+		{
+			RemoveVirtualListItemData(iItemInternal);
+		}
 
-	nItems = ListView_GetItemCount(m_hListView);
+		m_directoryState.columnTextCache.InvalidateItem(iItemInternal);
+		m_directoryState.itemColors.erase(iItemInternal);
+		m_directoryState.itemGroupIds.erase(iItemInternal);
+		m_directoryState.pendingGroupResultIds.erase(iItemInternal);
+		m_thumbnailImageStore.RemoveItem(iItemInternal);
+		m_directoryState.cachedFolderSizes.erase(iItemInternal);
+		m_directoryState.pendingFolderSizeResultIds.erase(iItemInternal);
+		m_itemStore.Erase(iItemInternal);
 
-	m_directoryState.numItems--;
+		m_directoryState.numItems--;
+	}
 }
 
 ShellNavigationController *ShellBrowser::GetNavigationController() const
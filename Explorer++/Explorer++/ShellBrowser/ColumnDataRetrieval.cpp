@@ -9,7 +9,6 @@
 #include "ItemData.h"
 #include "../Helper/DriveInfo.h"
 #include "../Helper/FileOperations.h"
-#include "../Helper/FolderSize.h"
 #include "../Helper/Helper.h"
 #include "../Helper/Macros.h"
 #include "../Helper/StringHelper.h"
@@ -17,9 +16,13 @@
 #include <wil/com.h>
 #include <IPHlpApi.h>
 #include <propkey.h>
+#include <propvarutil.h>
 #include <filesystem>
 
 BOOL GetPrinterStatusDescription(DWORD dwStatus, TCHAR *szStatus, size_t cchMax);
+const PROPERTYKEY *GetColumnPropertyKey(ColumnType columnType);
+std::wstring ConvertPropertyToColumnText(const PROPVARIANT &property,
+	const GlobalFolderSettings &globalFolderSettings);
 
 std::wstring GetColumnText(ColumnType columnType, const BasicItemInfo_t &basicItemInfo,
 	const GlobalFolderSettings &globalFolderSettings)
@@ -182,6 +185,110 @@ std::wstring GetColumnText(ColumnType columnType, const BasicItemInfo_t &basicIt
 	return EMPTY_STRING;
 }
 
+std::vector<std::wstring> GetColumnTextForRow(const std::vector<ColumnType> &columnTypes,
+	const BasicItemInfo_t &basicItemInfo, const GlobalFolderSettings &globalFolderSettings)
+{
+	std::vector<std::wstring> columnText(columnTypes.size());
+	std::vector<size_t> propertyColumns;
+
+	for (size_t i = 0; i < columnTypes.size(); i++)
+	{
+		if (GetColumnPropertyKey(columnTypes[i]))
+		{
+			propertyColumns.push_back(i);
+		}
+		else
+		{
+			columnText[i] = GetColumnText(columnTypes[i], basicItemInfo, globalFolderSettings);
+		}
+	}
+
+	if (propertyColumns.empty())
+	{
+		return columnText;
+	}
+
+	wil::com_ptr_nothrow<IPropertyStore> propertyStore;
+	HRESULT hr = SHGetPropertyStoreFromIDList(basicItemInfo.pidlComplete.get(), GPS_DEFAULT,
+		IID_PPV_ARGS(&propertyStore));
+
+	if (FAILED(hr))
+	{
+		// If the item doesn't provide a property store, the properties will be retrieved from the
+		// parent folder instead.
+		for (size_t index : propertyColumns)
+		{
+			columnText[index] = GetItemDetailsColumnText(basicItemInfo,
+				GetColumnPropertyKey(columnTypes[index]), globalFolderSettings);
+		}
+
+		return columnText;
+	}
+
+	for (size_t index : propertyColumns)
+	{
+		wil::unique_prop_variant property;
+		hr = propertyStore->GetValue(*GetColumnPropertyKey(columnTypes[index]), &property);
+
+		if (SUCCEEDED(hr))
+		{
+			columnText[index] = ConvertPropertyToColumnText(property, globalFolderSettings);
+		}
+	}
+
+	return columnText;
+}
+
+// Returns the property that the specified column displays, or nullptr if the column isn't backed by
+// a property that can be read from the item's property store. Note that the recycle bin columns
+// (original location and date deleted) are only provided by the recycle bin folder itself, so
+// they're not included here.
+const PROPERTYKEY *GetColumnPropertyKey(ColumnType columnType)
+{
+	switch (columnType)
+	{
+	case ColumnType::Title:
+		return &PKEY_Title;
+	case ColumnType::Subject:
+		return &PKEY_Subject;
+	case ColumnType::Authors:
+		return &PKEY_Author;
+	case ColumnType::Keywords:
+		return &PKEY_Keywords;
+	case ColumnType::Comment:
+		return &PKEY_Comment;
+
+	default:
+		return nullptr;
+	}
+}
+
+std::wstring ConvertPropertyToColumnText(const PROPVARIANT &property,
+	const GlobalFolderSettings &globalFolderSettings)
+{
+	// The conversion here matches the one performed by IShellFolder2::GetDetailsEx(), so that the
+	// text is the same, regardless of which method was used to retrieve the property.
+	VARIANT variant;
+	HRESULT hr = PropVariantToVariant(&property, &variant);
+
+	if (FAILED(hr))
+	{
+		return EMPTY_STRING;
+	}
+
+	TCHAR szDetail[512];
+	hr = ConvertVariantToString(&variant, szDetail, SIZEOF_ARRAY(szDetail),
+		globalFolderSettings.showFriendlyDates);
+	VariantClear(&variant);
+
+	if (FAILED(hr))
+	{
+		return EMPTY_STRING;
+	}
+
+	return szDetail;
+}
+
 std::wstring GetNameColumnText(const BasicItemInfo_t &itemInfo,
 	const GlobalFolderSettings &globalFolderSettings)
 {
@@ -254,28 +361,11 @@ std::wstring GetSizeColumnText(const BasicItemInfo_t &itemInfo,
 		return L"";
 	}
 
+	// Folder sizes are calculated separately (and only if they're enabled), since calculating the
+	// size of a folder can take a long time. See ShellBrowser::QueueFolderSizeTask().
 	if ((itemInfo.wfd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == FILE_ATTRIBUTE_DIRECTORY)
 	{
-		TCHAR drive[MAX_PATH];
-		StringCchCopy(drive, SIZEOF_ARRAY(drive), itemInfo.getFullPath().c_str());
-		PathStripToRoot(drive);
-
-		bool bNetworkRemovable = false;
-
-		if (GetDriveType(drive) == DRIVE_REMOVABLE || GetDriveType(drive) == DRIVE_REMOTE)
-		{
-			bNetworkRemovable = true;
-		}
-
-		if (globalFolderSettings.showFolderSizes
-			&& !(globalFolderSettings.disableFolderSizesNetworkRemovable && bNetworkRemovable))
-		{
-			return GetFolderSizeColumnText(itemInfo, globalFolderSettings);
-		}
-		else
-		{
-			return EMPTY_STRING;
-		}
+		return EMPTY_STRING;
 	}
 
 	ULARGE_INTEGER fileSize = { itemInfo.wfd.nFileSizeLow, itemInfo.wfd.nFileSizeHigh };
@@ -285,21 +375,34 @@ std::wstring GetSizeColumnText(const BasicItemInfo_t &itemInfo,
 	return FormatSizeString(fileSize.QuadPart, displayFormat);
 }
 
-std::wstring GetFolderSizeColumnText(const BasicItemInfo_t &itemInfo,
+bool ShouldCalculateFolderSize(const std::wstring &folderPath,
 	const GlobalFolderSettings &globalFolderSettings)
 {
-	auto folderInfo = GetFolderInfo(itemInfo.getFullPath());
+	if (!globalFolderSettings.showFolderSizes)
+	{
+		return false;
+	}
+
+	if (!globalFolderSettings.disableFolderSizesNetworkRemovable)
+	{
+		return true;
+	}
+
+	TCHAR drive[MAX_PATH];
+	StringCchCopy(drive, SIZEOF_ARRAY(drive), folderPath.c_str());
+	PathStripToRoot(drive);
 
-	/* TODO: This should
-	be done some other way.
-	Shouldn't depend on
-	the internal index. */
-	// m_cachedFolderSizes.insert({internalIndex, totalFolderSize.QuadPart});
+	UINT driveType = GetDriveType(drive);
+	return driveType != DRIVE_REMOVABLE && driveType != DRIVE_REMOTE;
+}
 
+std::wstring GetFolderSizeColumnText(uint64_t folderSize,
+	const GlobalFolderSettings &globalFolderSettings)
+{
 	SizeDisplayFormat displayFormat = globalFolderSettings.forceSize
 		? globalFolderSettings.sizeDisplayFormat
 		: SizeDisplayFormat::None;
-	return FormatSizeString(folderInfo.size, displayFormat);
+	return FormatSizeString(folderSize, displayFormat);
 }
 
 std::wstring GetTimeColumnText(const BasicItemInfo_t &itemInfo, TimeType timeType,
@@ -6,6 +6,7 @@
 
 #include "Columns.h"
 #include <string>
+#include <vector>
 
 struct BasicItemInfo_t;
 struct GlobalFolderSettings;
@@ -65,6 +66,12 @@ enum class MediaMetadataType
 
 std::wstring GetColumnText(ColumnType columnType, const BasicItemInfo_t &basicItemInfo,
 	const GlobalFolderSettings &globalFolderSettings);
+
+// Retrieves the text for several columns of a single item. All of the columns that are backed by
+// shell properties are read from one property store, rather than the item being bound to once per
+// column. The text is returned in the same order as the column types.
+std::vector<std::wstring> GetColumnTextForRow(const std::vector<ColumnType> &columnTypes,
+	const BasicItemInfo_t &basicItemInfo, const GlobalFolderSettings &globalFolderSettings);
 std::wstring GetNameColumnText(const BasicItemInfo_t &itemInfo,
 	const GlobalFolderSettings &globalFolderSettings);
 std::wstring ProcessItemFileName(const BasicItemInfo_t &itemInfo,
@@ -104,5 +111,7 @@ BOOL GetDriveSpaceColumnRawData(const BasicItemInfo_t &itemInfo, bool TotalSize,
 	ULARGE_INTEGER &DriveSpace);
 std::wstring GetSizeColumnText(const BasicItemInfo_t &itemInfo,
 	const GlobalFolderSettings &globalFolderSettings);
-std::wstring GetFolderSizeColumnText(const BasicItemInfo_t &itemInfo,
+bool ShouldCalculateFolderSize(const std::wstring &folderPath,
+	const GlobalFolderSettings &globalFolderSettings);
+std::wstring GetFolderSizeColumnText(uint64_t folderSize,
 	const GlobalFolderSettings &globalFolderSettings);
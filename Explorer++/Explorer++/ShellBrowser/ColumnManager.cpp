@@ -12,38 +12,162 @@
 #include "ResourceHelper.h"
 #include "SortModes.h"
 #include "ViewModes.h"
+#include "../Helper/Helper.h"
 #include <cassert>
 #include <list>
 
-void ShellBrowser::QueueColumnTask(int itemInternalIndex, ColumnType columnType)
+// Returns the text for the specified column, if it's already been retrieved. Otherwise, a task will
+// be queued to retrieve the text and the listview will be updated once the text is available.
+const std::wstring *ShellBrowser::MaybeGetColumnText(int itemIndex, int internalIndex,
+	ColumnType columnType)
 {
+	const std::wstring *text =
+		m_directoryState.columnTextCache.MaybeGetText(internalIndex, columnType);
+
+	if (text)
+	{
+		return text;
+	}
+
+	// The listview will continue to request the text each time the item is redrawn until the text
+	// has been retrieved, so there's no need to queue another task if one is already in flight.
+	if (!m_directoryState.columnTextCache.IsRequestPending(internalIndex, columnType))
+	{
+		QueueColumnTask(itemIndex, internalIndex, GetColumnTypesToRetrieve());
+	}
+
+	// Some text (e.g. the size of a folder whose size is already known) may have been stored
+	// directly, rather than being retrieved in the background.
+	return m_directoryState.columnTextCache.MaybeGetText(internalIndex, columnType);
+}
+
+// Queues a single task that retrieves the text for each of the specified columns that hasn't
+// already been retrieved or requested. That way, the item only has to be bound to once, rather than
+// once per column. The item index is used to prioritize the task, so that the text for the items
+// that are visible is retrieved first.
+void ShellBrowser::QueueColumnTask(int itemIndex, int itemInternalIndex,
+	std::vector<ColumnType> columnTypes)
+{
+	auto &columnTextCache = m_directoryState.columnTextCache;
+
+	std::erase_if(columnTypes,
+		[&columnTextCache, itemInternalIndex](ColumnType columnType)
+		{
+			return columnTextCache.MaybeGetText(itemInternalIndex, columnType)
+				|| columnTextCache.IsRequestPending(itemInternalIndex, columnType);
+		});
+
+	// The size of a folder is calculated separately, since doing so can take a long time.
+	if (m_itemStore.IsFolder(itemInternalIndex) && std::erase(columnTypes, ColumnType::Size) > 0)
+	{
+		RequestFolderSizeText(itemInternalIndex);
+	}
+
+	if (columnTypes.empty())
+	{
+		return;
+	}
+
+	// Any tasks for items that have been scrolled out of view will be dropped here, before the new
+	// task is queued.
+	UpdateColumnTaskVisibleRange();
+
 	int columnResultID = m_columnResultIDCounter++;
 
+	for (auto columnType : columnTypes)
+	{
+		columnTextCache.SetRequestPending(itemInternalIndex, columnType, columnResultID);
+	}
+
 	BasicItemInfo_t basicItemInfo = getBasicItemInfo(itemInternalIndex);
 	GlobalFolderSettings globalFolderSettings = m_config->globalFolderSettings;
 
-	auto result = m_columnThreadPool.push(
-		[listView = m_hListView, columnResultID, columnType, itemInternalIndex, basicItemInfo,
-			globalFolderSettings](int id)
+	auto task = std::make_shared<std::packaged_task<ColumnResult_t()>>(
+		[listView = m_hListView, columnResultID, columnTypes, itemInternalIndex, basicItemInfo,
+			globalFolderSettings]()
 		{
-			UNREFERENCED_PARAMETER(id);
-
-			return GetColumnTextAsync(listView, columnResultID, columnType, itemInternalIndex,
+			return GetColumnTextAsync(listView, columnResultID, columnTypes, itemInternalIndex,
 				basicItemInfo, globalFolderSettings);
 		});
 
-	// The function call above might finish before this line runs,
-	// but that doesn't matter, as the results won't be processed
-	// until a message posted to the main thread has been handled
+	// The task might finish before it's added to the list of results, but that doesn't matter, as
+	// the results won't be processed until a message posted to the main thread has been handled
 	// (which can only occur after this function has returned).
-	m_columnResults.insert({ columnResultID, std::move(result) });
+	m_columnTaskScheduler.Push(columnResultID, itemIndex,
+		[task]()
+		{
+			(*task)();
+		});
+
+	m_columnResults.insert(
+		{ columnResultID, { itemInternalIndex, std::move(columnTypes), task->get_future() } });
+}
+
+// Returns the columns whose text is retrieved in the background. In the virtual listview, the name
+// is generated directly when the item is displayed, so it's not included.
+std::vector<ColumnType> ShellBrowser::GetColumnTypesToRetrieve() const
+{
+	std::vector<ColumnType> columnTypes;
+
+	int numColumns = Header_GetItemCount(ListView_GetHeader(m_hListView));
+
+	for (int i = 0; i < numColumns; i++)
+	{
+		auto columnType = GetColumnTypeByIndex(i);
+
+		if (!columnType || (m_virtualListView && *columnType == ColumnType::Name))
+		{
+			continue;
+		}
+
+		columnTypes.push_back(*columnType);
+	}
+
+	return columnTypes;
+}
+
+void ShellBrowser::UpdateColumnTaskVisibleRange()
+{
+	int topIndex = ListView_GetTopIndex(m_hListView);
+	int countPerPage = ListView_GetCountPerPage(m_hListView);
+
+	auto droppedTaskIds =
+		m_columnTaskScheduler.SetVisibleRange(topIndex, topIndex + countPerPage - 1);
+
+	// The dropped tasks will never run, so the text for those items will need to be requested
+	// again if the items are scrolled back into view.
+	for (int taskId : droppedTaskIds)
+	{
+		auto itr = m_columnResults.find(taskId);
+
+		if (itr == m_columnResults.end())
+		{
+			continue;
+		}
+
+		for (auto columnType : itr->second.columnTypes)
+		{
+			m_directoryState.columnTextCache.CancelRequest(itr->second.itemInternalIndex,
+				columnType, taskId);
+		}
+
+		m_columnResults.erase(itr);
+	}
+}
+
+void ShellBrowser::CancelColumnTasks()
+{
+	m_columnTaskScheduler.ClearQueue();
+	m_columnResults.clear();
+	m_directoryState.columnTextCache.ClearPendingRequests();
 }
 
 ShellBrowser::ColumnResult_t ShellBrowser::GetColumnTextAsync(HWND listView, int columnResultId,
-	ColumnType columnType, int internalIndex, const BasicItemInfo_t &basicItemInfo,
-	const GlobalFolderSettings &globalFolderSettings)
+	const std::vector<ColumnType> &columnTypes, int internalIndex,
+	const BasicItemInfo_t &basicItemInfo, const GlobalFolderSettings &globalFolderSettings)
 {
-	std::wstring columnText = GetColumnText(columnType, basicItemInfo, globalFolderSettings);
+	std::vector<std::wstring> columnText =
+		GetColumnTextForRow(columnTypes, basicItemInfo, globalFolderSettings);
 
 	// This message may be delivered before this function has returned.
 	// That doesn't actually matter, since the message handler will
@@ -52,8 +176,8 @@ ShellBrowser::ColumnResult_t ShellBrowser::GetColumnTextAsync(HWND listView, int
 
 	ColumnResult_t result;
 	result.itemInternalIndex = internalIndex;
-	result.columnType = columnType;
-	result.columnText = columnText;
+	result.columnTypes = columnTypes;
+	result.columnText = std::move(columnText);
 
 	return result;
 }
@@ -65,37 +189,84 @@ void ShellBrowser::ProcessColumnResult(int columnResultId)
 	if (itr == m_columnResults.end())
 	{
 		// This result is for a previous folder. It can be ignored.
+		m_columnTaskScheduler.RecordWastedTask();
 		return;
 	}
 
-	if (m_folderSettings.viewMode != +ViewMode::Details)
+	auto result = itr->second.result.get();
+	m_columnResults.erase(itr);
+
+	// The item may have been removed, or its text invalidated, since the text was requested, in
+	// which case the result won't be stored.
+	std::vector<ColumnType> updatedColumnTypes;
+
+	for (size_t i = 0; i < result.columnTypes.size(); i++)
+	{
+		if (m_directoryState.columnTextCache.SetText(result.itemInternalIndex,
+				result.columnTypes[i], columnResultId, std::move(result.columnText[i])))
+		{
+			updatedColumnTypes.push_back(result.columnTypes[i]);
+		}
+	}
+
+	if (updatedColumnTypes.empty())
 	{
+		m_columnTaskScheduler.RecordWastedTask();
 		return;
 	}
 
-	auto result = itr->second.get();
+	OnColumnTextUpdated(result.itemInternalIndex, updatedColumnTypes);
+}
 
-	auto index = LocateItemByInternalIndex(result.itemInternalIndex);
+// Updates the listview once the text for the specified columns has been stored.
+void ShellBrowser::OnColumnTextUpdated(int internalIndex,
+	const std::vector<ColumnType> &columnTypes)
+{
+	if (m_virtualListView)
+	{
+		// In owner data mode, the text is requested when the item is drawn, so only the item
+		// itself needs to be redrawn.
+		auto position = GetVirtualListItemPosition(internalIndex);
 
-	if (!index)
+		if (position)
+		{
+			ListView_RedrawItems(m_hListView, *position, *position);
+		}
+
+		return;
+	}
+
+	if (m_folderSettings.viewMode != +ViewMode::Details)
 	{
-		// This is a valid state. The item may simply have been deleted.
 		return;
 	}
 
-	auto columnIndex = GetColumnIndexByType(result.columnType);
+	auto index = LocateItemByInternalIndex(internalIndex);
 
-	if (!columnIndex)
+	if (!index)
 	{
-		// This is also a valid state. The column may have been removed.
+		// This is a valid state. The item may simply have been deleted.
 		return;
 	}
 
-	auto columnText = std::make_unique<TCHAR[]>(result.columnText.size() + 1);
-	StringCchCopy(columnText.get(), result.columnText.size() + 1, result.columnText.c_str());
-	ListView_SetItemText(m_hListView, *index, *columnIndex, columnText.get());
+	for (auto columnType : columnTypes)
+	{
+		auto columnIndex = GetColumnIndexByType(columnType);
 
-	m_columnResults.erase(itr);
+		if (!columnIndex)
+		{
+			// This is also a valid state. The column may have been removed.
+			continue;
+		}
+
+		const std::wstring *text =
+			m_directoryState.columnTextCache.MaybeGetText(internalIndex, columnType);
+		assert(text);
+
+		auto columnText = std::make_unique<TCHAR[]>(text->size() + 1);
+		StringCchCopy(columnText.get(), text->size() + 1, text->c_str());
+		ListView_SetItemText(m_hListView, *index, *columnIndex, columnText.get());
+	}
 }
 
 std::optional<int> ShellBrowser::GetColumnIndexByType(ColumnType columnType) const
@@ -802,6 +973,24 @@ void ShellBrowser::ColumnClicked(int iClickedColumn)
 				sortMode = DetermineColumnSortMode(itr->type);
 				columnType = itr->type;
 
+				// Shift-clicking a column makes it the secondary sort column, which orders items
+				// that are equal under the primary sort column. Shift-clicking the secondary sort
+				// column again clears it.
+				if (IsKeyDown(VK_SHIFT))
+				{
+					std::optional<SortMode> secondarySortMode;
+
+					if (sortMode != m_folderSettings.sortMode
+						&& m_folderSettings.secondarySortMode != sortMode)
+					{
+						secondarySortMode = sortMode;
+					}
+
+					SortFolder(m_folderSettings.sortMode, secondarySortMode);
+
+					break;
+				}
+
 				if (m_previousSortColumn == columnType)
 				{
 					m_folderSettings.sortAscending = !m_folderSettings.sortAscending;
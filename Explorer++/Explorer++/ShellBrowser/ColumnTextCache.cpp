@@ -0,0 +1,146 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "ColumnTextCache.h"
+#include <algorithm>
+#include <utility>
+
+const std::wstring *ColumnTextCache::MaybeGetText(int internalIndex, ColumnType columnType) const
+{
+	const Entry *entry = FindEntry(internalIndex, columnType);
+
+	if (!entry || !entry->text)
+	{
+		return nullptr;
+	}
+
+	return &*entry->text;
+}
+
+bool ColumnTextCache::IsRequestPending(int internalIndex, ColumnType columnType) const
+{
+	const Entry *entry = FindEntry(internalIndex, columnType);
+	return entry && entry->pendingRequestId != NO_REQUEST;
+}
+
+void ColumnTextCache::SetRequestPending(int internalIndex, ColumnType columnType, int requestId)
+{
+	Entry *entry = FindEntry(internalIndex, columnType);
+
+	if (!entry)
+	{
+		m_items[internalIndex].push_back({ columnType, std::nullopt, requestId });
+		return;
+	}
+
+	entry->text.reset();
+	entry->pendingRequestId = requestId;
+}
+
+bool ColumnTextCache::SetText(int internalIndex, ColumnType columnType, int requestId,
+	std::wstring text)
+{
+	Entry *entry = FindEntry(internalIndex, columnType);
+
+	if (!entry || entry->pendingRequestId != requestId)
+	{
+		return false;
+	}
+
+	entry->text = std::move(text);
+	entry->pendingRequestId = NO_REQUEST;
+
+	return true;
+}
+
+void ColumnTextCache::CancelRequest(int internalIndex, ColumnType columnType, int requestId)
+{
+	auto itemItr = m_items.find(internalIndex);
+
+	if (itemItr == m_items.end())
+	{
+		return;
+	}
+
+	// A pending request is never stored alongside text, so the entry can be removed entirely.
+	auto &entries = itemItr->second;
+	std::erase_if(entries,
+		[columnType, requestId](const Entry &entry)
+		{
+			return entry.columnType == columnType && entry.pendingRequestId == requestId;
+		});
+
+	if (entries.empty())
+	{
+		m_items.erase(itemItr);
+	}
+}
+
+void ColumnTextCache::InvalidateItem(int internalIndex)
+{
+	m_items.erase(internalIndex);
+}
+
+void ColumnTextCache::ClearPendingRequests()
+{
+	for (auto itr = m_items.begin(); itr != m_items.end();)
+	{
+		auto &entries = itr->second;
+		std::erase_if(entries,
+			[](const Entry &entry)
+			{
+				return !entry.text;
+			});
+
+		if (entries.empty())
+		{
+			itr = m_items.erase(itr);
+		}
+		else
+		{
+			++itr;
+		}
+	}
+}
+
+void ColumnTextCache::Clear()
+{
+	m_items.clear();
+}
+
+size_t ColumnTextCache::GetNumItems() const
+{
+	return m_items.size();
+}
+
+const ColumnTextCache::Entry *ColumnTextCache::FindEntry(int internalIndex,
+	ColumnType columnType) const
+{
+	auto itemItr = m_items.find(internalIndex);
+
+	if (itemItr == m_items.end())
+	{
+		return nullptr;
+	}
+
+	const auto &entries = itemItr->second;
+	auto itr = std::find_if(entries.begin(), entries.end(),
+		[columnType](const Entry &entry)
+		{
+			return entry.columnType == columnType;
+		});
+
+	if (itr == entries.end())
+	{
+		return nullptr;
+	}
+
+	return &*itr;
+}
+
+ColumnTextCache::Entry *ColumnTextCache::FindEntry(int internalIndex, ColumnType columnType)
+{
+	return const_cast<Entry *>(std::as_const(*this).FindEntry(internalIndex, columnType));
+}
@@ -0,0 +1,66 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include "Columns.h"
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Caches the column text that's been retrieved for the items in a folder, keyed by the item's
+// internal index and the column type. Requests that are still in flight are also tracked, so that
+// the text for a particular item and column is only retrieved once, regardless of how many times
+// the listview asks for it.
+class ColumnTextCache
+{
+public:
+	// Returns the cached text, if it's been retrieved.
+	const std::wstring *MaybeGetText(int internalIndex, ColumnType columnType) const;
+
+	bool IsRequestPending(int internalIndex, ColumnType columnType) const;
+
+	// Records that a request has been made for the specified text. Any text previously cached for
+	// the item and column will be discarded.
+	void SetRequestPending(int internalIndex, ColumnType columnType, int requestId);
+
+	// Stores the result of a request. The result will only be stored if the request is still
+	// current (i.e. the item hasn't been invalidated since the request was made). Returns true if
+	// the result was stored.
+	bool SetText(int internalIndex, ColumnType columnType, int requestId, std::wstring text);
+
+	// Forgets the specified request, if it's still pending. This should be called if the request
+	// is cancelled, so that it can be made again.
+	void CancelRequest(int internalIndex, ColumnType columnType, int requestId);
+
+	// Discards all cached text for the item, along with any pending requests. Results for those
+	// requests will be ignored.
+	void InvalidateItem(int internalIndex);
+
+	// Forgets all pending requests, without affecting any text that's already been retrieved. This
+	// should be called if the requests are cancelled, so that they can be made again.
+	void ClearPendingRequests();
+
+	void Clear();
+
+	size_t GetNumItems() const;
+
+private:
+	static constexpr int NO_REQUEST = -1;
+
+	struct Entry
+	{
+		ColumnType columnType;
+		std::optional<std::wstring> text;
+		int pendingRequestId = NO_REQUEST;
+	};
+
+	const Entry *FindEntry(int internalIndex, ColumnType columnType) const;
+	Entry *FindEntry(int internalIndex, ColumnType columnType);
+
+	// Only a small number of columns are typically shown, so each item's entries are stored in a
+	// vector, which is scanned linearly.
+	std::unordered_map<int, std::vector<Entry>> m_items;
+};
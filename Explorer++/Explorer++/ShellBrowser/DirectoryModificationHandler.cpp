@@ -12,6 +12,7 @@
 #include "../Helper/Logging.h"
 #include "../Helper/Macros.h"
 #include "../Helper/ShellHelper.h"
+#include <cstring>
 #include <list>
 
 void ShellBrowser::StartDirectoryMonitoring(PCIDLIST_ABSOLUTE pidl)
@@ -73,21 +74,49 @@ void ShellBrowser::OnProcessShellChangeNotifications()
 {
 	KillTimer(m_hListView, PROCESS_SHELL_CHANGES_TIMER_ID);
 
-	SendMessage(m_hListView, WM_SETREDRAW, FALSE, NULL);
-
-	for (const auto &change : m_directoryState.shellChangeNotifications)
+	if (m_resyncContext)
 	{
-		ProcessShellChangeNotification(change);
+		// The notifications will be processed once the folder has been resynchronized.
+		return;
 	}
 
-	SendMessage(m_hListView, WM_SETREDRAW, TRUE, NULL);
-
+	auto notifications = std::move(m_directoryState.shellChangeNotifications);
 	m_directoryState.shellChangeNotifications.clear();
 
-	directoryModified.m_signal();
+	ShellChangeCoalescer coalescer(&ShellBrowser::GetShellChangeItemKey);
+
+	for (const auto &change : notifications)
+	{
+		if (change.event == SHCNE_UPDATEDIR
+			&& ArePidlsEquivalent(m_directoryState.pidlDirectory.get(), change.pidl1.get()))
+		{
+			// The folder will be reloaded, so there's no need to process any of the other changes.
+			m_navigationController->Refresh();
+			return;
+		}
+
+		ProcessShellChangeNotification(change, coalescer);
+	}
+
+	// When a large number of items change at once (e.g. when an archive is extracted into the
+	// folder), applying each change individually can take a significant amount of time on the UI
+	// thread. In that case, the folder is enumerated again in the background and the results are
+	// compared against the current set of items instead.
+	if (coalescer.GetNumChanges() >= SHELL_CHANGE_RESYNC_THRESHOLD)
+	{
+		StartResync();
+		return;
+	}
+
+	ApplyShellChanges(coalescer.TakeChanges());
 }
 
-void ShellBrowser::ProcessShellChangeNotification(const ShellChangeNotification &change)
+// Only the current directory is monitored, so notifications should only arrive for items in that
+// directory. However, if the user has just changed directories, a notification could still come in
+// for the previous directory. Therefore, it's important to verify that each item is actually a
+// child of the current directory.
+void ShellBrowser::ProcessShellChangeNotification(const ShellChangeNotification &change,
+	ShellChangeCoalescer &coalescer)
 {
 	switch (change.event)
 	{
@@ -95,7 +124,7 @@ void ShellBrowser::ProcessShellChangeNotification(const ShellChangeNotification
 	case SHCNE_CREATE:
 		if (ILIsParent(m_directoryState.pidlDirectory.get(), change.pidl1.get(), TRUE))
 		{
-			OnItemAdded(change.pidl1.get());
+			coalescer.OnItemAdded(change.pidl1.get());
 		}
 		break;
 
@@ -104,38 +133,274 @@ void ShellBrowser::ProcessShellChangeNotification(const ShellChangeNotification
 		if (ILIsParent(m_directoryState.pidlDirectory.get(), change.pidl1.get(), TRUE)
 			&& ILIsParent(m_directoryState.pidlDirectory.get(), change.pidl2.get(), TRUE))
 		{
-			OnItemRenamed(change.pidl1.get(), change.pidl2.get());
+			coalescer.OnItemRenamed(change.pidl1.get(), change.pidl2.get());
 		}
 		break;
 
 	case SHCNE_UPDATEITEM:
 		if (ILIsParent(m_directoryState.pidlDirectory.get(), change.pidl1.get(), TRUE))
 		{
-			OnItemModified(change.pidl1.get());
-		}
-		break;
-
-	case SHCNE_UPDATEDIR:
-		if (ArePidlsEquivalent(m_directoryState.pidlDirectory.get(), change.pidl1.get()))
-		{
-			m_navigationController->Refresh();
+			coalescer.OnItemUpdated(change.pidl1.get());
 		}
 		break;
 
 	case SHCNE_RMDIR:
 	case SHCNE_DELETE:
-		// Only the current directory is monitored, so notifications should only arrive for items in
-		// that directory. However, if the user has just changed directories, a notification could
-		// still come in for the previous directory. Therefore, it's important to verify that the
-		// item is actually a child of the current directory.
 		if (ILIsParent(m_directoryState.pidlDirectory.get(), change.pidl1.get(), TRUE))
 		{
-			OnItemRemoved(change.pidl1.get());
+			coalescer.OnItemRemoved(change.pidl1.get());
 		}
 		break;
 	}
 }
 
+// This is called for every notification in a burst, so the key is built directly from the contents
+// of the item's last ID. Retrieving the item's parsing name instead would require the folder to be
+// bound and queried for each notification on the UI thread. Notifications for the same item that
+// carry different IDs simply aren't merged, which is safe, since each change is checked against the
+// items that exist when it's applied.
+std::wstring ShellBrowser::GetShellChangeItemKey(PCIDLIST_ABSOLUTE pidl)
+{
+	PCUITEMID_CHILD pidlChild = ILFindLastID(pidl);
+	UINT size = ILGetSize(pidlChild);
+
+	// The data is copied byte-for-byte. Since an odd number of bytes won't fill the last
+	// character, it's padded out.
+	std::wstring key((size + 1) / sizeof(wchar_t), L'\0');
+	std::memcpy(key.data(), pidlChild, size);
+	return key;
+}
+
+void ShellBrowser::ApplyShellChanges(std::vector<ShellChangeCoalescer::Change> changes)
+{
+	SendMessage(m_hListView, WM_SETREDRAW, FALSE, NULL);
+
+	m_deferSorting = true;
+
+	// Removed items are handled first, all at once, so that the listview only needs to be updated a
+	// single time, rather than once per item.
+	std::unordered_set<int> removedItems;
+
+	for (const auto &change : changes)
+	{
+		if (change.type != ShellChangeCoalescer::ChangeType::Removed)
+		{
+			continue;
+		}
+
+		auto internalIndex = GetItemInternalIndexForPidl(change.pidl.get());
+
+		if (internalIndex)
+		{
+			removedItems.insert(*internalIndex);
+		}
+	}
+
+	RemoveItems({ removedItems.begin(), removedItems.end() });
+
+	// Since the changes have been coalesced, they're not necessarily in the same order they were
+	// made in. For example, a notification for an item that was added could be processed after
+	// the item has already been picked up by a resync. So the changes below are checked against
+	// the items that currently exist.
+	for (const auto &change : changes)
+	{
+		switch (change.type)
+		{
+		case ShellChangeCoalescer::ChangeType::Removed:
+			// Already handled above.
+			break;
+
+		case ShellChangeCoalescer::ChangeType::Renamed:
+			if (!GetItemInternalIndexForPidl(change.pidl.get())
+				&& !GetItemInternalIndexForPidl(change.pidlNew.get()))
+			{
+				OnItemAdded(change.pidlNew.get());
+			}
+			else
+			{
+				OnItemRenamed(change.pidl.get(), change.pidlNew.get());
+			}
+			break;
+
+		case ShellChangeCoalescer::ChangeType::Updated:
+			OnItemModified(change.pidl.get());
+			break;
+
+		case ShellChangeCoalescer::ChangeType::Added:
+			if (GetItemInternalIndexForPidl(change.pidl.get()))
+			{
+				OnItemModified(change.pidl.get());
+			}
+			else
+			{
+				OnItemAdded(change.pidl.get());
+			}
+			break;
+		}
+	}
+
+	InsertAddedItems();
+	EndDeferredSorting();
+
+	SendMessage(m_hListView, WM_SETREDRAW, TRUE, NULL);
+
+	directoryModified.m_signal();
+}
+
+void ShellBrowser::StartResync()
+{
+	auto context = std::make_shared<EnumerationContext>();
+	context->pidlDirectory.reset(ILCloneFull(m_directoryState.pidlDirectory.get()));
+	context->enumFlags = GetEnumerationFlags();
+	context->isRecycleBin = IsRecycleBin(m_directoryState.pidlDirectory.get());
+	m_resyncContext = context;
+
+	m_enumerationThreadPool.push(
+		[listView = m_hListView, folderId = m_uniqueFolderId, context](int id)
+		{
+			UNREFERENCED_PARAMETER(id);
+
+			EnumerateFolderAsync(listView, folderId, context);
+		});
+}
+
+void ShellBrowser::ProcessResyncResult()
+{
+	std::vector<ItemInfo_t> items;
+	bool enumeratedAllItems;
+
+	{
+		std::scoped_lock lock(m_resyncContext->mutex);
+
+		m_resyncContext->notificationPending = false;
+
+		// The items are only compared once the enumeration has finished, since an item can only be
+		// considered to have been removed once it's known that it's not in the folder.
+		if (!m_resyncContext->completed)
+		{
+			return;
+		}
+
+		items.swap(m_resyncContext->items);
+		enumeratedAllItems = m_resyncContext->enumeratedAllItems;
+	}
+
+	m_resyncContext.reset();
+
+	if (enumeratedAllItems)
+	{
+		SynchronizeItems(std::move(items));
+	}
+	else
+	{
+		// The folder couldn't be enumerated, so it's not possible to tell which items have
+		// changed.
+		m_navigationController->Refresh();
+		return;
+	}
+
+	// Any notifications that arrived while the enumeration was in progress still need to be
+	// processed, since the changes they refer to may have occurred after the item was enumerated.
+	if (!m_directoryState.shellChangeNotifications.empty())
+	{
+		OnProcessShellChangeNotifications();
+	}
+}
+
+// Brings the view up to date with a fresh enumeration of the folder, by removing the items that no
+// longer exist, updating the items whose details have changed and adding the items that are new.
+// Items that haven't changed are left as-is, so they'll retain their position and selection state.
+void ShellBrowser::SynchronizeItems(std::vector<ItemInfo_t> &&items)
+{
+	std::unordered_set<int> existingItems;
+	std::vector<std::pair<int, ItemInfo_t>> updatedItems;
+	std::vector<ItemInfo_t> newItems;
+
+	for (auto &item : items)
+	{
+		// If the child PIDL is identical, the details cached within it (e.g. the item's size and
+		// modification date) are also identical, so there's nothing that needs to be updated.
+		auto internalIndex = m_itemStore.FindByPidlChild(item.pridl.get());
+
+		if (internalIndex && !existingItems.contains(*internalIndex))
+		{
+			existingItems.insert(*internalIndex);
+			continue;
+		}
+
+		internalIndex = m_itemStore.FindByFileName(item.wfd.cFileName);
+
+		if (internalIndex && !existingItems.contains(*internalIndex))
+		{
+			existingItems.insert(*internalIndex);
+			updatedItems.emplace_back(*internalIndex, std::move(item));
+			continue;
+		}
+
+		newItems.push_back(std::move(item));
+	}
+
+	SendMessage(m_hListView, WM_SETREDRAW, FALSE, NULL);
+
+	m_deferSorting = true;
+
+	std::vector<int> removedItems;
+
+	for (int internalIndex : m_itemStore.GetIds())
+	{
+		if (!existingItems.contains(internalIndex))
+		{
+			removedItems.push_back(internalIndex);
+		}
+	}
+
+	RemoveItems(removedItems);
+
+	for (auto &[internalIndex, item] : updatedItems)
+	{
+		bool renamed = (m_itemStore.GetFileName(internalIndex) != item.wfd.cFileName);
+		UpdateItemDetails(internalIndex, std::move(item), renamed);
+	}
+
+	for (auto &item : newItems)
+	{
+		AddItemInternal(-1, std::move(item), FALSE);
+		m_directoryState.awaitingAddList.back().insertSorted =
+			m_config->globalFolderSettings.insertSorted;
+	}
+
+	InsertAddedItems();
+	EndDeferredSorting();
+
+	SendMessage(m_hListView, WM_SETREDRAW, TRUE, NULL);
+
+	directoryModified.m_signal();
+}
+
+// Sorting the items after each individual change would be expensive when a batch of changes is
+// being applied, so the sort is deferred until the end of the batch in that case.
+void ShellBrowser::RequestListViewSort()
+{
+	if (m_deferSorting)
+	{
+		m_sortingDeferred = true;
+		return;
+	}
+
+	SortListViewItems();
+}
+
+void ShellBrowser::EndDeferredSorting()
+{
+	m_deferSorting = false;
+
+	if (m_sortingDeferred)
+	{
+		m_sortingDeferred = false;
+		SortListViewItems();
+	}
+}
+
 void ShellBrowser::DirectoryAltered()
 {
 	EnterCriticalSection(&m_csDirectoryAltered);
@@ -200,6 +465,8 @@ void ShellBrowser::DirectoryAltered()
 		}
 	}
 
+	InsertAddedItems();
+
 	SendMessage(m_hListView, WM_SETREDRAW, TRUE, NULL);
 
 	/* Ensure the first dropped item is visible. */
@@ -335,7 +602,7 @@ void ShellBrowser::AddItem(PCIDLIST_ABSOLUTE pidl)
 		return;
 	}
 
-	const std::wstring displayName = m_itemInfoMap.at(*itemId).displayName;
+	const std::wstring displayName(m_itemStore.GetDisplayName(*itemId));
 	auto droppedFilesItr = std::find_if(m_droppedFileNameList.begin(), m_droppedFileNameList.end(),
 		[&displayName](const DroppedFile_t &droppedFile)
 		{
@@ -347,10 +614,6 @@ void ShellBrowser::AddItem(PCIDLIST_ABSOLUTE pidl)
 	// Only insert the item in its sorted position if it wasn't dropped in.
 	if (m_config->globalFolderSettings.insertSorted && !wasDropped)
 	{
-		// TODO: It would be better to pass the items details to this function directly
-		// instead (before the item is added to the awaiting list).
-		int sortedPosition = DetermineItemSortedPosition(*itemId);
-
 		auto itr = std::find_if(m_directoryState.awaitingAddList.begin(),
 			m_directoryState.awaitingAddList.end(),
 			[itemId](const AwaitingAdd_t &awaitingItem)
@@ -362,9 +625,23 @@ void ShellBrowser::AddItem(PCIDLIST_ABSOLUTE pidl)
 		// items.
 		assert(itr != m_directoryState.awaitingAddList.end());
 
-		itr->iItem = sortedPosition;
-		itr->bPosition = TRUE;
-		itr->iAfter = sortedPosition - 1;
+		itr->insertSorted = true;
+	}
+
+	// The item will be inserted once the current batch of changes has been processed (see
+	// InsertAddedItems()), so that all the items that are added in the batch can be positioned
+	// together.
+}
+
+// Items that are added as a result of directory changes are queued, so that the items added in a
+// single batch of changes can be positioned and inserted together. The queued items need to be
+// inserted before any other type of change is processed (e.g. a queued item could be removed
+// again).
+void ShellBrowser::InsertAddedItems()
+{
+	if (m_directoryState.awaitingAddList.empty())
+	{
+		return;
 	}
 
 	InsertAwaitingItems(m_folderSettings.showInGroups);
@@ -407,6 +684,8 @@ void ShellBrowser::OnItemModified(PCIDLIST_ABSOLUTE simplePidl)
 // better than having two very similar methods.
 void ShellBrowser::UpdateItem(PCIDLIST_ABSOLUTE pidl, PCIDLIST_ABSOLUTE updatedPidl)
 {
+	InsertAddedItems();
+
 	auto internalIndex = GetItemInternalIndexForPidl(pidl);
 
 	if (!internalIndex)
@@ -442,23 +721,45 @@ void ShellBrowser::UpdateItem(PCIDLIST_ABSOLUTE pidl, PCIDLIST_ABSOLUTE updatedP
 		return;
 	}
 
-	ULARGE_INTEGER oldFileSize = { m_itemInfoMap[*internalIndex].wfd.nFileSizeLow,
-		m_itemInfoMap[*internalIndex].wfd.nFileSizeHigh };
-	ULARGE_INTEGER newFileSize = { itemInfo->wfd.nFileSizeLow, itemInfo->wfd.nFileSizeHigh };
+	UpdateItemDetails(*internalIndex, std::move(*itemInfo), updatedPidl != nullptr);
+}
+
+void ShellBrowser::UpdateItemDetails(int internalIndex, ItemInfo_t &&itemInfo, bool renamed)
+{
+	ULARGE_INTEGER oldFileSize;
+	oldFileSize.QuadPart = m_itemStore.GetFileSize(internalIndex);
+	ULARGE_INTEGER newFileSize = { itemInfo.wfd.nFileSizeLow, itemInfo.wfd.nFileSizeHigh };
 
 	m_directoryState.totalDirSize += newFileSize.QuadPart - oldFileSize.QuadPart;
 
-	m_itemInfoMap[*internalIndex] = std::move(*itemInfo);
-	const ItemInfo_t &updatedItemInfo = m_itemInfoMap[*internalIndex];
+	m_itemStore.Replace(internalIndex, std::move(itemInfo));
+
+	// Any column text retrieved for the item is now out of date. That's the case even if the item
+	// is filtered or the listview isn't currently in details view. The same is true of the item's
+	// color, since the color rules can depend on the item's name and attributes.
+	m_directoryState.columnTextCache.InvalidateItem(internalIndex);
+	m_directoryState.itemColors.erase(internalIndex);
+	m_directoryState.itemGroupIds.erase(internalIndex);
+
+	// If the item is a folder, its contents may have changed.
+	m_directoryState.cachedFolderSizes.erase(internalIndex);
+	m_directoryState.pendingFolderSizeResultIds.erase(internalIndex);
 
-	auto itemIndex = LocateItemByInternalIndex(*internalIndex);
+	// The item isn't moved when its details change. Its sort key is still updated, however, so
+	// that the index can tell whether the items remain sorted.
+	if (m_directoryState.sortedItemIndex.Contains(internalIndex))
+	{
+		m_directoryState.sortedItemIndex.UpdateKey(internalIndex, GetSortKey(internalIndex));
+	}
+
+	auto itemIndex = LocateItemByInternalIndex(internalIndex);
 
 	// Items may be filtered out of the listview, so it's valid for an item not to be found.
 	if (!itemIndex)
 	{
-		if (!IsFileFiltered(updatedItemInfo))
+		if (!IsFileFiltered(internalIndex))
 		{
-			UnfilterItem(*internalIndex);
+			UnfilterItem(internalIndex);
 		}
 
 		return;
@@ -471,9 +772,9 @@ void ShellBrowser::UpdateItem(PCIDLIST_ABSOLUTE pidl, PCIDLIST_ABSOLUTE updatedP
 		m_directoryState.fileSelectionSize += newFileSize.QuadPart - oldFileSize.QuadPart;
 	}
 
-	if (IsFileFiltered(updatedItemInfo))
+	if (IsFileFiltered(internalIndex))
 	{
-		RemoveFilteredItem(*itemIndex, *internalIndex);
+		RemoveFilteredItem(*itemIndex, internalIndex);
 		return;
 	}
 
@@ -483,14 +784,14 @@ void ShellBrowser::UpdateItem(PCIDLIST_ABSOLUTE pidl, PCIDLIST_ABSOLUTE updatedP
 	{
 		InvalidateAllColumnsForItem(*itemIndex);
 	}
-	else if (updatedPidl)
+	else if (renamed)
 	{
-		BasicItemInfo_t basicItemInfo = getBasicItemInfo(*internalIndex);
+		BasicItemInfo_t basicItemInfo = m_itemStore.GetBasicItemInfo(internalIndex, false);
 		std::wstring filename = ProcessItemFileName(basicItemInfo, m_config->globalFolderSettings);
 		ListView_SetItemText(m_hListView, *itemIndex, 0, filename.data());
 	}
 
-	if (WI_IsFlagSet(updatedItemInfo.wfd.dwFileAttributes, FILE_ATTRIBUTE_HIDDEN))
+	if (WI_IsFlagSet(m_itemStore.GetAttributes(internalIndex), FILE_ATTRIBUTE_HIDDEN))
 	{
 		ListView_SetItemState(m_hListView, *itemIndex, LVIS_CUT, LVIS_CUT);
 	}
@@ -499,14 +800,14 @@ void ShellBrowser::UpdateItem(PCIDLIST_ABSOLUTE pidl, PCIDLIST_ABSOLUTE updatedP
 		ListView_SetItemState(m_hListView, *itemIndex, 0, LVIS_CUT);
 	}
 
-	if (m_folderSettings.showInGroups)
+	if (m_folderSettings.showInGroups && !m_virtualListView)
 	{
-		int groupId = DetermineItemGroup(*internalIndex);
+		int groupId = DetermineItemGroup(internalIndex);
 		InsertItemIntoGroup(*itemIndex, groupId);
 	}
 
 	// It's not safe to use itemIndex past this point.
-	ListView_SortItems(m_hListView, SortStub, this);
+	RequestListViewSort();
 	itemIndex.reset();
 }
 
@@ -549,6 +850,14 @@ void ShellBrowser::InvalidateAllColumnsForItem(int itemIndex)
 		return;
 	}
 
+	m_directoryState.columnTextCache.InvalidateItem(GetItemInternalIndex(itemIndex));
+
+	if (m_virtualListView)
+	{
+		ListView_RedrawItems(m_hListView, itemIndex, itemIndex);
+		return;
+	}
+
 	auto numColumns = std::count_if(m_pActiveColumns->begin(), m_pActiveColumns->end(),
 		[](const Column_t &column)
 		{
@@ -563,6 +872,15 @@ void ShellBrowser::InvalidateAllColumnsForItem(int itemIndex)
 
 void ShellBrowser::InvalidateIconForItem(int itemIndex)
 {
+	if (m_virtualListView)
+	{
+		int internalIndex = GetItemInternalIndex(itemIndex);
+		m_directoryState.virtualList.iconIndexes.erase(internalIndex);
+		m_directoryState.virtualList.thumbnailIndexes.erase(internalIndex);
+		ListView_RedrawItems(m_hListView, itemIndex, itemIndex);
+		return;
+	}
+
 	LVITEM lvItem;
 	lvItem.mask = LVIF_IMAGE;
 	lvItem.iItem = itemIndex;
@@ -36,14 +36,14 @@ int ShellBrowser::GetDropTargetItem(const POINT &pt)
 		return -1;
 	}
 
-	auto &item = GetItemByIndex(index);
+	int internalIndex = GetItemInternalIndex(index);
 
 	// Folders always act as drop targets. If a folder can't actually accept a drop, the drop should
 	// be marked as blocked. On the other hand, a file may accept a drop (e.g. it may be possible to
 	// drop an item on an executable). But if the file can't accept the drop, then the drop target
 	// should revert to the parent.
-	if (WI_IsFlagClear(item.wfd.dwFileAttributes, FILE_ATTRIBUTE_DIRECTORY)
-		&& !GetDropTargetForPidl(item.pidlComplete.get()))
+	if (!m_itemStore.IsFolder(internalIndex)
+		&& !GetDropTargetForPidl(m_itemStore.GetPidlComplete(internalIndex)))
 	{
 		return -1;
 	}
@@ -57,8 +57,8 @@ unique_pidl_absolute ShellBrowser::GetPidlForTargetItem(int targetItem)
 {
 	if (targetItem != -1)
 	{
-		auto &item = GetItemByIndex(targetItem);
-		return unique_pidl_absolute(ILCloneFull(item.pidlComplete.get()));
+		return unique_pidl_absolute(
+			ILCloneFull(m_itemStore.GetPidlComplete(GetItemInternalIndex(targetItem))));
 	}
 
 	return unique_pidl_absolute(ILCloneFull(m_directoryState.pidlDirectory.get()));
@@ -107,8 +107,7 @@ void ShellBrowser::UpdateUiForDrop(int targetItem, const POINT &pt)
 	ScrollListViewForDrop(pt);
 }
 
-/* TODO: This isn't declared. */
-int CALLBACK SortTemporaryStub(LPARAM lParam1, LPARAM lParam2, LPARAM lParamSort)
+int CALLBACK ShellBrowser::SortTemporaryStub(LPARAM lParam1, LPARAM lParam2, LPARAM lParamSort)
 {
 	auto *pShellBrowser = reinterpret_cast<ShellBrowser *>(lParamSort);
 	return pShellBrowser->SortTemporary(lParam1, lParam2);
@@ -116,8 +115,8 @@ int CALLBACK SortTemporaryStub(LPARAM lParam1, LPARAM lParam2, LPARAM lParamSort
 
 int CALLBACK ShellBrowser::SortTemporary(LPARAM lParam1, LPARAM lParam2)
 {
-	return m_itemInfoMap.at(static_cast<int>(lParam1)).iRelativeSort
-		- m_itemInfoMap.at(static_cast<int>(lParam2)).iRelativeSort;
+	return m_itemStore.GetRelativeSort(static_cast<int>(lParam1))
+		- m_itemStore.GetRelativeSort(static_cast<int>(lParam2));
 }
 
 void ShellBrowser::RepositionLocalFiles(const POINT *ppt)
@@ -125,6 +124,12 @@ void ShellBrowser::RepositionLocalFiles(const POINT *ppt)
 	POINT pt;
 	POINT ptOrigin;
 
+	// Owner data listviews don't support positioning individual items.
+	if (m_virtualListView)
+	{
+		return;
+	}
+
 	pt = *ppt;
 	ScreenToClient(m_hListView, &pt);
 
@@ -190,7 +195,7 @@ void ShellBrowser::RepositionLocalFiles(const POINT *ppt)
 				{
 					if (i == *index)
 					{
-						m_itemInfoMap.at((int) lvItem.lParam).iRelativeSort = iInsert;
+						m_itemStore.SetRelativeSort((int) lvItem.lParam, iInsert);
 					}
 					else
 					{
@@ -199,7 +204,7 @@ void ShellBrowser::RepositionLocalFiles(const POINT *ppt)
 							iSort++;
 						}
 
-						m_itemInfoMap.at((int) lvItem.lParam).iRelativeSort = iSort;
+						m_itemStore.SetRelativeSort((int) lvItem.lParam, iSort);
 					}
 				}
 
@@ -207,6 +212,10 @@ void ShellBrowser::RepositionLocalFiles(const POINT *ppt)
 			}
 
 			ListView_SortItems(m_hListView, SortTemporaryStub, (LPARAM) this);
+
+			// The items have been manually rearranged, so the index of sorted items needs to be
+			// rebuilt.
+			m_directoryState.sortedItemIndex.Invalidate();
 		}
 		else
 		{
@@ -6,28 +6,95 @@
 #include "ShellBrowser.h"
 #include "MainResource.h"
 #include "../Helper/ListViewHelper.h"
+#include <wil/common.h>
+#include <algorithm>
+
+namespace
+{
+
+// Returns true if every name matched by newPattern is also matched by pattern. That's the case
+// when newPattern can be formed by inserting text immediately before or after one of the '*'
+// wildcards in pattern (e.g. when "*abc*" is extended to "*abcd*"), since the wildcard can match
+// whatever the inserted text matches.
+bool IsNarrowerPattern(std::wstring_view pattern, std::wstring_view newPattern)
+{
+	if (newPattern.size() <= pattern.size() || pattern.find(':') != std::wstring_view::npos
+		|| newPattern.find(':') != std::wstring_view::npos)
+	{
+		return false;
+	}
+
+	auto prefixEnd =
+		std::mismatch(pattern.begin(), pattern.end(), newPattern.begin(), newPattern.end()).first;
+	auto suffixEnd = std::mismatch(pattern.rbegin(), pattern.rend(), newPattern.rbegin(),
+		newPattern.rend())
+						 .first;
+	size_t prefixLength = std::distance(pattern.begin(), prefixEnd);
+	size_t suffixLength = std::distance(pattern.rbegin(), suffixEnd);
+
+	// The inserted text can start at any position that leaves the original pattern on either side
+	// of it.
+	for (size_t i = pattern.size() - suffixLength; i <= prefixLength; i++)
+	{
+		if ((i > 0 && pattern[i - 1] == '*') || (i < pattern.size() && pattern[i] == '*'))
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+}
 
 std::wstring ShellBrowser::GetFilterText() const
 {
 	return m_folderSettings.filter;
 }
 
+// The filter is typically changed a character at a time. When the new filter can only match a
+// subset of the items matched by the previous filter, only the items that are currently shown need
+// to be checked. Conversely, when the new filter matches a superset, only the items that are
+// currently filtered need to be checked.
 void ShellBrowser::SetFilterText(std::wstring_view filter)
 {
-	m_folderSettings.filter = filter;
+	if (filter == m_folderSettings.filter)
+	{
+		return;
+	}
 
-	if (m_folderSettings.applyFilter)
+	std::wstring previousFilter = std::exchange(m_folderSettings.filter, filter);
+	m_filterPattern = CompileFilter();
+
+	if (!m_folderSettings.applyFilter)
 	{
-		UnfilterAllItems();
-		UpdateFiltering();
+		return;
 	}
+
+	FilterChange change = FilterChange::Replaced;
+
+	if (IsNarrowerPattern(previousFilter, m_folderSettings.filter))
+	{
+		change = FilterChange::Narrowed;
+	}
+	else if (IsNarrowerPattern(m_folderSettings.filter, previousFilter))
+	{
+		change = FilterChange::Widened;
+	}
+
+	UpdateFiltering(change);
 }
 
 void ShellBrowser::SetFilterApplied(BOOL bFilter)
 {
+	if (bFilter == m_folderSettings.applyFilter)
+	{
+		return;
+	}
+
 	m_folderSettings.applyFilter = bFilter;
 
-	UpdateFiltering();
+	UpdateFiltering(bFilter ? FilterChange::Narrowed : FilterChange::Widened);
 }
 
 BOOL ShellBrowser::IsFilterApplied() const
@@ -37,7 +104,20 @@ BOOL ShellBrowser::IsFilterApplied() const
 
 void ShellBrowser::SetFilterCaseSensitive(BOOL filterCaseSensitive)
 {
+	if (!filterCaseSensitive == !m_folderSettings.filterCaseSensitive)
+	{
+		return;
+	}
+
 	m_folderSettings.filterCaseSensitive = filterCaseSensitive;
+	m_filterPattern = CompileFilter();
+
+	// A case-sensitive match is also a case-insensitive match, so making the filter case-sensitive
+	// can only remove items.
+	if (m_folderSettings.applyFilter)
+	{
+		UpdateFiltering(filterCaseSensitive ? FilterChange::Narrowed : FilterChange::Widened);
+	}
 }
 
 BOOL ShellBrowser::GetFilterCaseSensitive() const
@@ -45,16 +125,34 @@ BOOL ShellBrowser::GetFilterCaseSensitive() const
 	return m_folderSettings.filterCaseSensitive;
 }
 
-void ShellBrowser::UpdateFiltering()
+// Rebuilds the set of displayed items in a single batch. Only the items whose state could have
+// changed are checked against the filter.
+void ShellBrowser::UpdateFiltering(FilterChange change)
 {
-	if (m_folderSettings.applyFilter)
+	SendMessage(m_hListView, WM_SETREDRAW, FALSE, NULL);
+
+	// The filtered items are taken before any items are removed below, so that the items that are
+	// removed aren't then checked a second time.
+	std::unordered_set<int> filteredItems;
+
+	if (change != FilterChange::Narrowed)
+	{
+		filteredItems = std::exchange(m_directoryState.filteredItemsList, {});
+	}
+
+	if (change != FilterChange::Widened)
 	{
 		RemoveFilteredItems();
 	}
-	else
+
+	if (!filteredItems.empty())
 	{
-		UnfilterAllItems();
+		RestoreFilteredItems(filteredItems);
 	}
+
+	SendMessage(m_hListView, WM_SETREDRAW, TRUE, NULL);
+
+	SendMessage(m_hOwner, WM_USER_UPDATEWINDOWS, 0, 0);
 }
 
 void ShellBrowser::RemoveFilteredItems()
@@ -64,48 +162,100 @@ void ShellBrowser::RemoveFilteredItems()
 		return;
 	}
 
+	if (m_virtualListView)
+	{
+		RemoveFilteredItemsFromVirtualList();
+		return;
+	}
+
+	// A listview that isn't in owner data mode can only remove items one at a time. Everything
+	// else is batched, so that the sorted index is only rebuilt once, rather than once per item.
+	// The items are removed from the end, so that the indexes of the items yet to be checked don't
+	// change.
 	int nItems = ListView_GetItemCount(m_hListView);
+	std::unordered_set<int> removedItems;
 
 	for (int i = nItems - 1; i >= 0; i--)
 	{
 		int internalIndex = GetItemInternalIndex(i);
 
-		if (!((m_itemInfoMap.at(internalIndex).wfd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
-				== FILE_ATTRIBUTE_DIRECTORY))
+		if (!m_itemStore.IsFolder(internalIndex))
 		{
-			if (IsFilenameFiltered(m_itemInfoMap.at(internalIndex).displayName.c_str()))
+			if (IsFilenameFiltered(m_itemStore.GetDisplayName(internalIndex).data()))
 			{
-				RemoveFilteredItem(i, internalIndex);
+				RemoveFilteredItemFromListView(i, internalIndex);
+				removedItems.insert(internalIndex);
 			}
 		}
 	}
 
-	SendMessage(m_hOwner, WM_USER_UPDATEWINDOWS, 0, 0);
+	m_directoryState.sortedItemIndex.Remove(removedItems);
+}
+
+// Rather than removing the filtered items one at a time, the list of displayed items is rebuilt in
+// a single pass.
+void ShellBrowser::RemoveFilteredItemsFromVirtualList()
+{
+	std::vector<int> items;
+	items.reserve(m_directoryState.virtualList.items.size());
+
+	std::unordered_set<int> removedItems;
+
+	for (int internalIndex : m_directoryState.virtualList.items)
+	{
+		if (m_itemStore.IsFolder(internalIndex)
+			|| !IsFilenameFiltered(m_itemStore.GetDisplayName(internalIndex).data()))
+		{
+			items.push_back(internalIndex);
+			continue;
+		}
+
+		m_directoryState.totalDirSize -= m_itemStore.GetFileSize(internalIndex);
+		m_directoryState.numItems--;
+
+		assert(m_directoryState.filteredItemsList.count(internalIndex) == 0);
+		m_directoryState.filteredItemsList.insert(internalIndex);
+
+		removedItems.insert(internalIndex);
+	}
+
+	m_directoryState.sortedItemIndex.Remove(removedItems);
+
+	// Any filtered items that were selected will be deselected here, with the selection
+	// information being updated as a result.
+	SetVirtualListItems(std::move(items));
 }
 
 void ShellBrowser::RemoveFilteredItem(int iItem, int iItemInternal)
 {
-	ULARGE_INTEGER ulFileSize;
+	RemoveFilteredItemFromListView(iItem, iItemInternal);
+	m_directoryState.sortedItemIndex.Remove(iItemInternal);
+}
 
-	const auto &item = m_itemInfoMap.at(iItemInternal);
+// Removes the item from the listview and marks it as filtered. The caller is responsible for
+// removing the item from the sorted index.
+void ShellBrowser::RemoveFilteredItemFromListView(int iItem, int iItemInternal)
+{
+	uint64_t fileSize = m_itemStore.GetFileSize(iItemInternal);
 
 	if (ListView_GetItemState(m_hListView, iItem, LVIS_SELECTED) == LVIS_SELECTED)
 	{
-		ulFileSize.LowPart = item.wfd.nFileSizeLow;
-		ulFileSize.HighPart = item.wfd.nFileSizeHigh;
-
-		m_directoryState.fileSelectionSize -= ulFileSize.QuadPart;
+		m_directoryState.fileSelectionSize -= fileSize;
 	}
 
 	/* Take the file size of the removed file away from the total
 	directory size. */
-	ulFileSize.LowPart = item.wfd.nFileSizeLow;
-	ulFileSize.HighPart = item.wfd.nFileSizeHigh;
+	m_directoryState.totalDirSize -= fileSize;
 
-	m_directoryState.totalDirSize -= ulFileSize.QuadPart;
-
-	/* Remove the item from the m_hListView. */
-	ListView_DeleteItem(m_hListView, iItem);
+	if (m_virtualListView)
+	{
+		RemoveVirtualListItems({ iItemInternal });
+	}
+	else
+	{
+		/* Remove the item from the m_hListView. */
+		ListView_DeleteItem(m_hListView, iItem);
+	}
 
 	m_directoryState.numItems--;
 
@@ -115,24 +265,28 @@ void ShellBrowser::RemoveFilteredItem(int iItem, int iItemInternal)
 
 BOOL ShellBrowser::IsFilenameFiltered(const TCHAR *FileName) const
 {
-	if (CheckWildcardMatch(m_folderSettings.filter.c_str(), FileName,
-			m_folderSettings.filterCaseSensitive))
-	{
-		return FALSE;
-	}
+	return !m_filterPattern.Match(FileName);
+}
 
-	return TRUE;
+// The filter is compiled whenever the filter text or case sensitivity changes, so that the work of
+// parsing the filter isn't repeated each time an item is checked.
+WildcardPattern ShellBrowser::CompileFilter() const
+{
+	return WildcardPattern(m_folderSettings.filter, m_folderSettings.filterCaseSensitive);
 }
 
-void ShellBrowser::UnfilterAllItems()
+// Queues the specified items to be inserted in their sorted positions. Any items that are still
+// filtered will be added back to the filtered list when the items are inserted.
+void ShellBrowser::RestoreFilteredItems(const std::unordered_set<int> &items)
 {
-	for (int internalIndex : m_directoryState.filteredItemsList)
+	for (int internalIndex : items)
 	{
 		RestoreFilteredItem(internalIndex);
 	}
 
-	m_directoryState.filteredItemsList.clear();
-	SendMessage(m_hOwner, WM_USER_UPDATEWINDOWS, 0, 0);
+	// All the items are positioned and inserted in a single batch. In owner data mode, that
+	// results in the new items being merged into the list of displayed items in a single pass.
+	InsertAwaitingItems(m_folderSettings.showInGroups);
 }
 
 void ShellBrowser::UnfilterItem(int internalIndex)
@@ -141,19 +295,19 @@ void ShellBrowser::UnfilterItem(int internalIndex)
 
 	RestoreFilteredItem(internalIndex);
 	m_directoryState.filteredItemsList.erase(internalIndex);
+	InsertAwaitingItems(m_folderSettings.showInGroups);
 	SendMessage(m_hOwner, WM_USER_UPDATEWINDOWS, 0, 0);
 }
 
+// Queues the item to be inserted in its sorted position. The position is determined when the
+// awaiting items are inserted.
 void ShellBrowser::RestoreFilteredItem(int internalIndex)
 {
-	int sortedPosition = DetermineItemSortedPosition(internalIndex);
-
 	AwaitingAdd_t awaitingAdd;
-	awaitingAdd.iItem = sortedPosition;
+	awaitingAdd.iItem = -1;
 	awaitingAdd.bPosition = TRUE;
-	awaitingAdd.iAfter = sortedPosition - 1;
+	awaitingAdd.iAfter = -1;
 	awaitingAdd.iItemInternal = internalIndex;
+	awaitingAdd.insertSorted = true;
 	m_directoryState.awaitingAddList.push_back(awaitingAdd);
-
-	InsertAwaitingItems(m_folderSettings.showInGroups);
 }
@@ -8,6 +8,7 @@
 #include "SortModes.h"
 #include "ViewModes.h"
 #include "../Helper/StringHelper.h"
+#include <optional>
 
 struct FolderColumns
 {
@@ -43,6 +44,10 @@ struct GlobalFolderSettings
 struct FolderSettings
 {
 	SortMode sortMode;
+
+	// Items that are equal according to the primary sort mode are ordered by this sort mode.
+	std::optional<SortMode> secondarySortMode;
+
 	ViewMode viewMode;
 	BOOL autoArrange;
 	BOOL sortAscending;
@@ -0,0 +1,182 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "ShellBrowser.h"
+#include "ColumnDataRetrieval.h"
+#include "Columns.h"
+#include "Config.h"
+#include "ItemData.h"
+#include "SortModes.h"
+#include "../Helper/FolderSize.h"
+
+// Calculating the size of a folder requires the folder to be recursively enumerated, which can
+// take a long time. Folder sizes are therefore calculated in the background, once per folder, with
+// the results being used both to display and to sort by size.
+void ShellBrowser::QueueFolderSizeTaskIfNecessary(int internalIndex)
+{
+	if (!m_config->globalFolderSettings.showFolderSizes
+		|| m_directoryState.cachedFolderSizes.contains(internalIndex)
+		|| m_directoryState.pendingFolderSizeResultIds.contains(internalIndex)
+		|| !m_itemStore.IsFolder(internalIndex) || !m_itemStore.IsFindDataValid(internalIndex))
+	{
+		return;
+	}
+
+	std::wstring folderPath = getBasicItemInfo(internalIndex).getFullPath();
+
+	if (!ShouldCalculateFolderSize(folderPath, m_config->globalFolderSettings))
+	{
+		return;
+	}
+
+	// The ID is also used to track the request for the text in the size column, so it's taken from
+	// the same sequence as the column result IDs.
+	int folderSizeResultId = m_columnResultIDCounter++;
+	m_directoryState.pendingFolderSizeResultIds[internalIndex] = folderSizeResultId;
+
+	auto result = m_folderSizeThreadPool.push(
+		[listView = m_hListView, folderSizeResultId, internalIndex, folderPath,
+			stopToken = m_folderSizeStopSource.get_token()](
+			int id) -> std::optional<FolderSizeResult>
+		{
+			UNREFERENCED_PARAMETER(id);
+
+			auto folderInfo = GetFolderInfo(folderPath, stopToken);
+
+			// If the calculation was stopped, the size will be incomplete.
+			if (stopToken.stop_requested())
+			{
+				return std::nullopt;
+			}
+
+			PostMessage(listView, WM_APP_FOLDER_SIZE_READY, folderSizeResultId, 0);
+
+			return FolderSizeResult{ internalIndex, folderInfo.size };
+		});
+
+	m_folderSizeResults.insert({ folderSizeResultId, std::move(result) });
+}
+
+// Stores the text for the size column of a folder if the folder's size is already known (or isn't
+// going to be shown). Otherwise, the text will be stored once the size has been calculated.
+void ShellBrowser::RequestFolderSizeText(int internalIndex)
+{
+	auto &columnTextCache = m_directoryState.columnTextCache;
+
+	QueueFolderSizeTaskIfNecessary(internalIndex);
+
+	auto pendingItr = m_directoryState.pendingFolderSizeResultIds.find(internalIndex);
+
+	if (pendingItr != m_directoryState.pendingFolderSizeResultIds.end())
+	{
+		columnTextCache.SetRequestPending(internalIndex, ColumnType::Size, pendingItr->second);
+		return;
+	}
+
+	std::wstring text;
+	auto sizeItr = m_directoryState.cachedFolderSizes.find(internalIndex);
+
+	if (sizeItr != m_directoryState.cachedFolderSizes.end()
+		&& m_config->globalFolderSettings.showFolderSizes)
+	{
+		text = GetFolderSizeColumnText(sizeItr->second, m_config->globalFolderSettings);
+	}
+
+	int requestId = m_columnResultIDCounter++;
+	columnTextCache.SetRequestPending(internalIndex, ColumnType::Size, requestId);
+	columnTextCache.SetText(internalIndex, ColumnType::Size, requestId, std::move(text));
+}
+
+void ShellBrowser::ProcessFolderSizeResult(int folderSizeResultId)
+{
+	auto itr = m_folderSizeResults.find(folderSizeResultId);
+
+	if (itr == m_folderSizeResults.end())
+	{
+		return;
+	}
+
+	auto result = itr->second.get();
+	m_folderSizeResults.erase(itr);
+
+	if (!result)
+	{
+		return;
+	}
+
+	// The folder may have been removed or changed since its size was requested.
+	auto pendingItr = m_directoryState.pendingFolderSizeResultIds.find(result->itemInternalIndex);
+
+	if (pendingItr == m_directoryState.pendingFolderSizeResultIds.end()
+		|| pendingItr->second != folderSizeResultId)
+	{
+		return;
+	}
+
+	m_directoryState.pendingFolderSizeResultIds.erase(pendingItr);
+	m_directoryState.cachedFolderSizes[result->itemInternalIndex] = result->size;
+
+	if (m_directoryState.columnTextCache.SetText(result->itemInternalIndex, ColumnType::Size,
+			folderSizeResultId,
+			GetFolderSizeColumnText(result->size, m_config->globalFolderSettings)))
+	{
+		OnColumnTextUpdated(result->itemInternalIndex, { ColumnType::Size });
+	}
+
+	if (m_folderSettings.sortMode != +SortMode::Size)
+	{
+		return;
+	}
+
+	// The folder isn't moved immediately. Rather, its key is updated here and the items are only
+	// sorted again (if they're no longer in order) once a batch of sizes has been calculated.
+	if (m_directoryState.sortedItemIndex.Contains(result->itemInternalIndex))
+	{
+		m_directoryState.sortedItemIndex.UpdateKey(result->itemInternalIndex,
+			GetSortKey(result->itemInternalIndex));
+	}
+
+	if (!m_folderSizeSortPending)
+	{
+		m_folderSizeSortPending = true;
+		SetTimer(m_hListView, SORT_BY_FOLDER_SIZE_TIMER_ID, SORT_BY_FOLDER_SIZE_TIMEOUT, nullptr);
+	}
+}
+
+void ShellBrowser::OnSortByFolderSizeTimer()
+{
+	KillTimer(m_hListView, SORT_BY_FOLDER_SIZE_TIMER_ID);
+	m_folderSizeSortPending = false;
+
+	if (m_folderSettings.sortMode != +SortMode::Size)
+	{
+		return;
+	}
+
+	const auto &sortedItemIndex = m_directoryState.sortedItemIndex;
+
+	if (sortedItemIndex.IsValid(m_folderSettings.sortMode, GetSortKeyOptions())
+		&& sortedItemIndex.IsSorted())
+	{
+		return;
+	}
+
+	RequestListViewSort();
+}
+
+void ShellBrowser::CancelFolderSizeTasks()
+{
+	m_folderSizeThreadPool.clear_queue();
+
+	// Any calculations that are currently running will be stopped early.
+	m_folderSizeStopSource.request_stop();
+	m_folderSizeStopSource = std::stop_source();
+
+	m_folderSizeResults.clear();
+	m_directoryState.pendingFolderSizeResultIds.clear();
+
+	m_folderSizeSortPending = false;
+	KillTimer(m_hListView, SORT_BY_FOLDER_SIZE_TIMER_ID);
+}
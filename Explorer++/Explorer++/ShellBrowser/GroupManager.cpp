@@ -26,6 +26,36 @@ namespace
 const uint64_t KBYTE = 1024;
 const uint64_t MBYTE = 1024 * 1024;
 const uint64_t GBYTE = 1024 * 1024 * 1024;
+
+// Determining the group for these sort modes requires each item to be opened (or its properties
+// to be queried), which can be slow, particularly for items on a network share. The groups for
+// these modes are determined on a background thread.
+bool IsGroupExpensiveToDetermine(SortMode sortMode)
+{
+	switch (sortMode)
+	{
+	case SortMode::OriginalLocation:
+	case SortMode::Owner:
+	case SortMode::ProductName:
+	case SortMode::Company:
+	case SortMode::Description:
+	case SortMode::FileVersion:
+	case SortMode::ProductVersion:
+	case SortMode::Title:
+	case SortMode::Subject:
+	case SortMode::Authors:
+	case SortMode::Keywords:
+	case SortMode::Comments:
+	case SortMode::CameraModel:
+	case SortMode::DateTaken:
+	case SortMode::Width:
+	case SortMode::Height:
+		return true;
+
+	default:
+		return false;
+	}
+}
 }
 
 BOOL ShellBrowser::GetShowInGroups() const
@@ -38,11 +68,24 @@ items into groups. */
 void ShellBrowser::SetShowInGroupsFlag(BOOL bShowInGroups)
 {
 	m_folderSettings.showInGroups = bShowInGroups;
+
+	// The items will need to be grouped from scratch the next time they're sorted.
+	m_groupsSortMode.reset();
+	CancelGroupTasks();
 }
 
 void ShellBrowser::SetShowInGroups(BOOL bShowInGroups)
 {
 	m_folderSettings.showInGroups = bShowInGroups;
+	m_groupsSortMode.reset();
+	CancelGroupTasks();
+
+	// Groups aren't supported by owner data listviews. Instead, the items are ordered by group.
+	if (m_virtualListView)
+	{
+		SortListViewItems();
+		return;
+	}
 
 	if (!m_folderSettings.showInGroups)
 	{
@@ -144,10 +187,42 @@ const ShellBrowser::ListViewGroup ShellBrowser::GetListViewGroupById(int groupId
 
 int ShellBrowser::DetermineItemGroup(int iItemInternal)
 {
-	BasicItemInfo_t basicItemInfo = getBasicItemInfo(iItemInternal);
+	auto itr = m_directoryState.itemGroupIds.find(iItemInternal);
+
+	if (itr != m_directoryState.itemGroupIds.end())
+	{
+		return itr->second;
+	}
+
+	int groupId;
+
+	if (IsGroupExpensiveToDetermine(m_folderSettings.sortMode))
+	{
+		// The item will be moved into its actual group once that's been determined.
+		QueueGroupTask(iItemInternal);
+
+		groupId = GetOrCreateListViewGroup(GroupInfo(
+			ResourceHelper::LoadString(m_resourceInstance, IDS_GROUPBY_PENDING), INT_MIN));
+	}
+	else
+	{
+		groupId = GetOrCreateListViewGroup(DetermineItemGroupInfo(getBasicItemInfo(iItemInternal),
+			m_folderSettings.sortMode, m_config->globalFolderSettings));
+	}
+
+	m_directoryState.itemGroupIds.insert({ iItemInternal, groupId });
+
+	return groupId;
+}
+
+// Note that this may be called on a background thread (see QueueGroupTask()), so it shouldn't
+// access any mutable state.
+ShellBrowser::GroupInfo ShellBrowser::DetermineItemGroupInfo(const BasicItemInfo_t &basicItemInfo,
+	SortMode sortMode, const GlobalFolderSettings &globalFolderSettings) const
+{
 	std::optional<GroupInfo> groupInfo;
 
-	switch (m_folderSettings.sortMode)
+	switch (sortMode)
 	{
 	case SortMode::Name:
 		groupInfo = DetermineItemNameGroup(basicItemInfo);
@@ -178,7 +253,7 @@ int ShellBrowser::DetermineItemGroup(int iItemInternal)
 
 	case SortMode::OriginalLocation:
 		groupInfo = DetermineItemSummaryGroup(basicItemInfo, &SCID_ORIGINAL_LOCATION,
-			m_config->globalFolderSettings);
+			globalFolderSettings);
 		break;
 
 	case SortMode::Attributes:
@@ -232,28 +307,23 @@ int ShellBrowser::DetermineItemGroup(int iItemInternal)
 		break;
 
 	case SortMode::Title:
-		groupInfo =
-			DetermineItemSummaryGroup(basicItemInfo, &PKEY_Title, m_config->globalFolderSettings);
+		groupInfo = DetermineItemSummaryGroup(basicItemInfo, &PKEY_Title, globalFolderSettings);
 		break;
 
 	case SortMode::Subject:
-		groupInfo =
-			DetermineItemSummaryGroup(basicItemInfo, &PKEY_Subject, m_config->globalFolderSettings);
+		groupInfo = DetermineItemSummaryGroup(basicItemInfo, &PKEY_Subject, globalFolderSettings);
 		break;
 
 	case SortMode::Authors:
-		groupInfo =
-			DetermineItemSummaryGroup(basicItemInfo, &PKEY_Author, m_config->globalFolderSettings);
+		groupInfo = DetermineItemSummaryGroup(basicItemInfo, &PKEY_Author, globalFolderSettings);
 		break;
 
 	case SortMode::Keywords:
-		groupInfo = DetermineItemSummaryGroup(basicItemInfo, &PKEY_Keywords,
-			m_config->globalFolderSettings);
+		groupInfo = DetermineItemSummaryGroup(basicItemInfo, &PKEY_Keywords, globalFolderSettings);
 		break;
 
 	case SortMode::Comments:
-		groupInfo =
-			DetermineItemSummaryGroup(basicItemInfo, &PKEY_Comment, m_config->globalFolderSettings);
+		groupInfo = DetermineItemSummaryGroup(basicItemInfo, &PKEY_Comment, globalFolderSettings);
 		break;
 
 	case SortMode::CameraModel:
@@ -306,7 +376,7 @@ int ShellBrowser::DetermineItemGroup(int iItemInternal)
 			ResourceHelper::LoadString(m_resourceInstance, IDS_GROUPBY_UNSPECIFIED), INT_MIN);
 	}
 
-	return GetOrCreateListViewGroup(*groupInfo);
+	return *groupInfo;
 }
 
 int ShellBrowser::GetOrCreateListViewGroup(const GroupInfo &groupInfo)
@@ -827,6 +897,25 @@ std::optional<ShellBrowser::GroupInfo> ShellBrowser::DetermineItemNetworkStatus(
 	return GroupInfo(szStatus);
 }
 
+// Removes all existing groups. If items are being shown in groups, newly added items can then be
+// placed directly into their groups, without the existing items having to be regrouped.
+void ShellBrowser::ResetGroups()
+{
+	ListView_RemoveAllGroups(m_hListView);
+
+	m_listViewGroups.clear();
+	m_groupIdCounter = 0;
+	m_directoryState.itemGroupIds.clear();
+	m_groupsSortMode.reset();
+	CancelGroupTasks();
+
+	if (m_folderSettings.showInGroups && !m_virtualListView)
+	{
+		ListView_EnableGroupView(m_hListView, TRUE);
+		m_groupsSortMode = m_folderSettings.sortMode;
+	}
+}
+
 void ShellBrowser::MoveItemsIntoGroups()
 {
 	LVITEM item;
@@ -843,6 +932,9 @@ void ShellBrowser::MoveItemsIntoGroups()
 
 	m_listViewGroups.clear();
 	m_groupIdCounter = 0;
+	m_directoryState.itemGroupIds.clear();
+	m_groupsSortMode = m_folderSettings.sortMode;
+	CancelGroupTasks();
 
 	for (i = 0; i < nItems; i++)
 	{
@@ -983,3 +1075,122 @@ std::optional<int> ShellBrowser::GetItemGroupId(int index)
 
 	return item.iGroupId;
 }
+
+void ShellBrowser::QueueGroupTask(int internalIndex)
+{
+	int groupResultId = m_groupResultIDCounter++;
+	m_directoryState.pendingGroupResultIds[internalIndex] = groupResultId;
+
+	BasicItemInfo_t basicItemInfo = getBasicItemInfo(internalIndex);
+	SortMode sortMode = m_folderSettings.sortMode;
+	GlobalFolderSettings globalFolderSettings = m_config->globalFolderSettings;
+
+	auto result = m_groupThreadPool.push(
+		[this, groupResultId, internalIndex, basicItemInfo, sortMode, globalFolderSettings](int id)
+		{
+			UNREFERENCED_PARAMETER(id);
+
+			GroupResult result = { internalIndex,
+				DetermineItemGroupInfo(basicItemInfo, sortMode, globalFolderSettings) };
+
+			PostMessage(m_hListView, WM_APP_GROUP_RESULT_READY, groupResultId, 0);
+
+			return result;
+		});
+
+	m_groupResults.insert({ groupResultId, std::move(result) });
+}
+
+void ShellBrowser::OnGroupResultReady(int groupResultId)
+{
+	m_readyGroupResultIds.push_back(groupResultId);
+
+	if (m_readyGroupResultIds.size() == 1)
+	{
+		SetTimer(m_hListView, PROCESS_GROUP_RESULTS_TIMER_ID, PROCESS_GROUP_RESULTS_TIMEOUT,
+			nullptr);
+	}
+}
+
+void ShellBrowser::ProcessGroupResults()
+{
+	KillTimer(m_hListView, PROCESS_GROUP_RESULTS_TIMER_ID);
+
+	std::vector<int> readyGroupResultIds;
+	std::swap(readyGroupResultIds, m_readyGroupResultIds);
+
+	bool groupsChanged = false;
+
+	if (!m_virtualListView)
+	{
+		SendMessage(m_hListView, WM_SETREDRAW, FALSE, NULL);
+	}
+
+	for (int groupResultId : readyGroupResultIds)
+	{
+		auto itr = m_groupResults.find(groupResultId);
+
+		if (itr == m_groupResults.end())
+		{
+			continue;
+		}
+
+		GroupResult result = itr->second.get();
+		m_groupResults.erase(itr);
+
+		// If the item has been removed, or changed (in which case another task will have been
+		// queued for it), the result can be ignored. Storing the group of a removed item would
+		// otherwise create a group that has no items.
+		auto pendingItr = m_directoryState.pendingGroupResultIds.find(result.itemInternalIndex);
+
+		if (pendingItr == m_directoryState.pendingGroupResultIds.end()
+			|| pendingItr->second != groupResultId)
+		{
+			continue;
+		}
+
+		if (!m_itemStore.Contains(result.itemInternalIndex))
+		{
+			m_directoryState.pendingGroupResultIds.erase(pendingItr);
+			continue;
+		}
+
+		m_directoryState.pendingGroupResultIds.erase(pendingItr);
+
+		int groupId = GetOrCreateListViewGroup(result.groupInfo);
+		m_directoryState.itemGroupIds[result.itemInternalIndex] = groupId;
+
+		if (!m_virtualListView)
+		{
+			auto index = LocateItemByInternalIndex(result.itemInternalIndex);
+
+			if (index)
+			{
+				InsertItemIntoGroup(*index, groupId);
+			}
+		}
+
+		groupsChanged = true;
+	}
+
+	if (!m_virtualListView)
+	{
+		SendMessage(m_hListView, WM_SETREDRAW, TRUE, NULL);
+	}
+	else if (groupsChanged)
+	{
+		// Items in an owner data listview are ordered by group, so they need to be reordered once
+		// their groups are known.
+		SortListViewItems();
+	}
+}
+
+void ShellBrowser::CancelGroupTasks()
+{
+	m_groupThreadPool.clear_queue();
+	m_groupResults.clear();
+	m_directoryState.pendingGroupResultIds.clear();
+
+	m_readyGroupResultIds.clear();
+	KillTimer(m_hListView, PROCESS_GROUP_RESULTS_TIMER_ID);
+}
@@ -6,13 +6,100 @@
 #include "ShellBrowser.h"
 #include "ItemData.h"
 #include "ViewModes.h"
+#include "../Helper/ImageHelper.h"
+#include "../Helper/ImageResampler.h"
+#include "../Helper/PersistentImageCache.h"
 #include <wil/com.h>
 #include <thumbcache.h>
+#include <cstring>
 #include <list>
 
 #define THUMBNAIL_TYPE_ICON 0
 #define THUMBNAIL_TYPE_EXTRACTED 1
 
+namespace
+{
+
+// Each thumbnail worker thread creates a single thumbnail cache instance when it starts. That
+// instance is then used for every item the thread processes.
+thread_local wil::com_ptr_nothrow<IThumbnailCache> g_thumbnailCache;
+
+struct BitmapPixels
+{
+	uint32_t width;
+	uint32_t height;
+	std::vector<uint32_t> pixels;
+};
+
+// Returns the contents of the bitmap as a 32-bit, top-down BGRA image.
+std::optional<BitmapPixels> GetBitmapPixels(HBITMAP bitmap)
+{
+	BITMAP bm;
+
+	if (GetObject(bitmap, sizeof(bm), &bm) == 0 || bm.bmWidth <= 0 || bm.bmHeight <= 0)
+	{
+		return std::nullopt;
+	}
+
+	// A negative height indicates that the bitmap is top-down.
+	BITMAPINFO bmi;
+	ImageHelper::InitBitmapInfo(&bmi, sizeof(bmi), bm.bmWidth, -bm.bmHeight, 32);
+
+	BitmapPixels bitmapPixels;
+	bitmapPixels.width = bm.bmWidth;
+	bitmapPixels.height = bm.bmHeight;
+	bitmapPixels.pixels.resize(static_cast<size_t>(bm.bmWidth) * bm.bmHeight);
+
+	wil::unique_hdc hdc(CreateCompatibleDC(nullptr));
+	int numLinesCopied = GetDIBits(hdc.get(), bitmap, 0, bm.bmHeight,
+		bitmapPixels.pixels.data(), &bmi, DIB_RGB_COLORS);
+
+	if (numLinesCopied != bm.bmHeight)
+	{
+		return std::nullopt;
+	}
+
+	return bitmapPixels;
+}
+
+// Area averaging is used here, since it's cheap and, at this size, there's little visible
+// difference between it and a higher-order filter.
+BitmapPixels ResizeBitmapPixels(const BitmapPixels &bitmapPixels, ImageResampler::Size size)
+{
+	BitmapPixels resizedPixels;
+	resizedPixels.width = size.width;
+	resizedPixels.height = size.height;
+	resizedPixels.pixels.resize(static_cast<size_t>(size.width) * size.height);
+
+	ImageResampler::Options options;
+	options.filter = ImageResampler::Filter::AreaAverage;
+
+	ImageResampler::Resize(bitmapPixels.pixels.data(), bitmapPixels.width, bitmapPixels.height,
+		bitmapPixels.width, resizedPixels.pixels.data(), size.width, size.height, size.width,
+		options);
+
+	return resizedPixels;
+}
+
+wil::unique_hbitmap CreateBitmapFromThumbnail(const ImageCacheThumbnail &thumbnail)
+{
+	SIZE size = { static_cast<LONG>(thumbnail.width), -static_cast<LONG>(thumbnail.height) };
+	void *bits;
+	HBITMAP bitmap;
+	HRESULT hr = ImageHelper::Create32BitHBITMAP(nullptr, &size, &bits, &bitmap);
+
+	if (FAILED(hr))
+	{
+		return nullptr;
+	}
+
+	std::memcpy(bits, thumbnail.pixels.data(), thumbnail.pixels.size_bytes());
+
+	return wil::unique_hbitmap(bitmap);
+}
+
+}
+
 void ShellBrowser::SetupThumbnailsView()
 {
 	HIMAGELIST himl;
@@ -33,17 +120,25 @@ void ShellBrowser::SetupThumbnailsView()
 
 	m_hListViewImageList = ListView_GetImageList(m_hListView, LVSIL_NORMAL);
 
-	himl = ImageList_Create(THUMBNAIL_ITEM_WIDTH, THUMBNAIL_ITEM_HEIGHT, ILC_COLOR32, nItems,
-		nItems + 100);
+	himl = CreateThumbnailsImageList();
 	ListView_SetImageList(m_hListView, himl, LVSIL_NORMAL);
 
-	for (i = 0; i < nItems; i++)
+	// In owner data mode, the image for each item is always requested, so it's only necessary to
+	// reset the images that have been generated.
+	if (m_virtualListView)
 	{
-		lvItem.mask = LVIF_IMAGE;
-		lvItem.iItem = i;
-		lvItem.iSubItem = 0;
-		lvItem.iImage = I_IMAGECALLBACK;
-		ListView_SetItem(m_hListView, &lvItem);
+		m_directoryState.virtualList.thumbnailIndexes.clear();
+	}
+	else
+	{
+		for (i = 0; i < nItems; i++)
+		{
+			lvItem.mask = LVIF_IMAGE;
+			lvItem.iItem = i;
+			lvItem.iSubItem = 0;
+			lvItem.iImage = I_IMAGECALLBACK;
+			ListView_SetItem(m_hListView, &lvItem);
+		}
 	}
 
 	m_bThumbnailsSetup = TRUE;
@@ -58,93 +153,372 @@ void ShellBrowser::RemoveThumbnailsView()
 
 	nItems = ListView_GetItemCount(m_hListView);
 
-	m_thumbnailThreadPool.clear_queue();
-	m_thumbnailResults.clear();
+	CancelThumbnailTasks();
 
-	for (i = 0; i < nItems; i++)
+	if (m_virtualListView)
 	{
-		lvItem.mask = LVIF_IMAGE;
-		lvItem.iItem = i;
-		lvItem.iSubItem = 0;
-		lvItem.iImage = I_IMAGECALLBACK;
-		ListView_SetItem(m_hListView, &lvItem);
+		m_directoryState.virtualList.thumbnailIndexes.clear();
+	}
+	else
+	{
+		for (i = 0; i < nItems; i++)
+		{
+			lvItem.mask = LVIF_IMAGE;
+			lvItem.iItem = i;
+			lvItem.iSubItem = 0;
+			lvItem.iImage = I_IMAGECALLBACK;
+			ListView_SetItem(m_hListView, &lvItem);
+		}
 	}
 
 	/* Destroy the thumbnails imagelist. */
 	himl = ListView_GetImageList(m_hListView, LVSIL_NORMAL);
 
 	ImageList_Destroy(himl);
+	m_thumbnailImageStore.Clear();
 
 	m_bThumbnailsSetup = FALSE;
 }
 
-void ShellBrowser::QueueThumbnailTask(int internalIndex)
+// Rather than reserving space for every item up front, the image list starts out empty. The number
+// of images it holds is then limited by the thumbnail store.
+HIMAGELIST ShellBrowser::CreateThumbnailsImageList()
 {
+	m_thumbnailImageStore.Clear();
+
+	return ImageList_Create(THUMBNAIL_ITEM_WIDTH, THUMBNAIL_ITEM_HEIGHT, ILC_COLOR32, 0,
+		THUMBNAIL_IMAGE_LIST_GROW_SIZE);
+}
+
+// The item index is used to prioritize the task, so that the thumbnails for the items that are
+// visible are extracted first. Extracting a thumbnail that's already in the system thumbnail cache
+// is relatively quick, but it still involves binding to the item, so that check is always performed
+// in the background as well.
+void ShellBrowser::QueueThumbnailTask(int itemIndex, int internalIndex)
+{
+	// Any tasks for items that have been scrolled out of view will be dropped once the listview
+	// has finished requesting the images for the items that are now visible.
+	ScheduleThumbnailTaskVisibleRangeUpdate();
+
 	int thumbnailResultID = m_thumbnailResultIDCounter++;
 
 	BasicItemInfo_t basicItemInfo = getBasicItemInfo(internalIndex);
+	auto cacheKey = GetImageCacheKey(internalIndex);
 
-	auto result = m_thumbnailThreadPool.push(
-		[this, thumbnailResultID, internalIndex, basicItemInfo](
-			int id) -> std::optional<ThumbnailResult_t>
+	auto task = std::make_shared<std::packaged_task<std::optional<ThumbnailResult_t>()>>(
+		[listView = m_hListView, thumbnailResultID, internalIndex, basicItemInfo,
+			cacheKey]() -> std::optional<ThumbnailResult_t>
 		{
-			UNREFERENCED_PARAMETER(id);
+			auto bitmap = GetThumbnail(g_thumbnailCache.get(), basicItemInfo.pidlComplete.get());
+			std::optional<BitmapPixels> bitmapPixels;
 
-			auto bitmap = GetThumbnail(basicItemInfo.pidlComplete.get(),
-				WTS_EXTRACT | WTS_SCALETOREQUESTEDSIZE);
+			if (bitmap)
+			{
+				bitmapPixels = GetBitmapPixels(bitmap.get());
+			}
+
+			// The thumbnail cache returns the thumbnail at the size it was cached at, which is
+			// typically larger than the size needed here. The thumbnail is scaled down on this
+			// thread, rather than by the cache, since the resampler produces a sharper result.
+			if (bitmapPixels)
+			{
+				auto size = ImageResampler::FitWithin(
+					{ static_cast<int>(bitmapPixels->width),
+						static_cast<int>(bitmapPixels->height) },
+					{ THUMBNAIL_ITEM_WIDTH, THUMBNAIL_ITEM_HEIGHT });
+
+				if (size.width != static_cast<int>(bitmapPixels->width)
+					|| size.height != static_cast<int>(bitmapPixels->height))
+				{
+					bitmapPixels = ResizeBitmapPixels(*bitmapPixels, size);
+					bitmap = CreateBitmapFromThumbnail({ bitmapPixels->width,
+						bitmapPixels->height, bitmapPixels->pixels });
+				}
+			}
+
+			// The message is posted even if the lookup fails, so that the pending result is
+			// removed.
+			PostMessage(listView, WM_APP_THUMBNAIL_RESULT_READY, thumbnailResultID, 0);
 
 			if (!bitmap)
 			{
 				return std::nullopt;
 			}
 
-			PostMessage(m_hListView, WM_APP_THUMBNAIL_RESULT_READY, thumbnailResultID, 0);
-
 			ThumbnailResult_t result;
 			result.itemInternalIndex = internalIndex;
+
+			if (cacheKey && bitmapPixels)
+			{
+				result.cacheKey = cacheKey;
+				result.width = bitmapPixels->width;
+				result.height = bitmapPixels->height;
+				result.pixels = std::move(bitmapPixels->pixels);
+			}
+
 			result.bitmap = std::move(bitmap);
 
 			return result;
 		});
 
-	m_thumbnailResults.insert({ thumbnailResultID, std::move(result) });
+	// As with column tasks, the result won't be processed until after this function has returned,
+	// so it doesn't matter if the task finishes before it's been added to the list of results.
+	m_thumbnailTaskScheduler.Push(thumbnailResultID, itemIndex,
+		[task]()
+		{
+			(*task)();
+		});
+
+	m_thumbnailResults.insert({ thumbnailResultID, { internalIndex, task->get_future() } });
 }
 
-std::optional<int> ShellBrowser::GetCachedThumbnailIndex(const ItemInfo_t &itemInfo)
+// This is called while the listview is requesting item images (via LVN_GETDISPINFO), at which point
+// it's not safe to modify other items. Updating the visible range can reset the images of other
+// items, so the update is deferred until the current batch of requests has been handled. Any
+// number of requests made in the meantime will only result in a single update.
+void ShellBrowser::ScheduleThumbnailTaskVisibleRangeUpdate()
 {
-	auto bitmap =
-		GetThumbnail(itemInfo.pidlComplete.get(), WTS_INCACHEONLY | WTS_SCALETOREQUESTEDSIZE);
+	if (m_thumbnailVisibleRangeUpdatePending)
+	{
+		return;
+	}
 
-	if (!bitmap)
+	m_thumbnailVisibleRangeUpdatePending = true;
+	PostMessage(m_hListView, WM_APP_UPDATE_THUMBNAIL_VISIBLE_RANGE, 0, 0);
+}
+
+void ShellBrowser::OnUpdateThumbnailTaskVisibleRange()
+{
+	m_thumbnailVisibleRangeUpdatePending = false;
+
+	// The view mode may have changed since the update was scheduled.
+	if (m_folderSettings.viewMode != +ViewMode::Thumbnails)
+	{
+		return;
+	}
+
+	UpdateThumbnailTaskVisibleRange();
+}
+
+void ShellBrowser::UpdateThumbnailTaskVisibleRange()
+{
+	auto visibleRange = GetThumbnailsVisibleRange();
+
+	if (!visibleRange)
+	{
+		return;
+	}
+
+	MarkVisibleThumbnailsUsed(visibleRange->first, visibleRange->second);
+
+	auto droppedTaskIds =
+		m_thumbnailTaskScheduler.SetVisibleRange(visibleRange->first, visibleRange->second);
+
+	// The dropped tasks will never run. Resetting the image for each of those items means that the
+	// task will be queued again if the item is scrolled back into view.
+	for (int taskId : droppedTaskIds)
+	{
+		auto itr = m_thumbnailResults.find(taskId);
+
+		if (itr == m_thumbnailResults.end())
+		{
+			continue;
+		}
+
+		int internalIndex = itr->second.itemInternalIndex;
+		m_thumbnailResults.erase(itr);
+
+		ResetThumbnailImage(internalIndex);
+	}
+}
+
+// The listview only requests the image for an item once (in the standard case) and only while the
+// item is visible (in the owner data case). Either way, it doesn't indicate when an item's
+// thumbnail is shown again, so the thumbnails for the visible items are marked as used here,
+// whenever the visible range changes. That ensures those thumbnails won't be evicted.
+void ShellBrowser::MarkVisibleThumbnailsUsed(int firstItem, int lastItem)
+{
+	auto range = std::make_pair(firstItem, lastItem);
+
+	if (m_directoryState.thumbnailVisibleRange == range)
+	{
+		return;
+	}
+
+	m_directoryState.thumbnailVisibleRange = range;
+
+	// Items are marked in reverse, so that the items are ordered from first to last, once they've
+	// all been moved to the front of the list.
+	for (int i = lastItem; i >= firstItem; i--)
+	{
+		m_thumbnailImageStore.GetItemSlot(GetItemInternalIndex(i));
+	}
+}
+
+// Switches the item back to its icon thumbnail. The listview will request the image again when the
+// item is next shown, at which point the thumbnail will be retrieved again.
+void ShellBrowser::ResetThumbnailImage(int internalIndex)
+{
+	if (m_virtualListView)
+	{
+		m_directoryState.virtualList.thumbnailIndexes.erase(internalIndex);
+		return;
+	}
+
+	auto index = LocateItemByInternalIndex(internalIndex);
+
+	if (!index)
+	{
+		return;
+	}
+
+	LVITEM lvItem;
+	lvItem.mask = LVIF_IMAGE;
+	lvItem.iItem = *index;
+	lvItem.iSubItem = 0;
+	lvItem.iImage = I_IMAGECALLBACK;
+	ListView_SetItem(m_hListView, &lvItem);
+}
+
+// ListView_GetTopIndex() only works in list and details view. When the items are auto-arranged in
+// thumbnails view, they're laid out in rows of equal size, so the visible range can be calculated
+// from the position of the first item instead.
+std::optional<std::pair<int, int>> ShellBrowser::GetThumbnailsVisibleRange() const
+{
+	int numItems = ListView_GetItemCount(m_hListView);
+
+	if (numItems == 0)
+	{
+		return std::nullopt;
+	}
+
+	RECT firstItemRect;
+	RECT clientRect;
+
+	if (!ListView_GetItemRect(m_hListView, 0, &firstItemRect, LVIR_BOUNDS)
+		|| !GetClientRect(m_hListView, &clientRect))
 	{
 		return std::nullopt;
 	}
 
-	return GetExtractedThumbnail(bitmap.get());
+	// If the items aren't auto-arranged, there's no simple relationship between an item's index
+	// and its position, so each item's position has to be checked. The range returned covers all
+	// the visible items, though it may also include some items that aren't visible.
+	if (!GetAutoArrange())
+	{
+		std::optional<std::pair<int, int>> visibleRange;
+
+		for (int i = 0; i < numItems; i++)
+		{
+			RECT itemRect;
+			RECT visibleRect;
+
+			if (!ListView_GetItemRect(m_hListView, i, &itemRect, LVIR_BOUNDS)
+				|| !IntersectRect(&visibleRect, &itemRect, &clientRect))
+			{
+				continue;
+			}
+
+			if (!visibleRange)
+			{
+				visibleRange = std::make_pair(i, i);
+			}
+
+			visibleRange->second = i;
+		}
+
+		return visibleRange;
+	}
+
+	DWORD spacing = ListView_GetItemSpacing(m_hListView, FALSE);
+	int itemWidth = max(static_cast<int>(LOWORD(spacing)), 1);
+	int itemHeight = max(static_cast<int>(HIWORD(spacing)), 1);
+
+	int itemsPerRow = max((clientRect.right - firstItemRect.left) / itemWidth, 1);
+
+	// The first item's position is relative to the client area, so it will be negative once the
+	// listview has been scrolled down.
+	int firstVisibleRow = max(-firstItemRect.top / itemHeight, 0);
+	int numVisibleRows = (clientRect.bottom - clientRect.top) / itemHeight + 2;
+
+	int firstItem = min(firstVisibleRow * itemsPerRow, numItems - 1);
+	int lastItem = min(firstItem + numVisibleRows * itemsPerRow - 1, numItems - 1);
+
+	return std::make_pair(firstItem, lastItem);
 }
 
-wil::unique_hbitmap ShellBrowser::GetThumbnail(PIDLIST_ABSOLUTE pidl, WTS_FLAGS flags)
+void ShellBrowser::CancelThumbnailTasks()
 {
-	wil::com_ptr_nothrow<IShellItem> shellItem;
-	HRESULT hr = SHCreateItemFromIDList(pidl, IID_PPV_ARGS(&shellItem));
+	m_thumbnailTaskScheduler.ClearQueue();
+	m_thumbnailResults.clear();
+}
 
-	if (FAILED(hr))
+void ShellBrowser::OnThumbnailThreadStart()
+{
+	CoInitializeEx(nullptr, COINIT_APARTMENTTHREADED);
+
+	// If this fails, the thread won't be able to extract any thumbnails, but the tasks will still
+	// run (and fail).
+	CoCreateInstance(CLSID_LocalThumbnailCache, nullptr, CLSCTX_INPROC_SERVER,
+		IID_PPV_ARGS(&g_thumbnailCache));
+}
+
+void ShellBrowser::OnThumbnailThreadExit()
+{
+	// The cache has to be released before COM is uninitialized on this thread.
+	g_thumbnailCache.reset();
+
+	CoUninitialize();
+}
+
+std::optional<int> ShellBrowser::GetPersistedThumbnailIndex(int internalIndex)
+{
+	auto cacheKey = GetImageCacheKey(internalIndex);
+
+	if (!cacheKey)
+	{
+		return std::nullopt;
+	}
+
+	auto thumbnail = m_persistentImageCache->GetStore()->GetThumbnail(*cacheKey);
+
+	if (!thumbnail)
+	{
+		return std::nullopt;
+	}
+
+	auto bitmap = CreateBitmapFromThumbnail(*thumbnail);
+
+	if (!bitmap)
+	{
+		return std::nullopt;
+	}
+
+	return GetExtractedThumbnail(internalIndex, bitmap.get());
+}
+
+wil::unique_hbitmap ShellBrowser::GetThumbnail(IThumbnailCache *thumbnailCache,
+	PCIDLIST_ABSOLUTE pidl)
+{
+	if (!thumbnailCache)
 	{
 		return nullptr;
 	}
 
-	wil::com_ptr_nothrow<IThumbnailCache> thumbnailCache;
-	hr = CoCreateInstance(CLSID_LocalThumbnailCache, nullptr, CLSCTX_INPROC_SERVER,
-		IID_PPV_ARGS(&thumbnailCache));
+	wil::com_ptr_nothrow<IShellItem> shellItem;
+	HRESULT hr = SHCreateItemFromIDList(pidl, IID_PPV_ARGS(&shellItem));
 
 	if (FAILED(hr))
 	{
 		return nullptr;
 	}
 
+	// If the thumbnail is already in the system cache, it will be returned directly, rather than
+	// being extracted again. The thumbnail isn't scaled to the requested size here, since that's
+	// done by the caller.
 	wil::com_ptr_nothrow<ISharedBitmap> sharedBitmap;
-	hr = thumbnailCache->GetThumbnail(shellItem.get(), THUMBNAIL_ITEM_WIDTH, flags, &sharedBitmap,
-		nullptr, nullptr);
+	hr = thumbnailCache->GetThumbnail(shellItem.get(), THUMBNAIL_ITEM_WIDTH, WTS_EXTRACT,
+		&sharedBitmap, nullptr, nullptr);
 
 	if (FAILED(hr))
 	{
@@ -171,31 +545,61 @@ void ShellBrowser::ProcessThumbnailResult(int thumbnailResultId)
 
 	if (itr == m_thumbnailResults.end())
 	{
+		// This result is for a previous folder (or the view mode has since changed).
+		m_thumbnailTaskScheduler.RecordWastedTask();
 		return;
 	}
 
+	auto result = itr->second.result.get();
+	m_thumbnailResults.erase(itr);
+
 	if (m_folderSettings.viewMode != +ViewMode::Thumbnails)
 	{
+		m_thumbnailTaskScheduler.RecordWastedTask();
 		return;
 	}
 
-	auto result = itr->second.get();
-
 	if (!result)
 	{
 		// Thumbnail lookup failed.
 		return;
 	}
 
-	int imageIndex = GetExtractedThumbnail(result->bitmap.get());
+	if (result->cacheKey)
+	{
+		m_persistentImageCache->GetStore()->SetThumbnail(*result->cacheKey, result->width,
+			result->height, std::move(result->pixels));
+	}
+
+	if (m_virtualListView)
+	{
+		auto &thumbnailIndexes = m_directoryState.virtualList.thumbnailIndexes;
+
+		if (!thumbnailIndexes.contains(result->itemInternalIndex))
+		{
+			m_thumbnailTaskScheduler.RecordWastedTask();
+			return;
+		}
+
+		// Note that generating the thumbnail can evict another item's entry from the map, so the
+		// entry for this item is only looked up again afterwards.
+		int imageIndex = GetExtractedThumbnail(result->itemInternalIndex, result->bitmap.get());
+		thumbnailIndexes[result->itemInternalIndex] = imageIndex;
+		InvalidateRect(m_hListView, nullptr, FALSE);
+
+		return;
+	}
 
 	auto index = LocateItemByInternalIndex(result->itemInternalIndex);
 
 	if (!index)
 	{
+		m_thumbnailTaskScheduler.RecordWastedTask();
 		return;
 	}
 
+	int imageIndex = GetExtractedThumbnail(result->itemInternalIndex, result->bitmap.get());
+
 	LVITEM lvItem;
 	lvItem.mask = LVIF_IMAGE;
 	lvItem.iItem = *index;
@@ -204,19 +608,45 @@ void ShellBrowser::ProcessThumbnailResult(int thumbnailResultId)
 	ListView_SetItem(m_hListView, &lvItem);
 }
 
-/* Draws a thumbnail based on an items icon. */
-int ShellBrowser::GetIconThumbnail(int iInternalIndex) const
+// Icon thumbnails only depend on the item's icon, so they're shared between all the items that
+// have the same icon.
+int ShellBrowser::GetIconThumbnail(int iInternalIndex)
 {
-	return GetThumbnailInternal(THUMBNAIL_TYPE_ICON, iInternalIndex, nullptr);
+	SHFILEINFO shfi = {};
+	SHGetFileInfo((LPCTSTR) m_itemStore.GetPidlComplete(iInternalIndex), 0, &shfi, sizeof(shfi),
+		SHGFI_PIDL | SHGFI_SYSICONINDEX);
+
+	auto existingImage = m_thumbnailImageStore.GetIconSlot(shfi.iIcon);
+
+	if (existingImage)
+	{
+		return *existingImage;
+	}
+
+	int iImage = m_thumbnailImageStore.AllocateIconSlot(shfi.iIcon);
+	SetThumbnailImage(iImage, THUMBNAIL_TYPE_ICON, shfi.iIcon, nullptr);
+
+	return iImage;
 }
 
 /* Draws an items extracted thumbnail. */
-int ShellBrowser::GetExtractedThumbnail(HBITMAP hThumbnailBitmap) const
+int ShellBrowser::GetExtractedThumbnail(int iInternalIndex, HBITMAP hThumbnailBitmap)
 {
-	return GetThumbnailInternal(THUMBNAIL_TYPE_EXTRACTED, 0, hThumbnailBitmap);
+	auto allocation = m_thumbnailImageStore.AllocateItemSlot(iInternalIndex);
+
+	// The evicted item is no longer visible, since the thumbnails for the visible items are always
+	// the most recently used.
+	if (allocation.evictedItem)
+	{
+		ResetThumbnailImage(*allocation.evictedItem);
+	}
+
+	SetThumbnailImage(allocation.slot, THUMBNAIL_TYPE_EXTRACTED, 0, hThumbnailBitmap);
+
+	return allocation.slot;
 }
 
-int ShellBrowser::GetThumbnailInternal(int iType, int iInternalIndex,
+void ShellBrowser::SetThumbnailImage(int iImage, int iType, int iIconIndex,
 	HBITMAP hThumbnailBitmap) const
 {
 	HDC hdc;
@@ -225,7 +655,6 @@ int ShellBrowser::GetThumbnailInternal(int iType, int iInternalIndex,
 	HBITMAP hBackingBitmapOld;
 	HIMAGELIST himl;
 	HBRUSH hbr;
-	int iImage;
 
 	hdc = GetDC(m_hListView);
 	hdcBacking = CreateCompatibleDC(hdc);
@@ -242,7 +671,7 @@ int ShellBrowser::GetThumbnailInternal(int iType, int iInternalIndex,
 
 	if (iType == THUMBNAIL_TYPE_ICON)
 	{
-		DrawIconThumbnailInternal(hdcBacking, iInternalIndex);
+		DrawIconThumbnailInternal(hdcBacking, iIconIndex);
 	}
 	else if (iType == THUMBNAIL_TYPE_EXTRACTED)
 	{
@@ -257,27 +686,30 @@ int ShellBrowser::GetThumbnailInternal(int iType, int iInternalIndex,
 	DeleteDC(hdcBacking);
 	ReleaseDC(m_hListView, hdc);
 
-	/* Add the new bitmap to the imagelist. */
+	// Slots are allocated in order, so an image that's not in the imagelist yet will always be
+	// the next one added.
 	himl = ListView_GetImageList(m_hListView, LVSIL_NORMAL);
-	iImage = ImageList_Add(himl, hBackingBitmap, nullptr);
+
+	if (iImage < ImageList_GetImageCount(himl))
+	{
+		ImageList_Replace(himl, iImage, hBackingBitmap, nullptr);
+	}
+	else
+	{
+		ImageList_Add(himl, hBackingBitmap, nullptr);
+	}
 
 	/* Now delete the backing bitmap. */
 	DeleteObject(hBackingBitmap);
-
-	return iImage;
 }
 
-void ShellBrowser::DrawIconThumbnailInternal(HDC hdcBacking, int iInternalIndex) const
+void ShellBrowser::DrawIconThumbnailInternal(HDC hdcBacking, int iIconIndex) const
 {
 	HICON hIcon;
-	SHFILEINFO shfi;
 	int iIconWidth;
 	int iIconHeight;
 
-	SHGetFileInfo((LPCTSTR) m_itemInfoMap.at(iInternalIndex).pidlComplete.get(), 0, &shfi,
-		sizeof(shfi), SHGFI_PIDL | SHGFI_SYSICONINDEX);
-
-	hIcon = ImageList_GetIcon(m_hListViewImageList, shfi.iIcon, ILD_NORMAL);
+	hIcon = ImageList_GetIcon(m_hListViewImageList, iIconIndex, ILD_NORMAL);
 
 	ImageList_GetIconSize(m_hListViewImageList, &iIconWidth, &iIconHeight);
 
@@ -7,6 +7,29 @@
 #include "../Helper/Macros.h"
 #include "../Helper/ShellHelper.h"
 #include <wil/resource.h>
+#include <string>
+
+// The full set of data retrieved for an item when it's enumerated. Once an item has been added to
+// a folder, this data is held in the folder's ItemStore instead.
+struct ItemInfo_t
+{
+	unique_pidl_absolute pidlComplete;
+	unique_pidl_child pridl;
+	WIN32_FIND_DATA wfd;
+	bool isFindDataValid;
+	std::wstring parsingName;
+	std::wstring displayName;
+	std::wstring editingName;
+
+	/* Drives are needed so that, when a drive is removed
+	from the system, the item representing it can be found
+	(via its parsing name). */
+	BOOL bDrive;
+
+	ItemInfo_t() : wfd({}), isFindDataValid(false), bDrive(FALSE)
+	{
+	}
+};
 
 struct BasicItemInfo_t
 {
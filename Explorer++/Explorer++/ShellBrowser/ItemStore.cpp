@@ -0,0 +1,452 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "ItemStore.h"
+#include <wil/common.h>
+#include <stdexcept>
+
+void ItemStore::Insert(int id, ItemInfo_t &&itemInfo)
+{
+	assert(id >= 0);
+
+	if (static_cast<size_t>(id) >= m_positions.size())
+	{
+		m_positions.resize(id + 1, INVALID_POSITION);
+	}
+
+	assert(m_positions[id] == INVALID_POSITION);
+
+	size_t position = m_ids.size();
+	m_positions[id] = static_cast<uint32_t>(position);
+
+	m_ids.push_back(id);
+	m_attributes.emplace_back();
+	m_fileSizes.emplace_back();
+	m_creationTimes.emplace_back();
+	m_lastAccessTimes.emplace_back();
+	m_lastWriteTimes.emplace_back();
+	m_displayNames.emplace_back();
+	m_flags.emplace_back();
+	m_relativeSort.emplace_back();
+	m_coldData.emplace_back();
+
+	SetItemData(position, std::move(itemInfo));
+	AddToIndexes(position);
+}
+
+void ItemStore::Replace(int id, ItemInfo_t &&itemInfo)
+{
+	size_t position = GetPosition(id);
+
+	// Replacing an item can change both its PIDL and filename (e.g. when the item is renamed).
+	RemoveFromIndexes(position);
+	SetItemData(position, std::move(itemInfo));
+	AddToIndexes(position);
+
+	CompactStringsIfNecessary();
+}
+
+void ItemStore::SetItemData(size_t position, ItemInfo_t &&itemInfo)
+{
+	const WIN32_FIND_DATA &wfd = itemInfo.wfd;
+
+	ULARGE_INTEGER fileSize = { wfd.nFileSizeLow, wfd.nFileSizeHigh };
+
+	m_attributes[position] = wfd.dwFileAttributes;
+	m_fileSizes[position] = fileSize.QuadPart;
+	m_creationTimes[position] = wfd.ftCreationTime;
+	m_lastAccessTimes[position] = wfd.ftLastAccessTime;
+	m_lastWriteTimes[position] = wfd.ftLastWriteTime;
+
+	// For the majority of items, the display name, filename and editing name will all be
+	// identical, in which case they'll all share the same interned string.
+	m_displayNames[position] = m_strings.Intern(itemInfo.displayName);
+
+	uint8_t flags = 0;
+	WI_SetFlagIf(flags, FindDataValid, itemInfo.isFindDataValid);
+	WI_SetFlagIf(flags, Drive, itemInfo.bDrive);
+	m_flags[position] = flags;
+
+	ColdData &coldData = m_coldData[position];
+	coldData.pidlComplete = std::move(itemInfo.pidlComplete);
+	coldData.pridl = std::move(itemInfo.pridl);
+	coldData.fileName = m_strings.Intern(wfd.cFileName);
+	coldData.parsingName = m_strings.Intern(itemInfo.parsingName);
+	coldData.editingName = m_strings.Intern(itemInfo.editingName);
+}
+
+void ItemStore::Erase(int id)
+{
+	size_t position = GetPosition(id);
+	size_t lastPosition = m_ids.size() - 1;
+
+	RemoveFromIndexes(position);
+
+	// The last item is moved into the position being vacated, so that the arrays remain
+	// contiguous.
+	if (position != lastPosition)
+	{
+		int lastId = m_ids[lastPosition];
+
+		m_ids[position] = lastId;
+		m_attributes[position] = m_attributes[lastPosition];
+		m_fileSizes[position] = m_fileSizes[lastPosition];
+		m_creationTimes[position] = m_creationTimes[lastPosition];
+		m_lastAccessTimes[position] = m_lastAccessTimes[lastPosition];
+		m_lastWriteTimes[position] = m_lastWriteTimes[lastPosition];
+		m_displayNames[position] = m_displayNames[lastPosition];
+		m_flags[position] = m_flags[lastPosition];
+		m_relativeSort[position] = m_relativeSort[lastPosition];
+		m_coldData[position] = std::move(m_coldData[lastPosition]);
+
+		m_positions[lastId] = static_cast<uint32_t>(position);
+	}
+
+	m_ids.pop_back();
+	m_attributes.pop_back();
+	m_fileSizes.pop_back();
+	m_creationTimes.pop_back();
+	m_lastAccessTimes.pop_back();
+	m_lastWriteTimes.pop_back();
+	m_displayNames.pop_back();
+	m_flags.pop_back();
+	m_relativeSort.pop_back();
+	m_coldData.pop_back();
+
+	m_positions[id] = INVALID_POSITION;
+
+	CompactStringsIfNecessary();
+}
+
+void ItemStore::Clear()
+{
+	// Each folder has its own store, so the memory is released here, rather than being retained
+	// for the next folder.
+	*this = {};
+}
+
+bool ItemStore::Contains(int id) const
+{
+	return id >= 0 && static_cast<size_t>(id) < m_positions.size()
+		&& m_positions[id] != INVALID_POSITION;
+}
+
+size_t ItemStore::GetNumItems() const
+{
+	return m_ids.size();
+}
+
+const std::vector<int> &ItemStore::GetIds() const
+{
+	return m_ids;
+}
+
+DWORD ItemStore::GetAttributes(int id) const
+{
+	return m_attributes[GetPosition(id)];
+}
+
+bool ItemStore::IsFolder(int id) const
+{
+	return WI_IsFlagSet(GetAttributes(id), FILE_ATTRIBUTE_DIRECTORY);
+}
+
+uint64_t ItemStore::GetFileSize(int id) const
+{
+	return m_fileSizes[GetPosition(id)];
+}
+
+bool ItemStore::IsFindDataValid(int id) const
+{
+	return WI_IsFlagSet(m_flags[GetPosition(id)], FindDataValid);
+}
+
+bool ItemStore::IsDrive(int id) const
+{
+	return WI_IsFlagSet(m_flags[GetPosition(id)], Drive);
+}
+
+std::wstring_view ItemStore::GetDisplayName(int id) const
+{
+	return m_strings.Get(m_displayNames[GetPosition(id)]);
+}
+
+std::wstring_view ItemStore::GetFileName(int id) const
+{
+	return m_strings.Get(m_coldData[GetPosition(id)].fileName);
+}
+
+std::wstring_view ItemStore::GetParsingName(int id) const
+{
+	return m_strings.Get(m_coldData[GetPosition(id)].parsingName);
+}
+
+std::wstring_view ItemStore::GetEditingName(int id) const
+{
+	return m_strings.Get(m_coldData[GetPosition(id)].editingName);
+}
+
+void ItemStore::SetDisplayName(int id, std::wstring_view displayName)
+{
+	m_displayNames[GetPosition(id)] = m_strings.Intern(displayName);
+
+	CompactStringsIfNecessary();
+}
+
+std::optional<int> ItemStore::FindByPidlChild(PCITEMID_CHILD pidlChild) const
+{
+	UINT size = ILGetSize(pidlChild);
+	auto [first, last] = m_pidlIndex.equal_range(HashPidlChild(pidlChild));
+
+	for (auto itr = first; itr != last; ++itr)
+	{
+		PCITEMID_CHILD currentPidlChild = GetPidlChild(itr->second);
+
+		if (currentPidlChild && ILGetSize(currentPidlChild) == size
+			&& memcmp(currentPidlChild, pidlChild, size) == 0)
+		{
+			return itr->second;
+		}
+	}
+
+	return std::nullopt;
+}
+
+std::optional<int> ItemStore::FindByFileName(std::wstring_view fileName) const
+{
+	std::optional<int> caseInsensitiveMatch;
+	std::wstring normalizedFileName = NormalizeFileName(fileName);
+	auto [first, last] =
+		m_fileNameIndex.equal_range(std::hash<std::wstring>{}(normalizedFileName));
+
+	for (auto itr = first; itr != last; ++itr)
+	{
+		auto currentFileName = GetFileName(itr->second);
+
+		if (currentFileName == fileName)
+		{
+			return itr->second;
+		}
+
+		if (!caseInsensitiveMatch && NormalizeFileName(currentFileName) == normalizedFileName)
+		{
+			caseInsensitiveMatch = itr->second;
+		}
+	}
+
+	return caseInsensitiveMatch;
+}
+
+PCIDLIST_ABSOLUTE ItemStore::GetPidlComplete(int id) const
+{
+	return m_coldData[GetPosition(id)].pidlComplete.get();
+}
+
+PCITEMID_CHILD ItemStore::GetPidlChild(int id) const
+{
+	return m_coldData[GetPosition(id)].pridl.get();
+}
+
+// Note that only the fields used within Explorer++ are retained, so the short filename and reserved
+// fields will always be empty.
+WIN32_FIND_DATA ItemStore::GetFindData(int id) const
+{
+	size_t position = GetPosition(id);
+
+	WIN32_FIND_DATA wfd = {};
+	wfd.dwFileAttributes = m_attributes[position];
+	wfd.ftCreationTime = m_creationTimes[position];
+	wfd.ftLastAccessTime = m_lastAccessTimes[position];
+	wfd.ftLastWriteTime = m_lastWriteTimes[position];
+
+	ULARGE_INTEGER fileSize;
+	fileSize.QuadPart = m_fileSizes[position];
+	wfd.nFileSizeLow = fileSize.LowPart;
+	wfd.nFileSizeHigh = fileSize.HighPart;
+
+	auto fileName = m_strings.Get(m_coldData[position].fileName);
+	StringCchCopy(wfd.cFileName, SIZEOF_ARRAY(wfd.cFileName), fileName.data());
+
+	return wfd;
+}
+
+BasicItemInfo_t ItemStore::GetBasicItemInfo(int id, bool includePidls) const
+{
+	size_t position = GetPosition(id);
+
+	BasicItemInfo_t basicItemInfo;
+
+	if (includePidls)
+	{
+		basicItemInfo.pidlComplete.reset(ILCloneFull(m_coldData[position].pidlComplete.get()));
+		basicItemInfo.pridl.reset(ILCloneChild(m_coldData[position].pridl.get()));
+	}
+
+	basicItemInfo.wfd = GetFindData(id);
+	basicItemInfo.isFindDataValid = WI_IsFlagSet(m_flags[position], FindDataValid);
+	StringCchCopy(basicItemInfo.szDisplayName, SIZEOF_ARRAY(basicItemInfo.szDisplayName),
+		m_strings.Get(m_displayNames[position]).data());
+	basicItemInfo.isRoot = WI_IsFlagSet(m_flags[position], Drive);
+
+	return basicItemInfo;
+}
+
+int ItemStore::GetRelativeSort(int id) const
+{
+	return m_relativeSort[GetPosition(id)];
+}
+
+void ItemStore::SetRelativeSort(int id, int relativeSort)
+{
+	m_relativeSort[GetPosition(id)] = relativeSort;
+}
+
+ItemStore::MemoryUsage ItemStore::GetMemoryUsage() const
+{
+	MemoryUsage memoryUsage = {};
+
+	memoryUsage.hotData = m_ids.capacity() * sizeof(int)
+		+ m_attributes.capacity() * sizeof(DWORD) + m_fileSizes.capacity() * sizeof(uint64_t)
+		+ m_creationTimes.capacity() * sizeof(FILETIME)
+		+ m_lastAccessTimes.capacity() * sizeof(FILETIME)
+		+ m_lastWriteTimes.capacity() * sizeof(FILETIME)
+		+ m_displayNames.capacity() * sizeof(NameHandle) + m_flags.capacity() * sizeof(uint8_t)
+		+ m_relativeSort.capacity() * sizeof(int);
+	memoryUsage.coldData = m_coldData.capacity() * sizeof(ColdData);
+
+	for (const auto &coldData : m_coldData)
+	{
+		memoryUsage.pidls += ILGetSize(coldData.pidlComplete.get()) + ILGetSize(coldData.pridl.get());
+	}
+
+	memoryUsage.strings = m_strings.GetMemoryUsage();
+	memoryUsage.index = m_positions.capacity() * sizeof(uint32_t)
+		+ GetIndexMemoryUsage(m_pidlIndex) + GetIndexMemoryUsage(m_fileNameIndex);
+
+	return memoryUsage;
+}
+
+size_t ItemStore::GetPosition(int id) const
+{
+	// An item that has been erased still has an entry in m_positions (set to INVALID_POSITION),
+	// so checking that the id is in range isn't sufficient here.
+	if (!Contains(id))
+	{
+		throw std::out_of_range("Item not found");
+	}
+
+	return m_positions[id];
+}
+
+void ItemStore::AddToIndexes(size_t position)
+{
+	int id = m_ids[position];
+	const ColdData &coldData = m_coldData[position];
+
+	if (coldData.pridl)
+	{
+		m_pidlIndex.emplace(HashPidlChild(coldData.pridl.get()), id);
+	}
+
+	m_fileNameIndex.emplace(
+		std::hash<std::wstring>{}(NormalizeFileName(m_strings.Get(coldData.fileName))), id);
+}
+
+void ItemStore::RemoveFromIndexes(size_t position)
+{
+	int id = m_ids[position];
+	const ColdData &coldData = m_coldData[position];
+
+	if (coldData.pridl)
+	{
+		RemoveFromIndex(m_pidlIndex, HashPidlChild(coldData.pridl.get()), id);
+	}
+
+	RemoveFromIndex(m_fileNameIndex,
+		std::hash<std::wstring>{}(NormalizeFileName(m_strings.Get(coldData.fileName))), id);
+}
+
+void ItemStore::RemoveFromIndex(HashIndex &index, size_t hash, int id)
+{
+	auto [first, last] = index.equal_range(hash);
+	auto itr = std::find_if(first, last,
+		[id](const auto &entry)
+		{
+			return entry.second == id;
+		});
+
+	assert(itr != last);
+
+	if (itr != last)
+	{
+		index.erase(itr);
+	}
+}
+
+size_t ItemStore::HashPidlChild(PCITEMID_CHILD pidlChild)
+{
+	std::string_view bytes(reinterpret_cast<const char *>(pidlChild), ILGetSize(pidlChild));
+	return std::hash<std::string_view>{}(bytes);
+}
+
+std::wstring ItemStore::NormalizeFileName(std::wstring_view fileName)
+{
+	if (fileName.empty())
+	{
+		return {};
+	}
+
+	// Filenames are case-insensitive, so they're converted to uppercase before being hashed. The
+	// invariant locale is used, since the comparison shouldn't depend on the user's locale.
+	std::wstring normalizedFileName(fileName.size(), '\0');
+	int res = LCMapStringEx(LOCALE_NAME_INVARIANT, LCMAP_UPPERCASE, fileName.data(),
+		static_cast<int>(fileName.size()), normalizedFileName.data(),
+		static_cast<int>(normalizedFileName.size()), nullptr, nullptr, 0);
+
+	if (res == 0)
+	{
+		return std::wstring(fileName);
+	}
+
+	normalizedFileName.resize(res);
+
+	return normalizedFileName;
+}
+
+// Each entry is stored in a list node (holding the key/value pair, along with next and previous
+// pointers) and each bucket holds a pair of list iterators.
+size_t ItemStore::GetIndexMemoryUsage(const HashIndex &index)
+{
+	return index.bucket_count() * 2 * sizeof(void *)
+		+ index.size() * (sizeof(HashIndex::value_type) + 2 * sizeof(void *));
+}
+
+// Strings are never removed from the arena individually, so names that are no longer referenced
+// (e.g. because an item was renamed or removed) accumulate. Once the arena holds far more strings
+// than the remaining items could be referencing, the live names are copied into a new arena.
+void ItemStore::CompactStringsIfNecessary()
+{
+	// Each item references at most four distinct strings.
+	const size_t maxLiveStrings = m_ids.size() * 4;
+
+	if (m_strings.GetNumStrings() <= 1024 || m_strings.GetNumStrings() <= maxLiveStrings * 2)
+	{
+		return;
+	}
+
+	StringArena strings;
+
+	for (size_t i = 0; i < m_ids.size(); i++)
+	{
+		m_displayNames[i] = strings.Intern(m_strings.Get(m_displayNames[i]));
+
+		ColdData &coldData = m_coldData[i];
+		coldData.fileName = strings.Intern(m_strings.Get(coldData.fileName));
+		coldData.parsingName = strings.Intern(m_strings.Get(coldData.parsingName));
+		coldData.editingName = strings.Intern(m_strings.Get(coldData.editingName));
+	}
+
+	m_strings = std::move(strings);
+}
@@ -0,0 +1,150 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include "ItemData.h"
+#include "../Helper/StringArena.h"
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Holds the items in a folder. Rather than storing each item in a separate allocation, the data
+// for each item is split into columns and the columns are stored in contiguous arrays. The data
+// that's needed for every item when sorting, filtering or calculating selection sizes (attributes,
+// size, times and display name) is kept apart from the data that's only needed when an individual
+// item is being operated on (PIDLs and the parsing/editing names). The item names themselves are
+// interned in a string arena owned by the store.
+//
+// Items are identified by the internal index assigned to them by the caller. Internal indexes are
+// expected to be allocated sequentially, starting from 0. Hashed indexes are maintained so that an
+// item can also be found from its child PIDL or filename in constant time.
+class ItemStore
+{
+public:
+	struct MemoryUsage
+	{
+		size_t hotData;
+		size_t coldData;
+		size_t pidls;
+		size_t strings;
+		size_t index;
+
+		size_t GetTotal() const
+		{
+			return hotData + coldData + pidls + strings + index;
+		}
+	};
+
+	void Insert(int id, ItemInfo_t &&itemInfo);
+	void Replace(int id, ItemInfo_t &&itemInfo);
+	void Erase(int id);
+	void Clear();
+
+	// The accessors below throw std::out_of_range if the item isn't in the store. Results that are
+	// retrieved in the background may arrive after the item they're for has been removed, so code
+	// that handles those results should check this first.
+	bool Contains(int id) const;
+	size_t GetNumItems() const;
+
+	// The ids of all items currently in the store, in storage order. This order is unrelated to
+	// the order items are displayed in and changes whenever an item is removed.
+	const std::vector<int> &GetIds() const;
+
+	DWORD GetAttributes(int id) const;
+	bool IsFolder(int id) const;
+	uint64_t GetFileSize(int id) const;
+	bool IsFindDataValid(int id) const;
+	bool IsDrive(int id) const;
+
+	// The views returned by the methods below are null-terminated. They remain valid until the
+	// store is next modified.
+	std::wstring_view GetDisplayName(int id) const;
+	std::wstring_view GetFileName(int id) const;
+	std::wstring_view GetParsingName(int id) const;
+	std::wstring_view GetEditingName(int id) const;
+
+	void SetDisplayName(int id, std::wstring_view displayName);
+
+	// Child PIDLs are compared byte-for-byte, so this will only find an item if the PIDL was
+	// retrieved from the same folder as the item.
+	std::optional<int> FindByPidlChild(PCITEMID_CHILD pidlChild) const;
+
+	// Filenames are compared case-insensitively, though an exact match will be preferred if there
+	// are several items whose names differ only by case.
+	std::optional<int> FindByFileName(std::wstring_view fileName) const;
+
+	PCIDLIST_ABSOLUTE GetPidlComplete(int id) const;
+	PCITEMID_CHILD GetPidlChild(int id) const;
+
+	WIN32_FIND_DATA GetFindData(int id) const;
+
+	// Copying the item's PIDLs can be skipped if the caller only needs the item's find data and
+	// display name.
+	BasicItemInfo_t GetBasicItemInfo(int id, bool includePidls = true) const;
+
+	// Used for temporary sorting in details mode (i.e. when items need to be rearranged).
+	int GetRelativeSort(int id) const;
+	void SetRelativeSort(int id, int relativeSort);
+
+	MemoryUsage GetMemoryUsage() const;
+
+private:
+	using NameHandle = StringArena::Handle;
+
+	static constexpr uint32_t INVALID_POSITION = UINT32_MAX;
+
+	enum ItemFlags : uint8_t
+	{
+		FindDataValid = 1 << 0,
+		Drive = 1 << 1
+	};
+
+	// Data that's only needed when operating on an individual item.
+	struct ColdData
+	{
+		unique_pidl_absolute pidlComplete;
+		unique_pidl_child pridl;
+		NameHandle fileName;
+		NameHandle parsingName;
+		NameHandle editingName;
+	};
+
+	// The indexes below only store hashes, rather than copies of the PIDLs and names. Any
+	// matching entries are then checked against the data held for the item.
+	using HashIndex = std::unordered_multimap<size_t, int>;
+
+	static size_t HashPidlChild(PCITEMID_CHILD pidlChild);
+	static std::wstring NormalizeFileName(std::wstring_view fileName);
+	static void RemoveFromIndex(HashIndex &index, size_t hash, int id);
+	static size_t GetIndexMemoryUsage(const HashIndex &index);
+
+	size_t GetPosition(int id) const;
+	void SetItemData(size_t position, ItemInfo_t &&itemInfo);
+	void AddToIndexes(size_t position);
+	void RemoveFromIndexes(size_t position);
+	void CompactStringsIfNecessary();
+
+	// Maps from an item's id to its position within the arrays below.
+	std::vector<uint32_t> m_positions;
+
+	std::vector<int> m_ids;
+	std::vector<DWORD> m_attributes;
+	std::vector<uint64_t> m_fileSizes;
+	std::vector<FILETIME> m_creationTimes;
+	std::vector<FILETIME> m_lastAccessTimes;
+	std::vector<FILETIME> m_lastWriteTimes;
+	std::vector<NameHandle> m_displayNames;
+	std::vector<uint8_t> m_flags;
+	std::vector<int> m_relativeSort;
+
+	std::vector<ColdData> m_coldData;
+
+	StringArena m_strings;
+
+	HashIndex m_pidlIndex;
+	HashIndex m_fileNameIndex;
+};
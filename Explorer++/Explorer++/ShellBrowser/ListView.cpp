@@ -17,9 +17,11 @@
 #include "ShellNavigationController.h"
 #include "../Helper/CachedIcons.h"
 #include "../Helper/DragDropHelper.h"
+#include "../Helper/ExtensionIconCache.h"
 #include "../Helper/Helper.h"
 #include "../Helper/IconFetcher.h"
 #include "../Helper/ListViewHelper.h"
+#include "../Helper/PersistentImageCache.h"
 #include "../Helper/ShellHelper.h"
 #include <boost/format.hpp>
 #include <wil/common.h>
@@ -105,6 +107,14 @@ LRESULT CALLBACK ShellBrowser::ListViewProc(HWND hwnd, UINT uMsg, WPARAM wParam,
 		{
 			OnProcessShellChangeNotifications();
 		}
+		else if (wParam == PROCESS_GROUP_RESULTS_TIMER_ID)
+		{
+			ProcessGroupResults();
+		}
+		else if (wParam == SORT_BY_FOLDER_SIZE_TIMER_ID)
+		{
+			OnSortByFolderSizeTimer();
+		}
 		break;
 
 	case WM_NOTIFY:
@@ -149,6 +159,22 @@ LRESULT CALLBACK ShellBrowser::ListViewProc(HWND hwnd, UINT uMsg, WPARAM wParam,
 	case WM_APP_SHELL_NOTIFY:
 		OnShellNotify(wParam, lParam);
 		break;
+
+	case WM_APP_ENUMERATION_RESULT_READY:
+		ProcessEnumerationResult(static_cast<int>(wParam));
+		break;
+
+	case WM_APP_GROUP_RESULT_READY:
+		OnGroupResultReady(static_cast<int>(wParam));
+		break;
+
+	case WM_APP_FOLDER_SIZE_READY:
+		ProcessFolderSizeResult(static_cast<int>(wParam));
+		break;
+
+	case WM_APP_UPDATE_THUMBNAIL_VISIBLE_RANGE:
+		OnUpdateThumbnailTaskVisibleRange();
+		break;
 	}
 
 	return DefSubclassProc(hwnd, uMsg, wParam, lParam);
@@ -185,6 +211,28 @@ LRESULT CALLBACK ShellBrowser::ListViewParentProc(HWND hwnd, UINT uMsg, WPARAM w
 				OnListViewGetDisplayInfo(lParam);
 				break;
 
+			case LVN_ODFINDITEM:
+				return OnListViewFindItem(reinterpret_cast<NMLVFINDITEM *>(lParam));
+
+			case LVN_ODCACHEHINT:
+				OnListViewCacheHint(reinterpret_cast<NMLVCACHEHINT *>(lParam));
+				break;
+
+			case LVN_ENDSCROLL:
+				if (m_folderSettings.viewMode == +ViewMode::Details)
+				{
+					UpdateColumnTaskVisibleRange();
+				}
+				else if (m_folderSettings.viewMode == +ViewMode::Thumbnails)
+				{
+					UpdateThumbnailTaskVisibleRange();
+				}
+				break;
+
+			case LVN_ODSTATECHANGED:
+				OnListViewStateChanged(reinterpret_cast<NMLVODSTATECHANGE *>(lParam));
+				break;
+
 			case LVN_GETINFOTIP:
 				return OnListViewGetInfoTip(reinterpret_cast<NMLVGETINFOTIP *>(lParam));
 
@@ -276,9 +324,9 @@ void ShellBrowser::OnListViewMButtonUp(const POINT *pt, UINT keysDown)
 		return;
 	}
 
-	const ItemInfo_t &itemInfo = GetItemByIndex(m_middleButtonItem);
+	int internalIndex = GetItemInternalIndex(m_middleButtonItem);
 
-	if (!WI_IsAnyFlagSet(itemInfo.wfd.dwFileAttributes,
+	if (!WI_IsAnyFlagSet(m_itemStore.GetAttributes(internalIndex),
 			FILE_ATTRIBUTE_DIRECTORY | FILE_ATTRIBUTE_ARCHIVE))
 	{
 		return;
@@ -291,7 +339,7 @@ void ShellBrowser::OnListViewMButtonUp(const POINT *pt, UINT keysDown)
 		switchToNewTab = !switchToNewTab;
 	}
 
-	m_tabNavigation->CreateNewTab(itemInfo.pidlComplete.get(), switchToNewTab);
+	m_tabNavigation->CreateNewTab(m_itemStore.GetPidlComplete(internalIndex), switchToNewTab);
 }
 
 void ShellBrowser::OnRButtonDown(HWND hwnd, BOOL doubleClick, int x, int y, UINT keyFlags)
@@ -325,6 +373,12 @@ void ShellBrowser::OnListViewGetDisplayInfo(LPARAM lParam)
 	pnmv = (NMLVDISPINFO *) lParam;
 	plvItem = &pnmv->item;
 
+	if (m_virtualListView)
+	{
+		OnVirtualListViewGetDisplayInfo(plvItem);
+		return;
+	}
+
 	int internalIndex = static_cast<int>(plvItem->lParam);
 
 	/* Construct an image here using the items
@@ -339,21 +393,22 @@ void ShellBrowser::OnListViewGetDisplayInfo(LPARAM lParam)
 	if (m_folderSettings.viewMode == +ViewMode::Thumbnails
 		&& (plvItem->mask & LVIF_IMAGE) == LVIF_IMAGE)
 	{
-		const ItemInfo_t &itemInfo = m_itemInfoMap.at(internalIndex);
-		auto cachedThumbnailIndex = GetCachedThumbnailIndex(itemInfo);
+		plvItem->mask |= LVIF_DI_SETITEM;
 
-		if (cachedThumbnailIndex)
-		{
-			plvItem->iImage = *cachedThumbnailIndex;
-		}
-		else
+		// Thumbnails in the persistent cache are keyed by the file's size and modification time,
+		// so there's no need to extract them again.
+		auto persistedThumbnailIndex = GetPersistedThumbnailIndex(internalIndex);
+
+		if (persistedThumbnailIndex)
 		{
-			plvItem->iImage = GetIconThumbnail(internalIndex);
+			plvItem->iImage = *persistedThumbnailIndex;
+			return;
 		}
 
-		plvItem->mask |= LVIF_DI_SETITEM;
-
-		QueueThumbnailTask(internalIndex);
+		// Checking whether the thumbnail is in the system thumbnail cache requires binding to the
+		// item, so that's left to the background task.
+		plvItem->iImage = GetIconThumbnail(internalIndex);
+		QueueThumbnailTask(plvItem->iItem, internalIndex);
 
 		return;
 	}
@@ -363,15 +418,26 @@ void ShellBrowser::OnListViewGetDisplayInfo(LPARAM lParam)
 		auto columnType = GetColumnTypeByIndex(plvItem->iSubItem);
 		assert(columnType);
 
-		QueueColumnTask(internalIndex, *columnType);
+		const std::wstring *columnText =
+			MaybeGetColumnText(plvItem->iItem, internalIndex, *columnType);
+
+		if (columnText)
+		{
+			StringCchCopy(plvItem->pszText, plvItem->cchTextMax, columnText->c_str());
+		}
 	}
 
 	if ((plvItem->mask & LVIF_IMAGE) == LVIF_IMAGE)
 	{
-		const ItemInfo_t &itemInfo = m_itemInfoMap.at(internalIndex);
-		auto cachedIconIndex = GetCachedIconIndex(itemInfo);
+		auto extensionIconIndex = GetExtensionIconIndex(internalIndex);
 
-		if (cachedIconIndex)
+		if (extensionIconIndex)
+		{
+			// The icon is shared by all files with this extension, so it can be set directly. Any
+			// overlay will be added once it's been retrieved.
+			plvItem->iImage = *extensionIconIndex;
+		}
+		else if (auto cachedIconIndex = GetCachedIconIndex(internalIndex))
 		{
 			// The icon retrieval method specifies the
 			// SHGFI_OVERLAYINDEX value. That means that cached icons
@@ -392,8 +458,7 @@ void ShellBrowser::OnListViewGetDisplayInfo(LPARAM lParam)
 		}
 		else
 		{
-			if ((itemInfo.wfd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
-				== FILE_ATTRIBUTE_DIRECTORY)
+			if (m_itemStore.IsFolder(internalIndex))
 			{
 				plvItem->iImage = m_iFolderIcon;
 			}
@@ -403,19 +468,135 @@ void ShellBrowser::OnListViewGetDisplayInfo(LPARAM lParam)
 			}
 		}
 
-		m_iconFetcher->QueueIconTask(itemInfo.pidlComplete.get(),
-			[this, internalIndex](int iconIndex)
+		QueueItemIconTask(plvItem->iItem, internalIndex, extensionIconIndex);
+	}
+
+	plvItem->mask |= LVIF_DI_SETITEM;
+}
+
+// Returns the icon shared by all files with the same extension as the specified item, if there is
+// one. This only applies to filesystem files; folders and virtual items always need to be queried
+// individually.
+std::optional<int> ShellBrowser::GetExtensionIconIndex(int internalIndex)
+{
+	if (!m_itemStore.IsFindDataValid(internalIndex) || m_itemStore.IsFolder(internalIndex))
+	{
+		return std::nullopt;
+	}
+
+	// The filename view is null-terminated.
+	auto fileName = m_itemStore.GetFileName(internalIndex);
+	std::wstring_view extension = PathFindExtension(fileName.data());
+
+	// Files without an extension don't share an icon, so they use the per-item path.
+	if (extension.empty())
+	{
+		return std::nullopt;
+	}
+
+	return m_extensionIconCache->GetIconIndex(extension);
+}
+
+// If the item's base icon is already known from its extension, only the overlay needs to be
+// retrieved, which avoids having to extract the icon for every file in the folder.
+void ShellBrowser::QueueItemIconTask(int itemIndex, int internalIndex,
+	std::optional<int> extensionIconIndex)
+{
+	PCIDLIST_ABSOLUTE pidl = m_itemStore.GetPidlComplete(internalIndex);
+
+	if (extensionIconIndex)
+	{
+		m_iconFetcher->QueueOverlayTask(pidl, GetIconPriority(itemIndex),
+			[this, internalIndex, iconIndex = *extensionIconIndex](int overlayIndex)
 			{
-				ProcessIconResult(internalIndex, iconIndex);
+				ProcessIconResult(internalIndex, iconIndex | (overlayIndex << 24));
 			});
+		return;
 	}
 
-	plvItem->mask |= LVIF_DI_SETITEM;
+	m_iconFetcher->QueueIconTask(pidl, GetIconPriority(itemIndex),
+		[this, internalIndex](int iconIndex)
+		{
+			ProcessIconResult(internalIndex, iconIndex);
+		});
+}
+
+// Icons can be requested for items that aren't on screen (e.g. the items covered by a cache hint in
+// owner data mode, or every item in a background tab). Only items that are actually within the
+// visible part of the listview in the selected tab are given priority.
+IconPriority ShellBrowser::GetIconPriority(int itemIndex) const
+{
+	if (!IsWindowVisible(m_hListView))
+	{
+		return IconPriority::Normal;
+	}
+
+	RECT itemRect;
+	RECT clientRect;
+
+	if (!ListView_GetItemRect(m_hListView, itemIndex, &itemRect, LVIR_BOUNDS)
+		|| !GetClientRect(m_hListView, &clientRect))
+	{
+		return IconPriority::Normal;
+	}
+
+	RECT visibleRect;
+	bool visible = IntersectRect(&visibleRect, &itemRect, &clientRect);
+	return visible ? IconPriority::High : IconPriority::Normal;
+}
+
+// Only files are stored in the persistent image cache. The thumbnail and overlay for a folder can
+// change without the folder itself being modified.
+std::optional<ImageCacheKey> ShellBrowser::GetImageCacheKey(int internalIndex) const
+{
+	// This is called when handling icon results, which may arrive after the item has been
+	// removed.
+	if (!m_itemStore.Contains(internalIndex) || !m_itemStore.IsFindDataValid(internalIndex)
+		|| m_itemStore.IsFolder(internalIndex))
+	{
+		return std::nullopt;
+	}
+
+	return PersistentImageCache::BuildKey(m_itemStore.GetParsingName(internalIndex),
+		m_itemStore.GetFindData(internalIndex));
+}
+
+std::optional<int> ShellBrowser::GetPersistedOverlayIndex(int internalIndex)
+{
+	auto cacheKey = GetImageCacheKey(internalIndex);
+
+	if (!cacheKey)
+	{
+		return std::nullopt;
+	}
+
+	return m_persistentImageCache->GetStore()->GetOverlayIndex(*cacheKey);
 }
 
-std::optional<int> ShellBrowser::GetCachedIconIndex(const ItemInfo_t &itemInfo)
+// Overlays are saved so that they can be shown as soon as the item is displayed in a later
+// session (the overlay is still retrieved again, in case it's changed). Most items have no overlay,
+// so an entry is only created for an item if it has one.
+void ShellBrowser::PersistOverlayIndex(int internalIndex, int overlayIndex)
 {
-	auto cachedItr = m_cachedIcons->findByPath(itemInfo.parsingName);
+	auto cacheKey = GetImageCacheKey(internalIndex);
+
+	if (!cacheKey)
+	{
+		return;
+	}
+
+	auto *store = m_persistentImageCache->GetStore();
+
+	if (overlayIndex != 0 || store->GetOverlayIndex(*cacheKey))
+	{
+		store->SetOverlayIndex(*cacheKey, overlayIndex);
+	}
+}
+
+std::optional<int> ShellBrowser::GetCachedIconIndex(int internalIndex)
+{
+	std::wstring parsingName(m_itemStore.GetParsingName(internalIndex));
+	auto cachedItr = m_cachedIcons->findByPath(parsingName);
 
 	if (cachedItr == m_cachedIcons->end())
 	{
@@ -427,6 +608,26 @@ std::optional<int> ShellBrowser::GetCachedIconIndex(const ItemInfo_t &itemInfo)
 
 void ShellBrowser::ProcessIconResult(int internalIndex, int iconIndex)
 {
+	if (m_virtualListView)
+	{
+		auto itr = m_directoryState.virtualList.iconIndexes.find(internalIndex);
+
+		// If the item has been removed, or its icon invalidated, the result can be ignored.
+		if (itr == m_directoryState.virtualList.iconIndexes.end())
+		{
+			return;
+		}
+
+		itr->second = iconIndex;
+		PersistOverlayIndex(internalIndex, iconIndex >> 24);
+
+		// Results will typically arrive for several items at once. Invalidating the listview
+		// (rather than locating and redrawing each individual item) allows those updates to be
+		// combined into a single paint.
+		InvalidateRect(m_hListView, nullptr, FALSE);
+		return;
+	}
+
 	auto index = LocateItemByInternalIndex(internalIndex);
 
 	if (!index)
@@ -434,6 +635,8 @@ void ShellBrowser::ProcessIconResult(int internalIndex, int iconIndex)
 		return;
 	}
 
+	PersistOverlayIndex(internalIndex, iconIndex >> 24);
+
 	LVITEM lvItem;
 	lvItem.mask = LVIF_IMAGE | LVIF_STATE;
 	lvItem.iItem = *index;
@@ -604,6 +807,15 @@ void ShellBrowser::OnListViewItemChanged(const NMLISTVIEW *changeData)
 		return;
 	}
 
+	// In owner data mode, a change to every item (e.g. when all items are selected) is reported
+	// using an index of -1. The lParam value also isn't set in that mode.
+	if (m_virtualListView && changeData->iItem == -1)
+	{
+		RecalculateFileSelectionInfo();
+		listViewSelectionChanged.m_signal();
+		return;
+	}
+
 	if (m_config->checkBoxSelection && (LVIS_STATEIMAGEMASK & changeData->uNewState) != 0)
 	{
 		bool checked = ((changeData->uNewState & LVIS_STATEIMAGEMASK) >> 12) == 2;
@@ -630,7 +842,9 @@ void ShellBrowser::OnListViewItemChanged(const NMLISTVIEW *changeData)
 		}
 	}
 
-	UpdateFileSelectionInfo(static_cast<int>(changeData->lParam), currentlySelected);
+	int internalIndex = m_virtualListView ? GetItemInternalIndex(changeData->iItem)
+										  : static_cast<int>(changeData->lParam);
+	UpdateFileSelectionInfo(internalIndex, currentlySelected);
 
 	listViewSelectionChanged.m_signal();
 }
@@ -640,11 +854,8 @@ void ShellBrowser::UpdateFileSelectionInfo(int internalIndex, BOOL selected)
 	ULARGE_INTEGER ulFileSize;
 	BOOL isFolder;
 
-	isFolder = (m_itemInfoMap.at(internalIndex).wfd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
-		== FILE_ATTRIBUTE_DIRECTORY;
-
-	ulFileSize.LowPart = m_itemInfoMap.at(internalIndex).wfd.nFileSizeLow;
-	ulFileSize.HighPart = m_itemInfoMap.at(internalIndex).wfd.nFileSizeHigh;
+	isFolder = m_itemStore.IsFolder(internalIndex);
+	ulFileSize.QuadPart = m_itemStore.GetFileSize(internalIndex);
 
 	if (selected)
 	{
@@ -674,6 +885,20 @@ void ShellBrowser::UpdateFileSelectionInfo(int internalIndex, BOOL selected)
 	}
 }
 
+void ShellBrowser::RecalculateFileSelectionInfo()
+{
+	m_directoryState.numFilesSelected = 0;
+	m_directoryState.numFoldersSelected = 0;
+	m_directoryState.fileSelectionSize = 0;
+
+	int item = -1;
+
+	while ((item = ListView_GetNextItem(m_hListView, item, LVNI_SELECTED)) != -1)
+	{
+		UpdateFileSelectionInfo(GetItemInternalIndex(item), TRUE);
+	}
+}
+
 void ShellBrowser::OnListViewKeyDown(const NMLVKEYDOWN *lvKeyDown)
 {
 	switch (lvKeyDown->wVKey)
@@ -744,20 +969,13 @@ void ShellBrowser::OnListViewKeyDown(const NMLVKEYDOWN *lvKeyDown)
 	}
 }
 
-const ShellBrowser::ItemInfo_t &ShellBrowser::GetItemByIndex(int index) const
-{
-	int internalIndex = GetItemInternalIndex(index);
-	return m_itemInfoMap.at(internalIndex);
-}
-
-ShellBrowser::ItemInfo_t &ShellBrowser::GetItemByIndex(int index)
-{
-	int internalIndex = GetItemInternalIndex(index);
-	return m_itemInfoMap.at(internalIndex);
-}
-
 int ShellBrowser::GetItemInternalIndex(int item) const
 {
+	if (m_virtualListView)
+	{
+		return m_directoryState.virtualList.items.at(item);
+	}
+
 	LVITEM lvItem;
 	lvItem.mask = LVIF_PARAM;
 	lvItem.iItem = item;
@@ -774,14 +992,29 @@ int ShellBrowser::GetItemInternalIndex(int item) const
 
 void ShellBrowser::MarkItemAsCut(int item, bool cut)
 {
-	const auto &itemInfo = GetItemByIndex(item);
+	int internalIndex = GetItemInternalIndex(item);
 
 	// If the file is hidden, prevent changes to its visibility state.
-	if (WI_IsFlagSet(itemInfo.wfd.dwFileAttributes, FILE_ATTRIBUTE_HIDDEN))
+	if (WI_IsFlagSet(m_itemStore.GetAttributes(internalIndex), FILE_ATTRIBUTE_HIDDEN))
 	{
 		return;
 	}
 
+	if (m_virtualListView)
+	{
+		if (cut)
+		{
+			m_directoryState.virtualList.cutItems.insert(internalIndex);
+		}
+		else
+		{
+			m_directoryState.virtualList.cutItems.erase(internalIndex);
+		}
+
+		ListView_RedrawItems(m_hListView, item, item);
+		return;
+	}
+
 	if (cut)
 	{
 		ListView_SetItemState(m_hListView, item, LVIS_CUT, LVIS_CUT);
@@ -975,10 +1208,10 @@ void ShellBrowser::SetFileAttributesForSelection()
 	{
 		NSetFileAttributesDialogExternal::SetFileAttributesInfo sfai;
 
-		const ItemInfo_t &item = GetItemByIndex(index);
-		sfai.wfd = item.wfd;
+		int internalIndex = GetItemInternalIndex(index);
+		sfai.wfd = m_itemStore.GetFindData(internalIndex);
 		StringCchCopy(sfai.szFullFileName, SIZEOF_ARRAY(sfai.szFullFileName),
-			item.parsingName.c_str());
+			m_itemStore.GetParsingName(internalIndex).data());
 
 		sfaiList.push_back(sfai);
 	}
@@ -1017,8 +1250,7 @@ HRESULT ShellBrowser::GetListViewSelectionAttributes(SFGAOF *attributes) const
 
 HRESULT ShellBrowser::GetListViewItemAttributes(int item, SFGAOF *attributes) const
 {
-	const auto &itemInfo = GetItemByIndex(item);
-	return GetItemAttributes(itemInfo.pidlComplete.get(), attributes);
+	return GetItemAttributes(m_itemStore.GetPidlComplete(GetItemInternalIndex(item)), attributes);
 }
 
 std::vector<PCIDLIST_ABSOLUTE> ShellBrowser::GetSelectedItemPidls()
@@ -1028,8 +1260,7 @@ std::vector<PCIDLIST_ABSOLUTE> ShellBrowser::GetSelectedItemPidls()
 
 	while ((index = ListView_GetNextItem(m_hListView, index, LVNI_SELECTED)) != -1)
 	{
-		const auto &item = GetItemByIndex(index);
-		selectedItemPidls.push_back(item.pidlComplete.get());
+		selectedItemPidls.push_back(m_itemStore.GetPidlComplete(GetItemInternalIndex(index)));
 	}
 
 	return selectedItemPidls;
@@ -1104,10 +1335,10 @@ void ShellBrowser::AutoSizeColumns()
 
 BOOL ShellBrowser::OnListViewBeginLabelEdit(const NMLVDISPINFO *dispInfo)
 {
-	const auto &item = GetItemByIndex(dispInfo->item.iItem);
+	int internalIndex = GetItemInternalIndex(dispInfo->item.iItem);
 
 	SFGAOF attributes = SFGAO_CANRENAME;
-	HRESULT hr = GetItemAttributes(item.pidlComplete.get(), &attributes);
+	HRESULT hr = GetItemAttributes(m_itemStore.GetPidlComplete(internalIndex), &attributes);
 
 	if (FAILED(hr) || WI_IsFlagClear(attributes, SFGAO_CANRENAME))
 	{
@@ -1115,6 +1346,7 @@ BOOL ShellBrowser::OnListViewBeginLabelEdit(const NMLVDISPINFO *dispInfo)
 	}
 
 	bool useEditingName = true;
+	std::wstring editingName(m_itemStore.GetEditingName(internalIndex));
 
 	// The editing name may differ from the display name. For example, the display name of the C:\
 	// drive item will be something like "Local Disk (C:)", while its editing name will be "Local
@@ -1126,7 +1358,7 @@ BOOL ShellBrowser::OnListViewBeginLabelEdit(const NMLVDISPINFO *dispInfo)
 	// - Extensions are shown in Explorer, but hidden in Explorer++ (since the editing name would
 	//   contain an extension). Note that this case is handled when editing is finished - if
 	//   extensions are hidden, the extension will be manually re-added when renaming an item.
-	if (!WI_IsFlagSet(item.wfd.dwFileAttributes, FILE_ATTRIBUTE_DIRECTORY))
+	if (!m_itemStore.IsFolder(internalIndex))
 	{
 		std::wstring displayName = GetItemDisplayName(dispInfo->item.iItem);
 
@@ -1136,17 +1368,17 @@ BOOL ShellBrowser::OnListViewBeginLabelEdit(const NMLVDISPINFO *dispInfo)
 			auto *extension = PathFindExtension(displayName.c_str());
 
 			if (*extension != '\0'
-				&& lstrcmp((item.editingName + extension).c_str(), displayName.c_str()) == 0)
+				&& lstrcmp((editingName + extension).c_str(), displayName.c_str()) == 0)
 			{
 				useEditingName = false;
 			}
 		}
 		else
 		{
-			auto *extension = PathFindExtension(item.editingName.c_str());
+			auto *extension = PathFindExtension(editingName.c_str());
 
 			if (*extension != '\0'
-				&& lstrcmp((displayName + extension).c_str(), item.editingName.c_str()) == 0)
+				&& lstrcmp((displayName + extension).c_str(), editingName.c_str()) == 0)
 			{
 				useEditingName = false;
 			}
@@ -1170,11 +1402,10 @@ BOOL ShellBrowser::OnListViewBeginLabelEdit(const NMLVDISPINFO *dispInfo)
 	// nothing that needs to be changed if editing is canceled.
 	if (useEditingName)
 	{
-		SetWindowText(editControl, item.editingName.c_str());
+		SetWindowText(editControl, editingName.c_str());
 	}
 
-	ListViewEdit::CreateNew(editControl, m_acceleratorTable,
-		WI_IsFlagClear(item.wfd.dwFileAttributes, FILE_ATTRIBUTE_DIRECTORY));
+	ListViewEdit::CreateNew(editControl, m_acceleratorTable, !m_itemStore.IsFolder(internalIndex));
 
 	return FALSE;
 }
@@ -1194,16 +1425,18 @@ BOOL ShellBrowser::OnListViewEndLabelEdit(const NMLVDISPINFO *dispInfo)
 		return FALSE;
 	}
 
-	const auto &item = GetItemByIndex(dispInfo->item.iItem);
+	int internalIndex = GetItemInternalIndex(dispInfo->item.iItem);
 
-	if (newFilename == item.editingName)
+	if (newFilename == m_itemStore.GetEditingName(internalIndex))
 	{
 		return FALSE;
 	}
 
-	if (!WI_IsFlagSet(item.wfd.dwFileAttributes, FILE_ATTRIBUTE_DIRECTORY))
+	bool isFolder = m_itemStore.IsFolder(internalIndex);
+
+	if (!isFolder)
 	{
-		auto *extension = PathFindExtension(item.wfd.cFileName);
+		auto *extension = PathFindExtension(m_itemStore.GetFileName(internalIndex).data());
 
 		bool extensionHidden = !m_config->globalFolderSettings.showExtensions
 			|| (m_config->globalFolderSettings.hideLinkExtension
@@ -1219,7 +1452,8 @@ BOOL ShellBrowser::OnListViewEndLabelEdit(const NMLVDISPINFO *dispInfo)
 
 	wil::com_ptr_nothrow<IShellFolder> parent;
 	PCITEMID_CHILD child;
-	HRESULT hr = SHBindToParent(item.pidlComplete.get(), IID_PPV_ARGS(&parent), &child);
+	HRESULT hr =
+		SHBindToParent(m_itemStore.GetPidlComplete(internalIndex), IID_PPV_ARGS(&parent), &child);
 
 	if (FAILED(hr))
 	{
@@ -1239,8 +1473,7 @@ BOOL ShellBrowser::OnListViewEndLabelEdit(const NMLVDISPINFO *dispInfo)
 	// extension would always be re-added by the shell.
 	// Therefore, if a file is being edited, the parsing name (which will always contain an
 	// extension) will be updated.
-	if (!m_directoryState.virtualFolder
-		&& !WI_IsFlagSet(item.wfd.dwFileAttributes, FILE_ATTRIBUTE_DIRECTORY))
+	if (!m_directoryState.virtualFolder && !isFolder)
 	{
 		flags |= SHGDN_FORPARSING;
 	}
@@ -1273,7 +1506,7 @@ BOOL ShellBrowser::OnListViewEndLabelEdit(const NMLVDISPINFO *dispInfo)
 	// Performing an immediate update here means that the user can continue to interact with the
 	// item, without having to wait for the rename notification to be processed.
 	unique_pidl_absolute pidlNew(ILCombine(m_directoryState.pidlDirectory.get(), newChild.get()));
-	UpdateItem(item.pidlComplete.get(), pidlNew.get());
+	UpdateItem(m_itemStore.GetPidlComplete(internalIndex), pidlNew.get());
 
 	// The text will be set by UpdateItem. It's not safe to return true here, since items can sorted
 	// by UpdateItem, which can result in the index of this item being changed.
@@ -1289,48 +1522,14 @@ LRESULT ShellBrowser::OnListViewCustomDraw(NMLVCUSTOMDRAW *listViewCustomDraw)
 
 	case CDDS_ITEMPREPAINT:
 	{
-		const auto &itemInfo =
-			GetItemByIndex(static_cast<int>(listViewCustomDraw->nmcd.dwItemSpec));
+		int internalIndex =
+			GetItemInternalIndex(static_cast<int>(listViewCustomDraw->nmcd.dwItemSpec));
+		auto color = GetItemColor(internalIndex);
 
-		for (const auto &colorRule :
-			ColorRuleModelFactory::GetInstance()->GetColorRuleModel()->GetItems())
+		if (color)
 		{
-			bool matchedFileName = false;
-			bool matchedAttributes = false;
-
-			if (!colorRule->GetFilterPattern().empty())
-			{
-				if (CheckWildcardMatch(colorRule->GetFilterPattern().c_str(),
-						itemInfo.displayName.c_str(), !colorRule->GetFilterPatternCaseInsensitive())
-					== 1)
-				{
-					matchedFileName = true;
-				}
-			}
-			else
-			{
-				matchedFileName = true;
-			}
-
-			if (colorRule->GetFilterAttributes() != 0)
-			{
-				if (itemInfo.isFindDataValid
-					&& WI_IsAnyFlagSet(itemInfo.wfd.dwFileAttributes,
-						colorRule->GetFilterAttributes()))
-				{
-					matchedAttributes = true;
-				}
-			}
-			else
-			{
-				matchedAttributes = true;
-			}
-
-			if (matchedFileName && matchedAttributes)
-			{
-				listViewCustomDraw->clrText = colorRule->GetColor();
-				return CDRF_NEWFONT;
-			}
+			listViewCustomDraw->clrText = *color;
+			return CDRF_NEWFONT;
 		}
 	}
 	break;
@@ -1339,8 +1538,36 @@ LRESULT ShellBrowser::OnListViewCustomDraw(NMLVCUSTOMDRAW *listViewCustomDraw)
 	return CDRF_DODEFAULT;
 }
 
+// Items are redrawn frequently (e.g. each time the mouse moves over an item), so the color for each
+// item is only determined once and then cached.
+std::optional<COLORREF> ShellBrowser::GetItemColor(int internalIndex)
+{
+	auto itr = m_directoryState.itemColors.find(internalIndex);
+
+	if (itr != m_directoryState.itemColors.end())
+	{
+		return itr->second;
+	}
+
+	std::optional<DWORD> attributes;
+
+	if (m_itemStore.IsFindDataValid(internalIndex))
+	{
+		attributes = m_itemStore.GetAttributes(internalIndex);
+	}
+
+	auto color = m_colorRuleMatcher.GetColor(m_itemStore.GetDisplayName(internalIndex), attributes);
+	m_directoryState.itemColors.insert({ internalIndex, color });
+
+	return color;
+}
+
 void ShellBrowser::OnColorRulesUpdated()
 {
+	m_colorRuleMatcher =
+		ColorRuleMatcher(ColorRuleModelFactory::GetInstance()->GetColorRuleModel()->GetItems());
+	m_directoryState.itemColors.clear();
+
 	// Any changes to the color rules will require the listview to be redrawn.
 	InvalidateRect(m_hListView, nullptr, false);
 }
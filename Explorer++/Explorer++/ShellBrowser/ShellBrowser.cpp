@@ -65,14 +65,18 @@ ShellBrowser::ShellBrowser(int id, HWND hOwner, CoreInterface *coreInterface,
 ShellBrowser::ShellBrowser(int id, HWND hOwner, CoreInterface *coreInterface,
 	TabNavigationInterface *tabNavigation, FileActionHandler *fileActionHandler,
 	const FolderSettings &folderSettings, const FolderColumns *initialColumns) :
-	ShellDropTargetWindow(CreateListView(hOwner)),
+	ShellDropTargetWindow(
+		CreateListView(hOwner, coreInterface->GetConfig()->useVirtualListView)),
 	m_hListView(GetHWND()),
+	m_virtualListView(coreInterface->GetConfig()->useVirtualListView),
 	m_ID(id),
 	m_shChangeNotifyId(0),
 	m_resourceInstance(coreInterface->GetResourceInstance()),
 	m_acceleratorTable(coreInterface->GetAcceleratorTable()),
 	m_hOwner(hOwner),
 	m_cachedIcons(coreInterface->GetCachedIcons()),
+	m_extensionIconCache(coreInterface->GetExtensionIconCache()),
+	m_persistentImageCache(coreInterface->GetPersistentImageCache()),
 	m_iconResourceLoader(coreInterface->GetIconResourceLoader()),
 	m_config(coreInterface->GetConfig()),
 	m_tabNavigation(tabNavigation),
@@ -81,20 +85,29 @@ ShellBrowser::ShellBrowser(int id, HWND hOwner, CoreInterface *coreInterface,
 	m_folderColumns(initialColumns
 			? *initialColumns
 			: coreInterface->GetConfig()->globalFolderSettings.folderColumns),
-	m_columnThreadPool(1, std::bind(CoInitializeEx, nullptr, COINIT_APARTMENTTHREADED),
+	m_enumerationThreadPool(1, std::bind(CoInitializeEx, nullptr, COINIT_APARTMENTTHREADED),
 		CoUninitialize),
+	m_columnTaskScheduler(coreInterface->GetConfig()->columnRetrievalThreads,
+		std::bind(CoInitializeEx, nullptr, COINIT_APARTMENTTHREADED), CoUninitialize),
 	m_columnResultIDCounter(0),
-	m_thumbnailThreadPool(1, std::bind(CoInitializeEx, nullptr, COINIT_APARTMENTTHREADED),
-		CoUninitialize),
+	m_thumbnailTaskScheduler(NUM_THUMBNAIL_THREADS, OnThumbnailThreadStart, OnThumbnailThreadExit),
 	m_thumbnailResultIDCounter(0),
+	m_thumbnailImageStore(
+		static_cast<size_t>(max(coreInterface->GetConfig()->thumbnailMemoryBudget, 0)) * 1024
+			* 1024,
+		THUMBNAIL_ITEM_WIDTH * THUMBNAIL_ITEM_HEIGHT * 4),
 	m_infoTipsThreadPool(1, std::bind(CoInitializeEx, nullptr, COINIT_APARTMENTTHREADED),
 		CoUninitialize),
 	m_infoTipResultIDCounter(0),
+	m_groupThreadPool(NUM_GROUP_THREADS,
+		std::bind(CoInitializeEx, nullptr, COINIT_APARTMENTTHREADED), CoUninitialize),
+	m_groupResultIDCounter(0),
+	m_folderSizeThreadPool(1),
 	m_draggedDataObject(nullptr),
 	m_shellWindowRegistered(false)
 {
 	InitializeListView();
-	m_iconFetcher = std::make_unique<IconFetcher>(m_hListView, m_cachedIcons);
+	m_iconFetcher = std::make_unique<IconFetcher>(coreInterface->GetIconService());
 	m_navigationController =
 		std::make_unique<ShellNavigationController>(this, tabNavigation, m_iconFetcher.get());
 
@@ -114,6 +127,8 @@ ShellBrowser::ShellBrowser(int id, HWND hOwner, CoreInterface *coreInterface,
 
 	m_PreviousSortColumnExists = false;
 
+	m_filterPattern = CompileFilter();
+
 	// This interface is required. It's not expected that the call would fail.
 	HRESULT hr = SHGetDesktopFolder(&m_desktopFolder);
 	FAIL_FAST_IF_FAILED(hr);
@@ -149,25 +164,36 @@ ShellBrowser::~ShellBrowser()
 
 	DestroyWindow(m_hListView);
 
-	m_columnThreadPool.clear_queue();
-	m_thumbnailThreadPool.clear_queue();
+	CancelEnumeration();
+	m_columnTaskScheduler.ClearQueue();
+	m_thumbnailTaskScheduler.ClearQueue();
 	m_infoTipsThreadPool.clear_queue();
+	m_groupThreadPool.clear_queue();
+	m_folderSizeThreadPool.clear_queue();
+	m_folderSizeStopSource.request_stop();
 
 	DeleteCriticalSection(&m_csDirectoryAltered);
 
 	/* TODO: Also destroy the thumbnails imagelist. */
 }
 
-HWND ShellBrowser::CreateListView(HWND parent)
+HWND ShellBrowser::CreateListView(HWND parent, bool virtualListView)
 {
 	// Note that the only reason LVS_REPORT is specified here is so that the listview header theme
 	// can be set immediately when in dark mode. Without this style, ListView_GetHeader() will
 	// return NULL. The actual view mode set here doesn't matter, since it will be updated when
 	// navigating to a folder.
-	return ::CreateListView(parent,
-		WS_CHILD | WS_VISIBLE | WS_CLIPSIBLINGS | WS_CLIPCHILDREN | LVS_REPORT | LVS_EDITLABELS
-			| LVS_SHOWSELALWAYS | LVS_SHAREIMAGELISTS | LVS_AUTOARRANGE | WS_TABSTOP
-			| LVS_ALIGNTOP);
+	DWORD style = WS_CHILD | WS_VISIBLE | WS_CLIPSIBLINGS | WS_CLIPCHILDREN | LVS_REPORT
+		| LVS_EDITLABELS | LVS_SHOWSELALWAYS | LVS_SHAREIMAGELISTS | LVS_AUTOARRANGE | WS_TABSTOP
+		| LVS_ALIGNTOP;
+
+	// This style can't be added or removed once the control has been created.
+	if (virtualListView)
+	{
+		style |= LVS_OWNERDATA;
+	}
+
+	return ::CreateListView(parent, style);
 }
 
 void ShellBrowser::InitializeListView()
@@ -186,6 +212,13 @@ void ShellBrowser::InitializeListView()
 
 	ListView_SetExtendedListViewStyle(m_hListView, dwExtendedStyle);
 
+	if (m_virtualListView)
+	{
+		// The cut and overlay states aren't stored by an owner data listview, so they need to be
+		// provided whenever the item is displayed.
+		ListView_SetCallbackMask(m_hListView, LVIS_CUT | LVIS_OVERLAYMASK);
+	}
+
 	ListViewHelper::SetAutoArrange(m_hListView, m_folderSettings.autoArrange);
 	ListViewHelper::SetGridlines(m_hListView, m_config->globalFolderSettings.showGridlines);
 
@@ -210,6 +243,9 @@ void ShellBrowser::InitializeListView()
 	m_windowSubclasses.push_back(std::make_unique<WindowSubclassWrapper>(GetParent(m_hListView),
 		ListViewParentProcStub, reinterpret_cast<DWORD_PTR>(this)));
 
+	m_colorRuleMatcher =
+		ColorRuleMatcher(ColorRuleModelFactory::GetInstance()->GetColorRuleModel()->GetItems());
+
 	m_connections.push_back(
 		ColorRuleModelFactory::GetInstance()->GetColorRuleModel()->AddItemAddedObserver(
 			std::bind(&ShellBrowser::OnColorRulesUpdated, this)));
@@ -373,8 +409,7 @@ void ShellBrowser::SetViewModeInternal(ViewMode viewMode)
 
 	if (viewMode != +ViewMode::Details)
 	{
-		m_columnThreadPool.clear_queue();
-		m_columnResults.clear();
+		CancelColumnTasks();
 	}
 
 	if (viewMode != +ViewMode::Details && viewMode != +ViewMode::Tiles)
@@ -410,6 +445,12 @@ void ShellBrowser::SetViewModeInternal(ViewMode viewMode)
 
 void ShellBrowser::SetFirstColumnTextToCallback()
 {
+	// The text for each item is always requested in owner data mode.
+	if (m_virtualListView)
+	{
+		return;
+	}
+
 	int numItems = ListView_GetItemCount(m_hListView);
 
 	for (int i = 0; i < numItems; i++)
@@ -420,13 +461,18 @@ void ShellBrowser::SetFirstColumnTextToCallback()
 
 void ShellBrowser::SetFirstColumnTextToFilename()
 {
+	if (m_virtualListView)
+	{
+		return;
+	}
+
 	int numItems = ListView_GetItemCount(m_hListView);
 
 	for (int i = 0; i < numItems; i++)
 	{
 		int internalIndex = GetItemInternalIndex(i);
 
-		BasicItemInfo_t basicItemInfo = getBasicItemInfo(internalIndex);
+		BasicItemInfo_t basicItemInfo = m_itemStore.GetBasicItemInfo(internalIndex, false);
 		std::wstring filename = ProcessItemFileName(basicItemInfo, m_config->globalFolderSettings);
 
 		ListView_SetItemText(m_hListView, i, 0, filename.data());
@@ -459,6 +505,11 @@ void ShellBrowser::SetSortMode(SortMode sortMode)
 	m_folderSettings.sortMode = sortMode;
 }
 
+std::optional<SortMode> ShellBrowser::GetSecondarySortMode() const
+{
+	return m_folderSettings.secondarySortMode;
+}
+
 int ShellBrowser::GetId() const
 {
 	return m_ID;
@@ -471,7 +522,7 @@ void ShellBrowser::OnGridlinesSettingChanged()
 
 std::wstring ShellBrowser::GetItemName(int index) const
 {
-	return GetItemByIndex(index).wfd.cFileName;
+	return std::wstring(m_itemStore.GetFileName(GetItemInternalIndex(index)));
 }
 
 // Returns the name of the item as it's shown to the user. Note that this name may not be unique.
@@ -485,13 +536,14 @@ std::wstring ShellBrowser::GetItemDisplayName(int index) const
 	// hidden within Explorer++, then the display name will contain the file extension, but the text
 	// displayed to the user won't. Processing the filename here ensures that the extension is
 	// removed, if necessary.
-	BasicItemInfo_t basicItemInfo = getBasicItemInfo(GetItemInternalIndex(index));
+	BasicItemInfo_t basicItemInfo =
+		m_itemStore.GetBasicItemInfo(GetItemInternalIndex(index), false);
 	return ProcessItemFileName(basicItemInfo, m_config->globalFolderSettings);
 }
 
 std::wstring ShellBrowser::GetItemFullName(int index) const
 {
-	return GetItemByIndex(index).parsingName;
+	return std::wstring(m_itemStore.GetParsingName(GetItemInternalIndex(index)));
 }
 
 std::wstring ShellBrowser::GetDirectory() const
@@ -509,6 +561,8 @@ void ShellBrowser::SelectItems(const std::vector<PCIDLIST_ABSOLUTE> &pidls)
 {
 	ListViewHelper::SelectAllItems(m_hListView, FALSE);
 
+	m_directoryState.pendingSelection.clear();
+
 	int smallestIndex = INT_MAX;
 
 	for (auto &pidl : pidls)
@@ -517,6 +571,13 @@ void ShellBrowser::SelectItems(const std::vector<PCIDLIST_ABSOLUTE> &pidls)
 
 		if (!internalIndex)
 		{
+			// If the folder is still being enumerated, the item may simply not have been
+			// added yet. In that case, it will be selected once it's been inserted.
+			if (IsEnumerationInProgress())
+			{
+				m_directoryState.pendingSelection.emplace_back(ILCloneFull(pidl));
+			}
+
 			continue;
 		}
 
@@ -542,39 +603,80 @@ void ShellBrowser::SelectItems(const std::vector<PCIDLIST_ABSOLUTE> &pidls)
 	}
 }
 
-int ShellBrowser::LocateFileItemIndex(const TCHAR *szFileName) const
+void ShellBrowser::SelectPendingItems()
 {
-	LV_FINDINFO lvFind;
-	int iItem;
-	int iInternalIndex;
+	if (m_directoryState.pendingSelection.empty())
+	{
+		return;
+	}
 
-	iInternalIndex = LocateFileItemInternalIndex(szFileName);
+	int smallestIndex = INT_MAX;
+
+	auto itr = m_directoryState.pendingSelection.begin();
 
-	if (iInternalIndex != -1)
+	while (itr != m_directoryState.pendingSelection.end())
 	{
-		lvFind.flags = LVFI_PARAM;
-		lvFind.lParam = iInternalIndex;
-		iItem = ListView_FindItem(m_hListView, -1, &lvFind);
+		auto internalIndex = GetItemInternalIndexForPidl(itr->get());
 
-		return iItem;
+		if (!internalIndex)
+		{
+			++itr;
+			continue;
+		}
+
+		itr = m_directoryState.pendingSelection.erase(itr);
+
+		auto index = LocateItemByInternalIndex(*internalIndex);
+
+		if (!index)
+		{
+			continue;
+		}
+
+		ListViewHelper::SelectItem(m_hListView, *index, TRUE);
+
+		if (*index < smallestIndex)
+		{
+			smallestIndex = *index;
+		}
 	}
 
-	return -1;
+	if (smallestIndex != INT_MAX)
+	{
+		ListViewHelper::FocusItem(m_hListView, smallestIndex, TRUE);
+		ListView_EnsureVisible(m_hListView, smallestIndex, FALSE);
+	}
 }
 
-int ShellBrowser::LocateFileItemInternalIndex(const TCHAR *szFileName) const
+int ShellBrowser::LocateFileItemIndex(const TCHAR *szFileName) const
 {
-	for (int i = 0; i < m_directoryState.numItems; i++)
+	int iInternalIndex = LocateFileItemInternalIndex(szFileName);
+
+	if (iInternalIndex == -1)
 	{
-		const auto &item = GetItemByIndex(i);
+		return -1;
+	}
 
-		if (lstrcmp(item.wfd.cFileName, szFileName) == 0)
-		{
-			return GetItemInternalIndex(i);
-		}
+	auto index = LocateItemByInternalIndex(iInternalIndex);
+
+	if (!index)
+	{
+		return -1;
+	}
+
+	return *index;
+}
+
+int ShellBrowser::LocateFileItemInternalIndex(const TCHAR *szFileName) const
+{
+	auto internalIndex = m_itemStore.FindByFileName(szFileName);
+
+	if (!internalIndex)
+	{
+		return -1;
 	}
 
-	return -1;
+	return *internalIndex;
 }
 
 std::optional<int> ShellBrowser::GetItemIndexForPidl(PCIDLIST_ABSOLUTE pidl) const
@@ -589,24 +691,50 @@ std::optional<int> ShellBrowser::GetItemIndexForPidl(PCIDLIST_ABSOLUTE pidl) con
 	return LocateItemByInternalIndex(*internalIndex);
 }
 
+// Items are first looked up using the bytes of their child PIDL, which will work for any PIDL that
+// was retrieved from this folder. The simple PIDLs that are built when processing shell change
+// notifications have different contents, however, so if that lookup fails, the item is looked up
+// by name instead. In both cases, the item that's found is then compared against the original
+// PIDL, which also ensures that the PIDL is actually in this folder.
 std::optional<int> ShellBrowser::GetItemInternalIndexForPidl(PCIDLIST_ABSOLUTE pidl) const
 {
-	auto itr = std::find_if(m_itemInfoMap.begin(), m_itemInfoMap.end(),
-		[pidl](const auto &pair)
-		{
-			return ArePidlsEquivalent(pidl, pair.second.pidlComplete.get());
-		});
+	if (ILIsEmpty(pidl))
+	{
+		return std::nullopt;
+	}
+
+	auto internalIndex = m_itemStore.FindByPidlChild(ILFindLastID(pidl));
+
+	if (internalIndex && ArePidlsEquivalent(pidl, m_itemStore.GetPidlComplete(*internalIndex)))
+	{
+		return internalIndex;
+	}
+
+	std::wstring name;
+	HRESULT hr = GetDisplayName(pidl, SHGDN_INFOLDER | SHGDN_FORPARSING, name);
 
-	if (itr == m_itemInfoMap.end())
+	if (FAILED(hr))
 	{
 		return std::nullopt;
 	}
 
-	return itr->first;
+	internalIndex = m_itemStore.FindByFileName(name);
+
+	if (internalIndex && ArePidlsEquivalent(pidl, m_itemStore.GetPidlComplete(*internalIndex)))
+	{
+		return internalIndex;
+	}
+
+	return std::nullopt;
 }
 
 std::optional<int> ShellBrowser::LocateItemByInternalIndex(int internalIndex) const
 {
+	if (m_virtualListView)
+	{
+		return GetVirtualListItemPosition(internalIndex);
+	}
+
 	LVFINDINFO lvfi;
 	lvfi.flags = LVFI_PARAM;
 	lvfi.lParam = internalIndex;
@@ -622,17 +750,18 @@ std::optional<int> ShellBrowser::LocateItemByInternalIndex(int internalIndex) co
 
 WIN32_FIND_DATA ShellBrowser::GetItemFileFindData(int index) const
 {
-	return GetItemByIndex(index).wfd;
+	return m_itemStore.GetFindData(GetItemInternalIndex(index));
 }
 
 unique_pidl_absolute ShellBrowser::GetItemCompleteIdl(int index) const
 {
-	return unique_pidl_absolute(ILCloneFull(GetItemByIndex(index).pidlComplete.get()));
+	return unique_pidl_absolute(
+		ILCloneFull(m_itemStore.GetPidlComplete(GetItemInternalIndex(index))));
 }
 
 unique_pidl_child ShellBrowser::GetItemChildIdl(int index) const
 {
-	return unique_pidl_child(ILCloneChild(GetItemByIndex(index).pridl.get()));
+	return unique_pidl_child(ILCloneChild(m_itemStore.GetPidlChild(GetItemInternalIndex(index))));
 }
 
 bool ShellBrowser::InVirtualFolder() const
@@ -878,50 +1007,6 @@ void ShellBrowser::PositionDroppedItems()
 	}
 }
 
-int ShellBrowser::DetermineItemSortedPosition(LPARAM lParam) const
-{
-	LVITEM lvItem;
-	BOOL bItem;
-	int res = 1;
-	int nItems = 0;
-	int i = 0;
-
-	nItems = ListView_GetItemCount(m_hListView);
-
-	while (res > 0 && i < nItems)
-	{
-		lvItem.mask = LVIF_PARAM;
-		lvItem.iItem = i;
-		lvItem.iSubItem = 0;
-		bItem = ListView_GetItem(m_hListView, &lvItem);
-
-		if (bItem)
-		{
-			res = Sort(static_cast<int>(lParam), static_cast<int>(lvItem.lParam));
-		}
-		else
-		{
-			res = 0;
-		}
-
-		i++;
-	}
-
-	/* The item will always be inserted BEFORE
-	the item at position i that we specify here.
-	For example, specifying 0, will place the item
-	at 0 (and push 0 to 1), specifying 1 will place
-	the item at 1 (and push 1 to 2).
-	Therefore, to place in the last position, need
-	to place AFTER last item. */
-	if ((i - 1) == nItems - 1 && res > 0)
-	{
-		i++;
-	}
-
-	return i - 1;
-}
-
 int ShellBrowser::GetNumItems() const
 {
 	return m_directoryState.numItems;
@@ -987,13 +1072,24 @@ void ShellBrowser::VerifySortMode()
 		columns = &m_folderColumns.realFolderColumns;
 	}
 
-	auto itr = std::find_if(columns->begin(), columns->end(),
-		[this](const Column_t &column)
-		{
-			return DetermineColumnSortMode(column.type) == m_folderSettings.sortMode;
-		});
+	auto isSortModeAvailable = [columns](SortMode sortMode)
+	{
+		return std::any_of(columns->begin(), columns->end(),
+			[sortMode](const Column_t &column)
+			{
+				return DetermineColumnSortMode(column.type) == sortMode;
+			});
+	};
+
+	// Unlike the primary sort mode, there's no need to replace the secondary sort mode if it's not
+	// available. Items will simply be ordered by the primary sort mode alone.
+	if (m_folderSettings.secondarySortMode
+		&& !isSortModeAvailable(*m_folderSettings.secondarySortMode))
+	{
+		m_folderSettings.secondarySortMode.reset();
+	}
 
-	if (itr != columns->end())
+	if (isSortModeAvailable(m_folderSettings.sortMode))
 	{
 		return;
 	}
@@ -1048,17 +1144,12 @@ may or may not have been inserted into
 the listview yet. */
 void ShellBrowser::QueueRename(PCIDLIST_ABSOLUTE pidlItem)
 {
-	int numItems = ListView_GetItemCount(m_hListView);
+	auto index = GetItemIndexForPidl(pidlItem);
 
-	for (int i = 0; i < numItems; i++)
+	if (index)
 	{
-		const auto &item = GetItemByIndex(i);
-
-		if (ArePidlsEquivalent(pidlItem, item.pidlComplete.get()))
-		{
-			ListView_EditLabel(m_hListView, i);
-			return;
-		}
+		ListView_EditLabel(m_hListView, *index);
+		return;
 	}
 
 	m_queuedRenameItem.reset(ILCloneFull(pidlItem));
@@ -1147,6 +1238,7 @@ void ShellBrowser::OnDeviceChange(WPARAM wParam, LPARAM lParam)
 					if (SUCCEEDED(hr))
 					{
 						OnItemAdded(simplePidl.get());
+						InsertAddedItems();
 					}
 				}
 			}
@@ -1203,7 +1295,6 @@ void ShellBrowser::UpdateDriveIcon(const TCHAR *szDrive)
 	HRESULT hr;
 	int iItem = -1;
 	int iItemInternal = -1;
-	int i = 0;
 
 	/* Look for the item using its display name, NOT
 	its drive letter/name. */
@@ -1215,20 +1306,16 @@ void ShellBrowser::UpdateDriveIcon(const TCHAR *szDrive)
 
 	if (SUCCEEDED(hr))
 	{
-		for (i = 0; i < m_directoryState.numItems; i++)
+		auto internalIndex = GetItemInternalIndexForPidl(pidlDrive.get());
+
+		if (internalIndex)
 		{
-			lvItem.mask = LVIF_PARAM;
-			lvItem.iItem = i;
-			lvItem.iSubItem = 0;
-			ListView_GetItem(m_hListView, &lvItem);
+			auto index = LocateItemByInternalIndex(*internalIndex);
 
-			if (ArePidlsEquivalent(pidlDrive.get(),
-					m_itemInfoMap.at((int) lvItem.lParam).pidlComplete.get()))
+			if (index)
 			{
-				iItem = i;
-				iItemInternal = (int) lvItem.lParam;
-
-				break;
+				iItem = *index;
+				iItemInternal = *internalIndex;
 			}
 		}
 	}
@@ -1237,7 +1324,9 @@ void ShellBrowser::UpdateDriveIcon(const TCHAR *szDrive)
 	{
 		SHGetFileInfo(szDrive, 0, &shfi, sizeof(shfi), SHGFI_SYSICONINDEX);
 
-		m_itemInfoMap.at(iItemInternal).displayName = displayName;
+		m_itemStore.SetDisplayName(iItemInternal, displayName);
+		m_directoryState.itemColors.erase(iItemInternal);
+		m_directoryState.itemGroupIds.erase(iItemInternal);
 
 		/* Update the drives icon and display name. */
 		lvItem.mask = LVIF_TEXT | LVIF_IMAGE;
@@ -1246,27 +1335,29 @@ void ShellBrowser::UpdateDriveIcon(const TCHAR *szDrive)
 		lvItem.iSubItem = 0;
 		lvItem.pszText = displayName.data();
 		ListView_SetItem(m_hListView, &lvItem);
+
+		if (m_virtualListView)
+		{
+			m_directoryState.virtualList.iconIndexes.erase(iItemInternal);
+			ListView_RedrawItems(m_hListView, iItem, iItem);
+		}
 	}
 }
 
 void ShellBrowser::RemoveDrive(const TCHAR *szDrive)
 {
-	LVITEM lvItem;
 	int iItemInternal = -1;
 	int i = 0;
 
 	for (i = 0; i < m_directoryState.numItems; i++)
 	{
-		lvItem.mask = LVIF_PARAM;
-		lvItem.iItem = i;
-		lvItem.iSubItem = 0;
-		ListView_GetItem(m_hListView, &lvItem);
+		int internalIndex = GetItemInternalIndex(i);
 
-		if (m_itemInfoMap.at((int) lvItem.lParam).bDrive)
+		if (m_itemStore.IsDrive(internalIndex))
 		{
-			if (lstrcmp(szDrive, m_itemInfoMap.at((int) lvItem.lParam).szDrive) == 0)
+			if (m_itemStore.GetParsingName(internalIndex) == szDrive)
 			{
-				iItemInternal = (int) lvItem.lParam;
+				iItemInternal = internalIndex;
 				break;
 			}
 		}
@@ -1285,18 +1376,7 @@ int ShellBrowser::GetUniqueFolderId() const
 
 BasicItemInfo_t ShellBrowser::getBasicItemInfo(int internalIndex) const
 {
-	const ItemInfo_t &itemInfo = m_itemInfoMap.at(internalIndex);
-
-	BasicItemInfo_t basicItemInfo;
-	basicItemInfo.pidlComplete.reset(ILCloneFull(itemInfo.pidlComplete.get()));
-	basicItemInfo.pridl.reset(ILCloneChild(itemInfo.pridl.get()));
-	basicItemInfo.wfd = itemInfo.wfd;
-	basicItemInfo.isFindDataValid = itemInfo.isFindDataValid;
-	StringCchCopy(basicItemInfo.szDisplayName, SIZEOF_ARRAY(basicItemInfo.szDisplayName),
-		itemInfo.displayName.c_str());
-	basicItemInfo.isRoot = itemInfo.bDrive;
-
-	return basicItemInfo;
+	return m_itemStore.GetBasicItemInfo(internalIndex);
 }
 
 HWND ShellBrowser::GetListView() const
@@ -1316,8 +1396,7 @@ void ShellBrowser::DeleteSelectedItems(bool permanent)
 
 	while ((item = ListView_GetNextItem(m_hListView, item, LVNI_SELECTED)) != -1)
 	{
-		auto &itemInfo = GetItemByIndex(item);
-		pidls.push_back(itemInfo.pidlComplete.get());
+		pidls.push_back(m_itemStore.GetPidlComplete(GetItemInternalIndex(item)));
 	}
 
 	if (pidls.empty())
@@ -4,17 +4,27 @@
 
 #pragma once
 
+#include "ColorRuleMatcher.h"
 #include "ColumnDataRetrieval.h"
+#include "ColumnTextCache.h"
 #include "Columns.h"
 #include "FolderSettings.h"
+#include "ItemStore.h"
 #include "NavigatorInterface.h"
 #include "ServiceProvider.h"
+#include "ShellChangeCoalescer.h"
 #include "SignalWrapper.h"
+#include "SortHelper.h"
 #include "SortModes.h"
+#include "SortedItemIndex.h"
+#include "ThumbnailImageStore.h"
 #include "ViewModes.h"
+#include "ViewportTaskScheduler.h"
+#include "../Helper/ImageCacheStore.h"
 #include "../Helper/Macros.h"
 #include "../Helper/ShellDropTargetWindow.h"
 #include "../Helper/ShellHelper.h"
+#include "../Helper/WildcardPattern.h"
 #include "../Helper/WinRTBaseWrapper.h"
 #include "../ThirdParty/CTPL/cpl_stl.h"
 #include <boost/multi_index/hashed_index.hpp>
@@ -24,9 +34,12 @@
 #include <wil/com.h>
 #include <wil/resource.h>
 #include <thumbcache.h>
+#include <chrono>
 #include <future>
 #include <list>
+#include <mutex>
 #include <optional>
+#include <stop_token>
 #include <unordered_map>
 #include <unordered_set>
 
@@ -37,9 +50,12 @@ struct BasicItemInfo_t;
 class CachedIcons;
 struct Config;
 class CoreInterface;
+class ExtensionIconCache;
 class FileActionHandler;
 class IconFetcher;
+enum class IconPriority;
 class IconResourceLoader;
+class PersistentImageCache;
 struct PreservedFolderState;
 struct PreservedHistoryEntry;
 class ShellNavigationController;
@@ -98,7 +114,9 @@ public:
 	void CycleViewMode(bool cycleForward);
 	SortMode GetSortMode() const;
 	void SetSortMode(SortMode sortMode);
+	std::optional<SortMode> GetSecondarySortMode() const;
 	void SortFolder(SortMode sortMode);
+	void SortFolder(SortMode sortMode, std::optional<SortMode> secondarySortMode);
 	BOOL GetSortAscending() const;
 	BOOL SetSortAscending(BOOL bAscending);
 	BOOL GetShowHidden() const;
@@ -150,6 +168,7 @@ public:
 	void SetFileAttributesForSelection();
 
 	void SelectItems(const std::vector<PCIDLIST_ABSOLUTE> &pidls);
+	bool IsEnumerationInProgress() const;
 	uint64_t GetTotalDirectorySize();
 	uint64_t GetSelectionSize();
 	int LocateFileItemIndex(const TCHAR *szFileName) const;
@@ -183,33 +202,6 @@ public:
 private:
 	DISALLOW_COPY_AND_ASSIGN(ShellBrowser);
 
-	struct ItemInfo_t
-	{
-		unique_pidl_absolute pidlComplete;
-		unique_pidl_child pridl;
-		WIN32_FIND_DATA wfd;
-		bool isFindDataValid;
-		std::wstring parsingName;
-		std::wstring displayName;
-		std::wstring editingName;
-		int iIcon;
-
-		/* These are only used for drives. They are
-		needed for when a drive is removed from the
-		system, in which case the drive name is needed
-		so that the removed drive can be found. */
-		BOOL bDrive;
-		TCHAR szDrive[4];
-
-		/* Used for temporary sorting in details mode (i.e.
-		when items need to be rearranged). */
-		int iRelativeSort;
-
-		ItemInfo_t() : wfd({}), isFindDataValid(false), iIcon(0), bDrive(FALSE)
-		{
-		}
-	};
-
 	struct ShellChangeNotification
 	{
 		LONG event;
@@ -224,6 +216,19 @@ private:
 		}
 	};
 
+	// Describes how the set of items matched by the filter has changed.
+	enum class FilterChange
+	{
+		// The filter now matches a subset of the items it previously matched.
+		Narrowed,
+
+		// The filter now matches a superset of the items it previously matched.
+		Widened,
+
+		// The filter could match any set of items.
+		Replaced
+	};
+
 	struct AlteredFile_t
 	{
 		TCHAR szFileName[MAX_PATH];
@@ -238,6 +243,10 @@ private:
 
 		BOOL bPosition;
 		int iAfter;
+
+		// If set, the item will be inserted in its sorted position (which is determined when the
+		// item is inserted), rather than at iItem.
+		bool insertSorted;
 	};
 
 	struct Added_t
@@ -251,17 +260,64 @@ private:
 		POINT DropPoint;
 	};
 
+	// Holds the state that's shared between the UI thread and the background thread that
+	// enumerates a folder. Items are appended to the list here by the background thread and
+	// periodically moved into the view by the UI thread.
+	struct EnumerationContext
+	{
+		unique_pidl_absolute pidlDirectory;
+		SHCONTF enumFlags;
+		bool isRecycleBin;
+		std::stop_source stopSource;
+
+		std::mutex mutex;
+		std::vector<ItemInfo_t> items;
+		bool completed = false;
+		bool notificationPending = false;
+
+		// Only set if the enumeration ran to completion (i.e. it wasn't stopped and didn't fail).
+		bool enumeratedAllItems = false;
+	};
+
+	// The text for all of the requested columns of an item is retrieved together, in a single
+	// task.
 	struct ColumnResult_t
 	{
 		int itemInternalIndex;
-		ColumnType columnType;
-		std::wstring columnText;
+		std::vector<ColumnType> columnTypes;
+		std::vector<std::wstring> columnText;
+	};
+
+	struct PendingColumnResult
+	{
+		int itemInternalIndex;
+		std::vector<ColumnType> columnTypes;
+		std::future<ColumnResult_t> result;
+	};
+
+	struct FolderSizeResult
+	{
+		int itemInternalIndex;
+		ULONGLONG size;
 	};
 
 	struct ThumbnailResult_t
 	{
 		int itemInternalIndex;
 		wil::unique_hbitmap bitmap;
+
+		// If the item can be stored in the persistent image cache, the thumbnail pixels are also
+		// retrieved (on the background thread), so that they can be saved to the cache.
+		std::optional<ImageCacheKey> cacheKey;
+		uint32_t width = 0;
+		uint32_t height = 0;
+		std::vector<uint32_t> pixels;
+	};
+
+	struct PendingThumbnailResult
+	{
+		int itemInternalIndex;
+		std::future<std::optional<ThumbnailResult_t>> result;
 	};
 
 	struct InfoTipResult
@@ -286,6 +342,12 @@ private:
 		}
 	};
 
+	struct GroupResult
+	{
+		int itemInternalIndex;
+		GroupInfo groupInfo;
+	};
+
 	struct ListViewGroup
 	{
 		int id;
@@ -302,6 +364,25 @@ private:
 		}
 	};
 
+	// When the listview is in owner data mode, it doesn't store any information on the items it
+	// displays. The items (in display order), along with the data that's been retrieved for them,
+	// are stored here instead.
+	struct VirtualListState
+	{
+		std::vector<int> items;
+
+		// Maps the internal index of each item in the list above to its position. This allows
+		// results that are keyed by internal index to be matched to an item without having to
+		// search the list.
+		std::unordered_map<int, int> positions;
+
+		// A value of -1 indicates that the icon has been requested, but hasn't been retrieved yet.
+		std::unordered_map<int, int> iconIndexes;
+
+		std::unordered_map<int, int> thumbnailIndexes;
+		std::unordered_set<int> cutItems;
+	};
+
 	enum class GroupByDateType
 	{
 		Created,
@@ -329,11 +410,50 @@ private:
 		uint64_t totalDirSize;
 		uint64_t fileSelectionSize;
 
-		/* Cached folder size data. */
-		mutable std::unordered_map<int, ULONGLONG> cachedFolderSizes;
+		// The sizes of the folders in the directory, which are calculated in the background and
+		// used both when displaying and sorting by size. Entries are removed when the folder
+		// changes.
+		std::unordered_map<int, ULONGLONG> cachedFolderSizes;
+
+		// Maps each folder whose size is currently being calculated to the ID of that request.
+		std::unordered_map<int, int> pendingFolderSizeResultIds;
 
 		std::vector<ShellChangeNotification> shellChangeNotifications;
 
+		/* Items that were requested to be selected before they
+		were enumerated. */
+		std::vector<unique_pidl_absolute> pendingSelection;
+
+		// Used to determine where items should be inserted when they're added in their sorted
+		// position.
+		SortedItemIndex sortedItemIndex;
+
+		// The text retrieved for each item in details view. The listview requests the text each
+		// time an item is redrawn, so the text is served from here, rather than being retrieved
+		// again.
+		ColumnTextCache columnTextCache;
+
+		// The color rule that applies to each item is determined the first time the item is
+		// drawn. An item that doesn't match any rule is stored as std::nullopt. Entries are
+		// removed when the item changes, or the color rules themselves change.
+		std::unordered_map<int, std::optional<COLORREF>> itemColors;
+
+		// The group each item has been placed in. Determining an item's group can be expensive
+		// (e.g. when grouping by a property), so it's only done once per item, until the items are
+		// regrouped or the item changes.
+		std::unordered_map<int, int> itemGroupIds;
+
+		// Items whose group is being determined in the background are initially placed in a
+		// pending group. This maps each of those items to the ID of its most recent group task, so
+		// that results from earlier tasks can be ignored.
+		std::unordered_map<int, int> pendingGroupResultIds;
+
+		// The range of items that was visible the last time the thumbnails for the visible items
+		// were marked as used.
+		std::optional<std::pair<int, int>> thumbnailVisibleRange;
+
+		VirtualListState virtualList;
+
 		DirectoryState() :
 			virtualFolder(false),
 			itemIDCounter(0),
@@ -363,13 +483,47 @@ private:
 	static const UINT WM_APP_THUMBNAIL_RESULT_READY = WM_APP + 151;
 	static const UINT WM_APP_INFO_TIP_READY = WM_APP + 152;
 	static const UINT WM_APP_SHELL_NOTIFY = WM_APP + 153;
+	static const UINT WM_APP_ENUMERATION_RESULT_READY = WM_APP + 154;
+	static const UINT WM_APP_GROUP_RESULT_READY = WM_APP + 155;
+	static const UINT WM_APP_FOLDER_SIZE_READY = WM_APP + 156;
+	static const UINT WM_APP_UPDATE_THUMBNAIL_VISIBLE_RANGE = WM_APP + 157;
 
 	static const int THUMBNAIL_ITEM_WIDTH = 120;
 	static const int THUMBNAIL_ITEM_HEIGHT = 120;
 
+	// The thumbnails image list is created empty and grows by this many images at a time.
+	static const int THUMBNAIL_IMAGE_LIST_GROW_SIZE = 64;
+
 	static const UINT PROCESS_SHELL_CHANGES_TIMER_ID = 1;
 	static const UINT PROCESS_SHELL_CHANGES_TIMEOUT = 100;
 
+	// Moving an item to a different group causes the listview to be redrawn, so group results are
+	// collected and applied in batches.
+	static const UINT PROCESS_GROUP_RESULTS_TIMER_ID = 2;
+	static const UINT PROCESS_GROUP_RESULTS_TIMEOUT = 100;
+
+	static const int NUM_GROUP_THREADS = 2;
+
+	// Each thumbnail thread keeps its own thumbnail cache instance for as long as the thread runs.
+	static const int NUM_THUMBNAIL_THREADS = 3;
+
+	// As folder sizes are calculated, the items are sorted again (if they're being sorted by size)
+	// at most once during this interval.
+	static const UINT SORT_BY_FOLDER_SIZE_TIMER_ID = 3;
+	static const UINT SORT_BY_FOLDER_SIZE_TIMEOUT = 200;
+
+	// If a batch of shell changes results in at least this many item changes (after the changes
+	// have been coalesced), the folder will be enumerated again and compared against the existing
+	// items, rather than each change being applied individually.
+	static const size_t SHELL_CHANGE_RESYNC_THRESHOLD = 500;
+
+	// Enumerated items are sent back to the UI thread in batches. The size of each batch doubles,
+	// so that the cost of inserting and sorting the items stays proportional to the total number
+	// of items. A batch will also be sent once the interval below has elapsed, so that the view
+	// continues to update when enumerating a slow folder.
+	static const size_t ENUMERATION_INITIAL_BATCH_SIZE = 128;
+	static constexpr auto ENUMERATION_BATCH_INTERVAL = std::chrono::milliseconds(250);
+
 	ShellBrowser(int id, HWND hOwner, CoreInterface *coreInterface,
 		TabNavigationInterface *tabNavigation, FileActionHandler *fileActionHandler,
 		const std::vector<std::unique_ptr<PreservedHistoryEntry>> &history, int currentEntry,
@@ -378,7 +532,7 @@ private:
 		TabNavigationInterface *tabNavigation, FileActionHandler *fileActionHandler,
 		const FolderSettings &folderSettings, const FolderColumns *initialColumns);
 
-	static HWND CreateListView(HWND parent);
+	static HWND CreateListView(HWND parent, bool virtualListView);
 	void InitializeListView();
 	int GenerateUniqueItemId();
 	void MarkItemAsCut(int item, bool cut);
@@ -389,20 +543,33 @@ private:
 	HRESULT BrowseFolder(PCIDLIST_ABSOLUTE pidlDirectory, bool addHistoryEntry = true) override;
 
 	/* Browsing support. */
-	HRESULT EnumerateFolder(PCIDLIST_ABSOLUTE pidlDirectory, bool addHistoryEntry,
-		std::vector<ItemInfo_t> &items);
+	HRESULT EnumerateFolder(PCIDLIST_ABSOLUTE pidlDirectory, bool addHistoryEntry);
+	SHCONTF GetEnumerationFlags() const;
+	static void EnumerateFolderAsync(HWND listView, int folderId,
+		std::shared_ptr<EnumerationContext> context);
+	static void SendEnumeratedItems(HWND listView, int folderId, EnumerationContext &context,
+		std::vector<ItemInfo_t> &items, bool completed);
+	void ProcessEnumerationResult(int folderId);
+	void CancelEnumeration();
 	void PrepareToChangeFolders();
 	void ClearPendingResults();
 	void ResetFolderState();
 	void StoreCurrentlySelectedItems();
-	void OnEnumerationCompleted(std::vector<ItemInfo_t> &&items);
+	void InsertEnumeratedItems(std::vector<ItemInfo_t> &&items);
+	void OnEnumerationCompleted();
 	void InsertAwaitingItems(BOOL bInsertIntoGroup);
-	BOOL IsFileFiltered(const ItemInfo_t &itemInfo) const;
+	void InsertAwaitingItemsIntoVirtualList(BOOL bInsertIntoGroup,
+		std::vector<SortedItemIndex::NewItem> sortedItems);
+	void InsertAddedItems();
+	BOOL IsFileFiltered(int internalIndex) const;
 	std::optional<int> AddItemInternal(IShellFolder *shellFolder, PCIDLIST_ABSOLUTE pidlDirectory,
 		PCITEMID_CHILD pidlChild, int itemIndex, BOOL setPosition);
 	int AddItemInternal(int itemIndex, ItemInfo_t itemInfo, BOOL setPosition);
 	std::optional<ItemInfo_t> GetItemInformation(IShellFolder *shellFolder,
 		PCIDLIST_ABSOLUTE pidlDirectory, PCITEMID_CHILD pidlChild);
+	static std::optional<ItemInfo_t> GetItemInformation(IShellFolder *shellFolder,
+		PCIDLIST_ABSOLUTE pidlDirectory, PCITEMID_CHILD pidlChild, bool isRecycleBin);
+	bool IsRecycleBin(PCIDLIST_ABSOLUTE pidl) const;
 	static HRESULT ExtractFindDataUsingPropertyStore(IShellFolder *shellFolder,
 		PCITEMID_CHILD pidlChild, WIN32_FIND_DATA &output);
 	void SetViewModeInternal(ViewMode viewMode);
@@ -422,7 +589,7 @@ private:
 		LPARAM lParam, UINT_PTR uIdSubclass, DWORD_PTR dwRefData);
 	LRESULT CALLBACK ListViewParentProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam);
 
-	static int CALLBACK SortStub(LPARAM lParam1, LPARAM lParam2, LPARAM lParamSort);
+	static int CALLBACK SortTemporaryStub(LPARAM lParam1, LPARAM lParam2, LPARAM lParamSort);
 
 	/* Message handlers. */
 	void ColumnClicked(int iClickedColumn);
@@ -432,6 +599,10 @@ private:
 	void OnListViewMButtonUp(const POINT *pt, UINT keysDown);
 	void OnRButtonDown(HWND hwnd, BOOL doubleClick, int x, int y, UINT keyFlags);
 	void OnListViewGetDisplayInfo(LPARAM lParam);
+	void OnVirtualListViewGetDisplayInfo(LVITEM *item);
+	int OnListViewFindItem(const NMLVFINDITEM *findItem) const;
+	void OnListViewCacheHint(const NMLVCACHEHINT *cacheHint);
+	void OnListViewStateChanged(const NMLVODSTATECHANGE *stateChange);
 	LRESULT OnListViewGetInfoTip(NMLVGETINFOTIP *getInfoTip);
 	BOOL OnListViewGetEmptyMarkup(NMLVEMPTYMARKUP *emptyMarkup);
 	void QueueInfoTipTask(int internalIndex, const std::wstring &existingInfoTip);
@@ -442,6 +613,7 @@ private:
 	void OnListViewItemInserted(const NMLISTVIEW *itemData);
 	void OnListViewItemChanged(const NMLISTVIEW *changeData);
 	void UpdateFileSelectionInfo(int internalIndex, BOOL selected);
+	void RecalculateFileSelectionInfo();
 	void OnListViewKeyDown(const NMLVKEYDOWN *lvKeyDown);
 	std::vector<PCIDLIST_ABSOLUTE> GetSelectedItemPidls();
 	void OnListViewBeginDrag(const NMLISTVIEW *info);
@@ -450,6 +622,7 @@ private:
 	BOOL OnListViewBeginLabelEdit(const NMLVDISPINFO *dispInfo);
 	BOOL OnListViewEndLabelEdit(const NMLVDISPINFO *dispInfo);
 	LRESULT OnListViewCustomDraw(NMLVCUSTOMDRAW *listViewCustomDraw);
+	std::optional<COLORREF> GetItemColor(int internalIndex);
 	void OnColorRulesUpdated();
 
 	HRESULT GetListViewItemAttributes(int item, SFGAOF *attributes) const;
@@ -465,29 +638,38 @@ private:
 	void OnColumnMenuItemSelected(int menuItemId,
 		const std::unordered_map<int, ColumnType> &menuItemMappings);
 
-	const ItemInfo_t &GetItemByIndex(int index) const;
-	ItemInfo_t &GetItemByIndex(int index);
 	int GetItemInternalIndex(int item) const;
 
 	BasicItemInfo_t getBasicItemInfo(int internalIndex) const;
 
 	/* Sorting. */
-	int CALLBACK Sort(int InternalIndex1, int InternalIndex2) const;
+	void SortListViewItems();
+	SortKey GetSortKey(int internalIndex) const;
+	SortKeyOptions GetSortKeyOptions() const;
+	void UpdateSortedItemIndexIfNecessary();
+	std::vector<SortedItemIndex::NewItem> DetermineSortedPositionsForAwaitingItems();
 
 	/* Listview column support. */
 	void AddFirstColumn();
 	void SetUpListViewColumns();
 	void DeleteAllColumns();
-	void QueueColumnTask(int itemInternalIndex, ColumnType columnType);
+	const std::wstring *MaybeGetColumnText(int itemIndex, int internalIndex,
+		ColumnType columnType);
+	void QueueColumnTask(int itemIndex, int itemInternalIndex,
+		std::vector<ColumnType> columnTypes);
+	std::vector<ColumnType> GetColumnTypesToRetrieve() const;
+	void UpdateColumnTaskVisibleRange();
+	void CancelColumnTasks();
 	static ColumnResult_t GetColumnTextAsync(HWND listView, int columnResultId,
-		ColumnType columnType, int internalIndex, const BasicItemInfo_t &basicItemInfo,
-		const GlobalFolderSettings &globalFolderSettings);
+		const std::vector<ColumnType> &columnTypes, int internalIndex,
+		const BasicItemInfo_t &basicItemInfo, const GlobalFolderSettings &globalFolderSettings);
 	void InsertColumn(ColumnType columnType, int columnIndex, int width);
 	void SetActiveColumnSet();
 	void GetColumnInternal(ColumnType columnType, Column_t *pci) const;
 	Column_t GetFirstCheckedColumn();
 	void SaveColumnWidths();
 	void ProcessColumnResult(int columnResultId);
+	void OnColumnTextUpdated(int internalIndex, const std::vector<ColumnType> &columnTypes);
 	std::optional<int> GetColumnIndexByType(ColumnType columnType) const;
 	std::optional<ColumnType> GetColumnTypeByIndex(int index) const;
 
@@ -501,27 +683,46 @@ private:
 	bool IsMonitoringShellChanges();
 	void OnShellNotify(WPARAM wParam, LPARAM lParam);
 	void OnProcessShellChangeNotifications();
-	void ProcessShellChangeNotification(const ShellChangeNotification &change);
+	void ProcessShellChangeNotification(const ShellChangeNotification &change,
+		ShellChangeCoalescer &coalescer);
+	static std::wstring GetShellChangeItemKey(PCIDLIST_ABSOLUTE pidl);
+	void ApplyShellChanges(std::vector<ShellChangeCoalescer::Change> changes);
+	void StartResync();
+	void ProcessResyncResult();
+	void SynchronizeItems(std::vector<ItemInfo_t> &&items);
+	void RequestListViewSort();
+	void EndDeferredSorting();
 	void OnItemAdded(PCIDLIST_ABSOLUTE simplePidl);
 	void AddItem(PCIDLIST_ABSOLUTE pidl);
 	void RemoveItem(int iItemInternal);
+	void RemoveItems(const std::vector<int> &internalIndexes);
 	void OnItemRemoved(PCIDLIST_ABSOLUTE simplePidl);
 	void OnItemModified(PCIDLIST_ABSOLUTE simplePidl);
 	void UpdateItem(PCIDLIST_ABSOLUTE pidl, PCIDLIST_ABSOLUTE updatedPidl = nullptr);
+	void UpdateItemDetails(int internalIndex, ItemInfo_t &&itemInfo, bool renamed);
 	void OnItemRenamed(PCIDLIST_ABSOLUTE simplePidlOld, PCIDLIST_ABSOLUTE simplePidlNew);
 	void InvalidateAllColumnsForItem(int itemIndex);
 	void InvalidateIconForItem(int itemIndex);
-	int DetermineItemSortedPosition(LPARAM lParam) const;
 
 	/* Filtering support. */
-	void UpdateFiltering();
+	void UpdateFiltering(FilterChange change);
 	void RemoveFilteredItems();
+	void RemoveFilteredItemsFromVirtualList();
 	void RemoveFilteredItem(int iItem, int iItemInternal);
+	void RemoveFilteredItemFromListView(int iItem, int iItemInternal);
 	BOOL IsFilenameFiltered(const TCHAR *FileName) const;
-	void UnfilterAllItems();
+	WildcardPattern CompileFilter() const;
+	void RestoreFilteredItems(const std::unordered_set<int> &items);
 	void UnfilterItem(int internalIndex);
 	void RestoreFilteredItem(int internalIndex);
 
+	/* Folder sizes. */
+	void QueueFolderSizeTaskIfNecessary(int internalIndex);
+	void RequestFolderSizeText(int internalIndex);
+	void ProcessFolderSizeResult(int folderSizeResultId);
+	void OnSortByFolderSizeTimer();
+	void CancelFolderSizeTasks();
+
 	/* Listview group support. */
 	static int CALLBACK GroupComparisonStub(int id1, int id2, void *data);
 	int GroupComparison(int id1, int id2);
@@ -529,6 +730,8 @@ private:
 	int GroupRelativePositionComparison(const ListViewGroup &group1, const ListViewGroup &group2);
 	const ListViewGroup GetListViewGroupById(int groupId);
 	int DetermineItemGroup(int iItemInternal);
+	GroupInfo DetermineItemGroupInfo(const BasicItemInfo_t &basicItemInfo, SortMode sortMode,
+		const GlobalFolderSettings &globalFolderSettings) const;
 	std::optional<GroupInfo> DetermineItemNameGroup(const BasicItemInfo_t &itemInfo) const;
 	std::optional<GroupInfo> DetermineItemSizeGroup(const BasicItemInfo_t &itemInfo) const;
 	std::optional<GroupInfo> DetermineItemTotalSizeGroup(const BasicItemInfo_t &itemInfo) const;
@@ -550,6 +753,7 @@ private:
 
 	/* Other grouping support. */
 	int GetOrCreateListViewGroup(const GroupInfo &groupInfo);
+	void ResetGroups();
 	void MoveItemsIntoGroups();
 	void InsertItemIntoGroup(int index, int groupId);
 	void EnsureGroupExistsInListView(int groupId);
@@ -560,28 +764,58 @@ private:
 	void OnItemRemovedFromGroup(int groupId);
 	void OnItemAddedToGroup(int groupId);
 	std::optional<int> GetItemGroupId(int index);
+	void QueueGroupTask(int internalIndex);
+	void OnGroupResultReady(int groupResultId);
+	void ProcessGroupResults();
+	void CancelGroupTasks();
 
 	/* Listview icons. */
 	void ProcessIconResult(int internalIndex, int iconIndex);
-	std::optional<int> GetCachedIconIndex(const ItemInfo_t &itemInfo);
+	std::optional<int> GetCachedIconIndex(int internalIndex);
+	std::optional<int> GetExtensionIconIndex(int internalIndex);
+	void QueueItemIconTask(int itemIndex, int internalIndex,
+		std::optional<int> extensionIconIndex);
+	IconPriority GetIconPriority(int itemIndex) const;
+	std::optional<ImageCacheKey> GetImageCacheKey(int internalIndex) const;
+	std::optional<int> GetPersistedOverlayIndex(int internalIndex);
+	void PersistOverlayIndex(int internalIndex, int overlayIndex);
+
+	/* Owner data (virtual) listview support. */
+	void SetVirtualListItems(std::vector<int> items);
+	void RemoveVirtualListItems(const std::unordered_set<int> &internalIndexes);
+	std::optional<int> GetVirtualListItemPosition(int internalIndex) const;
+	void QueueVirtualListIconTask(int itemIndex, int internalIndex);
+	void RemoveVirtualListItemData(int internalIndex);
 
 	/* Thumbnails view. */
-	void QueueThumbnailTask(int internalIndex);
-	std::optional<int> GetCachedThumbnailIndex(const ItemInfo_t &itemInfo);
-	static wil::unique_hbitmap GetThumbnail(PIDLIST_ABSOLUTE pidl, WTS_FLAGS flags);
+	void QueueThumbnailTask(int itemIndex, int internalIndex);
+	void ScheduleThumbnailTaskVisibleRangeUpdate();
+	void OnUpdateThumbnailTaskVisibleRange();
+	void UpdateThumbnailTaskVisibleRange();
+	std::optional<std::pair<int, int>> GetThumbnailsVisibleRange() const;
+	void CancelThumbnailTasks();
+	static void OnThumbnailThreadStart();
+	static void OnThumbnailThreadExit();
+	std::optional<int> GetPersistedThumbnailIndex(int internalIndex);
+	static wil::unique_hbitmap GetThumbnail(IThumbnailCache *thumbnailCache,
+		PCIDLIST_ABSOLUTE pidl);
 	void ProcessThumbnailResult(int thumbnailResultId);
 	void SetupThumbnailsView();
 	void RemoveThumbnailsView();
-	int GetIconThumbnail(int iInternalIndex) const;
-	int GetExtractedThumbnail(HBITMAP hThumbnailBitmap) const;
-	int GetThumbnailInternal(int iType, int iInternalIndex, HBITMAP hThumbnailBitmap) const;
-	void DrawIconThumbnailInternal(HDC hdcBacking, int iInternalIndex) const;
+	HIMAGELIST CreateThumbnailsImageList();
+	void ResetThumbnailImage(int internalIndex);
+	void MarkVisibleThumbnailsUsed(int firstItem, int lastItem);
+	int GetIconThumbnail(int iInternalIndex);
+	int GetExtractedThumbnail(int iInternalIndex, HBITMAP hThumbnailBitmap);
+	void SetThumbnailImage(int iImage, int iType, int iIconIndex, HBITMAP hThumbnailBitmap) const;
+	void DrawIconThumbnailInternal(HDC hdcBacking, int iIconIndex) const;
 	void DrawThumbnailInternal(HDC hdcBacking, HBITMAP hThumbnailBitmap) const;
 
 	/* Tiles view. */
 	void InsertTileViewColumns();
 	void SetTileViewInfo();
 	void SetTileViewItemInfo(int iItem, int iItemInternal);
+	std::wstring GetTileViewItemText(int internalIndex, int subItem) const;
 
 	void UpdateCurrentClipboardObject(wil::com_ptr_nothrow<IDataObject> clipboardDataObject);
 	void OnClipboardUpdate();
@@ -609,9 +843,11 @@ private:
 	std::optional<int> GetItemInternalIndexForPidl(PCIDLIST_ABSOLUTE pidl) const;
 	std::optional<int> LocateItemByInternalIndex(int internalIndex) const;
 	void ApplyHeaderSortArrow();
+	void SelectPendingItems();
 
 	HWND m_hListView;
 	HWND m_hOwner;
+	const bool m_virtualListView;
 
 	NavigationStartedSignal m_navigationStartedSignal;
 	NavigationCommittedSignal m_navigationCommittedSignal;
@@ -631,25 +867,51 @@ private:
 
 	/* Stores various extra information on files, such
 	as display name. */
-	std::unordered_map<int, ItemInfo_t> m_itemInfoMap;
+	ItemStore m_itemStore;
 
-	ctpl::thread_pool m_columnThreadPool;
-	std::unordered_map<int, std::future<ColumnResult_t>> m_columnResults;
+	ctpl::thread_pool m_enumerationThreadPool;
+	std::shared_ptr<EnumerationContext> m_enumerationContext;
+
+	// Set while the current folder is being enumerated again, in response to a large batch of
+	// shell changes.
+	std::shared_ptr<EnumerationContext> m_resyncContext;
+
+	// Set while a batch of changes is being applied, so that the items are only sorted once, after
+	// the whole batch has been processed.
+	bool m_deferSorting = false;
+	bool m_sortingDeferred = false;
+
+	ViewportTaskScheduler m_columnTaskScheduler;
+	std::unordered_map<int, PendingColumnResult> m_columnResults;
 	int m_columnResultIDCounter;
 
 	std::unique_ptr<IconFetcher> m_iconFetcher;
 	CachedIcons *m_cachedIcons;
+	ExtensionIconCache *m_extensionIconCache;
+	PersistentImageCache *m_persistentImageCache;
 
 	IconResourceLoader *m_iconResourceLoader;
 
-	ctpl::thread_pool m_thumbnailThreadPool;
-	std::unordered_map<int, std::future<std::optional<ThumbnailResult_t>>> m_thumbnailResults;
+	ViewportTaskScheduler m_thumbnailTaskScheduler;
+	std::unordered_map<int, PendingThumbnailResult> m_thumbnailResults;
 	int m_thumbnailResultIDCounter;
+	ThumbnailImageStore m_thumbnailImageStore;
+	bool m_thumbnailVisibleRangeUpdatePending = false;
 
 	ctpl::thread_pool m_infoTipsThreadPool;
 	std::unordered_map<int, std::future<std::optional<InfoTipResult>>> m_infoTipResults;
 	int m_infoTipResultIDCounter;
 
+	ctpl::thread_pool m_groupThreadPool;
+	std::unordered_map<int, std::future<GroupResult>> m_groupResults;
+	int m_groupResultIDCounter;
+	std::vector<int> m_readyGroupResultIds;
+
+	ctpl::thread_pool m_folderSizeThreadPool;
+	std::unordered_map<int, std::future<std::optional<FolderSizeResult>>> m_folderSizeResults;
+	std::stop_source m_folderSizeStopSource;
+	bool m_folderSizeSortPending = false;
+
 	/* Internal state. */
 	const HINSTANCE m_resourceInstance;
 	HACCEL *m_acceleratorTable;
@@ -668,6 +930,12 @@ private:
 	const Config *m_config;
 	FolderSettings m_folderSettings;
 
+	// The compiled form of the filter. Updated whenever the filter changes.
+	WildcardPattern m_filterPattern;
+
+	// The compiled form of the color rules. Updated whenever the rules change.
+	ColorRuleMatcher m_colorRuleMatcher;
+
 	/* ID. */
 	const int m_ID;
 
@@ -722,4 +990,8 @@ private:
 
 	ListViewGroupSet m_listViewGroups;
 	int m_groupIdCounter;
+
+	// The sort mode the current set of groups was built for. The items only need to be regrouped
+	// if they're subsequently grouped by a different column.
+	std::optional<SortMode> m_groupsSortMode;
 };
@@ -0,0 +1,272 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "ShellChangeCoalescer.h"
+#include <algorithm>
+#include <unordered_set>
+
+ShellChangeCoalescer::ShellChangeCoalescer(GetItemKey getItemKey) :
+	m_getItemKey(std::move(getItemKey))
+{
+}
+
+void ShellChangeCoalescer::OnItemAdded(PCIDLIST_ABSOLUTE pidl)
+{
+	auto key = m_getItemKey(pidl);
+	auto itr = m_entries.find(key);
+
+	if (itr == m_entries.end())
+	{
+		auto &entry = m_entries[key];
+		entry.currentPidl.reset(ILCloneFull(pidl));
+		entry.sequence = m_sequence++;
+		return;
+	}
+
+	// Either the item was removed earlier in the burst and has now been recreated, or this is a
+	// duplicate notification. In both cases, the item is treated as having been modified (if it
+	// existed before the burst) or added (if it didn't).
+	itr->second.currentPidl.reset(ILCloneFull(pidl));
+	itr->second.modified = true;
+}
+
+void ShellChangeCoalescer::OnItemRemoved(PCIDLIST_ABSOLUTE pidl)
+{
+	auto key = m_getItemKey(pidl);
+	auto itr = m_entries.find(key);
+
+	if (itr == m_entries.end())
+	{
+		auto &entry = GetOrCreateEntry(key, pidl);
+		entry.currentPidl.reset();
+		return;
+	}
+
+	if (!itr->second.originalPidl)
+	{
+		// The item was created during the burst, so the two changes cancel each other out.
+		m_entries.erase(itr);
+		return;
+	}
+
+	itr->second.currentPidl.reset();
+}
+
+void ShellChangeCoalescer::OnItemUpdated(PCIDLIST_ABSOLUTE pidl)
+{
+	auto key = m_getItemKey(pidl);
+	auto &entry = GetOrCreateEntry(key, pidl);
+	entry.currentPidl.reset(ILCloneFull(pidl));
+	entry.modified = true;
+}
+
+void ShellChangeCoalescer::OnItemRenamed(PCIDLIST_ABSOLUTE pidlOld, PCIDLIST_ABSOLUTE pidlNew)
+{
+	auto oldKey = m_getItemKey(pidlOld);
+	auto newKey = m_getItemKey(pidlNew);
+
+	if (oldKey == newKey)
+	{
+		OnItemUpdated(pidlNew);
+		return;
+	}
+
+	GetOrCreateEntry(oldKey, pidlOld);
+	Entry source = std::move(m_entries.extract(oldKey).mapped());
+
+	auto targetItr = m_entries.find(newKey);
+
+	if (targetItr != m_entries.end() && targetItr->second.originalPidl)
+	{
+		// There was an item with the new name before the burst started (which has either been
+		// removed or is being replaced by this rename). Rather than tracking two items with the
+		// same name, the original item is updated and the source item is removed.
+		Entry &target = targetItr->second;
+		target.currentPidl.reset(ILCloneFull(pidlNew));
+		target.modified = true;
+
+		if (source.originalPidl)
+		{
+			source.currentPidl.reset();
+			m_detachedEntries.push_back(std::move(source));
+		}
+
+		return;
+	}
+
+	// If there's an entry for the new name at this point, it refers to an item that was created
+	// during the burst. That item is being replaced, so the entry can simply be overwritten.
+	source.currentPidl.reset(ILCloneFull(pidlNew));
+	source.modified = true;
+	m_entries.insert_or_assign(newKey, std::move(source));
+}
+
+size_t ShellChangeCoalescer::GetNumChanges() const
+{
+	auto numChanges = std::count_if(m_entries.begin(), m_entries.end(),
+		[](const auto &entry)
+		{
+			return GetChangeType(entry.second, entry.first).has_value();
+		});
+
+	return static_cast<size_t>(numChanges) + m_detachedEntries.size();
+}
+
+std::vector<ShellChangeCoalescer::Change> ShellChangeCoalescer::TakeChanges()
+{
+	struct PendingChange
+	{
+		ChangeType type;
+		const std::wstring *key;
+		Entry *entry;
+	};
+
+	std::vector<PendingChange> pendingChanges;
+	std::unordered_set<std::wstring> renamedFromKeys;
+
+	for (auto &[key, entry] : m_entries)
+	{
+		auto changeType = GetChangeType(entry, key);
+
+		if (!changeType)
+		{
+			continue;
+		}
+
+		pendingChanges.push_back({ *changeType, &key, &entry });
+
+		if (*changeType == ChangeType::Renamed)
+		{
+			renamedFromKeys.insert(entry.originalKey);
+		}
+	}
+
+	for (auto &entry : m_detachedEntries)
+	{
+		pendingChanges.push_back({ ChangeType::Removed, nullptr, &entry });
+	}
+
+	struct SequencedChange
+	{
+		Change change;
+		size_t sequence;
+	};
+
+	std::vector<SequencedChange> changes;
+	changes.reserve(pendingChanges.size());
+
+	for (auto &pendingChange : pendingChanges)
+	{
+		Entry &entry = *pendingChange.entry;
+
+		switch (pendingChange.type)
+		{
+		case ChangeType::Removed:
+			changes.push_back(
+				{ { ChangeType::Removed, std::move(entry.originalPidl), nullptr }, entry.sequence });
+			break;
+
+		case ChangeType::Renamed:
+			if (renamedFromKeys.contains(*pendingChange.key))
+			{
+				// The item is being renamed to the original name of another item that's also being
+				// renamed (e.g. two items have had their names swapped). There's no order in which
+				// the renames can be applied that avoids two items temporarily having the same
+				// name, so the item is removed and re-added instead.
+				changes.push_back({ { ChangeType::Removed, std::move(entry.originalPidl), nullptr },
+					entry.sequence });
+				changes.push_back({ { ChangeType::Added, std::move(entry.currentPidl), nullptr },
+					entry.sequence });
+			}
+			else
+			{
+				changes.push_back({ { ChangeType::Renamed, std::move(entry.originalPidl),
+										std::move(entry.currentPidl) },
+					entry.sequence });
+			}
+			break;
+
+		case ChangeType::Updated:
+		case ChangeType::Added:
+			changes.push_back(
+				{ { pendingChange.type, std::move(entry.currentPidl), nullptr }, entry.sequence });
+			break;
+		}
+	}
+
+	std::sort(changes.begin(), changes.end(),
+		[](const SequencedChange &change1, const SequencedChange &change2)
+		{
+			if (change1.change.type != change2.change.type)
+			{
+				return change1.change.type < change2.change.type;
+			}
+
+			return change1.sequence < change2.sequence;
+		});
+
+	std::vector<Change> orderedChanges;
+	orderedChanges.reserve(changes.size());
+
+	for (auto &change : changes)
+	{
+		orderedChanges.push_back(std::move(change.change));
+	}
+
+	m_entries.clear();
+	m_detachedEntries.clear();
+	m_sequence = 0;
+
+	return orderedChanges;
+}
+
+std::optional<ShellChangeCoalescer::ChangeType> ShellChangeCoalescer::GetChangeType(
+	const Entry &entry, const std::wstring &key)
+{
+	if (!entry.originalPidl)
+	{
+		if (!entry.currentPidl)
+		{
+			return std::nullopt;
+		}
+
+		return ChangeType::Added;
+	}
+
+	if (!entry.currentPidl)
+	{
+		return ChangeType::Removed;
+	}
+
+	if (entry.originalKey != key)
+	{
+		return ChangeType::Renamed;
+	}
+
+	if (entry.modified)
+	{
+		return ChangeType::Updated;
+	}
+
+	return std::nullopt;
+}
+
+// Returns the entry for the specified key, creating it if necessary. If there's no existing entry,
+// the item is assumed to have existed (unchanged) before the burst started.
+ShellChangeCoalescer::Entry &ShellChangeCoalescer::GetOrCreateEntry(const std::wstring &key,
+	PCIDLIST_ABSOLUTE pidl)
+{
+	auto [itr, inserted] = m_entries.try_emplace(key);
+
+	if (inserted)
+	{
+		itr->second.originalPidl.reset(ILCloneFull(pidl));
+		itr->second.originalKey = key;
+		itr->second.currentPidl.reset(ILCloneFull(pidl));
+		itr->second.sequence = m_sequence++;
+	}
+
+	return itr->second;
+}
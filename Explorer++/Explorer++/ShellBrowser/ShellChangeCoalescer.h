@@ -0,0 +1,91 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include "../Helper/ShellHelper.h"
+#include <functional>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Reduces a burst of change notifications for the items in a folder to the smallest set of changes
+// that will bring the view up to date. For example, repeated updates to an item are merged, an item
+// that's created and then deleted within the burst is dropped entirely and a chain of renames is
+// folded into a single rename from the item's original name to its final name.
+//
+// Items are identified by the key returned for their PIDL, rather than by the PIDL itself, so the
+// caller decides which PIDLs refer to the same item.
+class ShellChangeCoalescer
+{
+public:
+	enum class ChangeType
+	{
+		Removed,
+		Renamed,
+		Updated,
+		Added
+	};
+
+	struct Change
+	{
+		ChangeType type;
+
+		// For renames, this is the item's original PIDL. For all other changes, it's the item's
+		// current PIDL.
+		unique_pidl_absolute pidl;
+
+		// Only set for renames.
+		unique_pidl_absolute pidlNew;
+	};
+
+	using GetItemKey = std::function<std::wstring(PCIDLIST_ABSOLUTE pidl)>;
+
+	explicit ShellChangeCoalescer(GetItemKey getItemKey);
+
+	void OnItemAdded(PCIDLIST_ABSOLUTE pidl);
+	void OnItemRemoved(PCIDLIST_ABSOLUTE pidl);
+	void OnItemUpdated(PCIDLIST_ABSOLUTE pidl);
+	void OnItemRenamed(PCIDLIST_ABSOLUTE pidlOld, PCIDLIST_ABSOLUTE pidlNew);
+
+	// The number of changes that will be returned by TakeChanges().
+	size_t GetNumChanges() const;
+
+	// Returns the coalesced changes and resets the coalescer. The changes are returned in the
+	// order they should be applied in: removals first, followed by renames, updates and additions.
+	// Within each group, changes are ordered by when the item was first changed.
+	std::vector<Change> TakeChanges();
+
+private:
+	// Tracks the state of an item over the course of the burst, keyed by the item's current name
+	// (or, if the item no longer exists, its original name).
+	struct Entry
+	{
+		// The item's PIDL and key before the burst started. These will only be set if the item
+		// existed at that point.
+		unique_pidl_absolute originalPidl;
+		std::wstring originalKey;
+
+		// The item's current PIDL. This will only be set if the item currently exists.
+		unique_pidl_absolute currentPidl;
+
+		bool modified = false;
+		size_t sequence = 0;
+	};
+
+	static std::optional<ChangeType> GetChangeType(const Entry &entry, const std::wstring &key);
+
+	Entry &GetOrCreateEntry(const std::wstring &key, PCIDLIST_ABSOLUTE pidl);
+
+	GetItemKey m_getItemKey;
+	std::unordered_map<std::wstring, Entry> m_entries;
+
+	// Items that existed before the burst and were then renamed to the name of another item that
+	// also existed before the burst. The other item is treated as having been updated, so these
+	// items need to be removed, even though they no longer have an entry of their own.
+	std::vector<Entry> m_detachedEntries;
+
+	size_t m_sequence = 0;
+};
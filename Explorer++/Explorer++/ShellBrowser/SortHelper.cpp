@@ -5,108 +5,139 @@
 #include "stdafx.h"
 #include "SortHelper.h"
 #include "ItemData.h"
+#include "../Helper/NaturalSortKey.h"
 #include <wil/common.h>
+#include <propkey.h>
 #include <propvarutil.h>
 
-int SortByName(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2,
+namespace
+{
+void SetNameKey(SortKey &key, const BasicItemInfo_t &itemInfo,
 	const GlobalFolderSettings &globalFolderSettings)
 {
-	if (itemInfo1.isRoot && !itemInfo2.isRoot)
+	/* If the items been compared are both drives,
+	sort by drive letter, rather than display name.
+	Drives are always placed before other items. */
+	if (itemInfo.isRoot)
 	{
-		return -1;
+		key.rank = 0;
+		key.text = itemInfo.getFullPath();
 	}
-	else if (!itemInfo1.isRoot && itemInfo2.isRoot)
+	else
 	{
-		return 1;
-	}
-	else if (itemInfo1.isRoot && itemInfo2.isRoot)
-	{
-		/* If the items been compared are both drives,
-		sort by drive letter, rather than display name. */
-		if (globalFolderSettings.useNaturalSortOrder)
-		{
-			return StrCmpLogicalW(itemInfo1.getFullPath().c_str(), itemInfo2.getFullPath().c_str());
-		}
-		else
-		{
-			return StrCmpIW(itemInfo1.getFullPath().c_str(), itemInfo2.getFullPath().c_str());
-		}
+		key.rank = 1;
+		key.text = GetNameColumnText(itemInfo, globalFolderSettings);
 	}
+}
 
-	std::wstring name1 = GetNameColumnText(itemInfo1, globalFolderSettings);
-	std::wstring name2 = GetNameColumnText(itemInfo2, globalFolderSettings);
+void SetTypeKey(SortKey &key, const BasicItemInfo_t &itemInfo)
+{
+	key.rank = itemInfo.isRoot ? 0 : 1;
+	key.text = GetTypeColumnText(itemInfo);
+}
 
-	if (globalFolderSettings.useNaturalSortOrder)
+void SetSizeKey(SortKey &key, const BasicItemInfo_t &itemInfo)
+{
+	if (!itemInfo.isFindDataValid)
 	{
-		return StrCmpLogicalW(name1.c_str(), name2.c_str());
+		key.hasValue = false;
+		return;
 	}
-	else
+
+	// Folder sizes are calculated in the background, so aren't known here. The size of a folder is
+	// filled in by the caller, once it's been calculated.
+	if (key.isFolder)
 	{
-		return StrCmpIW(name1.c_str(), name2.c_str());
+		key.number = 0;
+		return;
 	}
+
+	ULARGE_INTEGER fileSize = { itemInfo.wfd.nFileSizeLow, itemInfo.wfd.nFileSizeHigh };
+	key.number = fileSize.QuadPart;
 }
 
-int SortBySize(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2)
+void SetDateKey(SortKey &key, const BasicItemInfo_t &itemInfo, DateType dateType)
 {
-	if (!itemInfo1.isFindDataValid && itemInfo2.isFindDataValid)
+	if (!itemInfo.isFindDataValid)
 	{
-		return -1;
+		key.hasValue = false;
+		return;
 	}
-	else if (itemInfo1.isFindDataValid && !itemInfo2.isFindDataValid)
+
+	const FILETIME *fileTime = nullptr;
+
+	switch (dateType)
 	{
-		return 1;
+	case DateType::Created:
+		fileTime = &itemInfo.wfd.ftCreationTime;
+		break;
+
+	case DateType::Modified:
+		fileTime = &itemInfo.wfd.ftLastWriteTime;
+		break;
+
+	case DateType::Accessed:
+		fileTime = &itemInfo.wfd.ftLastAccessTime;
+		break;
+
+	default:
+		assert(false);
+		return;
 	}
-	else if (!itemInfo1.isFindDataValid && !itemInfo2.isFindDataValid)
+
+	ULARGE_INTEGER time = { fileTime->dwLowDateTime, fileTime->dwHighDateTime };
+	key.number = time.QuadPart;
+}
+
+void SetTotalSizeKey(SortKey &key, const BasicItemInfo_t &itemInfo, bool totalSize)
+{
+	ULARGE_INTEGER driveSpace;
+	BOOL res = GetDriveSpaceColumnRawData(itemInfo, totalSize, driveSpace);
+
+	if (!res)
 	{
-		return 0;
+		key.hasValue = false;
+		return;
 	}
 
-	bool isFolder1 = WI_IsFlagSet(itemInfo1.wfd.dwFileAttributes, FILE_ATTRIBUTE_DIRECTORY);
-	bool isFolder2 = WI_IsFlagSet(itemInfo2.wfd.dwFileAttributes, FILE_ATTRIBUTE_DIRECTORY);
+	key.number = driveSpace.QuadPart;
+}
 
-	ULONGLONG size1;
-	ULONGLONG size2;
+void SetRealSizeKey(SortKey &key, const BasicItemInfo_t &itemInfo)
+{
+	ULARGE_INTEGER realFileSize;
+	bool res = GetRealSizeColumnRawData(itemInfo, realFileSize);
 
-	if (isFolder1 && isFolder2)
+	if (!res)
 	{
-		// Temporarily disabled.
-		/*auto itr1 = m_cachedFolderSizes.find(InternalIndex1);
-		auto itr2 = m_cachedFolderSizes.find(InternalIndex2);
+		key.hasValue = false;
+		return;
+	}
 
-		if (itr1 == m_cachedFolderSizes.end() && itr2 == m_cachedFolderSizes.end())
-		{
-			return 0;
-		}
-		else if (itr1 != m_cachedFolderSizes.end() && itr2 == m_cachedFolderSizes.end())
-		{
-			return 1;
-		}
-		else if (itr1 == m_cachedFolderSizes.end() && itr2 != m_cachedFolderSizes.end())
-		{
-			return -1;
-		}
+	key.number = realFileSize.QuadPart;
+}
 
-		size1 = itr1->second;
-		size2 = itr2->second;*/
+void SetItemDetailsKey(SortKey &key, const BasicItemInfo_t &itemInfo, const SHCOLUMNID *pscid)
+{
+	VARIANT variant;
+	HRESULT hr = GetItemDetailsRawData(itemInfo, pscid, &variant);
 
-		size1 = 0;
-		size2 = 0;
-	}
-	else
+	if (FAILED(hr))
 	{
-		// Both items are files (as opposed to folders).
-		ULARGE_INTEGER fileSize1 = { itemInfo1.wfd.nFileSizeLow, itemInfo1.wfd.nFileSizeHigh };
-		ULARGE_INTEGER fileSize2 = { itemInfo2.wfd.nFileSizeLow, itemInfo2.wfd.nFileSizeHigh };
-
-		size1 = fileSize1.QuadPart;
-		size2 = fileSize2.QuadPart;
+		key.hasValue = false;
+		return;
 	}
 
-	if (size1 > size2)
+	key.variant.reset(variant);
+}
+
+int CompareNumbers(uint64_t number1, uint64_t number2)
+{
+	if (number1 > number2)
 	{
 		return 1;
 	}
-	else if (size1 < size2)
+	else if (number1 < number2)
 	{
 		return -1;
 	}
@@ -114,258 +145,453 @@ int SortBySize(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo
 	return 0;
 }
 
-int SortByType(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2)
+int CompareText(const std::wstring &text1, const std::string &collationKey1,
+	const std::wstring &text2, const std::string &collationKey2, bool naturalOrder)
 {
-	if (itemInfo1.isRoot && !itemInfo2.isRoot)
+	if (naturalOrder)
 	{
-		return -1;
+		return CompareNaturalSortKeys(collationKey1, collationKey2);
 	}
-	else if (!itemInfo1.isRoot && itemInfo2.isRoot)
+	else
 	{
-		return 1;
+		return StrCmpIW(text1.c_str(), text2.c_str());
 	}
-
-	std::wstring type1 = GetTypeColumnText(itemInfo1);
-	std::wstring type2 = GetTypeColumnText(itemInfo2);
-
-	return StrCmpLogicalW(type1.c_str(), type2.c_str());
 }
 
-int SortByDate(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2,
-	DateType dateType)
+int CompareVariants(const VARIANT &variant1, const VARIANT &variant2)
 {
-	if (!itemInfo1.isFindDataValid && itemInfo2.isFindDataValid)
+	// Values of different types can't be meaningfully compared, but they still need to be
+	// consistently ordered.
+	if (variant1.vt != variant2.vt)
 	{
-		return -1;
+		return (variant1.vt < variant2.vt) ? -1 : 1;
 	}
-	else if (itemInfo1.isFindDataValid && !itemInfo2.isFindDataValid)
+
+	if (variant1.vt == VT_EMPTY)
 	{
-		return 1;
+		return 0;
 	}
-	else if (!itemInfo1.isFindDataValid && !itemInfo2.isFindDataValid)
+
+	return VariantCompare(variant1, variant2);
+}
+
+// Compares the values that are specific to the sort mode the keys were built for.
+int CompareSortValues(const SortKey &key1, const SortKey &key2, bool naturalTextOrder)
+{
+	if (key1.hasValue != key2.hasValue)
 	{
-		return 0;
+		return key1.hasValue ? 1 : -1;
 	}
 
-	switch (dateType)
+	if (key1.rank != key2.rank)
 	{
-	case DateType::Created:
-		return CompareFileTime(&itemInfo1.wfd.ftCreationTime, &itemInfo2.wfd.ftCreationTime);
+		return (key1.rank < key2.rank) ? -1 : 1;
+	}
 
-	case DateType::Modified:
-		return CompareFileTime(&itemInfo1.wfd.ftLastWriteTime, &itemInfo2.wfd.ftLastWriteTime);
+	int comparisonResult = CompareNumbers(key1.number, key2.number);
 
-	case DateType::Accessed:
-		return CompareFileTime(&itemInfo1.wfd.ftLastAccessTime, &itemInfo2.wfd.ftLastAccessTime);
+	if (comparisonResult != 0)
+	{
+		return comparisonResult;
+	}
 
-	default:
-		assert(false);
-		break;
+	comparisonResult = CompareText(key1.text, key1.textCollationKey, key2.text,
+		key2.textCollationKey, naturalTextOrder);
+
+	if (comparisonResult != 0)
+	{
+		return comparisonResult;
 	}
 
-	return 0;
+	return CompareVariants(key1.variant, key2.variant);
 }
 
-int SortByTotalSize(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2,
-	bool TotalSize)
+int CompareSortKeysInternal(const SortKey &key1, const SortKey &key2,
+	const SortKeyOptions &options)
 {
-	ULARGE_INTEGER driveSpace1;
-	BOOL res1 = GetDriveSpaceColumnRawData(itemInfo1, TotalSize, driveSpace1);
-
-	ULARGE_INTEGER driveSpace2;
-	BOOL res2 = GetDriveSpaceColumnRawData(itemInfo2, TotalSize, driveSpace2);
-
-	if (res1 && !res2)
-	{
-		return 1;
-	}
-	else if (!res1 && res2)
-	{
-		return -1;
-	}
-	else if (!res1 && !res2)
+	if (options.foldersFirst && key1.isFolder != key2.isFolder)
 	{
-		return 0;
+		return key1.isFolder ? -1 : 1;
 	}
 
-	if (driveSpace1.QuadPart > driveSpace2.QuadPart)
+	int comparisonResult = CompareSortValues(key1, key2, options.naturalTextOrder);
+
+	if (comparisonResult != 0)
 	{
-		return 1;
+		return comparisonResult;
 	}
-	else if (driveSpace1.QuadPart < driveSpace2.QuadPart)
+
+	if (options.secondarySortMode && key1.secondaryKey && key2.secondaryKey)
 	{
-		return -1;
+		comparisonResult = CompareSortValues(*key1.secondaryKey, *key2.secondaryKey,
+			options.naturalSecondaryTextOrder);
+
+		if (comparisonResult != 0)
+		{
+			return comparisonResult;
+		}
 	}
 
-	return 0;
+	/* By default, items that are equal will be sub-sorted
+	by their display names. */
+	return CompareText(key1.displayName, key1.displayNameCollationKey, key2.displayName,
+		key2.displayNameCollationKey, options.naturalDisplayNameOrder);
+}
 }
 
-int SortByAttributes(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2)
+SortKey BuildSortKey(SortMode sortMode, const BasicItemInfo_t &itemInfo,
+	const GlobalFolderSettings &globalFolderSettings)
 {
-	std::wstring attributeString1 = GetAttributeColumnText(itemInfo1);
-	std::wstring attributeString2 = GetAttributeColumnText(itemInfo2);
+	SortKey key;
+	key.isFolder = WI_IsFlagSet(itemInfo.wfd.dwFileAttributes, FILE_ATTRIBUTE_DIRECTORY);
+	key.displayName = itemInfo.szDisplayName;
 
-	return StrCmpLogicalW(attributeString1.c_str(), attributeString2.c_str());
-}
+	switch (sortMode)
+	{
+	case SortMode::Name:
+		SetNameKey(key, itemInfo, globalFolderSettings);
+		break;
 
-int SortByRealSize(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2)
-{
-	ULARGE_INTEGER realFileSize1;
-	bool res1 = GetRealSizeColumnRawData(itemInfo1, realFileSize1);
+	case SortMode::Type:
+		SetTypeKey(key, itemInfo);
+		break;
 
-	ULARGE_INTEGER realFileSize2;
-	bool res2 = GetRealSizeColumnRawData(itemInfo2, realFileSize2);
+	case SortMode::Size:
+		SetSizeKey(key, itemInfo);
+		break;
 
-	if (res1 && !res2)
-	{
-		return 1;
-	}
-	else if (!res1 && res2)
-	{
-		return -1;
-	}
-	else if (!res1 && !res2)
-	{
-		return 0;
-	}
+	case SortMode::DateModified:
+		SetDateKey(key, itemInfo, DateType::Modified);
+		break;
 
-	if (realFileSize1.QuadPart > realFileSize2.QuadPart)
-	{
-		return 1;
-	}
-	else if (realFileSize1.QuadPart < realFileSize2.QuadPart)
-	{
-		return -1;
-	}
+	case SortMode::TotalSize:
+		SetTotalSizeKey(key, itemInfo, true);
+		break;
 
-	return 0;
-}
+	case SortMode::FreeSpace:
+		SetTotalSizeKey(key, itemInfo, false);
+		break;
 
-int SortByShortName(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2)
-{
-	std::wstring shortName1 = GetShortNameColumnText(itemInfo1);
-	std::wstring shortName2 = GetShortNameColumnText(itemInfo2);
+	case SortMode::DateDeleted:
+		SetItemDetailsKey(key, itemInfo, &SCID_DATE_DELETED);
+		break;
 
-	return StrCmpLogicalW(shortName1.c_str(), shortName2.c_str());
-}
+	case SortMode::OriginalLocation:
+		SetItemDetailsKey(key, itemInfo, &SCID_ORIGINAL_LOCATION);
+		break;
 
-int SortByOwner(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2)
-{
-	std::wstring owner1 = GetOwnerColumnText(itemInfo1);
-	std::wstring owner2 = GetOwnerColumnText(itemInfo2);
+	case SortMode::Attributes:
+		key.text = GetAttributeColumnText(itemInfo);
+		break;
 
-	return StrCmpLogicalW(owner1.c_str(), owner2.c_str());
-}
+	case SortMode::RealSize:
+		SetRealSizeKey(key, itemInfo);
+		break;
 
-int SortByVersionInfo(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2,
-	VersionInfoType versionInfoType)
-{
-	std::wstring versionInfo1 = GetVersionColumnText(itemInfo1, versionInfoType);
-	std::wstring versionInfo2 = GetVersionColumnText(itemInfo2, versionInfoType);
+	case SortMode::ShortName:
+		key.text = GetShortNameColumnText(itemInfo);
+		break;
 
-	return StrCmpLogicalW(versionInfo1.c_str(), versionInfo2.c_str());
-}
+	case SortMode::Owner:
+		key.text = GetOwnerColumnText(itemInfo);
+		break;
 
-int SortByShortcutTo(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2)
-{
-	std::wstring resolvedLinkPath1 = GetShortcutToColumnText(itemInfo1);
-	std::wstring resolvedLinkPath2 = GetShortcutToColumnText(itemInfo2);
+	case SortMode::ProductName:
+		key.text = GetVersionColumnText(itemInfo, VersionInfoType::ProductName);
+		break;
 
-	return StrCmpLogicalW(resolvedLinkPath1.c_str(), resolvedLinkPath2.c_str());
-}
+	case SortMode::Company:
+		key.text = GetVersionColumnText(itemInfo, VersionInfoType::Company);
+		break;
 
-int SortByHardlinks(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2)
-{
-	DWORD numHardLinks1 = GetHardLinksColumnRawData(itemInfo1);
-	DWORD numHardLinks2 = GetHardLinksColumnRawData(itemInfo2);
+	case SortMode::Description:
+		key.text = GetVersionColumnText(itemInfo, VersionInfoType::Description);
+		break;
 
-	return numHardLinks1 - numHardLinks2;
-}
+	case SortMode::FileVersion:
+		key.text = GetVersionColumnText(itemInfo, VersionInfoType::FileVersion);
+		break;
 
-int SortByExtension(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2)
-{
-	std::wstring extension1 = GetExtensionColumnText(itemInfo1);
-	std::wstring extension2 = GetExtensionColumnText(itemInfo2);
+	case SortMode::ProductVersion:
+		key.text = GetVersionColumnText(itemInfo, VersionInfoType::ProductVersion);
+		break;
 
-	return StrCmpLogicalW(extension1.c_str(), extension2.c_str());
-}
+	case SortMode::ShortcutTo:
+		key.text = GetShortcutToColumnText(itemInfo);
+		break;
 
-int SortByItemDetails(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2,
-	const SHCOLUMNID *pscid)
-{
-	VARIANT vt1;
-	HRESULT hr1 = GetItemDetailsRawData(itemInfo1, pscid, &vt1);
+	case SortMode::HardLinks:
+		key.number = GetHardLinksColumnRawData(itemInfo);
+		break;
+
+	case SortMode::Extension:
+		key.text = GetExtensionColumnText(itemInfo);
+		break;
 
-	VARIANT vt2;
-	HRESULT hr2 = GetItemDetailsRawData(itemInfo2, pscid, &vt2);
+	case SortMode::Created:
+		SetDateKey(key, itemInfo, DateType::Created);
+		break;
 
-	int ret = 0;
+	case SortMode::Accessed:
+		SetDateKey(key, itemInfo, DateType::Accessed);
+		break;
 
-	if (SUCCEEDED(hr1) && SUCCEEDED(hr2) && vt1.vt == vt2.vt)
-	{
-		ret = VariantCompare(vt1, vt2);
+	case SortMode::Title:
+		SetItemDetailsKey(key, itemInfo, &PKEY_Title);
+		break;
+
+	case SortMode::Subject:
+		SetItemDetailsKey(key, itemInfo, &PKEY_Subject);
+		break;
+
+	case SortMode::Authors:
+		SetItemDetailsKey(key, itemInfo, &PKEY_Author);
+		break;
+
+	case SortMode::Keywords:
+		SetItemDetailsKey(key, itemInfo, &PKEY_Keywords);
+		break;
+
+	case SortMode::Comments:
+		SetItemDetailsKey(key, itemInfo, &PKEY_Comment);
+		break;
+
+	case SortMode::CameraModel:
+		key.text = GetImageColumnText(itemInfo, PropertyTagEquipModel);
+		break;
+
+	case SortMode::DateTaken:
+		key.text = GetImageColumnText(itemInfo, PropertyTagDateTime);
+		break;
+
+	case SortMode::Width:
+		key.text = GetImageColumnText(itemInfo, PropertyTagImageWidth);
+		break;
+
+	case SortMode::Height:
+		key.text = GetImageColumnText(itemInfo, PropertyTagImageHeight);
+		break;
+
+	case SortMode::VirtualComments:
+		key.text = GetControlPanelCommentsColumnText(itemInfo);
+		break;
+
+	case SortMode::FileSystem:
+		key.text = GetFileSystemColumnText(itemInfo);
+		break;
+
+	case SortMode::NumPrinterDocuments:
+		key.text = GetPrinterColumnText(itemInfo, PrinterInformationType::NumJobs);
+		break;
+
+	case SortMode::PrinterStatus:
+		key.text = GetPrinterColumnText(itemInfo, PrinterInformationType::Status);
+		break;
+
+	case SortMode::PrinterComments:
+		key.text = GetPrinterColumnText(itemInfo, PrinterInformationType::Comments);
+		break;
+
+	case SortMode::PrinterLocation:
+		key.text = GetPrinterColumnText(itemInfo, PrinterInformationType::Location);
+		break;
+
+	case SortMode::NetworkAdapterStatus:
+		key.text = GetNetworkAdapterColumnText(itemInfo);
+		break;
+
+	case SortMode::MediaBitrate:
+		key.text = GetMediaMetadataColumnText(itemInfo, MediaMetadataType::Bitrate);
+		break;
+
+	case SortMode::MediaCopyright:
+		key.text = GetMediaMetadataColumnText(itemInfo, MediaMetadataType::Copyright);
+		break;
+
+	case SortMode::MediaDuration:
+		key.text = GetMediaMetadataColumnText(itemInfo, MediaMetadataType::Duration);
+		break;
+
+	case SortMode::MediaProtected:
+		key.text = GetMediaMetadataColumnText(itemInfo, MediaMetadataType::Protected);
+		break;
+
+	case SortMode::MediaRating:
+		key.text = GetMediaMetadataColumnText(itemInfo, MediaMetadataType::Rating);
+		break;
+
+	case SortMode::MediaAlbumArtist:
+		key.text = GetMediaMetadataColumnText(itemInfo, MediaMetadataType::AlbumArtist);
+		break;
+
+	case SortMode::MediaAlbum:
+		key.text = GetMediaMetadataColumnText(itemInfo, MediaMetadataType::AlbumTitle);
+		break;
+
+	case SortMode::MediaBeatsPerMinute:
+		key.text = GetMediaMetadataColumnText(itemInfo, MediaMetadataType::BeatsPerMinute);
+		break;
+
+	case SortMode::MediaComposer:
+		key.text = GetMediaMetadataColumnText(itemInfo, MediaMetadataType::Composer);
+		break;
+
+	case SortMode::MediaConductor:
+		key.text = GetMediaMetadataColumnText(itemInfo, MediaMetadataType::Conductor);
+		break;
+
+	case SortMode::MediaDirector:
+		key.text = GetMediaMetadataColumnText(itemInfo, MediaMetadataType::Director);
+		break;
+
+	case SortMode::MediaGenre:
+		key.text = GetMediaMetadataColumnText(itemInfo, MediaMetadataType::Genre);
+		break;
+
+	case SortMode::MediaLanguage:
+		key.text = GetMediaMetadataColumnText(itemInfo, MediaMetadataType::Language);
+		break;
+
+	case SortMode::MediaBroadcastDate:
+		key.text = GetMediaMetadataColumnText(itemInfo, MediaMetadataType::BroadcastDate);
+		break;
+
+	case SortMode::MediaChannel:
+		key.text = GetMediaMetadataColumnText(itemInfo, MediaMetadataType::Channel);
+		break;
+
+	case SortMode::MediaStationName:
+		key.text = GetMediaMetadataColumnText(itemInfo, MediaMetadataType::StationName);
+		break;
+
+	case SortMode::MediaMood:
+		key.text = GetMediaMetadataColumnText(itemInfo, MediaMetadataType::Mood);
+		break;
+
+	case SortMode::MediaParentalRating:
+		key.text = GetMediaMetadataColumnText(itemInfo, MediaMetadataType::ParentalRating);
+		break;
+
+	case SortMode::MediaParentalRatingReason:
+		key.text = GetMediaMetadataColumnText(itemInfo, MediaMetadataType::ParentalRatingReason);
+		break;
+
+	case SortMode::MediaPeriod:
+		key.text = GetMediaMetadataColumnText(itemInfo, MediaMetadataType::Period);
+		break;
+
+	case SortMode::MediaProducer:
+		key.text = GetMediaMetadataColumnText(itemInfo, MediaMetadataType::Producer);
+		break;
+
+	case SortMode::MediaPublisher:
+		key.text = GetMediaMetadataColumnText(itemInfo, MediaMetadataType::Publisher);
+		break;
+
+	case SortMode::MediaWriter:
+		key.text = GetMediaMetadataColumnText(itemInfo, MediaMetadataType::Writer);
+		break;
+
+	case SortMode::MediaYear:
+		key.text = GetMediaMetadataColumnText(itemInfo, MediaMetadataType::Year);
+		break;
+
+	default:
+		assert(false);
+		break;
 	}
 
-	if (SUCCEEDED(hr1))
+	// Building a collation key is more expensive than a single comparison, but each key will
+	// typically be compared many times during a sort, so it's cheaper overall to build the keys up
+	// front. The ascending and foldersFirst values here don't affect how the text is compared.
+	auto options = BuildSortKeyOptions(sortMode, globalFolderSettings, false, true);
+
+	if (options.naturalTextOrder)
 	{
-		VariantClear(&vt1);
+		key.textCollationKey = BuildNaturalSortKey(key.text);
 	}
 
-	if (SUCCEEDED(hr2))
+	if (options.naturalDisplayNameOrder)
 	{
-		VariantClear(&vt2);
+		key.displayNameCollationKey = BuildNaturalSortKey(key.displayName);
 	}
 
-	return ret;
+	return key;
 }
 
-int SortByImageProperty(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2,
-	PROPID PropertyId)
+SortKey BuildSortKey(SortMode sortMode, std::optional<SortMode> secondarySortMode,
+	const BasicItemInfo_t &itemInfo, const GlobalFolderSettings &globalFolderSettings)
 {
-	std::wstring imageProperty1 = GetImageColumnText(itemInfo1, PropertyId);
-	std::wstring imageProperty2 = GetImageColumnText(itemInfo2, PropertyId);
+	SortKey key = BuildSortKey(sortMode, itemInfo, globalFolderSettings);
 
-	return StrCmpLogicalW(imageProperty1.c_str(), imageProperty2.c_str());
-}
+	if (!secondarySortMode || *secondarySortMode == sortMode)
+	{
+		return key;
+	}
 
-int SortByVirtualComments(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2)
-{
-	std::wstring comments1 = GetControlPanelCommentsColumnText(itemInfo1);
-	std::wstring comments2 = GetControlPanelCommentsColumnText(itemInfo2);
+	auto secondaryKey = std::make_unique<SortKey>(
+		BuildSortKey(*secondarySortMode, itemInfo, globalFolderSettings));
 
-	return StrCmpLogicalW(comments1.c_str(), comments2.c_str());
-}
+	// Only the primary key's display name is used.
+	secondaryKey->displayName.clear();
+	secondaryKey->displayNameCollationKey.clear();
 
-int SortByFileSystem(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2)
-{
-	std::wstring fileSystemName1 = GetFileSystemColumnText(itemInfo1);
-	std::wstring fileSystemName2 = GetFileSystemColumnText(itemInfo2);
+	key.secondaryKey = std::move(secondaryKey);
 
-	return StrCmpLogicalW(fileSystemName1.c_str(), fileSystemName2.c_str());
+	return key;
 }
 
-int SortByPrinterProperty(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2,
-	PrinterInformationType printerInformationType)
+bool DoesSortKeyRequirePidl(SortMode sortMode, bool isRoot)
 {
-	std::wstring printerInformation1 = GetPrinterColumnText(itemInfo1, printerInformationType);
-	std::wstring printerInformation2 = GetPrinterColumnText(itemInfo2, printerInformationType);
+	switch (sortMode)
+	{
+	// Drives are sorted by their path, which is retrieved from the PIDL.
+	case SortMode::Name:
+		return isRoot;
 
-	return StrCmpLogicalW(printerInformation1.c_str(), printerInformation2.c_str());
+	case SortMode::Size:
+	case SortMode::DateModified:
+	case SortMode::Attributes:
+		return false;
+
+	default:
+		return true;
+	}
 }
 
-int SortByNetworkAdapterStatus(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2)
+SortKeyOptions BuildSortKeyOptions(SortMode sortMode,
+	const GlobalFolderSettings &globalFolderSettings, bool foldersFirst, bool ascending,
+	std::optional<SortMode> secondarySortMode)
 {
-	std::wstring status1 = GetNetworkAdapterColumnText(itemInfo1);
-	std::wstring status2 = GetNetworkAdapterColumnText(itemInfo2);
+	SortKeyOptions options;
+
+	// Only names are compared using the user's preferred ordering. All other text values are
+	// always compared using a natural ordering.
+	options.naturalTextOrder =
+		(sortMode == +SortMode::Name) ? globalFolderSettings.useNaturalSortOrder : true;
+	options.naturalDisplayNameOrder = globalFolderSettings.useNaturalSortOrder;
+	options.foldersFirst = foldersFirst;
+	options.ascending = ascending;
+
+	if (secondarySortMode && *secondarySortMode != sortMode)
+	{
+		options.secondarySortMode = secondarySortMode;
+		options.naturalSecondaryTextOrder = (*secondarySortMode == +SortMode::Name)
+			? globalFolderSettings.useNaturalSortOrder
+			: true;
+	}
 
-	return StrCmpLogicalW(status1.c_str(), status2.c_str());
+	return options;
 }
 
-int SortByMediaMetadata(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2,
-	MediaMetadataType mediaMetadataType)
+int CompareSortKeys(const SortKey &key1, const SortKey &key2, const SortKeyOptions &options)
 {
-	std::wstring mediaMetadata1 = GetMediaMetadataColumnText(itemInfo1, mediaMetadataType);
-	std::wstring mediaMetadata2 = GetMediaMetadataColumnText(itemInfo2, mediaMetadataType);
+	int comparisonResult = CompareSortKeysInternal(key1, key2, options);
+
+	if (!options.ascending)
+	{
+		comparisonResult = -comparisonResult;
+	}
 
-	return StrCmpLogicalW(mediaMetadata1.c_str(), mediaMetadata2.c_str());
+	return comparisonResult;
 }
@@ -6,6 +6,11 @@
 
 #include "ColumnDataRetrieval.h"
 #include "FolderSettings.h"
+#include "SortModes.h"
+#include <wil/resource.h>
+#include <memory>
+#include <optional>
+#include <string>
 
 struct BasicItemInfo_t;
 
@@ -16,31 +21,66 @@ enum class DateType
 	Accessed
 };
 
-int SortByName(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2,
+// Holds the data for an item that's needed to compare it against other items, for a particular
+// sort mode. Retrieving that data can be expensive (e.g. it may involve reading metadata from the
+// file), so a key is built once for each item and the comparisons only operate on the keys.
+struct SortKey
+{
+	bool isFolder = false;
+
+	// Items without a value (e.g. items without valid find data when sorting by size) are placed
+	// before items that have one.
+	bool hasValue = true;
+
+	// Used to group certain items (e.g. drives, when sorting by name) ahead of all others.
+	int rank = 0;
+
+	uint64_t number = 0;
+	std::wstring text;
+	wil::unique_variant variant;
+
+	// Used to order items that are otherwise equal.
+	std::wstring displayName;
+
+	// When text is compared using a natural ordering, these collation keys (see
+	// BuildNaturalSortKey()) are compared in place of the text. They're only built if a natural
+	// comparison will be used.
+	std::string textCollationKey;
+	std::string displayNameCollationKey;
+
+	// If a secondary sort mode is in use, this holds the values for that sort mode. Items that are
+	// equal according to the primary sort mode are then ordered by these values, before falling
+	// back to the display name.
+	std::unique_ptr<SortKey> secondaryKey;
+};
+
+struct SortKeyOptions
+{
+	// If false, text values are compared using a case-insensitive comparison, rather than a
+	// natural (logical) comparison.
+	bool naturalTextOrder = true;
+	bool naturalDisplayNameOrder = true;
+	bool foldersFirst = true;
+	bool ascending = true;
+
+	// Only set if it differs from the primary sort mode.
+	std::optional<SortMode> secondarySortMode;
+	bool naturalSecondaryTextOrder = true;
+};
+
+SortKey BuildSortKey(SortMode sortMode, const BasicItemInfo_t &itemInfo,
 	const GlobalFolderSettings &globalFolderSettings);
-int SortBySize(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2);
-int SortByType(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2);
-int SortByDate(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2,
-	DateType dateType);
-int SortByTotalSize(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2,
-	bool TotalSize);
-int SortByAttributes(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2);
-int SortByRealSize(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2);
-int SortByShortName(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2);
-int SortByOwner(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2);
-int SortByVersionInfo(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2,
-	VersionInfoType versionInfoType);
-int SortByShortcutTo(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2);
-int SortByHardlinks(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2);
-int SortByExtension(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2);
-int SortByItemDetails(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2,
-	const SHCOLUMNID *pscid);
-int SortByImageProperty(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2,
-	PROPID PropertyId);
-int SortByVirtualComments(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2);
-int SortByFileSystem(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2);
-int SortByPrinterProperty(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2,
-	PrinterInformationType printerInformationType);
-int SortByNetworkAdapterStatus(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2);
-int SortByMediaMetadata(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2,
-	MediaMetadataType mediaMetadataType);
+
+// Builds a key that orders items by the primary sort mode and then, for items that are equal in
+// that respect, by the secondary sort mode (if any).
+SortKey BuildSortKey(SortMode sortMode, std::optional<SortMode> secondarySortMode,
+	const BasicItemInfo_t &itemInfo, const GlobalFolderSettings &globalFolderSettings);
+
+// Returns false if the key for the specified sort mode can be built from an item's find data and
+// display name alone, in which case the PIDLs in the BasicItemInfo_t passed to BuildSortKey() can
+// be left empty.
+bool DoesSortKeyRequirePidl(SortMode sortMode, bool isRoot);
+SortKeyOptions BuildSortKeyOptions(SortMode sortMode,
+	const GlobalFolderSettings &globalFolderSettings, bool foldersFirst, bool ascending,
+	std::optional<SortMode> secondarySortMode = std::nullopt);
+int CompareSortKeys(const SortKey &key1, const SortKey &key2, const SortKeyOptions &options);
@@ -9,24 +9,37 @@
 #include "SortHelper.h"
 #include "SortModes.h"
 #include "ViewModes.h"
-#include <propkey.h>
-#include <cassert>
+#include "../Helper/ParallelSort.h"
+#include <algorithm>
+#include <numeric>
+
+void ShellBrowser::SortFolder(SortMode sortMode, std::optional<SortMode> secondarySortMode)
+{
+	m_folderSettings.secondarySortMode = secondarySortMode;
+	SortFolder(sortMode);
+}
 
 void ShellBrowser::SortFolder(SortMode sortMode)
 {
 	m_folderSettings.sortMode = sortMode;
 
-	if (m_folderSettings.showInGroups)
+	if (m_folderSettings.showInGroups && !m_virtualListView)
 	{
-		ListView_EnableGroupView(m_hListView, FALSE);
-		ListView_RemoveAllGroups(m_hListView);
-		ListView_EnableGroupView(m_hListView, TRUE);
-
-		SetShowInGroups(TRUE);
+		// The items only need to be regrouped if they're now being grouped by a different column.
+		// Otherwise, items will have been added to and removed from their groups as they were
+		// added and removed, so only the order of the groups (which depends on the sort
+		// direction) needs to be updated.
+		if (!m_groupsSortMode || *m_groupsSortMode != sortMode)
+		{
+			MoveItemsIntoGroups();
+		}
+		else
+		{
+			ListView_SortGroups(m_hListView, GroupComparisonStub, this);
+		}
 	}
 
-	SendMessage(m_hListView, LVM_SORTITEMS, reinterpret_cast<WPARAM>(this),
-		reinterpret_cast<LPARAM>(SortStub));
+	SortListViewItems();
 
 	/* If in details view, the column sort
 	arrow will need to be changed to reflect
@@ -37,358 +50,290 @@ void ShellBrowser::SortFolder(SortMode sortMode)
 	}
 }
 
-int CALLBACK ShellBrowser::SortStub(LPARAM lParam1, LPARAM lParam2, LPARAM lParamSort)
+void ShellBrowser::SortListViewItems()
 {
-	auto *pShellBrowser = reinterpret_cast<ShellBrowser *>(lParamSort);
-	return pShellBrowser->Sort(static_cast<int>(lParam1), static_cast<int>(lParam2));
+	// Rather than retrieving the data for two items in every comparison, a key is built once for
+	// each item. The keys are then sorted and the resulting order is applied to the listview. Once
+	// the keys have been built, the comparisons don't touch any shared state, so large folders can
+	// be sorted across multiple threads.
+	int numItems = ListView_GetItemCount(m_hListView);
+
+	std::vector<int> internalIndexes;
+	std::vector<SortKey> sortKeys;
+	internalIndexes.reserve(numItems);
+	sortKeys.reserve(numItems);
+
+	for (int i = 0; i < numItems; i++)
+	{
+		int internalIndex = GetItemInternalIndex(i);
+
+		if (m_folderSettings.sortMode == +SortMode::Size)
+		{
+			QueueFolderSizeTaskIfNecessary(internalIndex);
+		}
+
+		internalIndexes.push_back(internalIndex);
+		sortKeys.push_back(GetSortKey(internalIndex));
+	}
+
+	SortKeyOptions options = GetSortKeyOptions();
+
+	std::vector<int> sortedOrder(numItems);
+	std::iota(sortedOrder.begin(), sortedOrder.end(), 0);
+
+	if (m_virtualListView && m_folderSettings.showInGroups)
+	{
+		// Groups can't be shown in owner data mode, but items are still kept together with the
+		// other items in their group. The groups are only rebuilt if the items are now being
+		// grouped by a different column.
+		if (!m_groupsSortMode || *m_groupsSortMode != m_folderSettings.sortMode)
+		{
+			m_listViewGroups.clear();
+			m_groupIdCounter = 0;
+			m_directoryState.itemGroupIds.clear();
+			m_groupsSortMode = m_folderSettings.sortMode;
+			CancelGroupTasks();
+		}
+
+		std::vector<int> groupIds;
+		groupIds.reserve(numItems);
+
+		for (int internalIndex : internalIndexes)
+		{
+			groupIds.push_back(DetermineItemGroup(internalIndex));
+		}
+
+		// There will generally be far fewer groups than items, so the groups are ordered once
+		// here, rather than being compared each time two items are compared.
+		std::vector<int> groupOrder;
+
+		for (const auto &group : m_listViewGroups)
+		{
+			groupOrder.push_back(group.id);
+		}
+
+		std::sort(groupOrder.begin(), groupOrder.end(),
+			[this](int id1, int id2)
+			{
+				return GroupComparison(id1, id2) < 0;
+			});
+
+		std::unordered_map<int, int> groupPositions;
+
+		for (int i = 0; i < static_cast<int>(groupOrder.size()); i++)
+		{
+			groupPositions[groupOrder[i]] = i;
+		}
+
+		std::vector<int> itemGroupPositions;
+		itemGroupPositions.reserve(numItems);
+
+		for (int groupId : groupIds)
+		{
+			itemGroupPositions.push_back(groupPositions.at(groupId));
+		}
+
+		ParallelStableSort(sortedOrder.begin(), sortedOrder.end(),
+			[&itemGroupPositions, &sortKeys, &options](int index1, int index2)
+			{
+				if (itemGroupPositions[index1] != itemGroupPositions[index2])
+				{
+					return itemGroupPositions[index1] < itemGroupPositions[index2];
+				}
+
+				return CompareSortKeys(sortKeys[index1], sortKeys[index2], options) < 0;
+			});
+	}
+	else
+	{
+		ParallelStableSort(sortedOrder.begin(), sortedOrder.end(),
+			[&sortKeys, &options](int index1, int index2)
+			{
+				return CompareSortKeys(sortKeys[index1], sortKeys[index2], options) < 0;
+			});
+	}
+
+	std::vector<int> sortedItems;
+	std::vector<SortKey> sortedKeys;
+	sortedItems.reserve(numItems);
+	sortedKeys.reserve(numItems);
+
+	for (int index : sortedOrder)
+	{
+		sortedItems.push_back(internalIndexes[index]);
+		sortedKeys.push_back(std::move(sortKeys[index]));
+	}
+
+	// The keys are retained, so that items that are later inserted in their sorted position can
+	// be positioned without having to rebuild the keys for the existing items.
+	m_directoryState.sortedItemIndex.Reset(sortedItems, std::move(sortedKeys),
+		m_folderSettings.sortMode, options);
+
+	if (m_virtualListView)
+	{
+		SetVirtualListItems(std::move(sortedItems));
+		return;
+	}
+
+	for (int i = 0; i < numItems; i++)
+	{
+		m_itemStore.SetRelativeSort(sortedItems[i], i);
+	}
+
+	ListView_SortItems(m_hListView, SortTemporaryStub, reinterpret_cast<LPARAM>(this));
 }
 
-/* Also see NBookmarkHelper::Sort. */
-int CALLBACK ShellBrowser::Sort(int InternalIndex1, int InternalIndex2) const
+SortKey ShellBrowser::GetSortKey(int internalIndex) const
 {
-	int comparisonResult = 0;
+	bool isDrive = m_itemStore.IsDrive(internalIndex);
+	bool includePidls = DoesSortKeyRequirePidl(m_folderSettings.sortMode, isDrive)
+		|| (m_folderSettings.secondarySortMode
+			&& DoesSortKeyRequirePidl(*m_folderSettings.secondarySortMode, isDrive));
 
-	BasicItemInfo_t basicItemInfo1 = getBasicItemInfo(InternalIndex1);
-	BasicItemInfo_t basicItemInfo2 = getBasicItemInfo(InternalIndex2);
+	SortKey key = BuildSortKey(m_folderSettings.sortMode, m_folderSettings.secondarySortMode,
+		m_itemStore.GetBasicItemInfo(internalIndex, includePidls), m_config->globalFolderSettings);
 
-	bool isFolder1 = ((basicItemInfo1.wfd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
-						 == FILE_ATTRIBUTE_DIRECTORY)
-		? true
-		: false;
-	bool isFolder2 = ((basicItemInfo2.wfd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
-						 == FILE_ATTRIBUTE_DIRECTORY)
-		? true
-		: false;
+	// Until a folder's size has been calculated, the folder is treated as being empty.
+	if (m_folderSettings.sortMode == +SortMode::Size && key.isFolder
+		&& m_config->globalFolderSettings.showFolderSizes)
+	{
+		auto itr = m_directoryState.cachedFolderSizes.find(internalIndex);
 
-	/* Folders will by default be sorted separately from files,
-	except in the recycle bin. */
-	if (!m_config->globalFolderSettings.displayMixedFilesAndFolders && isFolder1 && !isFolder2
-		&& !CompareVirtualFolders(CSIDL_BITBUCKET))
+		if (itr != m_directoryState.cachedFolderSizes.end())
+		{
+			key.number = itr->second;
+		}
+	}
+
+	return key;
+}
+
+void ShellBrowser::UpdateSortedItemIndexIfNecessary()
+{
+	SortKeyOptions options = GetSortKeyOptions();
+
+	if (m_directoryState.sortedItemIndex.IsValid(m_folderSettings.sortMode, options))
 	{
-		comparisonResult = -1;
+		return;
 	}
-	else if (!m_config->globalFolderSettings.displayMixedFilesAndFolders && !isFolder1 && isFolder2
-		&& !CompareVirtualFolders(CSIDL_BITBUCKET))
+
+	int numItems = ListView_GetItemCount(m_hListView);
+
+	std::vector<int> items;
+	std::vector<SortKey> keys;
+	items.reserve(numItems);
+	keys.reserve(numItems);
+
+	for (int i = 0; i < numItems; i++)
 	{
-		comparisonResult = 1;
+		int internalIndex = GetItemInternalIndex(i);
+
+		items.push_back(internalIndex);
+		keys.push_back(GetSortKey(internalIndex));
 	}
-	else
+
+	m_directoryState.sortedItemIndex.Reset(std::move(items), std::move(keys),
+		m_folderSettings.sortMode, options);
+}
+
+// Items that are inserted in their sorted position (e.g. items that have been created, or items
+// that are no longer filtered) are positioned together here. A key only needs to be built for each
+// new item, with the position of each item then being found via a binary search over the keys for
+// the existing items.
+std::vector<SortedItemIndex::NewItem> ShellBrowser::DetermineSortedPositionsForAwaitingItems()
+{
+	auto &awaitingAddList = m_directoryState.awaitingAddList;
+
+	// Any other items are inserted first. Those items are added at the end of the listview, so
+	// they won't affect the positions determined below.
+	auto firstSortedItr = std::stable_partition(awaitingAddList.begin(), awaitingAddList.end(),
+		[](const AwaitingAdd_t &awaitingItem)
+		{
+			return !awaitingItem.insertSorted;
+		});
+
+	if (firstSortedItr == awaitingAddList.end())
 	{
-		switch (m_folderSettings.sortMode)
+		return {};
+	}
+
+	// In owner data mode, items are ordered by group and the full set of items is sorted again
+	// once the new items have been inserted, so there's no need to position the items here.
+	if (m_virtualListView && m_folderSettings.showInGroups)
+	{
+		for (auto itr = firstSortedItr; itr != awaitingAddList.end(); ++itr)
 		{
-		case SortMode::Name:
-			comparisonResult =
-				SortByName(basicItemInfo1, basicItemInfo2, m_config->globalFolderSettings);
-			break;
-
-		case SortMode::Type:
-			comparisonResult = SortByType(basicItemInfo1, basicItemInfo2);
-			break;
-
-		case SortMode::Size:
-			comparisonResult = SortBySize(basicItemInfo1, basicItemInfo2);
-			break;
-
-		case SortMode::DateModified:
-			comparisonResult = SortByDate(basicItemInfo1, basicItemInfo2, DateType::Modified);
-			break;
-
-		case SortMode::TotalSize:
-			comparisonResult = SortByTotalSize(basicItemInfo1, basicItemInfo2, TRUE);
-			break;
-
-		case SortMode::FreeSpace:
-			comparisonResult = SortByTotalSize(basicItemInfo1, basicItemInfo2, FALSE);
-			break;
-
-		case SortMode::DateDeleted:
-			comparisonResult =
-				SortByItemDetails(basicItemInfo1, basicItemInfo2, &SCID_DATE_DELETED);
-			break;
-
-		case SortMode::OriginalLocation:
-			comparisonResult =
-				SortByItemDetails(basicItemInfo1, basicItemInfo2, &SCID_ORIGINAL_LOCATION);
-			break;
-
-		case SortMode::Attributes:
-			comparisonResult = SortByAttributes(basicItemInfo1, basicItemInfo2);
-			break;
-
-		case SortMode::RealSize:
-			comparisonResult = SortByRealSize(basicItemInfo1, basicItemInfo2);
-			break;
-
-		case SortMode::ShortName:
-			comparisonResult = SortByShortName(basicItemInfo1, basicItemInfo2);
-			break;
-
-		case SortMode::Owner:
-			comparisonResult = SortByOwner(basicItemInfo1, basicItemInfo2);
-			break;
-
-		case SortMode::ProductName:
-			comparisonResult =
-				SortByVersionInfo(basicItemInfo1, basicItemInfo2, VersionInfoType::ProductName);
-			break;
-
-		case SortMode::Company:
-			comparisonResult =
-				SortByVersionInfo(basicItemInfo1, basicItemInfo2, VersionInfoType::Company);
-			break;
-
-		case SortMode::Description:
-			comparisonResult =
-				SortByVersionInfo(basicItemInfo1, basicItemInfo2, VersionInfoType::Description);
-			break;
-
-		case SortMode::FileVersion:
-			comparisonResult =
-				SortByVersionInfo(basicItemInfo1, basicItemInfo2, VersionInfoType::FileVersion);
-			break;
-
-		case SortMode::ProductVersion:
-			comparisonResult =
-				SortByVersionInfo(basicItemInfo1, basicItemInfo2, VersionInfoType::ProductVersion);
-			break;
-
-		case SortMode::ShortcutTo:
-			comparisonResult = SortByShortcutTo(basicItemInfo1, basicItemInfo2);
-			break;
-
-		case SortMode::HardLinks:
-			comparisonResult = SortByHardlinks(basicItemInfo1, basicItemInfo2);
-			break;
-
-		case SortMode::Extension:
-			comparisonResult = SortByExtension(basicItemInfo1, basicItemInfo2);
-			break;
-
-		case SortMode::Created:
-			comparisonResult = SortByDate(basicItemInfo1, basicItemInfo2, DateType::Created);
-			break;
-
-		case SortMode::Accessed:
-			comparisonResult = SortByDate(basicItemInfo1, basicItemInfo2, DateType::Accessed);
-			break;
-
-		case SortMode::Title:
-			comparisonResult = SortByItemDetails(basicItemInfo1, basicItemInfo2, &PKEY_Title);
-			break;
-
-		case SortMode::Subject:
-			comparisonResult = SortByItemDetails(basicItemInfo1, basicItemInfo2, &PKEY_Subject);
-			break;
-
-		case SortMode::Authors:
-			comparisonResult = SortByItemDetails(basicItemInfo1, basicItemInfo2, &PKEY_Author);
-			break;
-
-		case SortMode::Keywords:
-			comparisonResult = SortByItemDetails(basicItemInfo1, basicItemInfo2, &PKEY_Keywords);
-			break;
-
-		case SortMode::Comments:
-			comparisonResult = SortByItemDetails(basicItemInfo1, basicItemInfo2, &PKEY_Comment);
-			break;
-
-		case SortMode::CameraModel:
-			comparisonResult =
-				SortByImageProperty(basicItemInfo1, basicItemInfo2, PropertyTagEquipModel);
-			break;
-
-		case SortMode::DateTaken:
-			comparisonResult =
-				SortByImageProperty(basicItemInfo1, basicItemInfo2, PropertyTagDateTime);
-			break;
-
-		case SortMode::Width:
-			comparisonResult =
-				SortByImageProperty(basicItemInfo1, basicItemInfo2, PropertyTagImageWidth);
-			break;
-
-		case SortMode::Height:
-			comparisonResult =
-				SortByImageProperty(basicItemInfo1, basicItemInfo2, PropertyTagImageHeight);
-			break;
-
-		case SortMode::VirtualComments:
-			comparisonResult = SortByVirtualComments(basicItemInfo1, basicItemInfo2);
-			break;
-
-		case SortMode::FileSystem:
-			comparisonResult = SortByFileSystem(basicItemInfo1, basicItemInfo2);
-			break;
-
-		case SortMode::NumPrinterDocuments:
-			comparisonResult = SortByPrinterProperty(basicItemInfo1, basicItemInfo2,
-				PrinterInformationType::NumJobs);
-			break;
-
-		case SortMode::PrinterStatus:
-			comparisonResult = SortByPrinterProperty(basicItemInfo1, basicItemInfo2,
-				PrinterInformationType::Status);
-			break;
-
-		case SortMode::PrinterComments:
-			comparisonResult = SortByPrinterProperty(basicItemInfo1, basicItemInfo2,
-				PrinterInformationType::Comments);
-			break;
-
-		case SortMode::PrinterLocation:
-			comparisonResult = SortByPrinterProperty(basicItemInfo1, basicItemInfo2,
-				PrinterInformationType::Location);
-			break;
-
-		case SortMode::NetworkAdapterStatus:
-			comparisonResult = SortByNetworkAdapterStatus(basicItemInfo1, basicItemInfo2);
-			break;
-
-		case SortMode::MediaBitrate:
-			comparisonResult =
-				SortByMediaMetadata(basicItemInfo1, basicItemInfo2, MediaMetadataType::Bitrate);
-			break;
-
-		case SortMode::MediaCopyright:
-			comparisonResult =
-				SortByMediaMetadata(basicItemInfo1, basicItemInfo2, MediaMetadataType::Copyright);
-			break;
-
-		case SortMode::MediaDuration:
-			comparisonResult =
-				SortByMediaMetadata(basicItemInfo1, basicItemInfo2, MediaMetadataType::Duration);
-			break;
-
-		case SortMode::MediaProtected:
-			comparisonResult =
-				SortByMediaMetadata(basicItemInfo1, basicItemInfo2, MediaMetadataType::Protected);
-			break;
-
-		case SortMode::MediaRating:
-			comparisonResult =
-				SortByMediaMetadata(basicItemInfo1, basicItemInfo2, MediaMetadataType::Rating);
-			break;
-
-		case SortMode::MediaAlbumArtist:
-			comparisonResult =
-				SortByMediaMetadata(basicItemInfo1, basicItemInfo2, MediaMetadataType::AlbumArtist);
-			break;
-
-		case SortMode::MediaAlbum:
-			comparisonResult =
-				SortByMediaMetadata(basicItemInfo1, basicItemInfo2, MediaMetadataType::AlbumTitle);
-			break;
-
-		case SortMode::MediaBeatsPerMinute:
-			comparisonResult = SortByMediaMetadata(basicItemInfo1, basicItemInfo2,
-				MediaMetadataType::BeatsPerMinute);
-			break;
-
-		case SortMode::MediaComposer:
-			comparisonResult =
-				SortByMediaMetadata(basicItemInfo1, basicItemInfo2, MediaMetadataType::Composer);
-			break;
-
-		case SortMode::MediaConductor:
-			comparisonResult =
-				SortByMediaMetadata(basicItemInfo1, basicItemInfo2, MediaMetadataType::Conductor);
-			break;
-
-		case SortMode::MediaDirector:
-			comparisonResult =
-				SortByMediaMetadata(basicItemInfo1, basicItemInfo2, MediaMetadataType::Director);
-			break;
-
-		case SortMode::MediaGenre:
-			comparisonResult =
-				SortByMediaMetadata(basicItemInfo1, basicItemInfo2, MediaMetadataType::Genre);
-			break;
-
-		case SortMode::MediaLanguage:
-			comparisonResult =
-				SortByMediaMetadata(basicItemInfo1, basicItemInfo2, MediaMetadataType::Language);
-			break;
-
-		case SortMode::MediaBroadcastDate:
-			comparisonResult = SortByMediaMetadata(basicItemInfo1, basicItemInfo2,
-				MediaMetadataType::BroadcastDate);
-			break;
-
-		case SortMode::MediaChannel:
-			comparisonResult =
-				SortByMediaMetadata(basicItemInfo1, basicItemInfo2, MediaMetadataType::Channel);
-			break;
-
-		case SortMode::MediaStationName:
-			comparisonResult =
-				SortByMediaMetadata(basicItemInfo1, basicItemInfo2, MediaMetadataType::StationName);
-			break;
-
-		case SortMode::MediaMood:
-			comparisonResult =
-				SortByMediaMetadata(basicItemInfo1, basicItemInfo2, MediaMetadataType::Mood);
-			break;
-
-		case SortMode::MediaParentalRating:
-			comparisonResult = SortByMediaMetadata(basicItemInfo1, basicItemInfo2,
-				MediaMetadataType::ParentalRating);
-			break;
-
-		case SortMode::MediaParentalRatingReason:
-			comparisonResult = SortByMediaMetadata(basicItemInfo1, basicItemInfo2,
-				MediaMetadataType::ParentalRatingReason);
-			break;
-
-		case SortMode::MediaPeriod:
-			comparisonResult =
-				SortByMediaMetadata(basicItemInfo1, basicItemInfo2, MediaMetadataType::Period);
-			break;
-
-		case SortMode::MediaProducer:
-			comparisonResult =
-				SortByMediaMetadata(basicItemInfo1, basicItemInfo2, MediaMetadataType::Producer);
-			break;
-
-		case SortMode::MediaPublisher:
-			comparisonResult =
-				SortByMediaMetadata(basicItemInfo1, basicItemInfo2, MediaMetadataType::Publisher);
-			break;
-
-		case SortMode::MediaWriter:
-			comparisonResult =
-				SortByMediaMetadata(basicItemInfo1, basicItemInfo2, MediaMetadataType::Writer);
-			break;
-
-		case SortMode::MediaYear:
-			comparisonResult =
-				SortByMediaMetadata(basicItemInfo1, basicItemInfo2, MediaMetadataType::Year);
-			break;
-
-		default:
-			assert(false);
-			break;
+			itr->insertSorted = false;
 		}
+
+		return {};
 	}
 
-	if (comparisonResult == 0)
+	std::vector<AwaitingAdd_t> filteredItems;
+	std::vector<int> items;
+	std::vector<SortKey> keys;
+
+	for (auto itr = firstSortedItr; itr != awaitingAddList.end(); ++itr)
 	{
-		/* By default, items that are equal will be sub-sorted
-		by their display names. */
-		if (m_config->globalFolderSettings.useNaturalSortOrder)
+		// Filtered items won't be inserted, so they don't need to be positioned.
+		if (IsFileFiltered(itr->iItemInternal))
 		{
-			comparisonResult =
-				StrCmpLogicalW(basicItemInfo1.szDisplayName, basicItemInfo2.szDisplayName);
+			filteredItems.push_back(*itr);
+			continue;
 		}
-		else
+
+		if (m_folderSettings.sortMode == +SortMode::Size)
 		{
-			comparisonResult = StrCmpIW(basicItemInfo1.szDisplayName, basicItemInfo2.szDisplayName);
+			QueueFolderSizeTaskIfNecessary(itr->iItemInternal);
 		}
+
+		items.push_back(itr->iItemInternal);
+		keys.push_back(GetSortKey(itr->iItemInternal));
 	}
 
-	if (!m_folderSettings.sortAscending)
+	UpdateSortedItemIndexIfNecessary();
+	auto positions = m_directoryState.sortedItemIndex.FindInsertPositions(keys);
+
+	std::vector<SortedItemIndex::NewItem> newItems;
+	newItems.reserve(items.size());
+
+	for (size_t i = 0; i < items.size(); i++)
 	{
-		comparisonResult = -comparisonResult;
+		newItems.push_back({ positions[i], items[i], std::move(keys[i]) });
 	}
 
-	return comparisonResult;
+	std::sort(newItems.begin(), newItems.end(),
+		[](const SortedItemIndex::NewItem &newItem1, const SortedItemIndex::NewItem &newItem2)
+		{
+			return newItem1.position < newItem2.position;
+		});
+
+	// Each position is the item's final position, so the items need to be inserted in order of
+	// increasing position.
+	awaitingAddList.erase(firstSortedItr, awaitingAddList.end());
+	awaitingAddList.insert(awaitingAddList.end(), filteredItems.begin(), filteredItems.end());
+
+	for (const auto &newItem : newItems)
+	{
+		AwaitingAdd_t awaitingAdd;
+		awaitingAdd.iItem = static_cast<int>(newItem.position);
+		awaitingAdd.iItemInternal = newItem.item;
+		awaitingAdd.bPosition = TRUE;
+		awaitingAdd.iAfter = awaitingAdd.iItem - 1;
+		awaitingAdd.insertSorted = true;
+		awaitingAddList.push_back(awaitingAdd);
+	}
+
+	return newItems;
+}
+
+SortKeyOptions ShellBrowser::GetSortKeyOptions() const
+{
+	/* Folders will by default be sorted separately from files,
+	except in the recycle bin. */
+	bool foldersFirst = !m_config->globalFolderSettings.displayMixedFilesAndFolders
+		&& !CompareVirtualFolders(CSIDL_BITBUCKET);
+
+	return BuildSortKeyOptions(m_folderSettings.sortMode, m_config->globalFolderSettings,
+		foldersFirst, m_folderSettings.sortAscending, m_folderSettings.secondarySortMode);
 }
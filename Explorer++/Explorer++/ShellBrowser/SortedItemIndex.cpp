@@ -0,0 +1,293 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "SortedItemIndex.h"
+#include <algorithm>
+#include <numeric>
+
+void SortedItemIndex::Reset(std::vector<int> items, std::vector<SortKey> keys, SortMode sortMode,
+	const SortKeyOptions &options)
+{
+	assert(items.size() == keys.size());
+
+	m_items = std::move(items);
+	m_keys.clear();
+	m_keys.reserve(m_items.size());
+
+	for (size_t i = 0; i < m_items.size(); i++)
+	{
+		m_keys.emplace(m_items[i], std::move(keys[i]));
+	}
+
+	m_sortMode = sortMode;
+	m_options = options;
+	m_valid = true;
+	m_sorted = true;
+
+	for (size_t i = 1; i < m_items.size() && m_sorted; i++)
+	{
+		m_sorted = IsInOrderAt(i);
+	}
+}
+
+void SortedItemIndex::Invalidate()
+{
+	m_items.clear();
+	m_keys.clear();
+	m_valid = false;
+	m_sorted = false;
+}
+
+bool SortedItemIndex::IsValid(SortMode sortMode, const SortKeyOptions &options) const
+{
+	return m_valid && sortMode == m_sortMode
+		&& options.naturalTextOrder == m_options.naturalTextOrder
+		&& options.naturalDisplayNameOrder == m_options.naturalDisplayNameOrder
+		&& options.foldersFirst == m_options.foldersFirst
+		&& options.ascending == m_options.ascending
+		&& options.secondarySortMode == m_options.secondarySortMode
+		&& options.naturalSecondaryTextOrder == m_options.naturalSecondaryTextOrder;
+}
+
+bool SortedItemIndex::IsSorted() const
+{
+	return m_valid && m_sorted;
+}
+
+bool SortedItemIndex::Contains(int item) const
+{
+	return m_valid && m_keys.contains(item);
+}
+
+size_t SortedItemIndex::GetNumItems() const
+{
+	return m_items.size();
+}
+
+const std::vector<int> &SortedItemIndex::GetItems() const
+{
+	return m_items;
+}
+
+std::vector<size_t> SortedItemIndex::FindInsertPositions(const std::vector<SortKey> &keys) const
+{
+	assert(m_valid);
+
+	// The new items are first ordered amongst themselves. The final position of the nth new item
+	// is then the position it would have in the existing list, plus the number of new items that
+	// come before it.
+	std::vector<size_t> order(keys.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(),
+		[this, &keys](size_t index1, size_t index2)
+		{
+			return Compare(keys[index1], keys[index2]) < 0;
+		});
+
+	std::vector<size_t> positions(keys.size());
+	size_t previousPosition = 0;
+
+	for (size_t i = 0; i < order.size(); i++)
+	{
+		size_t position = FindInsertPosition(keys[order[i]]);
+
+		// If the existing items aren't sorted, the positions found above won't necessarily be
+		// increasing. They're adjusted here, so that the new items at least remain ordered
+		// relative to each other.
+		position = max(position + i, previousPosition);
+
+		positions[order[i]] = position;
+		previousPosition = position + 1;
+	}
+
+	return positions;
+}
+
+void SortedItemIndex::Insert(std::vector<NewItem> newItems)
+{
+	if (!m_valid || newItems.empty())
+	{
+		return;
+	}
+
+	// The new items are merged into the existing list in a single pass, rather than being inserted
+	// one at a time (which would require the existing items to be moved for each new item).
+	std::vector<int> items;
+	items.reserve(m_items.size() + newItems.size());
+
+	std::vector<size_t> insertedPositions;
+	insertedPositions.reserve(newItems.size());
+
+	auto existingItr = m_items.begin();
+
+	for (auto &newItem : newItems)
+	{
+		assert(!m_keys.contains(newItem.item));
+
+		while (items.size() < newItem.position && existingItr != m_items.end())
+		{
+			items.push_back(*existingItr);
+			++existingItr;
+		}
+
+		insertedPositions.push_back(items.size());
+		items.push_back(newItem.item);
+		m_keys.emplace(newItem.item, std::move(newItem.key));
+	}
+
+	items.insert(items.end(), existingItr, m_items.end());
+	m_items = std::move(items);
+
+	if (!m_sorted)
+	{
+		return;
+	}
+
+	for (size_t position : insertedPositions)
+	{
+		if (!IsInOrderAt(position) || !IsInOrderAt(position + 1))
+		{
+			m_sorted = false;
+			break;
+		}
+	}
+}
+
+void SortedItemIndex::Remove(int item)
+{
+	auto position = FindPosition(item);
+
+	if (!position)
+	{
+		return;
+	}
+
+	// Removing an item won't affect whether the remaining items are sorted.
+	m_items.erase(m_items.begin() + *position);
+	m_keys.erase(item);
+}
+
+void SortedItemIndex::Remove(const std::unordered_set<int> &items)
+{
+	if (!m_valid || items.empty())
+	{
+		return;
+	}
+
+	std::erase_if(m_items,
+		[&items](int item)
+		{
+			return items.contains(item);
+		});
+
+	for (int item : items)
+	{
+		m_keys.erase(item);
+	}
+}
+
+void SortedItemIndex::UpdateKey(int item, SortKey key)
+{
+	auto position = FindPosition(item);
+
+	if (!position)
+	{
+		return;
+	}
+
+	m_keys.at(item) = std::move(key);
+
+	if (m_sorted && (!IsInOrderAt(*position) || !IsInOrderAt(*position + 1)))
+	{
+		m_sorted = false;
+	}
+}
+
+int SortedItemIndex::Compare(const SortKey &key1, const SortKey &key2) const
+{
+	return CompareSortKeys(key1, key2, m_options);
+}
+
+// Returns the position of the first item that's not less than the specified key. If the items
+// aren't sorted, they're checked in order, which is the same way the position was previously
+// determined.
+size_t SortedItemIndex::FindInsertPosition(const SortKey &key) const
+{
+	auto isLess = [this](int item, const SortKey &value)
+	{
+		return Compare(m_keys.at(item), value) < 0;
+	};
+
+	if (m_sorted)
+	{
+		auto itr = std::lower_bound(m_items.begin(), m_items.end(), key, isLess);
+		return std::distance(m_items.begin(), itr);
+	}
+
+	auto itr = std::find_if_not(m_items.begin(), m_items.end(),
+		[&isLess, &key](int item)
+		{
+			return isLess(item, key);
+		});
+	return std::distance(m_items.begin(), itr);
+}
+
+std::optional<size_t> SortedItemIndex::FindPosition(int item) const
+{
+	auto keyItr = m_keys.find(item);
+
+	if (!m_valid || keyItr == m_keys.end())
+	{
+		return std::nullopt;
+	}
+
+	auto first = m_items.begin();
+	auto last = m_items.end();
+
+	if (m_sorted)
+	{
+		// Only the items that compare equal to this item need to be checked.
+		const SortKey &key = keyItr->second;
+		first = std::lower_bound(m_items.begin(), m_items.end(), key,
+			[this](int currentItem, const SortKey &value)
+			{
+				return Compare(m_keys.at(currentItem), value) < 0;
+			});
+		last = std::upper_bound(first, m_items.end(), key,
+			[this](const SortKey &value, int currentItem)
+			{
+				return Compare(value, m_keys.at(currentItem)) < 0;
+			});
+	}
+
+	auto itr = std::find(first, last, item);
+
+	if (itr != last)
+	{
+		return std::distance(m_items.begin(), itr);
+	}
+
+	// The item should always be found above, though if the items aren't actually in order, all
+	// the items will need to be checked.
+	itr = std::find(m_items.begin(), m_items.end(), item);
+
+	if (itr == m_items.end())
+	{
+		return std::nullopt;
+	}
+
+	return std::distance(m_items.begin(), itr);
+}
+
+// Returns true if the item at the specified position isn't less than the item before it.
+bool SortedItemIndex::IsInOrderAt(size_t position) const
+{
+	if (position == 0 || position >= m_items.size())
+	{
+		return true;
+	}
+
+	return Compare(m_keys.at(m_items[position - 1]), m_keys.at(m_items[position])) <= 0;
+}
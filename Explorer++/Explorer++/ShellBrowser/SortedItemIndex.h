@@ -0,0 +1,72 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include "SortHelper.h"
+#include "SortModes.h"
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Mirrors the order of the items shown in the listview, along with the sort key for each of those
+// items. While the items remain sorted, the position at which a new item should be inserted can be
+// found with a binary search over the cached keys, rather than by building a key for each existing
+// item and comparing the new item against each one in turn.
+//
+// The index can be invalidated whenever the items are rearranged in a way that isn't tracked here,
+// in which case it needs to be rebuilt (via Reset()) before it's next used.
+class SortedItemIndex
+{
+public:
+	struct NewItem
+	{
+		size_t position;
+		int item;
+		SortKey key;
+	};
+
+	// The items should be passed in the order they're displayed in, with keys[i] being the key for
+	// items[i]. The items don't need to be sorted, though positions will only be found using a
+	// binary search if they are.
+	void Reset(std::vector<int> items, std::vector<SortKey> keys, SortMode sortMode,
+		const SortKeyOptions &options);
+	void Invalidate();
+
+	bool IsValid(SortMode sortMode, const SortKeyOptions &options) const;
+	bool IsSorted() const;
+	bool Contains(int item) const;
+	size_t GetNumItems() const;
+	const std::vector<int> &GetItems() const;
+
+	// Returns the position each of the specified keys should be inserted at. Each position refers
+	// to the item's final position (i.e. after all the items have been inserted), so that if the
+	// items are inserted in order of increasing position, the resulting list will be sorted. New
+	// items are placed before any existing items they compare equal to.
+	std::vector<size_t> FindInsertPositions(const std::vector<SortKey> &keys) const;
+
+	// The new items should be ordered by position, with each position being the item's final
+	// position, as returned by FindInsertPositions().
+	void Insert(std::vector<NewItem> newItems);
+	void Remove(int item);
+	void Remove(const std::unordered_set<int> &items);
+
+	// Called when an item's details change. The item stays at its current position, so the items
+	// may no longer be sorted afterwards.
+	void UpdateKey(int item, SortKey key);
+
+private:
+	int Compare(const SortKey &key1, const SortKey &key2) const;
+	size_t FindInsertPosition(const SortKey &key) const;
+	std::optional<size_t> FindPosition(int item) const;
+	bool IsInOrderAt(size_t position) const;
+
+	std::vector<int> m_items;
+	std::unordered_map<int, SortKey> m_keys;
+	SortMode m_sortMode = SortMode::Name;
+	SortKeyOptions m_options;
+	bool m_valid = false;
+	bool m_sorted = false;
+};
@@ -0,0 +1,135 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "ThumbnailImageStore.h"
+
+ThumbnailImageStore::ThumbnailImageStore(size_t byteBudget, size_t bytesPerImage) :
+	m_bytesPerImage(bytesPerImage),
+	m_maxItemSlots(max(byteBudget / max(bytesPerImage, size_t{ 1 }), MIN_ITEM_SLOTS))
+{
+}
+
+std::optional<int> ThumbnailImageStore::GetItemSlot(int internalIndex)
+{
+	auto &itemSlotsByIndex = m_itemSlots.get<1>();
+	auto itr = itemSlotsByIndex.find(internalIndex);
+
+	if (itr == itemSlotsByIndex.end())
+	{
+		return std::nullopt;
+	}
+
+	m_itemSlots.relocate(m_itemSlots.begin(), m_itemSlots.project<0>(itr));
+
+	return itr->slot;
+}
+
+ThumbnailImageStore::ItemSlotAllocation ThumbnailImageStore::AllocateItemSlot(int internalIndex)
+{
+	auto existingSlot = GetItemSlot(internalIndex);
+
+	if (existingSlot)
+	{
+		return { *existingSlot, std::nullopt };
+	}
+
+	if (m_itemSlots.size() >= m_maxItemSlots)
+	{
+		// The least recently used thumbnail is at the back, so its slot can simply be handed over
+		// to this item.
+		ItemSlot evictedItemSlot = m_itemSlots.back();
+		m_itemSlots.pop_back();
+		m_itemSlots.push_front({ internalIndex, evictedItemSlot.slot });
+		m_numEvictions++;
+
+		return { evictedItemSlot.slot, evictedItemSlot.internalIndex };
+	}
+
+	int slot = TakeSlot();
+	m_itemSlots.push_front({ internalIndex, slot });
+
+	return { slot, std::nullopt };
+}
+
+void ThumbnailImageStore::RemoveItem(int internalIndex)
+{
+	auto &itemSlotsByIndex = m_itemSlots.get<1>();
+	auto itr = itemSlotsByIndex.find(internalIndex);
+
+	if (itr == itemSlotsByIndex.end())
+	{
+		return;
+	}
+
+	m_freeSlots.push_back(itr->slot);
+	itemSlotsByIndex.erase(itr);
+}
+
+std::optional<int> ThumbnailImageStore::GetIconSlot(int iconIndex) const
+{
+	auto itr = m_iconSlots.find(iconIndex);
+
+	if (itr == m_iconSlots.end())
+	{
+		return std::nullopt;
+	}
+
+	return itr->second;
+}
+
+int ThumbnailImageStore::AllocateIconSlot(int iconIndex)
+{
+	auto existingSlot = GetIconSlot(iconIndex);
+
+	if (existingSlot)
+	{
+		return *existingSlot;
+	}
+
+	int slot = TakeSlot();
+	m_iconSlots.insert({ iconIndex, slot });
+
+	return slot;
+}
+
+int ThumbnailImageStore::TakeSlot()
+{
+	if (!m_freeSlots.empty())
+	{
+		int slot = m_freeSlots.back();
+		m_freeSlots.pop_back();
+		return slot;
+	}
+
+	return m_numSlots++;
+}
+
+void ThumbnailImageStore::Clear()
+{
+	m_itemSlots.clear();
+	m_iconSlots.clear();
+	m_freeSlots.clear();
+	m_numSlots = 0;
+}
+
+int ThumbnailImageStore::GetNumSlots() const
+{
+	return m_numSlots;
+}
+
+size_t ThumbnailImageStore::GetNumItemThumbnails() const
+{
+	return m_itemSlots.size();
+}
+
+size_t ThumbnailImageStore::GetMemoryUsage() const
+{
+	return static_cast<size_t>(m_numSlots) * m_bytesPerImage;
+}
+
+uint64_t ThumbnailImageStore::GetNumEvictions() const
+{
+	return m_numEvictions;
+}
@@ -0,0 +1,94 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <boost/multi_index/hashed_index.hpp>
+#include <boost/multi_index/member.hpp>
+#include <boost/multi_index/sequenced_index.hpp>
+#include <boost/multi_index_container.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+// Tracks how the slots in the thumbnails view image list are used. Each slot holds a single,
+// fixed-size image. There are two types of image:
+//
+// - Extracted thumbnails, which are specific to an item. Only a limited number of these are kept
+//   (determined by the byte budget). Once that limit has been reached, the slot for the least
+//   recently used thumbnail is reassigned. The item that previously used the slot is returned, so
+//   that it can be switched back to its icon thumbnail.
+// - Icon thumbnails, which are shared by every item with the same system icon. There are only ever
+//   a small number of these, so they're never evicted.
+//
+// Slots are numbered from 0 and are handed out in order, so a new slot always corresponds to the
+// next image that will be added to the image list. Slots freed when an item is removed are reused
+// before any new slots are created. The image list never shrinks, so the memory used is determined
+// by the total number of slots that have been created.
+class ThumbnailImageStore
+{
+public:
+	// The minimum number of extracted thumbnails that will be kept, regardless of the byte budget.
+	// This is enough to fill the listview at high resolutions, which ensures that a thumbnail that
+	// is visible is never evicted to make room for another visible thumbnail.
+	static constexpr size_t MIN_ITEM_SLOTS = 512;
+
+	struct ItemSlotAllocation
+	{
+		int slot;
+
+		// The item whose thumbnail was evicted to make room for this one, if any.
+		std::optional<int> evictedItem;
+	};
+
+	ThumbnailImageStore(size_t byteBudget, size_t bytesPerImage);
+
+	// Returns the slot holding the thumbnail for the item, if there is one. The thumbnail will be
+	// marked as the most recently used.
+	std::optional<int> GetItemSlot(int internalIndex);
+
+	// Returns the slot that should be used to hold the thumbnail for the item. If the item already
+	// has a slot, the same slot will be returned.
+	ItemSlotAllocation AllocateItemSlot(int internalIndex);
+
+	void RemoveItem(int internalIndex);
+
+	std::optional<int> GetIconSlot(int iconIndex) const;
+	int AllocateIconSlot(int iconIndex);
+
+	// Forgets all slots. This should be called whenever the image list is recreated.
+	void Clear();
+
+	int GetNumSlots() const;
+	size_t GetNumItemThumbnails() const;
+	size_t GetMemoryUsage() const;
+	uint64_t GetNumEvictions() const;
+
+private:
+	struct ItemSlot
+	{
+		int internalIndex;
+		int slot;
+	};
+
+	// The sequenced index is ordered from the most recently used thumbnail to the least recently
+	// used one.
+	using ItemSlotSet = boost::multi_index_container<ItemSlot,
+		boost::multi_index::indexed_by<boost::multi_index::sequenced<>,
+			boost::multi_index::hashed_unique<
+				boost::multi_index::member<ItemSlot, int, &ItemSlot::internalIndex>>>>;
+
+	int TakeSlot();
+
+	const size_t m_bytesPerImage;
+	const size_t m_maxItemSlots;
+
+	ItemSlotSet m_itemSlots;
+	std::unordered_map<int, int> m_iconSlots;
+	std::vector<int> m_freeSlots;
+	int m_numSlots = 0;
+	uint64_t m_numEvictions = 0;
+};
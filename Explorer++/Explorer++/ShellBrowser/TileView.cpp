@@ -35,6 +35,12 @@ void ShellBrowser::SetTileViewInfo()
 	int nItems;
 	int i = 0;
 
+	// In owner data mode, the tile information is requested when each item is displayed.
+	if (m_virtualListView)
+	{
+		return;
+	}
+
 	nItems = ListView_GetItemCount(m_hListView);
 
 	for (i = 0; i < nItems; i++)
@@ -54,7 +60,6 @@ void ShellBrowser::SetTileViewInfo()
 /* TODO: Make this function configurable. */
 void ShellBrowser::SetTileViewItemInfo(int iItem, int iItemInternal)
 {
-	SHFILEINFO shfi;
 	LVTILEINFO lvti;
 	UINT uColumns[2] = { 1, 2 };
 	int columnFormats[2] = { LVCFMT_LEFT, LVCFMT_LEFT };
@@ -66,22 +71,34 @@ void ShellBrowser::SetTileViewItemInfo(int iItem, int iItemInternal)
 	lvti.piColFmt = columnFormats;
 	ListView_SetTileInfo(m_hListView, &lvti);
 
-	std::wstring fullFileName = GetItemFullName(iItem);
+	std::wstring typeText = GetTileViewItemText(iItemInternal, 1);
+	ListView_SetItemText(m_hListView, iItem, 1, typeText.data());
 
-	SHGetFileInfo(fullFileName.c_str(), 0, &shfi, sizeof(SHFILEINFO), SHGFI_TYPENAME);
+	std::wstring fileSizeText = GetTileViewItemText(iItemInternal, 2);
 
-	ListView_SetItemText(m_hListView, iItem, 1, shfi.szTypeName);
+	if (!fileSizeText.empty())
+	{
+		ListView_SetItemText(m_hListView, iItem, 2, fileSizeText.data());
+	}
+}
 
-	if ((m_itemInfoMap.at(iItemInternal).wfd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
-		!= FILE_ATTRIBUTE_DIRECTORY)
+std::wstring ShellBrowser::GetTileViewItemText(int internalIndex, int subItem) const
+{
+	if (subItem == 1)
 	{
-		ULARGE_INTEGER fileSize = { m_itemInfoMap.at(iItemInternal).wfd.nFileSizeLow,
-			m_itemInfoMap.at(iItemInternal).wfd.nFileSizeHigh };
+		SHFILEINFO shfi;
+		SHGetFileInfo(m_itemStore.GetParsingName(internalIndex).data(), 0, &shfi,
+			sizeof(SHFILEINFO), SHGFI_TYPENAME);
+		return shfi.szTypeName;
+	}
 
+	if (subItem == 2 && !m_itemStore.IsFolder(internalIndex))
+	{
 		SizeDisplayFormat displayFormat = m_config->globalFolderSettings.forceSize
 			? m_config->globalFolderSettings.sizeDisplayFormat
 			: SizeDisplayFormat::None;
-		std::wstring fileSizeText = FormatSizeString(fileSize.QuadPart, displayFormat);
-		ListView_SetItemText(m_hListView, iItem, 2, fileSizeText.data());
+		return FormatSizeString(m_itemStore.GetFileSize(internalIndex), displayFormat);
 	}
+
+	return {};
 }
@@ -0,0 +1,186 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "ViewportTaskScheduler.h"
+
+ViewportTaskScheduler::ViewportTaskScheduler(int numThreads, ThreadFunction threadInit,
+	ThreadFunction threadExit)
+{
+	numThreads = max(numThreads, 1);
+
+	for (int i = 0; i < numThreads; i++)
+	{
+		m_threads.emplace_back(&ViewportTaskScheduler::RunWorker, this, threadInit, threadExit);
+	}
+}
+
+ViewportTaskScheduler::~ViewportTaskScheduler()
+{
+	{
+		std::scoped_lock lock(m_mutex);
+		m_pendingTasks.clear();
+		m_stopping = true;
+	}
+
+	m_taskAvailable.notify_all();
+
+	for (auto &thread : m_threads)
+	{
+		thread.join();
+	}
+}
+
+void ViewportTaskScheduler::Push(int taskId, int itemIndex, Task task)
+{
+	{
+		std::scoped_lock lock(m_mutex);
+		m_pendingTasks.push_back({ taskId, itemIndex, m_sequenceNumber++, std::move(task) });
+		m_stats.peakQueueDepth = max(m_stats.peakQueueDepth, m_pendingTasks.size());
+	}
+
+	m_taskAvailable.notify_one();
+}
+
+std::vector<int> ViewportTaskScheduler::SetVisibleRange(int firstItem, int lastItem)
+{
+	std::scoped_lock lock(m_mutex);
+
+	if (m_visibleRange && m_visibleRange->first == firstItem && m_visibleRange->second == lastItem)
+	{
+		return {};
+	}
+
+	m_visibleRange = { firstItem, lastItem };
+
+	// Items within a page of the visible range can be scrolled into view quickly, so the tasks for
+	// those items are kept (though they'll be run after the tasks for the visible items).
+	int maxDistance = max(lastItem - firstItem + 1, 1);
+
+	std::vector<int> droppedTaskIds;
+
+	std::erase_if(m_pendingTasks,
+		[this, maxDistance, &droppedTaskIds](const PendingTask &pendingTask)
+		{
+			if (GetDistanceFromVisibleRange(pendingTask.itemIndex) <= maxDistance)
+			{
+				return false;
+			}
+
+			droppedTaskIds.push_back(pendingTask.id);
+			return true;
+		});
+
+	m_stats.numTasksDropped += droppedTaskIds.size();
+
+	return droppedTaskIds;
+}
+
+void ViewportTaskScheduler::ClearQueue()
+{
+	std::scoped_lock lock(m_mutex);
+	m_pendingTasks.clear();
+}
+
+void ViewportTaskScheduler::RecordWastedTask()
+{
+	std::scoped_lock lock(m_mutex);
+	m_stats.numTasksWasted++;
+}
+
+ViewportTaskScheduler::Stats ViewportTaskScheduler::GetStats() const
+{
+	std::scoped_lock lock(m_mutex);
+
+	Stats stats = m_stats;
+	stats.queueDepth = m_pendingTasks.size();
+	return stats;
+}
+
+void ViewportTaskScheduler::RunWorker(ThreadFunction threadInit, ThreadFunction threadExit)
+{
+	threadInit();
+
+	while (true)
+	{
+		Task task;
+
+		{
+			std::unique_lock lock(m_mutex);
+			m_taskAvailable.wait(lock,
+				[this]
+				{
+					return m_stopping || !m_pendingTasks.empty();
+				});
+
+			if (m_stopping)
+			{
+				break;
+			}
+
+			size_t index = FindNextTask();
+			task = std::move(m_pendingTasks[index].task);
+
+			// The order of the remaining tasks doesn't matter, since the next task is always found
+			// by searching all of them.
+			if (index != m_pendingTasks.size() - 1)
+			{
+				m_pendingTasks[index] = std::move(m_pendingTasks.back());
+			}
+
+			m_pendingTasks.pop_back();
+		}
+
+		task();
+
+		std::scoped_lock lock(m_mutex);
+		m_stats.numTasksRun++;
+	}
+
+	threadExit();
+}
+
+int ViewportTaskScheduler::GetDistanceFromVisibleRange(int itemIndex) const
+{
+	if (!m_visibleRange)
+	{
+		return 0;
+	}
+
+	if (itemIndex < m_visibleRange->first)
+	{
+		return m_visibleRange->first - itemIndex;
+	}
+
+	if (itemIndex > m_visibleRange->second)
+	{
+		return itemIndex - m_visibleRange->second;
+	}
+
+	return 0;
+}
+
+// Returns the index of the pending task whose item is closest to the visible range, with tasks that
+// are equally close being run in the order they were queued. Only a few pages of tasks will
+// typically be queued, so a linear search is sufficient here.
+size_t ViewportTaskScheduler::FindNextTask() const
+{
+	size_t bestIndex = 0;
+	int bestDistance = GetDistanceFromVisibleRange(m_pendingTasks[0].itemIndex);
+
+	for (size_t i = 1; i < m_pendingTasks.size(); i++)
+	{
+		int distance = GetDistanceFromVisibleRange(m_pendingTasks[i].itemIndex);
+
+		if (distance < bestDistance
+			|| (distance == bestDistance
+				&& m_pendingTasks[i].sequenceNumber < m_pendingTasks[bestIndex].sequenceNumber))
+		{
+			bestIndex = i;
+			bestDistance = distance;
+		}
+	}
+
+	return bestIndex;
+}
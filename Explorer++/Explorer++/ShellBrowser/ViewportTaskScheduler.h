@@ -0,0 +1,88 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+// Runs tasks for listview items on a pool of worker threads. Rather than running tasks in the order
+// they were queued, the task whose item is closest to the visible range of items is always run
+// next. That way, once the listview has been scrolled, the tasks for the items that are now visible
+// are run before those for the items that were previously visible.
+//
+// Tasks for items that are far outside the visible range are dropped when the range changes. It's
+// up to the caller to queue those tasks again if the items are scrolled back into view.
+class ViewportTaskScheduler
+{
+public:
+	using Task = std::function<void()>;
+	using ThreadFunction = std::function<void()>;
+
+	struct Stats
+	{
+		// The number of tasks that are waiting to be run.
+		size_t queueDepth = 0;
+
+		// The largest number of tasks that have been waiting at any one time.
+		size_t peakQueueDepth = 0;
+
+		uint64_t numTasksRun = 0;
+
+		// Tasks that were removed from the queue before being run, because their items were
+		// scrolled too far out of view.
+		uint64_t numTasksDropped = 0;
+
+		// Tasks that were run, but whose results were never used (e.g. because the item changed
+		// while the task was running).
+		uint64_t numTasksWasted = 0;
+	};
+
+	// threadInit and threadExit are called on each worker thread when the thread starts and just
+	// before it exits.
+	ViewportTaskScheduler(int numThreads, ThreadFunction threadInit, ThreadFunction threadExit);
+	~ViewportTaskScheduler();
+
+	// Queues a task for the item at the specified index. The index is only used to prioritize the
+	// task, so it doesn't matter if the item is subsequently moved.
+	void Push(int taskId, int itemIndex, Task task);
+
+	// Updates the range of visible items. Tasks for items that are more than a page outside the new
+	// range are dropped and their IDs returned.
+	std::vector<int> SetVisibleRange(int firstItem, int lastItem);
+
+	// Removes all queued tasks. Tasks that are currently running will still run to completion.
+	void ClearQueue();
+
+	void RecordWastedTask();
+	Stats GetStats() const;
+
+private:
+	struct PendingTask
+	{
+		int id;
+		int itemIndex;
+		uint64_t sequenceNumber;
+		Task task;
+	};
+
+	void RunWorker(ThreadFunction threadInit, ThreadFunction threadExit);
+	int GetDistanceFromVisibleRange(int itemIndex) const;
+	size_t FindNextTask() const;
+
+	std::vector<std::thread> m_threads;
+
+	mutable std::mutex m_mutex;
+	std::condition_variable m_taskAvailable;
+	std::vector<PendingTask> m_pendingTasks;
+	uint64_t m_sequenceNumber = 0;
+	std::optional<std::pair<int, int>> m_visibleRange;
+	Stats m_stats;
+	bool m_stopping = false;
+};
@@ -0,0 +1,390 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "ShellBrowser.h"
+#include "ColumnDataRetrieval.h"
+#include "Config.h"
+#include "ItemData.h"
+#include "ViewModes.h"
+#include "../Helper/IconFetcher.h"
+#include "../Helper/ListViewHelper.h"
+#include <wil/common.h>
+#include <algorithm>
+#include <cassert>
+
+// In owner data mode, the listview only stores the number of items, along with the selection and
+// focus state of each item. Everything else is requested through LVN_GETDISPINFO when an item is
+// displayed. Since that can happen frequently, the data for each item is retrieved once and then
+// stored in m_directoryState.virtualList.
+void ShellBrowser::OnVirtualListViewGetDisplayInfo(LVITEM *item)
+{
+	const auto &items = m_directoryState.virtualList.items;
+
+	if (item->iItem < 0 || item->iItem >= static_cast<int>(items.size()))
+	{
+		return;
+	}
+
+	int internalIndex = items[item->iItem];
+
+	if (WI_IsFlagSet(item->mask, LVIF_TEXT))
+	{
+		std::wstring text;
+
+		if (m_folderSettings.viewMode == +ViewMode::Details)
+		{
+			auto columnType = GetColumnTypeByIndex(item->iSubItem);
+			assert(columnType);
+
+			if (*columnType == ColumnType::Name)
+			{
+				text = ProcessItemFileName(m_itemStore.GetBasicItemInfo(internalIndex, false),
+					m_config->globalFolderSettings);
+			}
+			else
+			{
+				const std::wstring *columnText =
+					MaybeGetColumnText(item->iItem, internalIndex, *columnType);
+
+				if (columnText)
+				{
+					text = *columnText;
+				}
+			}
+		}
+		else if (m_folderSettings.viewMode == +ViewMode::Tiles && item->iSubItem > 0)
+		{
+			text = GetTileViewItemText(internalIndex, item->iSubItem);
+		}
+		else
+		{
+			text = ProcessItemFileName(m_itemStore.GetBasicItemInfo(internalIndex, false),
+				m_config->globalFolderSettings);
+		}
+
+		StringCchCopy(item->pszText, item->cchTextMax, text.c_str());
+	}
+
+	// The icon index is used for both the image and the overlay, neither of which is requested
+	// from here in thumbnails view. Since looking up the icon can involve a lookup in the
+	// persistent cache, it's only done when the listview has actually asked for one of them.
+	bool overlayRequested = WI_IsFlagSet(item->mask, LVIF_STATE)
+		&& WI_IsAnyFlagSet(item->stateMask, LVIS_OVERLAYMASK);
+	std::optional<int> iconIndex;
+
+	if (m_folderSettings.viewMode != +ViewMode::Thumbnails
+		&& (WI_IsFlagSet(item->mask, LVIF_IMAGE) || overlayRequested))
+	{
+		auto iconItr = m_directoryState.virtualList.iconIndexes.find(internalIndex);
+
+		if (iconItr != m_directoryState.virtualList.iconIndexes.end() && iconItr->second != -1)
+		{
+			iconIndex = iconItr->second;
+		}
+		else if (auto extensionIconIndex = GetExtensionIconIndex(internalIndex))
+		{
+			// Until the overlay has been retrieved, any overlay saved in a previous session is
+			// shown.
+			int overlayIndex = GetPersistedOverlayIndex(internalIndex).value_or(0);
+			iconIndex = *extensionIconIndex | (overlayIndex << 24);
+		}
+		else
+		{
+			iconIndex = GetCachedIconIndex(internalIndex);
+		}
+	}
+
+	if (WI_IsFlagSet(item->mask, LVIF_IMAGE))
+	{
+		if (m_folderSettings.viewMode == +ViewMode::Thumbnails)
+		{
+			auto &thumbnailIndexes = m_directoryState.virtualList.thumbnailIndexes;
+			auto thumbnailItr = thumbnailIndexes.find(internalIndex);
+
+			if (thumbnailItr == thumbnailIndexes.end())
+			{
+				auto persistedThumbnailIndex = GetPersistedThumbnailIndex(internalIndex);
+
+				if (persistedThumbnailIndex)
+				{
+					thumbnailItr =
+						thumbnailIndexes.emplace(internalIndex, *persistedThumbnailIndex).first;
+				}
+				else
+				{
+					QueueThumbnailTask(item->iItem, internalIndex);
+
+					int imageIndex = GetIconThumbnail(internalIndex);
+					thumbnailItr = thumbnailIndexes.emplace(internalIndex, imageIndex).first;
+				}
+			}
+
+			item->iImage = thumbnailItr->second;
+		}
+		else
+		{
+			// As in the standard case, any overlay is stored in the upper eight bits of the icon
+			// index and has to be masked out here. The overlay is returned through the item state
+			// below.
+			if (iconIndex)
+			{
+				item->iImage = (*iconIndex & 0x0FFF);
+			}
+			else if (m_itemStore.IsFolder(internalIndex))
+			{
+				item->iImage = m_iFolderIcon;
+			}
+			else
+			{
+				item->iImage = m_iFileIcon;
+			}
+
+			QueueVirtualListIconTask(item->iItem, internalIndex);
+		}
+	}
+
+	if (WI_IsFlagSet(item->mask, LVIF_STATE))
+	{
+		if (WI_IsFlagSet(item->stateMask, LVIS_CUT)
+			&& (WI_IsFlagSet(m_itemStore.GetAttributes(internalIndex), FILE_ATTRIBUTE_HIDDEN)
+				|| m_directoryState.virtualList.cutItems.contains(internalIndex)))
+		{
+			item->state |= LVIS_CUT;
+		}
+
+		if (overlayRequested && iconIndex)
+		{
+			item->state |= INDEXTOOVERLAYMASK(*iconIndex >> 24);
+		}
+	}
+
+	if (WI_IsFlagSet(item->mask, LVIF_COLUMNS) && m_folderSettings.viewMode == +ViewMode::Tiles)
+	{
+		// These are the same columns set by SetTileViewItemInfo().
+		UINT numColumns = min(item->cColumns, 2u);
+
+		for (UINT i = 0; i < numColumns; i++)
+		{
+			item->puColumns[i] = i + 1;
+
+			if (WI_IsFlagSet(item->mask, LVIF_COLFMT) && item->piColFmt)
+			{
+				item->piColFmt[i] = LVCFMT_LEFT;
+			}
+		}
+
+		item->cColumns = numColumns;
+	}
+}
+
+int ShellBrowser::OnListViewFindItem(const NMLVFINDITEM *findItem) const
+{
+	const auto &items = m_directoryState.virtualList.items;
+	const LVFINDINFO &findInfo = findItem->lvfi;
+
+	if (WI_IsFlagSet(findInfo.flags, LVFI_PARAM))
+	{
+		return GetVirtualListItemPosition(static_cast<int>(findInfo.lParam)).value_or(-1);
+	}
+
+	// The remaining case is a search by name, which is what the listview uses when the user types
+	// the start of an item's name.
+	if (!WI_IsAnyFlagSet(findInfo.flags, LVFI_STRING | LVFI_PARTIAL) || !findInfo.psz)
+	{
+		return -1;
+	}
+
+	int numItems = static_cast<int>(items.size());
+	int start = std::clamp(findItem->iStart, 0, numItems);
+	size_t searchLength = lstrlen(findInfo.psz);
+
+	auto matches = [this, &items, &findInfo, searchLength](int index)
+	{
+		auto displayName = m_itemStore.GetDisplayName(items[index]);
+
+		if (WI_IsFlagSet(findInfo.flags, LVFI_PARTIAL))
+		{
+			return StrCmpNI(displayName.data(), findInfo.psz, static_cast<int>(searchLength)) == 0;
+		}
+
+		return lstrcmpi(displayName.data(), findInfo.psz) == 0;
+	};
+
+	for (int i = start; i < numItems; i++)
+	{
+		if (matches(i))
+		{
+			return i;
+		}
+	}
+
+	if (WI_IsFlagSet(findInfo.flags, LVFI_WRAP))
+	{
+		for (int i = 0; i < start; i++)
+		{
+			if (matches(i))
+			{
+				return i;
+			}
+		}
+	}
+
+	return -1;
+}
+
+void ShellBrowser::OnListViewCacheHint(const NMLVCACHEHINT *cacheHint)
+{
+	// The listview is about to request the items in this range. Queuing the requests for all of
+	// the items here means that the data will be retrieved in display order, rather than in the
+	// order in which the individual items happen to be painted.
+	const auto &items = m_directoryState.virtualList.items;
+	int from = max(cacheHint->iFrom, 0);
+	int to = min(cacheHint->iTo, static_cast<int>(items.size()) - 1);
+
+	std::vector<ColumnType> columnTypes;
+
+	if (m_folderSettings.viewMode == +ViewMode::Details)
+	{
+		columnTypes = GetColumnTypesToRetrieve();
+	}
+
+	for (int i = from; i <= to; i++)
+	{
+		int internalIndex = items[i];
+
+		if (m_folderSettings.viewMode != +ViewMode::Thumbnails)
+		{
+			QueueVirtualListIconTask(i, internalIndex);
+		}
+
+		if (!columnTypes.empty())
+		{
+			QueueColumnTask(i, internalIndex, columnTypes);
+		}
+	}
+}
+
+void ShellBrowser::OnListViewStateChanged(const NMLVODSTATECHANGE *stateChange)
+{
+	// This is sent when the state of a range of items changes (e.g. when a range of items is
+	// selected using the shift key). Individual notifications aren't sent for the items in the
+	// range, so the selection information is rebuilt here.
+	if (WI_IsFlagClear(stateChange->uOldState ^ stateChange->uNewState, LVIS_SELECTED))
+	{
+		return;
+	}
+
+	RecalculateFileSelectionInfo();
+
+	listViewSelectionChanged.m_signal();
+}
+
+// Replaces the set of items shown in the listview. The listview tracks the selected and focused
+// items by position, so those items are saved here and restored once the items have been
+// rearranged.
+void ShellBrowser::SetVirtualListItems(std::vector<int> items)
+{
+	std::vector<int> selectedItems;
+	int item = -1;
+
+	while ((item = ListView_GetNextItem(m_hListView, item, LVNI_SELECTED)) != -1)
+	{
+		selectedItems.push_back(GetItemInternalIndex(item));
+	}
+
+	std::optional<int> focusedItem;
+	int focusedIndex = ListView_GetNextItem(m_hListView, -1, LVNI_FOCUSED);
+
+	if (focusedIndex != -1)
+	{
+		focusedItem = GetItemInternalIndex(focusedIndex);
+	}
+
+	auto &virtualList = m_directoryState.virtualList;
+	virtualList.items = std::move(items);
+
+	const auto &updatedItems = virtualList.items;
+	auto &positions = virtualList.positions;
+	positions.clear();
+	positions.reserve(updatedItems.size());
+
+	for (int i = 0; i < static_cast<int>(updatedItems.size()); i++)
+	{
+		positions.emplace(updatedItems[i], i);
+	}
+
+	ListView_SetItemCountEx(m_hListView, updatedItems.size(), LVSICF_NOSCROLL);
+
+	if (selectedItems.empty() && !focusedItem)
+	{
+		return;
+	}
+
+	ListViewHelper::SelectAllItems(m_hListView, FALSE);
+
+	for (int internalIndex : selectedItems)
+	{
+		auto itr = positions.find(internalIndex);
+
+		if (itr != positions.end())
+		{
+			ListViewHelper::SelectItem(m_hListView, itr->second, TRUE);
+		}
+	}
+
+	if (focusedItem)
+	{
+		auto itr = positions.find(*focusedItem);
+
+		if (itr != positions.end())
+		{
+			ListViewHelper::FocusItem(m_hListView, itr->second, TRUE);
+		}
+	}
+}
+
+// Removing an item changes the position of every item that follows it. So, when multiple items are
+// being removed, they should all be passed in at once, so that the positions are only rebuilt a
+// single time.
+void ShellBrowser::RemoveVirtualListItems(const std::unordered_set<int> &internalIndexes)
+{
+	std::vector<int> items = m_directoryState.virtualList.items;
+	std::erase_if(items,
+		[&internalIndexes](int internalIndex) { return internalIndexes.contains(internalIndex); });
+
+	SetVirtualListItems(std::move(items));
+}
+
+std::optional<int> ShellBrowser::GetVirtualListItemPosition(int internalIndex) const
+{
+	const auto &positions = m_directoryState.virtualList.positions;
+	auto itr = positions.find(internalIndex);
+
+	if (itr == positions.end())
+	{
+		return std::nullopt;
+	}
+
+	return itr->second;
+}
+
+void ShellBrowser::QueueVirtualListIconTask(int itemIndex, int internalIndex)
+{
+	auto [itr, inserted] = m_directoryState.virtualList.iconIndexes.try_emplace(internalIndex, -1);
+
+	if (!inserted)
+	{
+		return;
+	}
+
+	QueueItemIconTask(itemIndex, internalIndex, GetExtensionIconIndex(internalIndex));
+}
+
+void ShellBrowser::RemoveVirtualListItemData(int internalIndex)
+{
+	m_directoryState.virtualList.iconIndexes.erase(internalIndex);
+	m_directoryState.virtualList.thumbnailIndexes.erase(internalIndex);
+	m_directoryState.virtualList.cutItems.erase(internalIndex);
+}
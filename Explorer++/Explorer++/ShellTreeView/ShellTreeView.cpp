@@ -29,11 +29,11 @@
 #include "../Helper/FileOperations.h"
 #include "../Helper/Helper.h"
 #include "../Helper/Macros.h"
+#include "../Helper/NaturalSortKey.h"
 #include "../Helper/ShellHelper.h"
 #include <wil/common.h>
 #include <propkey.h>
 
-int CALLBACK CompareItemsStub(LPARAM lParam1, LPARAM lParam2, LPARAM lParamSort);
 DWORD WINAPI Thread_MonitorAllDrives(LPVOID pParam);
 
 ShellTreeView::ShellTreeView(HWND hParent, CoreInterface *coreInterface, IDirectoryMonitor *pDirMon,
@@ -46,9 +46,7 @@ ShellTreeView::ShellTreeView(HWND hParent, CoreInterface *coreInterface, IDirect
 	m_fileActionHandler(fileActionHandler),
 	m_cachedIcons(cachedIcons),
 	m_itemIDCounter(0),
-	m_iconThreadPool(1, std::bind(CoInitializeEx, nullptr, COINIT_APARTMENTTHREADED),
-		CoUninitialize),
-	m_iconResultIDCounter(0),
+	m_iconFetcher(coreInterface->GetIconService()),
 	m_subfoldersThreadPool(1, std::bind(CoInitializeEx, nullptr, COINIT_APARTMENTTHREADED),
 		CoUninitialize),
 	m_subfoldersResultIDCounter(0),
@@ -110,8 +108,6 @@ HWND ShellTreeView::CreateTreeView(HWND parent)
 ShellTreeView::~ShellTreeView()
 {
 	DeleteCriticalSection(&m_cs);
-
-	m_iconThreadPool.clear_queue();
 }
 
 void ShellTreeView::OnApplicationShuttingDown()
@@ -244,10 +240,6 @@ LRESULT CALLBACK ShellTreeView::TreeViewProc(HWND hwnd, UINT msg, WPARAM wParam,
 		OnClipboardUpdate();
 		return 0;
 
-	case WM_APP_ICON_RESULT_READY:
-		ProcessIconResult(static_cast<int>(wParam));
-		break;
-
 	case WM_APP_SUBFOLDERS_RESULT_READY:
 		ProcessSubfoldersResult(static_cast<int>(wParam));
 		break;
@@ -409,95 +401,29 @@ void ShellTreeView::QueueIconTask(HTREEITEM item, int internalIndex)
 {
 	const ItemInfo_t &itemInfo = m_itemInfoMap.at(internalIndex);
 
-	BasicItemInfo basicItemInfo;
-	basicItemInfo.pidl.reset(ILCloneFull(itemInfo.pidl.get()));
-
-	int iconResultID = m_iconResultIDCounter++;
-
-	auto result = m_iconThreadPool.push(
-		[this, iconResultID, item, internalIndex, basicItemInfo](int id)
+	m_iconFetcher.QueueIconTask(itemInfo.pidl.get(),
+		[this, item, internalIndex](int iconIndex)
 		{
-			UNREFERENCED_PARAMETER(id);
-
-			return FindIconAsync(m_hTreeView, iconResultID, item, internalIndex,
-				basicItemInfo.pidl.get());
+			ProcessIconResult(item, internalIndex, iconIndex);
 		});
-
-	m_iconResults.insert({ iconResultID, std::move(result) });
 }
 
-std::optional<ShellTreeView::IconResult> ShellTreeView::FindIconAsync(HWND treeView,
-	int iconResultId, HTREEITEM item, int internalIndex, PCIDLIST_ABSOLUTE pidl)
+void ShellTreeView::ProcessIconResult(HTREEITEM item, int internalIndex, int iconIndex)
 {
-	SHFILEINFO shfi;
-	DWORD_PTR res = SHGetFileInfo(reinterpret_cast<LPCTSTR>(pidl), 0, &shfi, sizeof(SHFILEINFO),
-		SHGFI_PIDL | SHGFI_ICON | SHGFI_OVERLAYINDEX);
-
-	if (res == 0)
-	{
-		return std::nullopt;
-	}
-
-	DestroyIcon(shfi.hIcon);
-
-	PostMessage(treeView, WM_APP_ICON_RESULT_READY, iconResultId, 0);
-
-	IconResult result;
-	result.item = item;
-	result.internalIndex = internalIndex;
-	result.iconIndex = shfi.iIcon;
-
-	return result;
-}
-
-void ShellTreeView::ProcessIconResult(int iconResultId)
-{
-	auto iconResultsItr = m_iconResults.find(iconResultId);
-
-	if (iconResultsItr == m_iconResults.end())
-	{
-		return;
-	}
-
-	auto cleanup = wil::scope_exit(
-		[this, iconResultsItr]()
-		{
-			m_iconResults.erase(iconResultsItr);
-		});
-
-	auto result = iconResultsItr->second.get();
-
-	if (!result)
-	{
-		return;
-	}
-
-	auto itemMapItr = m_itemInfoMap.find(result->internalIndex);
-
 	// The item may have been removed (e.g. if the associated folder was deleted, or the parent was
 	// collapsed).
-	if (itemMapItr == m_itemInfoMap.end())
+	if (!m_itemInfoMap.contains(internalIndex))
 	{
 		return;
 	}
 
-	const ItemInfo_t &itemInfo = itemMapItr->second;
-
-	std::wstring filePath;
-	HRESULT hr = GetDisplayName(itemInfo.pidl.get(), SHGDN_FORPARSING, filePath);
-
-	if (SUCCEEDED(hr))
-	{
-		m_cachedIcons->addOrUpdateFileIcon(filePath, result->iconIndex);
-	}
-
 	TVITEM tvItem;
 	tvItem.mask = TVIF_HANDLE | TVIF_IMAGE | TVIF_SELECTEDIMAGE | TVIF_STATE;
-	tvItem.hItem = result->item;
-	tvItem.iImage = result->iconIndex;
-	tvItem.iSelectedImage = result->iconIndex;
+	tvItem.hItem = item;
+	tvItem.iImage = iconIndex;
+	tvItem.iSelectedImage = iconIndex;
 	tvItem.stateMask = TVIS_OVERLAYMASK;
-	tvItem.state = INDEXTOOVERLAYMASK(result->iconIndex >> 24);
+	tvItem.state = INDEXTOOVERLAYMASK(iconIndex >> 24);
 	TreeView_SetItem(m_hTreeView, &tvItem);
 }
 
@@ -674,68 +600,54 @@ LRESULT ShellTreeView::OnKeyDown(const NMTVKEYDOWN *keyDown)
  - Real Items
 
 Each set is ordered alphabetically. */
-int CALLBACK CompareItemsStub(LPARAM lParam1, LPARAM lParam2, LPARAM lParamSort)
+ShellTreeView::ItemSortKey ShellTreeView::BuildItemSortKey(int itemId) const
 {
-	ShellTreeView *shellTreeView = nullptr;
+	const ItemInfo_t &itemInfo = m_itemInfoMap.at(itemId);
 
-	shellTreeView = (ShellTreeView *) lParamSort;
+	ItemSortKey key;
 
-	return shellTreeView->CompareItems(lParam1, lParam2);
-}
+	std::wstring parsingName;
+	GetDisplayName(itemInfo.pidl.get(), SHGDN_FORPARSING, parsingName);
+
+	if (PathIsRoot(parsingName.c_str()))
+	{
+		key.rank = 0;
+		key.name = parsingName;
+		return key;
+	}
 
-int CALLBACK ShellTreeView::CompareItems(LPARAM lParam1, LPARAM lParam2)
-{
 	TCHAR szTemp[MAX_PATH];
-	int iItemId1 = (int) lParam1;
-	int iItemId2 = (int) lParam2;
+	key.rank = SHGetPathFromIDList(itemInfo.pidl.get(), szTemp) ? 2 : 1;
 
-	const ItemInfo_t &itemInfo1 = m_itemInfoMap.at(iItemId1);
-	const ItemInfo_t &itemInfo2 = m_itemInfoMap.at(iItemId2);
+	GetDisplayName(itemInfo.pidl.get(), SHGDN_INFOLDER, key.name);
 
-	std::wstring displayName1;
-	GetDisplayName(itemInfo1.pidl.get(), SHGDN_FORPARSING, displayName1);
+	if (m_config->globalFolderSettings.useNaturalSortOrder)
+	{
+		key.naturalSortKey = BuildNaturalSortKey(key.name);
+	}
 
-	std::wstring displayName2;
-	GetDisplayName(itemInfo2.pidl.get(), SHGDN_FORPARSING, displayName2);
+	return key;
+}
 
-	if (PathIsRoot(displayName1.c_str()) && !PathIsRoot(displayName2.c_str()))
+int ShellTreeView::CompareItems(const ItemSortKey &key1, const ItemSortKey &key2) const
+{
+	if (key1.rank != key2.rank)
 	{
-		return -1;
+		return (key1.rank < key2.rank) ? -1 : 1;
 	}
-	else if (!PathIsRoot(displayName1.c_str()) && PathIsRoot(displayName2.c_str()))
+
+	if (key1.rank == 0)
 	{
-		return 1;
+		return lstrcmpi(key1.name.c_str(), key2.name.c_str());
 	}
-	else if (PathIsRoot(displayName1.c_str()) && PathIsRoot(displayName2.c_str()))
+
+	if (m_config->globalFolderSettings.useNaturalSortOrder)
 	{
-		return lstrcmpi(displayName1.c_str(), displayName2.c_str());
+		return CompareNaturalSortKeys(key1.naturalSortKey, key2.naturalSortKey);
 	}
 	else
 	{
-		if (!SHGetPathFromIDList(itemInfo1.pidl.get(), szTemp)
-			&& SHGetPathFromIDList(itemInfo2.pidl.get(), szTemp))
-		{
-			return -1;
-		}
-		else if (SHGetPathFromIDList(itemInfo1.pidl.get(), szTemp)
-			&& !SHGetPathFromIDList(itemInfo2.pidl.get(), szTemp))
-		{
-			return 1;
-		}
-		else
-		{
-			GetDisplayName(itemInfo1.pidl.get(), SHGDN_INFOLDER, displayName1);
-			GetDisplayName(itemInfo2.pidl.get(), SHGDN_INFOLDER, displayName2);
-
-			if (m_config->globalFolderSettings.useNaturalSortOrder)
-			{
-				return StrCmpLogicalW(displayName1.c_str(), displayName2.c_str());
-			}
-			else
-			{
-				return StrCmpIW(displayName1.c_str(), displayName2.c_str());
-			}
-		}
+		return StrCmpIW(key1.name.c_str(), key2.name.c_str());
 	}
 }
 
@@ -815,11 +727,20 @@ HRESULT ShellTreeView::ExpandDirectory(HTREEITEM hParent)
 				EnumeratedItem item;
 				item.internalIndex = itemId;
 				item.name = itemName;
-				items.push_back(item);
+				item.sortKey = BuildItemSortKey(itemId);
+				items.push_back(std::move(item));
 			}
 		}
 	}
 
+	// The items are sorted before being inserted, rather than sorting the children of the parent
+	// item afterwards. That way, the sort key for each item only has to be built once.
+	std::stable_sort(items.begin(), items.end(),
+		[this](const EnumeratedItem &item1, const EnumeratedItem &item2)
+		{
+			return CompareItems(item1.sortKey, item2.sortKey) < 0;
+		});
+
 	for (auto &item : items)
 	{
 		TVITEMEX tvItem;
@@ -838,12 +759,6 @@ HRESULT ShellTreeView::ExpandDirectory(HTREEITEM hParent)
 		TreeView_InsertItem(m_hTreeView, &tvis);
 	}
 
-	TVSORTCB tvscb;
-	tvscb.hParent = hParent;
-	tvscb.lpfnCompare = CompareItemsStub;
-	tvscb.lParam = reinterpret_cast<LPARAM>(this);
-	TreeView_SortChildrenCB(m_hTreeView, &tvscb, 0);
-
 	SendMessage(m_hTreeView, WM_SETREDRAW, TRUE, 0);
 
 	return hr;
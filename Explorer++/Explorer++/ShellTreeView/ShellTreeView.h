@@ -5,6 +5,7 @@
 #pragma once
 
 #include "../Helper/DropHandler.h"
+#include "../Helper/IconFetcher.h"
 #include "../Helper/ShellDropTargetWindow.h"
 #include "../Helper/ShellHelper.h"
 #include "../Helper/WindowSubclassWrapper.h"
@@ -33,9 +34,6 @@ public:
 	void SetShowHidden(BOOL bShowHidden);
 	void RefreshAllIcons();
 
-	/* Sorting. */
-	int CALLBACK CompareItems(LPARAM lParam1, LPARAM lParam2);
-
 	void MonitorDrivePublic(const TCHAR *szDrive);
 
 	void StartRenamingSelectedItem();
@@ -46,7 +44,6 @@ public:
 	void PasteShortcut();
 
 private:
-	static const UINT WM_APP_ICON_RESULT_READY = WM_APP + 1;
 	static const UINT WM_APP_SUBFOLDERS_RESULT_READY = WM_APP + 2;
 
 	// This is the same background color as used in the Explorer treeview.
@@ -67,10 +64,22 @@ private:
 		unique_pidl_child pridl;
 	} ItemInfo_t;
 
+	// Contains everything needed to order an item relative to its siblings, so that the shell
+	// doesn't have to be queried on each comparison.
+	struct ItemSortKey
+	{
+		int rank;
+		std::wstring name;
+
+		// Only built if natural sort order is enabled.
+		std::string naturalSortKey;
+	};
+
 	typedef struct
 	{
 		int internalIndex;
 		std::wstring name;
+		ItemSortKey sortKey;
 	} EnumeratedItem;
 
 	typedef struct
@@ -91,13 +100,6 @@ private:
 		unique_pidl_absolute pidl;
 	};
 
-	struct IconResult
-	{
-		HTREEITEM item;
-		int internalIndex;
-		int iconIndex;
-	};
-
 	struct SubfoldersResult
 	{
 		HTREEITEM item;
@@ -128,6 +130,8 @@ private:
 	LRESULT CALLBACK ParentWndProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam);
 
 	HRESULT ExpandDirectory(HTREEITEM hParent);
+	ItemSortKey BuildItemSortKey(int itemId) const;
+	int CompareItems(const ItemSortKey &key1, const ItemSortKey &key2) const;
 	void DirectoryModified(DWORD dwAction, const TCHAR *szFullFileName);
 	void DirectoryAltered();
 	HTREEITEM AddRoot();
@@ -167,9 +171,7 @@ private:
 
 	/* Icons. */
 	void QueueIconTask(HTREEITEM item, int internalIndex);
-	static std::optional<IconResult> FindIconAsync(HWND treeView, int iconResultId, HTREEITEM item,
-		int internalIndex, PCIDLIST_ABSOLUTE pidl);
-	void ProcessIconResult(int iconResultId);
+	void ProcessIconResult(HTREEITEM item, int internalIndex, int iconIndex);
 	std::optional<int> GetCachedIconIndex(const ItemInfo_t &itemInfo);
 
 	void QueueSubfoldersTask(HTREEITEM item);
@@ -222,9 +224,7 @@ private:
 	TabContainer *m_tabContainer;
 	FileActionHandler *m_fileActionHandler;
 
-	ctpl::thread_pool m_iconThreadPool;
-	std::unordered_map<int, std::future<std::optional<IconResult>>> m_iconResults;
-	int m_iconResultIDCounter;
+	IconFetcher m_iconFetcher;
 
 	ctpl::thread_pool m_subfoldersThreadPool;
 	std::unordered_map<int, std::future<std::optional<SubfoldersResult>>> m_subfoldersResults;
@@ -63,7 +63,7 @@ TabContainer::TabContainer(HWND parent, TabNavigationInterface *tabNavigation,
 	m_config(config),
 	m_bTabBeenDragged(FALSE),
 	m_iPreviousTabSelectionId(-1),
-	m_iconFetcher(m_hwnd, cachedIcons),
+	m_iconFetcher(coreInterface->GetIconService()),
 	m_defaultFolderIconSystemImageListIndex(GetDefaultFolderIconIndex()),
 	m_dropTargetIndex(-1)
 {
@@ -12,6 +12,7 @@
 #include "../Helper/ListViewHelper.h"
 #include "../Helper/Macros.h"
 #include "../Helper/RegistrySettings.h"
+#include "../Helper/WildcardPattern.h"
 #include "../Helper/WindowHelper.h"
 #include "../Helper/XMLSettings.h"
 
@@ -141,11 +142,13 @@ void WildcardSelectDialog::SelectItems(TCHAR *szPattern)
 
 	int nItems = ListView_GetItemCount(hListView);
 
+	WildcardPattern pattern(szPattern, false);
+
 	for (int i = 0; i < nItems; i++)
 	{
 		std::wstring filename = m_coreInterface->GetActiveShellBrowser()->GetItemName(i);
 
-		if (CheckWildcardMatch(szPattern, filename.c_str(), FALSE) == 1)
+		if (pattern.Match(filename))
 		{
 			ListViewHelper::SelectItem(hListView, i, m_bSelect);
 		}
@@ -114,6 +114,9 @@ will need to be changed correspondingly. */
 #define HASH_DISPLAY_MIXED_FILES_AND_FOLDERS 1168704423
 #define HASH_USE_NATURAL_SORT_ORDER 528323501
 #define HASH_OPEN_TABS_IN_FOREGROUND 2957281235
+#define HASH_USE_VIRTUAL_LIST_VIEW 1299913936
+#define HASH_COLUMN_RETRIEVAL_THREADS 66816236
+#define HASH_THUMBNAIL_MEMORY_BUDGET 65743613
 
 struct ColumnXMLSaveData
 {
@@ -736,6 +739,20 @@ void Explorerplusplus::SaveGenericSettingsToXML(IXMLDOMDocument *pXMLDom, IXMLDO
 	NXMLSettings::WriteStandardSetting(pXMLDom, pe.get(), _T("Setting"), _T("OpenTabsInForeground"),
 		NXMLSettings::EncodeBoolValue(m_config->openTabsInForeground));
 
+	NXMLSettings::AddWhiteSpaceToNode(pXMLDom, bstr_wsntt.get(), pe.get());
+	NXMLSettings::WriteStandardSetting(pXMLDom, pe.get(), _T("Setting"), _T("UseVirtualListView"),
+		NXMLSettings::EncodeBoolValue(m_config->useVirtualListView));
+
+	NXMLSettings::AddWhiteSpaceToNode(pXMLDom, bstr_wsntt.get(), pe.get());
+	NXMLSettings::WriteStandardSetting(pXMLDom, pe.get(), _T("Setting"),
+		_T("ColumnRetrievalThreads"),
+		NXMLSettings::EncodeIntValue(m_config->columnRetrievalThreads));
+
+	NXMLSettings::AddWhiteSpaceToNode(pXMLDom, bstr_wsntt.get(), pe.get());
+	NXMLSettings::WriteStandardSetting(pXMLDom, pe.get(), _T("Setting"),
+		_T("ThumbnailMemoryBudget"),
+		NXMLSettings::EncodeIntValue(m_config->thumbnailMemoryBudget));
+
 	auto bstr_wsnt = wil::make_bstr_nothrow(L"\n\t");
 	NXMLSettings::AddWhiteSpaceToNode(pXMLDom, bstr_wsnt.get(), pe.get());
 
@@ -966,6 +983,14 @@ void Explorerplusplus::SaveTabSettingsToXMLnternal(IXMLDOMDocument *pXMLDom, IXM
 		NXMLSettings::AddAttributeToNode(pXMLDom, pParentNode.get(), _T("SortMode"),
 			NXMLSettings::EncodeIntValue(sortMode));
 
+		auto secondarySortMode = tab.GetShellBrowser()->GetSecondarySortMode();
+
+		if (secondarySortMode)
+		{
+			NXMLSettings::AddAttributeToNode(pXMLDom, pParentNode.get(), _T("SecondarySortMode"),
+				NXMLSettings::EncodeIntValue(*secondarySortMode));
+		}
+
 		UINT viewMode = tab.GetShellBrowser()->GetViewMode();
 		NXMLSettings::AddAttributeToNode(pXMLDom, pParentNode.get(), _T("ViewMode"),
 			NXMLSettings::EncodeIntValue(viewMode));
@@ -1794,6 +1819,19 @@ void Explorerplusplus::MapAttributeToValue(IXMLDOMNode *pNode, WCHAR *wszName, W
 	case HASH_OPEN_TABS_IN_FOREGROUND:
 		m_config->openTabsInForeground = NXMLSettings::DecodeBoolValue(wszValue);
 		break;
+
+	case HASH_USE_VIRTUAL_LIST_VIEW:
+		m_config->useVirtualListView = NXMLSettings::DecodeBoolValue(wszValue);
+		break;
+
+	case HASH_COLUMN_RETRIEVAL_THREADS:
+		m_config->columnRetrievalThreads =
+			Config::ClampColumnRetrievalThreads(NXMLSettings::DecodeIntValue(wszValue));
+		break;
+
+	case HASH_THUMBNAIL_MEMORY_BUDGET:
+		m_config->thumbnailMemoryBudget = NXMLSettings::DecodeIntValue(wszValue);
+		break;
 	}
 }
 
@@ -1832,6 +1870,17 @@ void Explorerplusplus::MapTabAttributeValue(WCHAR *wszName, WCHAR *wszValue,
 	{
 		folderSettings.sortMode = SortMode::_from_integral(NXMLSettings::DecodeIntValue(wszValue));
 	}
+	else if (lstrcmp(wszName, L"SecondarySortMode") == 0)
+	{
+		// The secondary sort mode is optional, so an invalid value is simply ignored.
+		auto secondarySortMode =
+			SortMode::_from_integral_nothrow(NXMLSettings::DecodeIntValue(wszValue));
+
+		if (secondarySortMode)
+		{
+			folderSettings.secondarySortMode = *secondarySortMode;
+		}
+	}
 	else if (lstrcmp(wszName, L"ViewMode") == 0)
 	{
 		folderSettings.viewMode = ViewMode::_from_integral(NXMLSettings::DecodeIntValue(wszValue));
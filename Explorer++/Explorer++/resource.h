@@ -72,6 +72,7 @@
 #define IDS_MANAGE_BOOKMARKS_TOOLBAR_VIEWS 262
 #define IDS_MANAGE_BOOKMARKS_TOOLBAR_ORGANIZE 263
 #define IDS_GROUPBY_UNSPECIFIED         264
+#define IDS_GROUPBY_PENDING             385
 #define IDS_APPLICATIONBUTTON_NEW       265
 #define IDS_GENERAL_DISPLAYWINDOW_IMAGEWIDTH 266
 #define IDS_GENERAL_DISPLAYWINDOW_IMAGEHEIGHT 267
@@ -973,7 +974,7 @@
 // 
 #ifdef APSTUDIO_INVOKED
 #ifndef APSTUDIO_READONLY_SYMBOLS
-#define _APS_NEXT_RESOURCE_VALUE        385
+#define _APS_NEXT_RESOURCE_VALUE        386
 #define _APS_NEXT_COMMAND_VALUE         40544
 #define _APS_NEXT_CONTROL_VALUE         1356
 #define _APS_NEXT_SYMED_VALUE           101
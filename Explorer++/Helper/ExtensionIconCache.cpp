@@ -0,0 +1,143 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "ExtensionIconCache.h"
+#include <wil/resource.h>
+#include <Shlwapi.h>
+#include <algorithm>
+#include <cwctype>
+
+namespace
+{
+// Each of these extensions has an icon that's either stored within the file itself (e.g. .exe,
+// .ico) or determined by the file's contents (e.g. .lnk, .url, which reference a target). Icon
+// handlers for these types are generally registered, but this list is used to ensure they're
+// always treated as having per-file icons.
+constexpr std::wstring_view PER_FILE_ICON_EXTENSIONS[] = { L".exe", L".ico", L".cur", L".ani",
+	L".lnk", L".url", L".pif", L".scr", L".cpl", L".msc", L".appref-ms", L".website",
+	L".library-ms" };
+
+std::wstring ToLower(std::wstring_view text)
+{
+	std::wstring lowercaseText(text);
+	std::transform(lowercaseText.begin(), lowercaseText.end(), lowercaseText.begin(),
+		[](wchar_t c)
+		{
+			return static_cast<wchar_t>(std::towlower(c));
+		});
+	return lowercaseText;
+}
+}
+
+std::optional<int> ExtensionIconCache::GetIconIndex(std::wstring_view extension)
+{
+	if (extension.empty() || extension == L".")
+	{
+		return std::nullopt;
+	}
+
+	std::wstring lowercaseExtension = ToLower(extension);
+	auto itr = m_iconIndexes.find(lowercaseExtension);
+
+	if (itr != m_iconIndexes.end())
+	{
+		return itr->second;
+	}
+
+	std::optional<int> iconIndex;
+
+	if (!DoesExtensionHavePerFileIcons(lowercaseExtension))
+	{
+		iconIndex = RetrieveIconIndex(lowercaseExtension);
+	}
+
+	m_iconIndexes.insert({ lowercaseExtension, iconIndex });
+
+	return iconIndex;
+}
+
+void ExtensionIconCache::Clear()
+{
+	m_iconIndexes.clear();
+}
+
+bool ExtensionIconCache::IsKnownPerFileIconExtension(std::wstring_view extension)
+{
+	std::wstring lowercaseExtension = ToLower(extension);
+
+	return std::find(std::begin(PER_FILE_ICON_EXTENSIONS), std::end(PER_FILE_ICON_EXTENSIONS),
+			   lowercaseExtension)
+		!= std::end(PER_FILE_ICON_EXTENSIONS);
+}
+
+bool ExtensionIconCache::DoesExtensionHavePerFileIcons(const std::wstring &extension)
+{
+	if (IsKnownPerFileIconExtension(extension))
+	{
+		return true;
+	}
+
+	// A DefaultIcon value of "%1" indicates that the icon is stored in the file itself.
+	wchar_t defaultIcon[MAX_PATH];
+	DWORD defaultIconSize = static_cast<DWORD>(std::size(defaultIcon));
+	HRESULT hr = AssocQueryString(ASSOCF_NONE, ASSOCSTR_DEFAULTICON, extension.c_str(), nullptr,
+		defaultIcon, &defaultIconSize);
+
+	if (SUCCEEDED(hr) && std::wstring_view(defaultIcon).find(L"%1") != std::wstring_view::npos)
+	{
+		return true;
+	}
+
+	return IsIconHandlerRegistered(extension);
+}
+
+// An icon handler can return a different icon for each file, so if one is registered, the icon
+// can't be shared between files.
+bool ExtensionIconCache::IsIconHandlerRegistered(const std::wstring &extension)
+{
+	const std::wstring iconHandlerSubKey = L"ShellEx\\IconHandler";
+
+	for (const auto &keyPath : { extension + L"\\" + iconHandlerSubKey,
+			 L"SystemFileAssociations\\" + extension + L"\\" + iconHandlerSubKey })
+	{
+		wil::unique_hkey key;
+		LSTATUS res = RegOpenKeyEx(HKEY_CLASSES_ROOT, keyPath.c_str(), 0, KEY_READ, &key);
+
+		if (res == ERROR_SUCCESS)
+		{
+			return true;
+		}
+	}
+
+	wil::unique_hkey classKey;
+	HRESULT hr = AssocQueryKey(ASSOCF_NONE, ASSOCKEY_CLASS, extension.c_str(), nullptr, &classKey);
+
+	if (FAILED(hr))
+	{
+		return false;
+	}
+
+	wil::unique_hkey iconHandlerKey;
+	LSTATUS res =
+		RegOpenKeyEx(classKey.get(), iconHandlerSubKey.c_str(), 0, KEY_READ, &iconHandlerKey);
+
+	return res == ERROR_SUCCESS;
+}
+
+std::optional<int> ExtensionIconCache::RetrieveIconIndex(const std::wstring &extension)
+{
+	// Since SHGFI_USEFILEATTRIBUTES is specified, the file doesn't need to exist. The icon is
+	// retrieved purely from the extension, without any disk access.
+	SHFILEINFO shfi;
+	DWORD_PTR res = SHGetFileInfo(extension.c_str(), FILE_ATTRIBUTE_NORMAL, &shfi, sizeof(shfi),
+		SHGFI_USEFILEATTRIBUTES | SHGFI_SYSICONINDEX);
+
+	if (res == 0)
+	{
+		return std::nullopt;
+	}
+
+	return shfi.iIcon;
+}
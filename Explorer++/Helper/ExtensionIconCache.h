@@ -0,0 +1,46 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+// Files with most extensions all share the same icon (e.g. every .txt file has the same icon). For
+// those extensions, the icon only needs to be retrieved once, rather than once for every file,
+// which is what this class caches.
+//
+// Only the base icon is cached. Overlays are set on a per-file basis and need to be retrieved
+// separately.
+//
+// This class should only be used from the main thread.
+class ExtensionIconCache
+{
+public:
+	// The extension should include the leading period (e.g. ".txt"). Returns std::nullopt if files
+	// with the extension can each have their own icon, in which case each file will need to be
+	// queried individually. That's also the case for files with no extension (i.e. an empty
+	// extension, or just a period), since those files aren't associated with a single type.
+	std::optional<int> GetIconIndex(std::wstring_view extension);
+
+	// Should be called if file associations change, since the icon for an extension may have
+	// changed as well.
+	void Clear();
+
+	// Returns true for extensions that are known to have per-file icons, regardless of what's
+	// registered on the system. For example, the icon for an .exe file is embedded in the file
+	// itself.
+	static bool IsKnownPerFileIconExtension(std::wstring_view extension);
+
+private:
+	static bool DoesExtensionHavePerFileIcons(const std::wstring &extension);
+	static bool IsIconHandlerRegistered(const std::wstring &extension);
+	static std::optional<int> RetrieveIconIndex(const std::wstring &extension);
+
+	// Extensions are stored in lowercase. A value of std::nullopt indicates that the extension
+	// has per-file icons.
+	std::unordered_map<std::wstring, std::optional<int>> m_iconIndexes;
+};
@@ -6,13 +6,18 @@
 #include "FolderSize.h"
 #include <filesystem>
 
-FolderInfo GetFolderInfo(const std::wstring &path)
+FolderInfo GetFolderInfo(const std::wstring &path, std::stop_token stopToken)
 {
 	FolderInfo folderInfo = {};
 	std::error_code error;
 
 	for (const auto &entry : std::filesystem::directory_iterator(path, error))
 	{
+		if (stopToken.stop_requested())
+		{
+			break;
+		}
+
 		std::error_code typeErrorCode;
 		auto isDirectory = entry.is_directory(typeErrorCode);
 
@@ -25,7 +30,7 @@ FolderInfo GetFolderInfo(const std::wstring &path)
 		{
 			folderInfo.numFolders++;
 
-			FolderInfo subFolderInfo = GetFolderInfo(entry.path());
+			FolderInfo subFolderInfo = GetFolderInfo(entry.path(), stopToken);
 
 			folderInfo.size += subFolderInfo.size;
 			folderInfo.numFolders += subFolderInfo.numFolders;
@@ -4,6 +4,8 @@
 
 #pragma once
 
+#include <stop_token>
+
 struct FolderInfo
 {
 	std::uintmax_t size;
@@ -11,7 +13,9 @@ struct FolderInfo
 	int numFiles;
 };
 
-FolderInfo GetFolderInfo(const std::wstring &path);
+// Recursively calculates the size of the specified folder. If a stop is requested, the calculation
+// will end early and the information returned will be incomplete.
+FolderInfo GetFolderInfo(const std::wstring &path, std::stop_token stopToken = {});
 
 typedef struct
 {
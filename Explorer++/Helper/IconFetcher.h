@@ -4,16 +4,10 @@
 
 #pragma once
 
-#include "ShellHelper.h"
-#include "../ThirdParty/CTPL/cpl_stl.h"
+#include "IconService.h"
 #include <ShlObj.h>
 #include <functional>
-#include <future>
-#include <optional>
-#include <unordered_map>
-
-class CachedIcons;
-class WindowSubclassWrapper;
+#include <unordered_set>
 
 class IconFetcherInterface
 {
@@ -25,60 +19,29 @@ public:
 	virtual void ClearQueue() = 0;
 };
 
+// Queues icon requests with the shared IconService on behalf of a single component. Outstanding
+// requests are tracked, so that they can be cancelled as a group (e.g. when a tab navigates to a
+// different folder). Any requests that are still outstanding when the instance is destroyed are
+// cancelled, so callbacks will never be invoked after that point.
 class IconFetcher : public IconFetcherInterface
 {
 public:
-	IconFetcher(HWND hwnd, CachedIcons *cachedIcons);
+	IconFetcher(IconService *iconService, IconPriority defaultPriority = IconPriority::Normal);
 	virtual ~IconFetcher();
 
 	void QueueIconTask(std::wstring_view path, Callback callback) override;
 	void QueueIconTask(PCIDLIST_ABSOLUTE pidl, Callback callback) override;
+	void QueueIconTask(PCIDLIST_ABSOLUTE pidl, IconPriority priority, Callback callback);
+
+	// The callback will be passed the overlay index for the item (which will be 0 if the item has
+	// no overlay).
+	void QueueOverlayTask(PCIDLIST_ABSOLUTE pidl, IconPriority priority, Callback callback);
 	void ClearQueue() override;
 
 private:
-	// This is the end of the range that starts at WM_APP. This class subclasses the window that's
-	// passed to the constructor, so it's not possible to tell what other WM_APP messages are in
-	// use. To try to avoid clashes with other messages sent throughout the application, the last
-	// value in the range will be used.
-	static const UINT WM_APP_ICON_RESULT_READY = 0xBFFF;
-
-	struct BasicItemInfo
-	{
-		BasicItemInfo() = default;
-
-		BasicItemInfo(const BasicItemInfo &other)
-		{
-			pidl.reset(ILCloneFull(other.pidl.get()));
-		}
-
-		unique_pidl_absolute pidl;
-	};
-
-	struct IconResult
-	{
-		int iconIndex;
-		std::wstring path;
-	};
-
-	struct FutureResult
-	{
-		Callback callback;
-		std::future<std::optional<IconResult>> iconResult;
-	};
-
-	static LRESULT CALLBACK WindowSubclassStub(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam,
-		UINT_PTR uIdSubclass, DWORD_PTR dwRefData);
-	LRESULT CALLBACK WindowSubclass(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam);
-
-	static std::optional<int> FindIconAsync(PCIDLIST_ABSOLUTE pidl);
-	void ProcessIconResult(int iconResultId);
-
-	const HWND m_hwnd;
-	std::vector<std::unique_ptr<WindowSubclassWrapper>> m_windowSubclasses;
+	IconService::Callback WrapCallback(std::shared_ptr<int> requestId, Callback callback);
 
-	ctpl::thread_pool m_iconThreadPool;
-	std::unordered_map<int, FutureResult> m_iconResults;
-	int m_iconResultIDCounter;
-	CachedIcons *m_cachedIcons;
-	std::function<void(int data)> m_callback;
+	IconService *const m_iconService;
+	const IconPriority m_defaultPriority;
+	std::unordered_set<int> m_requestIds;
 };
@@ -0,0 +1,390 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "IconService.h"
+#include "CachedIcons.h"
+#include "WindowSubclassWrapper.h"
+#include <wil/com.h>
+
+IconService::IconService(HWND hwnd, CachedIcons *cachedIcons, int numThreads) :
+	m_hwnd(hwnd),
+	m_cachedIcons(cachedIcons)
+{
+	m_windowSubclasses.push_back(std::make_unique<WindowSubclassWrapper>(hwnd, WindowSubclassStub,
+		reinterpret_cast<DWORD_PTR>(this)));
+
+	numThreads = max(numThreads, 1);
+
+	for (int i = 0; i < numThreads; i++)
+	{
+		m_threads.emplace_back(&IconService::RunWorker, this);
+	}
+}
+
+IconService::~IconService()
+{
+	{
+		std::scoped_lock lock(m_mutex);
+		m_queue.clear();
+		m_stopping = true;
+	}
+
+	m_taskAvailable.notify_all();
+
+	// It's not possible to cancel an icon lookup that's already running, so this will wait for any
+	// running lookups to finish. As this class exists for the lifetime of the application, that
+	// will only happen at shutdown.
+	for (auto &thread : m_threads)
+	{
+		thread.join();
+	}
+}
+
+LRESULT CALLBACK IconService::WindowSubclassStub(HWND hwnd, UINT uMsg, WPARAM wParam,
+	LPARAM lParam, UINT_PTR uIdSubclass, DWORD_PTR dwRefData)
+{
+	UNREFERENCED_PARAMETER(uIdSubclass);
+
+	auto *iconService = reinterpret_cast<IconService *>(dwRefData);
+
+	return iconService->WindowSubclass(hwnd, uMsg, wParam, lParam);
+}
+
+LRESULT CALLBACK IconService::WindowSubclass(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
+{
+	switch (msg)
+	{
+	case WM_APP_ICON_RESULT_READY:
+		ProcessIconResult(static_cast<int>(wParam));
+		return 0;
+	}
+
+	return DefSubclassProc(hwnd, msg, wParam, lParam);
+}
+
+int IconService::QueueIconTask(std::wstring_view path, IconPriority priority, Callback callback)
+{
+	return QueueTask(BuildTaskKey(path), TaskType::Icon, std::wstring(path), nullptr, priority,
+		std::move(callback));
+}
+
+int IconService::QueueIconTask(PCIDLIST_ABSOLUTE pidl, IconPriority priority, Callback callback)
+{
+	return QueueTask(BuildTaskKey(pidl, TaskType::Icon), TaskType::Icon, {},
+		unique_pidl_absolute(ILCloneFull(pidl)), priority, std::move(callback));
+}
+
+int IconService::QueueOverlayTask(PCIDLIST_ABSOLUTE pidl, IconPriority priority, Callback callback)
+{
+	return QueueTask(BuildTaskKey(pidl, TaskType::Overlay), TaskType::Overlay, {},
+		unique_pidl_absolute(ILCloneFull(pidl)), priority, std::move(callback));
+}
+
+int IconService::QueueTask(std::string key, TaskType type, std::wstring path,
+	unique_pidl_absolute pidl, IconPriority priority, Callback callback)
+{
+	int requestId = m_requestIdCounter++;
+	m_requests.insert({ requestId, { key, std::move(callback) } });
+
+	{
+		std::scoped_lock lock(m_mutex);
+
+		auto itr = m_tasks.find(key);
+
+		if (itr != m_tasks.end())
+		{
+			// There's already a task for this item, so the result of that task will be used for
+			// this request as well.
+			auto &existingTask = itr->second;
+			existingTask.requestIds.push_back(requestId);
+
+			if (!existingTask.running && priority > existingTask.priority)
+			{
+				m_queue.erase(BuildQueueKey(existingTask));
+				existingTask.priority = priority;
+				m_queue.insert({ BuildQueueKey(existingTask), key });
+			}
+
+			return requestId;
+		}
+
+		Task task;
+		task.type = type;
+		task.path = std::move(path);
+		task.pidl = std::move(pidl);
+		task.priority = priority;
+		task.sequenceNumber = m_sequenceNumber++;
+		task.requestIds.push_back(requestId);
+
+		m_queue.insert({ BuildQueueKey(task), key });
+		m_tasks.insert({ std::move(key), std::move(task) });
+	}
+
+	m_taskAvailable.notify_one();
+
+	return requestId;
+}
+
+void IconService::CancelRequest(int requestId)
+{
+	auto requestItr = m_requests.find(requestId);
+
+	// The request may have already completed.
+	if (requestItr == m_requests.end())
+	{
+		return;
+	}
+
+	std::string taskKey = std::move(requestItr->second.taskKey);
+	m_requests.erase(requestItr);
+
+	std::scoped_lock lock(m_mutex);
+
+	auto taskItr = m_tasks.find(taskKey);
+
+	if (taskItr == m_tasks.end())
+	{
+		return;
+	}
+
+	auto &task = taskItr->second;
+	std::erase(task.requestIds, requestId);
+
+	if (task.requestIds.empty() && !task.running)
+	{
+		m_queue.erase(BuildQueueKey(task));
+		m_tasks.erase(taskItr);
+	}
+}
+
+std::string IconService::BuildTaskKey(std::wstring_view path)
+{
+	std::string key = "S";
+	key.append(reinterpret_cast<const char *>(path.data()), path.size() * sizeof(wchar_t));
+	return key;
+}
+
+std::string IconService::BuildTaskKey(PCIDLIST_ABSOLUTE pidl, TaskType type)
+{
+	std::string key = (type == TaskType::Icon) ? "P" : "O";
+	key.append(reinterpret_cast<const char *>(pidl), ILGetSize(pidl));
+	return key;
+}
+
+IconService::QueueKey IconService::BuildQueueKey(const Task &task)
+{
+	return { -static_cast<int>(task.priority), task.sequenceNumber };
+}
+
+void IconService::RunWorker()
+{
+	CoInitializeEx(nullptr, COINIT_APARTMENTTHREADED);
+
+	while (true)
+	{
+		std::string key;
+		TaskType type;
+		std::wstring path;
+		unique_pidl_absolute pidl;
+
+		{
+			std::unique_lock lock(m_mutex);
+			m_taskAvailable.wait(lock,
+				[this]
+				{
+					return m_stopping || !m_queue.empty();
+				});
+
+			if (m_stopping)
+			{
+				break;
+			}
+
+			auto queueItr = m_queue.begin();
+			key = std::move(queueItr->second);
+			m_queue.erase(queueItr);
+
+			auto &task = m_tasks.at(key);
+			task.running = true;
+			type = task.type;
+			path = task.path;
+
+			if (task.pidl)
+			{
+				pidl.reset(ILCloneFull(task.pidl.get()));
+			}
+		}
+
+		IconResult result;
+
+		if (type == TaskType::Overlay)
+		{
+			result.iconIndex = FindOverlay(pidl.get());
+		}
+		else
+		{
+			result = RetrieveIcon(path, pidl.get());
+		}
+
+		result.type = type;
+		int iconResultId;
+
+		{
+			std::scoped_lock lock(m_mutex);
+
+			if (m_stopping)
+			{
+				break;
+			}
+
+			// Any requests that were merged into this task while it was running will be included
+			// here.
+			auto taskItr = m_tasks.find(key);
+			result.requestIds = std::move(taskItr->second.requestIds);
+			m_tasks.erase(taskItr);
+
+			iconResultId = m_iconResultIdCounter++;
+			m_iconResults.insert({ iconResultId, std::move(result) });
+		}
+
+		PostMessage(m_hwnd, WM_APP_ICON_RESULT_READY, iconResultId, 0);
+	}
+
+	CoUninitialize();
+}
+
+IconService::IconResult IconService::RetrieveIcon(const std::wstring &path,
+	PCIDLIST_ABSOLUTE pidl)
+{
+	IconResult result;
+	result.path = path;
+
+	unique_pidl_absolute parsedPidl;
+
+	if (!pidl)
+	{
+		// SHGetFileInfo will fail for non-filesystem paths that are passed in as strings. For
+		// example, attempting to retrieve the icon for the recycle bin will fail if you pass the
+		// parsing path (i.e. ::{645FF040-5081-101B-9F08-00AA002F954E}). If, however, you pass the
+		// pidl, the function will succeed. Therefore, paths will always be converted to pidls
+		// first here.
+		HRESULT hr =
+			SHParseDisplayName(path.c_str(), nullptr, wil::out_param(parsedPidl), 0, nullptr);
+
+		if (FAILED(hr))
+		{
+			return result;
+		}
+
+		pidl = parsedPidl.get();
+	}
+
+	result.iconIndex = FindIcon(pidl);
+
+	if (result.iconIndex && result.path.empty())
+	{
+		std::wstring parsingPath;
+		HRESULT hr = GetDisplayName(pidl, SHGDN_FORPARSING, parsingPath);
+
+		if (SUCCEEDED(hr))
+		{
+			result.path = parsingPath;
+		}
+	}
+
+	return result;
+}
+
+std::optional<int> IconService::FindIcon(PCIDLIST_ABSOLUTE pidl)
+{
+	// Must use SHGFI_ICON here, rather than SHGFO_SYSICONINDEX, or else
+	// icon overlays won't be applied.
+	SHFILEINFO shfi;
+	DWORD_PTR res = SHGetFileInfo(reinterpret_cast<LPCTSTR>(pidl), 0, &shfi, sizeof(shfi),
+		SHGFI_PIDL | SHGFI_ICON | SHGFI_OVERLAYINDEX);
+
+	if (res == 0)
+	{
+		return std::nullopt;
+	}
+
+	DestroyIcon(shfi.hIcon);
+
+	return shfi.iIcon;
+}
+
+std::optional<int> IconService::FindOverlay(PCIDLIST_ABSOLUTE pidl)
+{
+	wil::com_ptr_nothrow<IShellFolder> parent;
+	PCITEMID_CHILD child;
+	HRESULT hr = SHBindToParent(pidl, IID_PPV_ARGS(&parent), &child);
+
+	if (FAILED(hr))
+	{
+		return std::nullopt;
+	}
+
+	auto iconOverlay = parent.try_query<IShellIconOverlay>();
+
+	// Not every folder supports overlays, in which case none of the items in the folder will have
+	// one.
+	if (!iconOverlay)
+	{
+		return 0;
+	}
+
+	int overlayIndex = OI_DEFAULT;
+	hr = iconOverlay->GetOverlayIndex(child, &overlayIndex);
+
+	// S_FALSE is returned if the item has no overlay.
+	if (hr != S_OK)
+	{
+		return 0;
+	}
+
+	return overlayIndex;
+}
+
+void IconService::ProcessIconResult(int iconResultId)
+{
+	IconResult result;
+
+	{
+		std::scoped_lock lock(m_mutex);
+
+		auto itr = m_iconResults.find(iconResultId);
+
+		if (itr == m_iconResults.end())
+		{
+			return;
+		}
+
+		result = std::move(itr->second);
+		m_iconResults.erase(itr);
+	}
+
+	if (result.type == TaskType::Icon && result.iconIndex && !result.path.empty())
+	{
+		m_cachedIcons->addOrUpdateFileIcon(result.path, *result.iconIndex);
+	}
+
+	for (int requestId : result.requestIds)
+	{
+		auto requestItr = m_requests.find(requestId);
+
+		// The request may have been cancelled while the icon was being retrieved.
+		if (requestItr == m_requests.end())
+		{
+			continue;
+		}
+
+		// The callback is removed before being invoked, since the callback may itself queue or
+		// cancel requests.
+		auto callback = std::move(requestItr->second.callback);
+		m_requests.erase(requestItr);
+
+		callback(result.iconIndex);
+	}
+}
@@ -0,0 +1,148 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include "ShellHelper.h"
+#include <ShlObj.h>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+class CachedIcons;
+class WindowSubclassWrapper;
+
+enum class IconPriority
+{
+	Low,
+	Normal,
+
+	// Used for items that are currently visible to the user (e.g. the visible rows in the active
+	// tab).
+	High
+};
+
+// Retrieves system image list icon indexes on a pool of worker threads that's shared by the whole
+// application. Requests for the same item that are made while an icon is still being retrieved are
+// merged, so that the icon is only retrieved once, with the result then being passed to every
+// requester. Queued requests are run in order of priority.
+//
+// Overlays can also be retrieved on their own, which is useful for items whose base icon is
+// already known (e.g. because it's shared by every file with the same extension).
+//
+// All methods should be called from the thread that owns the window passed to the constructor.
+// Callbacks are invoked on that same thread.
+class IconService
+{
+public:
+	// For icon requests, the result is the icon index (with any overlay index stored in the upper
+	// eight bits). For overlay requests, the result is the overlay index, which will be 0 if the
+	// item has no overlay. If the lookup fails, the callback is still invoked, but with no result,
+	// so that the caller knows the request has finished.
+	using Callback = std::function<void(std::optional<int> result)>;
+
+	IconService(HWND hwnd, CachedIcons *cachedIcons, int numThreads);
+	~IconService();
+
+	// Each of these methods returns an ID that can be passed to CancelRequest().
+	int QueueIconTask(std::wstring_view path, IconPriority priority, Callback callback);
+	int QueueIconTask(PCIDLIST_ABSOLUTE pidl, IconPriority priority, Callback callback);
+	int QueueOverlayTask(PCIDLIST_ABSOLUTE pidl, IconPriority priority, Callback callback);
+
+	// Once a request has been cancelled, its callback won't be invoked. If there are no other
+	// requests for the same item and the icon hasn't started to be retrieved yet, the task is
+	// dropped.
+	void CancelRequest(int requestId);
+
+private:
+	// This is the end of the range that starts at WM_APP. This class subclasses the window that's
+	// passed to the constructor, so it's not possible to tell what other WM_APP messages are in
+	// use. To try to avoid clashes with other messages sent throughout the application, the last
+	// value in the range will be used.
+	static const UINT WM_APP_ICON_RESULT_READY = 0xBFFF;
+
+	enum class TaskType
+	{
+		Icon,
+		Overlay
+	};
+
+	// Tasks are identified by a key that's built from the task type and the path or PIDL being
+	// requested.
+	struct Task
+	{
+		TaskType type;
+		std::wstring path;
+		unique_pidl_absolute pidl;
+		IconPriority priority;
+		uint64_t sequenceNumber;
+		bool running = false;
+		std::vector<int> requestIds;
+	};
+
+	struct Request
+	{
+		std::string taskKey;
+		Callback callback;
+	};
+
+	struct IconResult
+	{
+		TaskType type = TaskType::Icon;
+
+		// For overlay tasks, this is the overlay index.
+		std::optional<int> iconIndex;
+		std::wstring path;
+		std::vector<int> requestIds;
+	};
+
+	// Orders queued tasks so that the highest priority task comes first, with tasks of equal
+	// priority being run in the order they were queued.
+	using QueueKey = std::pair<int, uint64_t>;
+
+	static LRESULT CALLBACK WindowSubclassStub(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam,
+		UINT_PTR uIdSubclass, DWORD_PTR dwRefData);
+	LRESULT CALLBACK WindowSubclass(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam);
+
+	static std::string BuildTaskKey(std::wstring_view path);
+	static std::string BuildTaskKey(PCIDLIST_ABSOLUTE pidl, TaskType type);
+	static QueueKey BuildQueueKey(const Task &task);
+
+	int QueueTask(std::string key, TaskType type, std::wstring path, unique_pidl_absolute pidl,
+		IconPriority priority, Callback callback);
+	void RunWorker();
+	static IconResult RetrieveIcon(const std::wstring &path, PCIDLIST_ABSOLUTE pidl);
+	static std::optional<int> FindIcon(PCIDLIST_ABSOLUTE pidl);
+	static std::optional<int> FindOverlay(PCIDLIST_ABSOLUTE pidl);
+	void ProcessIconResult(int iconResultId);
+
+	const HWND m_hwnd;
+	std::vector<std::unique_ptr<WindowSubclassWrapper>> m_windowSubclasses;
+	CachedIcons *const m_cachedIcons;
+
+	// Only accessed on the main thread.
+	std::unordered_map<int, Request> m_requests;
+	int m_requestIdCounter = 0;
+
+	std::vector<std::thread> m_threads;
+
+	// The members below are shared with the worker threads and protected by m_mutex. Each task
+	// remains in m_tasks until it's finished running, so that later requests for the same item can
+	// be merged into it.
+	std::mutex m_mutex;
+	std::condition_variable m_taskAvailable;
+	std::unordered_map<std::string, Task> m_tasks;
+	std::map<QueueKey, std::string> m_queue;
+	std::unordered_map<int, IconResult> m_iconResults;
+	uint64_t m_sequenceNumber = 0;
+	int m_iconResultIdCounter = 0;
+	bool m_stopping = false;
+};
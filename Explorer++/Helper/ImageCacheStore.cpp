@@ -0,0 +1,496 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "ImageCacheStore.h"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <tuple>
+
+namespace
+{
+
+size_t AlignUp(size_t value, size_t alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+}
+
+ImageCacheStore::ImageCacheStore(std::span<const std::byte> data, size_t pendingThumbnailBudget) :
+	m_pendingThumbnailBudget(pendingThumbnailBudget)
+{
+	static_assert(sizeof(Header) == 32);
+	static_assert(sizeof(EntryRecord) == 64);
+
+	if (data.size() < sizeof(Header))
+	{
+		return;
+	}
+
+	Header header;
+	std::memcpy(&header, data.data(), sizeof(header));
+
+	if (header.magic != MAGIC || header.version != VERSION || header.totalSize != data.size())
+	{
+		return;
+	}
+
+	if (header.numEntries > (data.size() - sizeof(Header)) / sizeof(EntryRecord))
+	{
+		return;
+	}
+
+	// The entry table, paths and thumbnails are all read directly from the data, so it needs to be
+	// suitably aligned. That will always be the case for a memory-mapped file.
+	if (reinterpret_cast<uintptr_t>(data.data()) % alignof(EntryRecord) != 0)
+	{
+		return;
+	}
+
+	m_data = data;
+	m_generation = header.generation;
+	m_numEntries = static_cast<size_t>(header.numEntries);
+}
+
+std::optional<int> ImageCacheStore::GetOverlayIndex(const ImageCacheKey &key)
+{
+	const auto *pendingEntry = FindPendingEntry(key);
+
+	if (pendingEntry && pendingEntry->overlayIndex)
+	{
+		return pendingEntry->overlayIndex;
+	}
+
+	auto existingEntry = pendingEntry ? pendingEntry->existingEntry : FindEntry(key);
+
+	if (!existingEntry)
+	{
+		return std::nullopt;
+	}
+
+	m_usedEntries.insert(*existingEntry);
+
+	const auto &entry = GetEntry(*existingEntry);
+
+	if (entry.overlayIndex == NO_OVERLAY_INDEX)
+	{
+		return std::nullopt;
+	}
+
+	return entry.overlayIndex;
+}
+
+std::optional<ImageCacheThumbnail> ImageCacheStore::GetThumbnail(const ImageCacheKey &key)
+{
+	const auto *pendingEntry = FindPendingEntry(key);
+
+	if (pendingEntry && pendingEntry->thumbnail)
+	{
+		const auto &thumbnail = *pendingEntry->thumbnail;
+		m_pendingThumbnailOrder.splice(m_pendingThumbnailOrder.begin(), m_pendingThumbnailOrder,
+			thumbnail.orderItr);
+		return ImageCacheThumbnail{ thumbnail.width, thumbnail.height, thumbnail.pixels };
+	}
+
+	auto existingEntry = pendingEntry ? pendingEntry->existingEntry : FindEntry(key);
+
+	if (!existingEntry)
+	{
+		return std::nullopt;
+	}
+
+	m_usedEntries.insert(*existingEntry);
+
+	return ReadEntryThumbnail(GetEntry(*existingEntry));
+}
+
+void ImageCacheStore::SetOverlayIndex(const ImageCacheKey &key, int overlayIndex)
+{
+	GetOrCreatePendingEntry(key).overlayIndex = overlayIndex;
+}
+
+void ImageCacheStore::SetThumbnail(const ImageCacheKey &key, uint32_t width, uint32_t height,
+	std::vector<uint32_t> pixels)
+{
+	assert(pixels.size() == static_cast<size_t>(width) * height);
+
+	auto &pendingEntry = GetOrCreatePendingEntry(key);
+	DiscardPendingThumbnail(pendingEntry);
+
+	m_pendingThumbnailOrder.push_front(key.path);
+	m_pendingThumbnailBytes += pixels.size() * sizeof(uint32_t);
+	pendingEntry.thumbnail = { width, height, std::move(pixels), m_pendingThumbnailOrder.begin() };
+
+	EvictPendingThumbnails();
+}
+
+std::vector<std::byte> ImageCacheStore::Serialize(size_t byteBudget) const
+{
+	struct OutputEntry
+	{
+		std::wstring path;
+		uint64_t pathHash;
+		uint64_t fileSize;
+		uint64_t lastWriteTime;
+		uint64_t generation;
+		int32_t overlayIndex = NO_OVERLAY_INDEX;
+		std::optional<ImageCacheThumbnail> thumbnail;
+	};
+
+	uint64_t newGeneration = m_generation + 1;
+	std::vector<OutputEntry> outputEntries;
+
+	for (const auto &[path, pendingEntry] : m_pendingEntries)
+	{
+		OutputEntry outputEntry;
+		outputEntry.path = path;
+		outputEntry.fileSize = pendingEntry.fileSize;
+		outputEntry.lastWriteTime = pendingEntry.lastWriteTime;
+		outputEntry.generation = newGeneration;
+
+		if (pendingEntry.existingEntry)
+		{
+			const auto &entry = GetEntry(*pendingEntry.existingEntry);
+			outputEntry.overlayIndex = entry.overlayIndex;
+			outputEntry.thumbnail = ReadEntryThumbnail(entry);
+		}
+
+		if (pendingEntry.overlayIndex)
+		{
+			outputEntry.overlayIndex = *pendingEntry.overlayIndex;
+		}
+
+		if (pendingEntry.thumbnail)
+		{
+			const auto &thumbnail = *pendingEntry.thumbnail;
+			outputEntry.thumbnail = { thumbnail.width, thumbnail.height, thumbnail.pixels };
+		}
+
+		outputEntries.push_back(std::move(outputEntry));
+	}
+
+	for (size_t i = 0; i < m_numEntries; i++)
+	{
+		const auto &entry = GetEntry(i);
+		auto path = ReadEntryPath(entry);
+
+		// Entries that are invalid, or that have been superseded by a change in this session, are
+		// dropped.
+		if (!path || m_pendingEntries.contains(*path))
+		{
+			continue;
+		}
+
+		OutputEntry outputEntry;
+		outputEntry.path = std::move(*path);
+		outputEntry.fileSize = entry.fileSize;
+		outputEntry.lastWriteTime = entry.lastWriteTime;
+		outputEntry.generation = m_usedEntries.contains(i) ? newGeneration : entry.generation;
+		outputEntry.overlayIndex = entry.overlayIndex;
+		outputEntry.thumbnail = ReadEntryThumbnail(entry);
+		outputEntries.push_back(std::move(outputEntry));
+	}
+
+	auto getEntrySize = [](const OutputEntry &outputEntry)
+	{
+		size_t size = sizeof(EntryRecord) + AlignUp(outputEntry.path.size() * sizeof(uint16_t), 4);
+
+		if (outputEntry.thumbnail)
+		{
+			size += outputEntry.thumbnail->pixels.size_bytes();
+		}
+
+		return size;
+	};
+
+	// All offsets are stored as 32-bit values.
+	if (byteBudget > UINT32_MAX)
+	{
+		byteBudget = UINT32_MAX;
+	}
+
+	// The most recently used entries are retained first.
+	std::stable_sort(outputEntries.begin(), outputEntries.end(),
+		[](const OutputEntry &outputEntry1, const OutputEntry &outputEntry2)
+		{
+			return outputEntry1.generation > outputEntry2.generation;
+		});
+
+	size_t totalSize = sizeof(Header);
+	size_t numRetainedEntries = 0;
+
+	for (; numRetainedEntries < outputEntries.size(); numRetainedEntries++)
+	{
+		size_t entrySize = getEntrySize(outputEntries[numRetainedEntries]);
+
+		if (totalSize + entrySize > byteBudget)
+		{
+			break;
+		}
+
+		totalSize += entrySize;
+	}
+
+	outputEntries.erase(outputEntries.begin() + numRetainedEntries, outputEntries.end());
+
+	// Entries are located using a binary search, so the entry table needs to be sorted.
+	for (auto &outputEntry : outputEntries)
+	{
+		outputEntry.pathHash = HashPath(outputEntry.path);
+	}
+
+	std::sort(outputEntries.begin(), outputEntries.end(),
+		[](const OutputEntry &outputEntry1, const OutputEntry &outputEntry2)
+		{
+			return std::tie(outputEntry1.pathHash, outputEntry1.fileSize,
+					   outputEntry1.lastWriteTime)
+				< std::tie(outputEntry2.pathHash, outputEntry2.fileSize,
+					outputEntry2.lastWriteTime);
+		});
+
+	std::vector<std::byte> data(totalSize);
+
+	Header header = {};
+	header.magic = MAGIC;
+	header.version = VERSION;
+	header.generation = newGeneration;
+	header.numEntries = outputEntries.size();
+	header.totalSize = totalSize;
+	std::memcpy(data.data(), &header, sizeof(header));
+
+	size_t dataOffset = sizeof(Header) + outputEntries.size() * sizeof(EntryRecord);
+
+	for (size_t i = 0; i < outputEntries.size(); i++)
+	{
+		const auto &outputEntry = outputEntries[i];
+
+		EntryRecord record = {};
+		record.pathHash = outputEntry.pathHash;
+		record.fileSize = outputEntry.fileSize;
+		record.lastWriteTime = outputEntry.lastWriteTime;
+		record.generation = outputEntry.generation;
+		record.overlayIndex = outputEntry.overlayIndex;
+
+		record.pathOffset = static_cast<uint32_t>(dataOffset);
+		record.pathLength = static_cast<uint32_t>(outputEntry.path.size());
+
+		for (wchar_t c : outputEntry.path)
+		{
+			auto codeUnit = static_cast<uint16_t>(c);
+			std::memcpy(data.data() + dataOffset, &codeUnit, sizeof(codeUnit));
+			dataOffset += sizeof(codeUnit);
+		}
+
+		dataOffset = AlignUp(dataOffset, 4);
+
+		if (outputEntry.thumbnail)
+		{
+			const auto &thumbnail = *outputEntry.thumbnail;
+			record.thumbnailOffset = static_cast<uint32_t>(dataOffset);
+			record.thumbnailWidth = thumbnail.width;
+			record.thumbnailHeight = thumbnail.height;
+
+			std::memcpy(data.data() + dataOffset, thumbnail.pixels.data(),
+				thumbnail.pixels.size_bytes());
+			dataOffset += thumbnail.pixels.size_bytes();
+		}
+
+		std::memcpy(data.data() + sizeof(Header) + i * sizeof(EntryRecord), &record,
+			sizeof(record));
+	}
+
+	assert(dataOffset == totalSize);
+
+	return data;
+}
+
+// FNV-1a, applied to the UTF-16 code units in the path.
+uint64_t ImageCacheStore::HashPath(const std::wstring &path)
+{
+	uint64_t hash = 14695981039346656037ULL;
+
+	for (wchar_t c : path)
+	{
+		auto codeUnit = static_cast<uint16_t>(c);
+		hash = (hash ^ (codeUnit & 0xFF)) * 1099511628211ULL;
+		hash = (hash ^ (codeUnit >> 8)) * 1099511628211ULL;
+	}
+
+	return hash;
+}
+
+std::optional<size_t> ImageCacheStore::FindEntry(const ImageCacheKey &key) const
+{
+	auto keyTuple = std::make_tuple(HashPath(key.path), key.fileSize, key.lastWriteTime);
+
+	size_t first = 0;
+	size_t count = m_numEntries;
+
+	while (count > 0)
+	{
+		size_t step = count / 2;
+		const auto &entry = GetEntry(first + step);
+
+		if (std::tie(entry.pathHash, entry.fileSize, entry.lastWriteTime) < keyTuple)
+		{
+			first += step + 1;
+			count -= step + 1;
+		}
+		else
+		{
+			count = step;
+		}
+	}
+
+	// Different paths can have the same hash, so each of the matching entries is checked.
+	for (size_t i = first; i < m_numEntries; i++)
+	{
+		const auto &entry = GetEntry(i);
+
+		if (std::tie(entry.pathHash, entry.fileSize, entry.lastWriteTime) != keyTuple)
+		{
+			break;
+		}
+
+		if (ReadEntryPath(entry) == key.path)
+		{
+			return i;
+		}
+	}
+
+	return std::nullopt;
+}
+
+const ImageCacheStore::EntryRecord &ImageCacheStore::GetEntry(size_t index) const
+{
+	assert(index < m_numEntries);
+
+	return reinterpret_cast<const EntryRecord *>(m_data.data() + sizeof(Header))[index];
+}
+
+std::optional<std::wstring> ImageCacheStore::ReadEntryPath(const EntryRecord &entry) const
+{
+	size_t pathSize = static_cast<size_t>(entry.pathLength) * sizeof(uint16_t);
+
+	if (entry.pathOffset > m_data.size() || pathSize > m_data.size() - entry.pathOffset)
+	{
+		return std::nullopt;
+	}
+
+	std::wstring path;
+	path.reserve(entry.pathLength);
+
+	for (size_t i = 0; i < entry.pathLength; i++)
+	{
+		uint16_t codeUnit;
+		std::memcpy(&codeUnit, m_data.data() + entry.pathOffset + i * sizeof(codeUnit),
+			sizeof(codeUnit));
+		path.push_back(static_cast<wchar_t>(codeUnit));
+	}
+
+	return path;
+}
+
+std::optional<ImageCacheThumbnail> ImageCacheStore::ReadEntryThumbnail(
+	const EntryRecord &entry) const
+{
+	if (entry.thumbnailWidth == 0 || entry.thumbnailHeight == 0)
+	{
+		return std::nullopt;
+	}
+
+	uint64_t numPixels = static_cast<uint64_t>(entry.thumbnailWidth) * entry.thumbnailHeight;
+
+	if (entry.thumbnailOffset % alignof(uint32_t) != 0 || entry.thumbnailOffset > m_data.size()
+		|| numPixels > (m_data.size() - entry.thumbnailOffset) / sizeof(uint32_t))
+	{
+		return std::nullopt;
+	}
+
+	const auto *pixels = reinterpret_cast<const uint32_t *>(m_data.data() + entry.thumbnailOffset);
+	return ImageCacheThumbnail{ entry.thumbnailWidth, entry.thumbnailHeight,
+		{ pixels, static_cast<size_t>(numPixels) } };
+}
+
+ImageCacheStore::PendingEntry &ImageCacheStore::GetOrCreatePendingEntry(const ImageCacheKey &key)
+{
+	auto itr = m_pendingEntries.find(key.path);
+
+	if (itr != m_pendingEntries.end() && itr->second.fileSize == key.fileSize
+		&& itr->second.lastWriteTime == key.lastWriteTime)
+	{
+		return itr->second;
+	}
+
+	// If the file has changed since an earlier value was set, the earlier value is discarded.
+	if (itr != m_pendingEntries.end())
+	{
+		DiscardPendingThumbnail(itr->second);
+	}
+
+	PendingEntry pendingEntry;
+	pendingEntry.fileSize = key.fileSize;
+	pendingEntry.lastWriteTime = key.lastWriteTime;
+	pendingEntry.existingEntry = FindEntry(key);
+
+	return m_pendingEntries.insert_or_assign(key.path, std::move(pendingEntry)).first->second;
+}
+
+const ImageCacheStore::PendingEntry *ImageCacheStore::FindPendingEntry(
+	const ImageCacheKey &key) const
+{
+	auto itr = m_pendingEntries.find(key.path);
+
+	if (itr == m_pendingEntries.end() || itr->second.fileSize != key.fileSize
+		|| itr->second.lastWriteTime != key.lastWriteTime)
+	{
+		return nullptr;
+	}
+
+	return &itr->second;
+}
+
+void ImageCacheStore::DiscardPendingThumbnail(PendingEntry &pendingEntry)
+{
+	if (!pendingEntry.thumbnail)
+	{
+		return;
+	}
+
+	m_pendingThumbnailBytes -= pendingEntry.thumbnail->pixels.size() * sizeof(uint32_t);
+	m_pendingThumbnailOrder.erase(pendingEntry.thumbnail->orderItr);
+	pendingEntry.thumbnail.reset();
+}
+
+// Pending thumbnails are only written out when the store is serialized, which may not happen until
+// the end of the session. So that memory usage doesn't grow without bound in the meantime, the
+// least recently used thumbnails are discarded once the budget has been exceeded. Those thumbnails
+// will simply be extracted again if they're needed.
+void ImageCacheStore::EvictPendingThumbnails()
+{
+	while (m_pendingThumbnailBytes > m_pendingThumbnailBudget)
+	{
+		auto itr = m_pendingEntries.find(m_pendingThumbnailOrder.back());
+		assert(itr != m_pendingEntries.end());
+
+		auto &pendingEntry = itr->second;
+		DiscardPendingThumbnail(pendingEntry);
+
+		if (pendingEntry.overlayIndex)
+		{
+			continue;
+		}
+
+		// There's nothing else left in the entry. Any existing entry was still used in this
+		// session, though, so it should be retained ahead of entries that weren't.
+		if (pendingEntry.existingEntry)
+		{
+			m_usedEntries.insert(*pendingEntry.existingEntry);
+		}
+
+		m_pendingEntries.erase(itr);
+	}
+}
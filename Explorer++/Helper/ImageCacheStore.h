@@ -0,0 +1,152 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <optional>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Identifies a particular version of a file. If the file is modified, its size or last write time
+// will change, so any data cached for the previous version won't be found.
+struct ImageCacheKey
+{
+	std::wstring path;
+	uint64_t fileSize;
+	uint64_t lastWriteTime;
+};
+
+// A 32-bit, top-down BGRA bitmap.
+struct ImageCacheThumbnail
+{
+	uint32_t width;
+	uint32_t height;
+	std::span<const uint32_t> pixels;
+};
+
+// Holds icon overlay indexes and pre-scaled thumbnails for files, in a format that can be saved to
+// disk and read back in a later session.
+//
+// The serialized data is used in-place (e.g. directly from a memory-mapped file), so opening a
+// store doesn't require any of the entries to be read or copied. Entries are only looked up (via a
+// binary search of the sorted entry table) when they're requested. Any changes are held in memory
+// until the store is next serialized. At that point, entries are retained in order of when they
+// were last used (either in this session or a previous one), until the specified byte budget has
+// been reached. Thumbnails added in this session are also limited while they're held in memory,
+// with the least recently used thumbnails being discarded once that limit has been reached.
+//
+// The format uses fixed-size, little-endian fields and doesn't depend on any platform APIs. Note
+// that system image list icon indexes are specific to a process, so only the overlay index is
+// stored for each icon.
+//
+// This class isn't thread-safe.
+class ImageCacheStore
+{
+public:
+	// The data must remain valid for the lifetime of this instance. If the data isn't in the
+	// expected format (e.g. because it's corrupt or was written by a different version of the
+	// application), the store will simply start out empty.
+	//
+	// The pending thumbnail budget is the total size of the pixel data that will be held for
+	// thumbnails that have been set, but not yet serialized.
+	explicit ImageCacheStore(std::span<const std::byte> data = {},
+		size_t pendingThumbnailBudget = SIZE_MAX);
+
+	std::optional<int> GetOverlayIndex(const ImageCacheKey &key);
+
+	// The returned pixels are only valid until the store is next modified.
+	std::optional<ImageCacheThumbnail> GetThumbnail(const ImageCacheKey &key);
+
+	void SetOverlayIndex(const ImageCacheKey &key, int overlayIndex);
+	void SetThumbnail(const ImageCacheKey &key, uint32_t width, uint32_t height,
+		std::vector<uint32_t> pixels);
+
+	std::vector<std::byte> Serialize(size_t byteBudget) const;
+
+private:
+	struct Header
+	{
+		uint32_t magic;
+		uint32_t version;
+
+		// Incremented each time the store is serialized. Each entry records the generation in
+		// which it was last used, which is what determines the order in which entries are evicted.
+		uint64_t generation;
+
+		uint64_t numEntries;
+		uint64_t totalSize;
+	};
+
+	struct EntryRecord
+	{
+		uint64_t pathHash;
+		uint64_t fileSize;
+		uint64_t lastWriteTime;
+		uint64_t generation;
+
+		// Offsets are from the start of the data. The path is stored as UTF-16 code units.
+		uint32_t pathOffset;
+		uint32_t pathLength;
+		uint32_t thumbnailOffset;
+		uint32_t thumbnailWidth;
+		uint32_t thumbnailHeight;
+		int32_t overlayIndex;
+		uint32_t reserved[2];
+	};
+
+	struct PendingThumbnail
+	{
+		uint32_t width;
+		uint32_t height;
+		std::vector<uint32_t> pixels;
+
+		// The thumbnail's position in m_pendingThumbnailOrder.
+		std::list<std::wstring>::iterator orderItr;
+	};
+
+	// Changes made in this session, keyed by path. Any values that haven't been set are taken from
+	// the existing entry (if there is one).
+	struct PendingEntry
+	{
+		uint64_t fileSize;
+		uint64_t lastWriteTime;
+		std::optional<size_t> existingEntry;
+		std::optional<int> overlayIndex;
+		std::optional<PendingThumbnail> thumbnail;
+	};
+
+	static constexpr uint32_t MAGIC = 0x43494550;
+	static constexpr uint32_t VERSION = 1;
+	static constexpr int32_t NO_OVERLAY_INDEX = -1;
+
+	static uint64_t HashPath(const std::wstring &path);
+
+	std::optional<size_t> FindEntry(const ImageCacheKey &key) const;
+	const EntryRecord &GetEntry(size_t index) const;
+	std::optional<std::wstring> ReadEntryPath(const EntryRecord &entry) const;
+	std::optional<ImageCacheThumbnail> ReadEntryThumbnail(const EntryRecord &entry) const;
+	PendingEntry &GetOrCreatePendingEntry(const ImageCacheKey &key);
+	const PendingEntry *FindPendingEntry(const ImageCacheKey &key) const;
+	void DiscardPendingThumbnail(PendingEntry &pendingEntry);
+	void EvictPendingThumbnails();
+
+	std::span<const std::byte> m_data;
+	uint64_t m_generation = 0;
+	size_t m_numEntries = 0;
+
+	std::unordered_set<size_t> m_usedEntries;
+	std::unordered_map<std::wstring, PendingEntry> m_pendingEntries;
+
+	// The paths of the entries with a pending thumbnail, ordered from the most recently used
+	// thumbnail to the least recently used one.
+	std::list<std::wstring> m_pendingThumbnailOrder;
+	const size_t m_pendingThumbnailBudget;
+	size_t m_pendingThumbnailBytes = 0;
+};
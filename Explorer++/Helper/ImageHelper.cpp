@@ -4,6 +4,7 @@
 
 #include "stdafx.h"
 #include "ImageHelper.h"
+#include "PixelKernels.h"
 #include <wil/com.h>
 
 wil::unique_hbitmap ImageHelper::ImageListIconToBitmap(IImageList *imageList, int iconIndex)
@@ -76,26 +77,16 @@ HRESULT ImageHelper::ConvertToPARGB32(HDC hdc, __inout ARGB *pargb, HBITMAP hbmp
 		if (GetDIBits(hdc, hbmp, 0, bmi.bmiHeader.biHeight, pvBits, &bmi, DIB_RGB_COLORS)
 			== bmi.bmiHeader.biHeight)
 		{
-			ULONG cxDelta = cxRow - bmi.bmiHeader.biWidth;
 			ARGB *pargbMask = static_cast<ARGB *>(pvBits);
 
+			// The mask is tightly packed, but the destination rows may be padded.
 			for (ULONG y = bmi.bmiHeader.biHeight; y; --y)
 			{
-				for (ULONG x = bmi.bmiHeader.biWidth; x; --x)
-				{
-					if (*pargbMask++)
-					{
-						// transparent pixel
-						*pargb++ = 0;
-					}
-					else
-					{
-						// opaque pixel
-						*pargb++ |= 0xFF000000;
-					}
-				}
+				PixelKernels::ApplyMask(reinterpret_cast<uint32_t *>(pargb),
+					reinterpret_cast<const uint32_t *>(pargbMask), bmi.bmiHeader.biWidth);
 
-				pargb += cxDelta;
+				pargb += cxRow;
+				pargbMask += bmi.bmiHeader.biWidth;
 			}
 
 			hr = S_OK;
@@ -109,18 +100,21 @@ HRESULT ImageHelper::ConvertToPARGB32(HDC hdc, __inout ARGB *pargb, HBITMAP hbmp
 
 bool ImageHelper::HasAlpha(__in ARGB *pargb, SIZE &sizImage, int cxRow)
 {
-	ULONG cxDelta = cxRow - sizImage.cx;
+	// If the rows aren't padded, the whole image can be checked at once.
+	if (cxRow == sizImage.cx)
+	{
+		return PixelKernels::HasAlpha(reinterpret_cast<const uint32_t *>(pargb),
+			static_cast<size_t>(sizImage.cx) * sizImage.cy);
+	}
+
 	for (ULONG y = sizImage.cy; y; --y)
 	{
-		for (ULONG x = sizImage.cx; x; --x)
+		if (PixelKernels::HasAlpha(reinterpret_cast<const uint32_t *>(pargb), sizImage.cx))
 		{
-			if (*pargb++ & 0xFF000000)
-			{
-				return true;
-			}
+			return true;
 		}
 
-		pargb += cxDelta;
+		pargb += cxRow;
 	}
 
 	return false;
@@ -215,6 +209,54 @@ HBITMAP ImageHelper::IconToBitmapPARGB32(HICON hicon, int width, int height)
 	return hbmp;
 }
 
+// Returns a 32-bit DIB section containing a resized copy of the bitmap. The bitmap can be any
+// format supported by GetDIBits.
+wil::unique_hbitmap ImageHelper::ResizeBitmap(HBITMAP bitmap, int width, int height,
+	ImageResampler::Filter filter)
+{
+	BITMAP bm;
+
+	if (GetObject(bitmap, sizeof(bm), &bm) == 0 || bm.bmWidth <= 0 || bm.bmHeight <= 0
+		|| width <= 0 || height <= 0)
+	{
+		return nullptr;
+	}
+
+	// A negative height indicates that the bitmap is top-down, which is the order the resampler
+	// expects.
+	BITMAPINFO bmi;
+	InitBitmapInfo(&bmi, sizeof(bmi), bm.bmWidth, -bm.bmHeight, 32);
+
+	std::vector<uint32_t> sourcePixels(static_cast<size_t>(bm.bmWidth) * bm.bmHeight);
+
+	wil::unique_hdc hdc(CreateCompatibleDC(nullptr));
+	int numLinesCopied = GetDIBits(hdc.get(), bitmap, 0, bm.bmHeight, sourcePixels.data(), &bmi,
+		DIB_RGB_COLORS);
+
+	if (numLinesCopied != bm.bmHeight)
+	{
+		return nullptr;
+	}
+
+	SIZE size = { width, -height };
+	void *bits;
+	HBITMAP resizedBitmap;
+	HRESULT hr = Create32BitHBITMAP(hdc.get(), &size, &bits, &resizedBitmap);
+
+	if (FAILED(hr))
+	{
+		return nullptr;
+	}
+
+	ImageResampler::Options options;
+	options.filter = filter;
+
+	ImageResampler::Resize(sourcePixels.data(), bm.bmWidth, bm.bmHeight, bm.bmWidth,
+		static_cast<uint32_t *>(bits), width, height, width, options);
+
+	return wil::unique_hbitmap(resizedBitmap);
+}
+
 // See https://stackoverflow.com/a/24571173.
 std::unique_ptr<Gdiplus::Bitmap> ImageHelper::LoadGdiplusBitmapFromPNG(HINSTANCE resourceInstance,
 	UINT resourceId)
@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include "ImageResampler.h"
 #include <wil/resource.h>
 #include <Uxtheme.h>
 #include <gdiplus.h>
@@ -22,6 +23,8 @@ HRESULT ConvertToPARGB32(HDC hdc, __inout ARGB *pargb, HBITMAP hbmp, SIZE &sizIm
 bool HasAlpha(__in ARGB *pargb, SIZE &sizImage, int cxRow);
 HRESULT ConvertBufferToPARGB32(HPAINTBUFFER hPaintBuffer, HDC hdc, HICON hicon, SIZE &sizIcon);
 HBITMAP IconToBitmapPARGB32(HICON hicon, int width, int height);
+wil::unique_hbitmap ResizeBitmap(HBITMAP bitmap, int width, int height,
+	ImageResampler::Filter filter);
 
 std::unique_ptr<Gdiplus::Bitmap> LoadGdiplusBitmapFromPNG(HINSTANCE resourceInstance,
 	UINT resourceId);
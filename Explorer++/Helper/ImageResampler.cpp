@@ -0,0 +1,537 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "ImageResampler.h"
+#include <cmath>
+#include <numbers>
+#include <thread>
+#include <vector>
+
+#ifdef PIXEL_KERNELS_X86
+#include <immintrin.h>
+#endif
+
+using namespace PixelKernels;
+
+namespace ImageResampler
+{
+
+namespace
+{
+
+constexpr int CHANNELS_PER_PIXEL = 4;
+constexpr int LANCZOS_LOBES = 3;
+
+// The weights applied to the source pixels that contribute to each output pixel, along one
+// dimension. The weights for each output pixel sum to 1.
+struct FilterWeights
+{
+	// The index of the first source pixel that contributes to each output pixel, and the number
+	// of source pixels that contribute.
+	std::vector<int> starts;
+	std::vector<int> counts;
+
+	// Each output pixel has maxTaps entries here, starting at (index * maxTaps). Only the first
+	// counts[index] entries are used.
+	std::vector<float> weights;
+	int maxTaps = 0;
+};
+
+double Sinc(double x)
+{
+	if (x == 0)
+	{
+		return 1;
+	}
+
+	x *= std::numbers::pi;
+	return std::sin(x) / x;
+}
+
+double LanczosKernel(double x)
+{
+	if (std::abs(x) >= LANCZOS_LOBES)
+	{
+		return 0;
+	}
+
+	return Sinc(x) * Sinc(x / LANCZOS_LOBES);
+}
+
+FilterWeights CalculateWeights(int sourceSize, int destinationSize, Filter filter)
+{
+	double scale = static_cast<double>(sourceSize) / destinationSize;
+
+	// When downscaling, the filter is stretched to cover the source pixels that map to each
+	// output pixel.
+	double filterScale = max(scale, 1.0);
+
+	std::vector<std::vector<double>> allWeights(destinationSize);
+
+	FilterWeights filterWeights;
+	filterWeights.starts.resize(destinationSize);
+	filterWeights.counts.resize(destinationSize);
+
+	for (int i = 0; i < destinationSize; i++)
+	{
+		int start;
+		int end;
+		auto &weights = allWeights[i];
+
+		if (filter == Filter::AreaAverage)
+		{
+			// Each source pixel contributes in proportion to how much of the output pixel it
+			// covers.
+			double left = i * scale;
+			double right = (i + 1) * scale;
+			start = static_cast<int>(std::floor(left));
+			end = min(static_cast<int>(std::ceil(right)), sourceSize);
+
+			for (int j = start; j < end; j++)
+			{
+				weights.push_back(min(right, j + 1.0) - max(left, static_cast<double>(j)));
+			}
+		}
+		else
+		{
+			double center = (i + 0.5) * scale;
+			double support = LANCZOS_LOBES * filterScale;
+
+			// Source pixels beyond the edges of the image are ignored, with the remaining weights
+			// being normalized below.
+			start = max(static_cast<int>(std::floor(center - support)), 0);
+			end = min(static_cast<int>(std::ceil(center + support)), sourceSize);
+
+			for (int j = start; j < end; j++)
+			{
+				weights.push_back(LanczosKernel((j + 0.5 - center) / filterScale));
+			}
+		}
+
+		double total = 0;
+
+		for (double weight : weights)
+		{
+			total += weight;
+		}
+
+		for (double &weight : weights)
+		{
+			weight /= total;
+		}
+
+		filterWeights.starts[i] = start;
+		filterWeights.counts[i] = static_cast<int>(weights.size());
+		filterWeights.maxTaps = max(filterWeights.maxTaps, static_cast<int>(weights.size()));
+	}
+
+	filterWeights.weights.resize(static_cast<size_t>(destinationSize) * filterWeights.maxTaps);
+
+	for (int i = 0; i < destinationSize; i++)
+	{
+		for (size_t j = 0; j < allWeights[i].size(); j++)
+		{
+			filterWeights.weights[static_cast<size_t>(i) * filterWeights.maxTaps + j] =
+				static_cast<float>(allWeights[i][j]);
+		}
+	}
+
+	return filterWeights;
+}
+
+uint8_t ClampToByte(float value)
+{
+	// This rounds to the nearest integer (with ties going to the even integer), which is the same
+	// as the SIMD conversion instructions.
+	long rounded = std::lrint(value);
+	return static_cast<uint8_t>(min(max(rounded, 0L), 255L));
+}
+
+// Filters a single source row horizontally. The output has four floats (one per channel) for each
+// output pixel.
+void FilterRowScalar(const uint32_t *source, const FilterWeights &filterWeights, int width,
+	float *output)
+{
+	for (int i = 0; i < width; i++)
+	{
+		const uint32_t *pixels = source + filterWeights.starts[i];
+		const float *weights =
+			filterWeights.weights.data() + static_cast<size_t>(i) * filterWeights.maxTaps;
+		float total[CHANNELS_PER_PIXEL] = {};
+
+		for (int j = 0; j < filterWeights.counts[i]; j++)
+		{
+			for (int channel = 0; channel < CHANNELS_PER_PIXEL; channel++)
+			{
+				auto value = static_cast<float>((pixels[j] >> (channel * 8)) & 0xFF);
+				total[channel] += weights[j] * value;
+			}
+		}
+
+		for (int channel = 0; channel < CHANNELS_PER_PIXEL; channel++)
+		{
+			output[i * CHANNELS_PER_PIXEL + channel] = total[channel];
+		}
+	}
+}
+
+// Combines the intermediate rows (which have already been filtered horizontally) that contribute
+// to a single output row.
+void FilterColumnsScalar(const float *const *rows, const float *weights, int numRows, int width,
+	uint32_t *output)
+{
+	for (int i = 0; i < width; i++)
+	{
+		uint32_t pixel = 0;
+
+		for (int channel = 0; channel < CHANNELS_PER_PIXEL; channel++)
+		{
+			size_t index = static_cast<size_t>(i) * CHANNELS_PER_PIXEL + channel;
+			float total = 0;
+
+			for (int j = 0; j < numRows; j++)
+			{
+				total += weights[j] * rows[j][index];
+			}
+
+			pixel |= static_cast<uint32_t>(ClampToByte(total)) << (channel * 8);
+		}
+
+		output[i] = pixel;
+	}
+}
+
+#ifdef PIXEL_KERNELS_X86
+
+PIXEL_KERNELS_TARGET("sse4.1")
+__m128 LoadPixelSSE41(uint32_t pixel)
+{
+	return _mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_cvtsi32_si128(static_cast<int>(pixel))));
+}
+
+// Converts four pixels (held as 16 floats) back to bytes, with saturation.
+PIXEL_KERNELS_TARGET("sse4.1")
+void StorePixelsSSE41(__m128 pixel0, __m128 pixel1, __m128 pixel2, __m128 pixel3,
+	uint32_t *output)
+{
+	__m128i low = _mm_packus_epi32(_mm_cvtps_epi32(pixel0), _mm_cvtps_epi32(pixel1));
+	__m128i high = _mm_packus_epi32(_mm_cvtps_epi32(pixel2), _mm_cvtps_epi32(pixel3));
+	_mm_storeu_si128(reinterpret_cast<__m128i *>(output), _mm_packus_epi16(low, high));
+}
+
+PIXEL_KERNELS_TARGET("sse4.1")
+uint32_t ConvertPixelSSE41(__m128 pixel)
+{
+	__m128i packed = _mm_packus_epi32(_mm_cvtps_epi32(pixel), _mm_setzero_si128());
+	return static_cast<uint32_t>(_mm_cvtsi128_si32(_mm_packus_epi16(packed, packed)));
+}
+
+PIXEL_KERNELS_TARGET("sse4.1")
+void FilterRowSSE41(const uint32_t *source, const FilterWeights &filterWeights, int width,
+	float *output)
+{
+	for (int i = 0; i < width; i++)
+	{
+		const uint32_t *pixels = source + filterWeights.starts[i];
+		const float *weights =
+			filterWeights.weights.data() + static_cast<size_t>(i) * filterWeights.maxTaps;
+		__m128 total = _mm_setzero_ps();
+
+		for (int j = 0; j < filterWeights.counts[i]; j++)
+		{
+			__m128 weight = _mm_set1_ps(weights[j]);
+			total = _mm_add_ps(total, _mm_mul_ps(weight, LoadPixelSSE41(pixels[j])));
+		}
+
+		_mm_storeu_ps(output + static_cast<size_t>(i) * CHANNELS_PER_PIXEL, total);
+	}
+}
+
+// Pixels before the starting pixel are left untouched, which allows this to be used to process the
+// pixels left over by the AVX2 implementation.
+PIXEL_KERNELS_TARGET("sse4.1")
+void FilterColumnsSSE41(const float *const *rows, const float *weights, int numRows, int start,
+	int width, uint32_t *output)
+{
+	int i = start;
+
+	for (; i + 4 <= width; i += 4)
+	{
+		size_t offset = static_cast<size_t>(i) * CHANNELS_PER_PIXEL;
+		__m128 total[4] = { _mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps(),
+			_mm_setzero_ps() };
+
+		for (int j = 0; j < numRows; j++)
+		{
+			__m128 weight = _mm_set1_ps(weights[j]);
+			const float *row = rows[j] + offset;
+
+			for (int k = 0; k < 4; k++)
+			{
+				total[k] = _mm_add_ps(total[k], _mm_mul_ps(weight, _mm_loadu_ps(row + k * 4)));
+			}
+		}
+
+		StorePixelsSSE41(total[0], total[1], total[2], total[3], output + i);
+	}
+
+	for (; i < width; i++)
+	{
+		size_t offset = static_cast<size_t>(i) * CHANNELS_PER_PIXEL;
+		__m128 total = _mm_setzero_ps();
+
+		for (int j = 0; j < numRows; j++)
+		{
+			__m128 weight = _mm_set1_ps(weights[j]);
+			total = _mm_add_ps(total, _mm_mul_ps(weight, _mm_loadu_ps(rows[j] + offset)));
+		}
+
+		output[i] = ConvertPixelSSE41(total);
+	}
+}
+
+// Two source pixels are processed at a time, one in each half of the register. The two halves are
+// then added together at the end.
+PIXEL_KERNELS_TARGET("avx2")
+void FilterRowAVX2(const uint32_t *source, const FilterWeights &filterWeights, int width,
+	float *output)
+{
+	for (int i = 0; i < width; i++)
+	{
+		const uint32_t *pixels = source + filterWeights.starts[i];
+		const float *weights =
+			filterWeights.weights.data() + static_cast<size_t>(i) * filterWeights.maxTaps;
+		int count = filterWeights.counts[i];
+		__m256 total = _mm256_setzero_ps();
+		int j = 0;
+
+		for (; j + 2 <= count; j += 2)
+		{
+			__m128i pixelPair = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(pixels + j));
+			__m256 values = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(pixelPair));
+			__m256 weightPair = _mm256_insertf128_ps(
+				_mm256_castps128_ps256(_mm_set1_ps(weights[j])), _mm_set1_ps(weights[j + 1]), 1);
+			total = _mm256_add_ps(total, _mm256_mul_ps(weightPair, values));
+		}
+
+		__m128 combined =
+			_mm_add_ps(_mm256_castps256_ps128(total), _mm256_extractf128_ps(total, 1));
+
+		if (j < count)
+		{
+			combined = _mm_add_ps(combined,
+				_mm_mul_ps(_mm_set1_ps(weights[j]), LoadPixelSSE41(pixels[j])));
+		}
+
+		_mm_storeu_ps(output + static_cast<size_t>(i) * CHANNELS_PER_PIXEL, combined);
+	}
+}
+
+// Eight pixels (32 floats) are combined at a time.
+PIXEL_KERNELS_TARGET("avx2")
+void FilterColumnsAVX2(const float *const *rows, const float *weights, int numRows, int width,
+	uint32_t *output)
+{
+	int i = 0;
+
+	for (; i + 8 <= width; i += 8)
+	{
+		size_t offset = static_cast<size_t>(i) * CHANNELS_PER_PIXEL;
+		__m256 total[4] = { _mm256_setzero_ps(), _mm256_setzero_ps(), _mm256_setzero_ps(),
+			_mm256_setzero_ps() };
+
+		for (int j = 0; j < numRows; j++)
+		{
+			__m256 weight = _mm256_set1_ps(weights[j]);
+			const float *row = rows[j] + offset;
+
+			for (int k = 0; k < 4; k++)
+			{
+				total[k] =
+					_mm256_add_ps(total[k], _mm256_mul_ps(weight, _mm256_loadu_ps(row + k * 8)));
+			}
+		}
+
+		for (int k = 0; k < 2; k++)
+		{
+			StorePixelsSSE41(_mm256_castps256_ps128(total[k * 2]),
+				_mm256_extractf128_ps(total[k * 2], 1), _mm256_castps256_ps128(total[k * 2 + 1]),
+				_mm256_extractf128_ps(total[k * 2 + 1], 1), output + i + k * 4);
+		}
+	}
+
+	// The remaining pixels are combined in the same way as in the SSE4.1 implementation, which
+	// produces identical results.
+	FilterColumnsSSE41(rows, weights, numRows, i, width, output);
+}
+
+#endif
+
+void FilterRow(const uint32_t *source, const FilterWeights &filterWeights, int width,
+	float *output, InstructionSet instructionSet)
+{
+	switch (instructionSet)
+	{
+#ifdef PIXEL_KERNELS_X86
+	case InstructionSet::AVX2:
+		FilterRowAVX2(source, filterWeights, width, output);
+		break;
+
+	case InstructionSet::SSE41:
+		FilterRowSSE41(source, filterWeights, width, output);
+		break;
+#endif
+
+	default:
+		FilterRowScalar(source, filterWeights, width, output);
+		break;
+	}
+}
+
+void FilterColumns(const float *const *rows, const float *weights, int numRows, int width,
+	uint32_t *output, InstructionSet instructionSet)
+{
+	switch (instructionSet)
+	{
+#ifdef PIXEL_KERNELS_X86
+	case InstructionSet::AVX2:
+		FilterColumnsAVX2(rows, weights, numRows, width, output);
+		break;
+
+	case InstructionSet::SSE41:
+		FilterColumnsSSE41(rows, weights, numRows, 0, width, output);
+		break;
+#endif
+
+	default:
+		FilterColumnsScalar(rows, weights, numRows, width, output);
+		break;
+	}
+}
+
+// Splits the rows into contiguous ranges and runs the function on each range in parallel. The
+// calling thread processes the first range.
+template <typename Function>
+void ForEachRowRange(int numRows, int numThreads, Function function)
+{
+	numThreads = min(numThreads, numRows);
+
+	if (numThreads <= 1)
+	{
+		function(0, numRows);
+		return;
+	}
+
+	int rowsPerThread = (numRows + numThreads - 1) / numThreads;
+	std::vector<std::thread> threads;
+
+	for (int start = rowsPerThread; start < numRows; start += rowsPerThread)
+	{
+		threads.emplace_back(function, start, min(start + rowsPerThread, numRows));
+	}
+
+	function(0, min(rowsPerThread, numRows));
+
+	for (auto &thread : threads)
+	{
+		thread.join();
+	}
+}
+
+int GetNumThreads(size_t numSourcePixels, int maxThreads)
+{
+	if (maxThreads <= 0)
+	{
+		maxThreads = max(static_cast<int>(std::thread::hardware_concurrency()), 1);
+	}
+
+	auto threadsForImage = static_cast<int>(
+		min(numSourcePixels / MIN_PIXELS_PER_THREAD, static_cast<size_t>(maxThreads)));
+	return max(threadsForImage, 1);
+}
+
+}
+
+void Resize(const uint32_t *source, int sourceWidth, int sourceHeight, size_t sourceStride,
+	uint32_t *destination, int destinationWidth, int destinationHeight, size_t destinationStride,
+	const Options &options)
+{
+	if (sourceWidth <= 0 || sourceHeight <= 0 || destinationWidth <= 0 || destinationHeight <= 0)
+	{
+		return;
+	}
+
+	auto horizontalWeights = CalculateWeights(sourceWidth, destinationWidth, options.filter);
+	auto verticalWeights = CalculateWeights(sourceHeight, destinationHeight, options.filter);
+
+	// Only the source rows that contribute to at least one output row need to be filtered
+	// horizontally (which excludes rows that are skipped when upscaling).
+	int firstRow = verticalWeights.starts.front();
+	int lastRow = verticalWeights.starts.back() + verticalWeights.counts.back();
+	int numIntermediateRows = lastRow - firstRow;
+
+	size_t intermediateStride = static_cast<size_t>(destinationWidth) * CHANNELS_PER_PIXEL;
+	std::vector<float> intermediate(intermediateStride * numIntermediateRows);
+
+	int numThreads = GetNumThreads(static_cast<size_t>(sourceWidth) * sourceHeight,
+		options.maxThreads);
+
+	ForEachRowRange(numIntermediateRows, numThreads,
+		[&](int start, int end)
+		{
+			for (int row = start; row < end; row++)
+			{
+				FilterRow(source + (firstRow + row) * sourceStride, horizontalWeights,
+					destinationWidth, intermediate.data() + row * intermediateStride,
+					options.instructionSet);
+			}
+		});
+
+	ForEachRowRange(destinationHeight, numThreads,
+		[&](int start, int end)
+		{
+			std::vector<const float *> rows(verticalWeights.maxTaps);
+
+			for (int row = start; row < end; row++)
+			{
+				int count = verticalWeights.counts[row];
+
+				for (int i = 0; i < count; i++)
+				{
+					rows[i] = intermediate.data()
+						+ (verticalWeights.starts[row] - firstRow + i) * intermediateStride;
+				}
+
+				const float *weights = verticalWeights.weights.data()
+					+ static_cast<size_t>(row) * verticalWeights.maxTaps;
+
+				FilterColumns(rows.data(), weights, count, destinationWidth,
+					destination + row * destinationStride, options.instructionSet);
+			}
+		});
+}
+
+Size FitWithin(Size size, Size bounds)
+{
+	if (size.width <= bounds.width && size.height <= bounds.height)
+	{
+		return size;
+	}
+
+	// The dimension that has to be scaled down the most determines the final size.
+	if (static_cast<int64_t>(size.width) * bounds.height
+		> static_cast<int64_t>(size.height) * bounds.width)
+	{
+		int height = static_cast<int>(
+			std::lround(static_cast<double>(size.height) * bounds.width / size.width));
+		return { bounds.width, max(height, 1) };
+	}
+
+	int width = static_cast<int>(
+		std::lround(static_cast<double>(size.width) * bounds.height / size.height));
+	return { max(width, 1), bounds.height };
+}
+
+}
@@ -0,0 +1,59 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include "PixelKernels.h"
+#include <cstddef>
+#include <cstdint>
+
+// Resizes 32-bit BGRA images. The four channels are filtered independently, so an image with
+// premultiplied alpha will remain premultiplied. The filter is applied in two passes (horizontally,
+// then vertically), with the intermediate result held at full precision. Large images are split
+// across multiple threads. Like PixelKernels, this doesn't depend on any platform APIs.
+namespace ImageResampler
+{
+
+enum class Filter
+{
+	// Each output pixel is the average of the source pixels it covers. This is relatively cheap
+	// and never introduces ringing, which makes it a good fit for small thumbnails.
+	AreaAverage,
+
+	// A three-lobed windowed sinc filter, which retains more detail than area averaging, at the
+	// cost of more work per pixel and slight ringing around hard edges.
+	Lanczos3
+};
+
+struct Options
+{
+	Filter filter = Filter::AreaAverage;
+	PixelKernels::InstructionSet instructionSet = PixelKernels::GetSupportedInstructionSet();
+
+	// The maximum number of threads to use. A value of 0 means that the number of threads will be
+	// based on the number of processors. Small images always use a single thread.
+	int maxThreads = 0;
+};
+
+struct Size
+{
+	int width;
+	int height;
+};
+
+// Images with fewer source pixels than this are always resized on the calling thread, since the
+// cost of starting another thread would outweigh the benefit.
+inline constexpr size_t MIN_PIXELS_PER_THREAD = 512 * 512;
+
+// The stride of each image is the distance between rows, in pixels. The source and destination
+// must not overlap.
+void Resize(const uint32_t *source, int sourceWidth, int sourceHeight, size_t sourceStride,
+	uint32_t *destination, int destinationWidth, int destinationHeight, size_t destinationStride,
+	const Options &options = {});
+
+// Returns the largest size that fits within the bounds, while retaining the aspect ratio of the
+// original size. The original size will be returned if it already fits.
+Size FitWithin(Size size, Size bounds);
+
+}
@@ -0,0 +1,78 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "NaturalSortKey.h"
+
+namespace
+{
+
+constexpr DWORD SORT_KEY_FLAGS = LCMAP_SORTKEY | NORM_IGNORECASE | SORT_DIGITSASNUMBERS;
+
+}
+
+std::string BuildNaturalSortKey(std::wstring_view text)
+{
+	if (text.empty())
+	{
+		return {};
+	}
+
+	// Sort keys are typically a little over twice the length of the text, so a single call will
+	// usually be enough.
+	std::string key(text.size() * 3 + 16, '\0');
+	int res = LCMapStringEx(LOCALE_NAME_USER_DEFAULT, SORT_KEY_FLAGS, text.data(),
+		static_cast<int>(text.size()), reinterpret_cast<LPWSTR>(key.data()),
+		static_cast<int>(key.size()), nullptr, nullptr, 0);
+
+	if (res == 0 && GetLastError() == ERROR_INSUFFICIENT_BUFFER)
+	{
+		int size = LCMapStringEx(LOCALE_NAME_USER_DEFAULT, SORT_KEY_FLAGS, text.data(),
+			static_cast<int>(text.size()), nullptr, 0, nullptr, nullptr, 0);
+		key.resize(size);
+
+		res = LCMapStringEx(LOCALE_NAME_USER_DEFAULT, SORT_KEY_FLAGS, text.data(),
+			static_cast<int>(text.size()), reinterpret_cast<LPWSTR>(key.data()),
+			static_cast<int>(key.size()), nullptr, nullptr, 0);
+	}
+
+	if (res == 0)
+	{
+		// This shouldn't happen for any valid input. Falling back to the UTF-16 code units means
+		// that the item will still be placed in a consistent (if not entirely natural) position.
+		key.clear();
+
+		for (wchar_t c : text)
+		{
+			key.push_back(static_cast<char>(c >> 8));
+			key.push_back(static_cast<char>(c & 0xFF));
+		}
+
+		return key;
+	}
+
+	// The size that's returned includes the terminating null byte, which isn't needed, since the
+	// keys are compared using their lengths.
+	key.resize(res - 1);
+
+	return key;
+}
+
+int CompareNaturalSortKeys(const std::string &key1, const std::string &key2)
+{
+	// std::string compares its characters as unsigned values, so this is equivalent to memcmp(),
+	// with the shorter key being ordered first if it's a prefix of the longer one.
+	int result = key1.compare(key2);
+
+	if (result < 0)
+	{
+		return -1;
+	}
+	else if (result > 0)
+	{
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,25 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <string>
+#include <string_view>
+
+// Builds a binary collation key for the specified text. Comparing the keys for two strings (with
+// CompareNaturalSortKeys(), which is a plain byte comparison) orders the strings in the same way
+// StrCmpLogicalW() does. That is, runs of digits are compared numerically (so "file2" sorts before
+// "file10") and the remaining text is compared case-insensitively, using the rules for the user's
+// locale.
+//
+// The key is generated by LCMapStringEx(), using the same flags that StrCmpLogicalW() passes to
+// CompareStringEx(), so accented letters, ignored punctuation (such as hyphens and apostrophes) and
+// so on are handled identically. Keys are specific to the locale and version of Windows they were
+// generated with, so they shouldn't be persisted.
+//
+// Building a key is more expensive than a single call to StrCmpLogicalW(), but when a set of
+// strings is sorted, each string only has to be processed once, rather than once per comparison.
+std::string BuildNaturalSortKey(std::wstring_view text);
+
+int CompareNaturalSortKeys(const std::string &key1, const std::string &key2);
@@ -0,0 +1,90 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <algorithm>
+#include <iterator>
+#include <thread>
+#include <vector>
+
+// Performs a stable sort of the specified range. Large ranges are split into one run per hardware
+// thread, with each run being sorted on its own thread. Adjacent runs are then merged in pairs
+// (again, in parallel), until a single sorted run remains. Since each merge places elements from
+// the earlier run before equal elements from the later run, the result is the same as that
+// produced by std::stable_sort().
+//
+// The comparison function will be called concurrently from multiple threads, so it must not modify
+// any shared state. Ranges with fewer than minItemsPerThread items per thread are simply sorted on
+// the calling thread, since the cost of starting the threads would outweigh any benefit.
+template <class RandomIt, class Compare>
+void ParallelStableSort(RandomIt first, RandomIt last, Compare comp,
+	size_t minItemsPerThread = 16384)
+{
+	auto numItems = static_cast<size_t>(std::distance(first, last));
+	size_t numRuns = std::thread::hardware_concurrency();
+
+	if (minItemsPerThread > 0 && numItems / minItemsPerThread < numRuns)
+	{
+		numRuns = numItems / minItemsPerThread;
+	}
+
+	if (numRuns <= 1)
+	{
+		std::stable_sort(first, last, comp);
+		return;
+	}
+
+	// Run i covers the range [runStarts[i], runStarts[i + 1]).
+	std::vector<RandomIt> runStarts;
+
+	for (size_t i = 0; i <= numRuns; i++)
+	{
+		runStarts.push_back(first + static_cast<std::ptrdiff_t>(numItems * i / numRuns));
+	}
+
+	{
+		std::vector<std::jthread> threads;
+
+		for (size_t i = 0; i < numRuns; i++)
+		{
+			threads.emplace_back(
+				[&runStarts, &comp, i]
+				{
+					std::stable_sort(runStarts[i], runStarts[i + 1], comp);
+				});
+		}
+	}
+
+	while (runStarts.size() > 2)
+	{
+		std::vector<RandomIt> mergedRunStarts;
+
+		{
+			std::vector<std::jthread> threads;
+			size_t i = 0;
+
+			for (; i + 2 < runStarts.size(); i += 2)
+			{
+				threads.emplace_back(
+					[&runStarts, &comp, i]
+					{
+						std::inplace_merge(runStarts[i], runStarts[i + 1], runStarts[i + 2], comp);
+					});
+
+				mergedRunStarts.push_back(runStarts[i]);
+			}
+
+			// If there's an odd number of runs, the last run is carried over to the next round
+			// as-is.
+			if (i + 1 < runStarts.size())
+			{
+				mergedRunStarts.push_back(runStarts[i]);
+			}
+		}
+
+		mergedRunStarts.push_back(runStarts.back());
+		runStarts = std::move(mergedRunStarts);
+	}
+}
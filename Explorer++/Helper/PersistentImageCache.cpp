@@ -0,0 +1,126 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "PersistentImageCache.h"
+#include "Logging.h"
+
+PersistentImageCache::PersistentImageCache(const std::wstring &filePath, size_t byteBudget) :
+	m_filePath(filePath),
+	m_byteBudget(byteBudget)
+{
+	Load();
+}
+
+ImageCacheStore *PersistentImageCache::GetStore()
+{
+	return m_store.get();
+}
+
+void PersistentImageCache::Load()
+{
+	// Deletion is allowed, since that's how the file is replaced when another instance of the
+	// application saves the cache.
+	m_file.reset(CreateFile(m_filePath.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE,
+		nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr));
+
+	LARGE_INTEGER fileSize;
+
+	// A file that's larger than the budget wasn't written with the current budget (or isn't a
+	// valid cache file), so it's ignored and will be overwritten on the next save.
+	if (!m_file || !GetFileSizeEx(m_file.get(), &fileSize) || fileSize.QuadPart == 0
+		|| static_cast<uint64_t>(fileSize.QuadPart) > m_byteBudget)
+	{
+		m_store = std::make_unique<ImageCacheStore>(std::span<const std::byte>(), m_byteBudget);
+		return;
+	}
+
+	m_fileMapping.reset(CreateFileMapping(m_file.get(), nullptr, PAGE_READONLY, 0, 0, nullptr));
+
+	if (m_fileMapping)
+	{
+		m_view.reset(MapViewOfFile(m_fileMapping.get(), FILE_MAP_READ, 0, 0, 0));
+	}
+
+	if (!m_view)
+	{
+		m_store = std::make_unique<ImageCacheStore>(std::span<const std::byte>(), m_byteBudget);
+		return;
+	}
+
+	m_store = std::make_unique<ImageCacheStore>(
+		std::span(static_cast<const std::byte *>(m_view.get()),
+			static_cast<size_t>(fileSize.QuadPart)),
+		m_byteBudget);
+}
+
+void PersistentImageCache::Unload()
+{
+	// The store references the mapped data, so it has to be destroyed first.
+	m_store.reset();
+	m_view.reset();
+	m_fileMapping.reset();
+	m_file.reset();
+}
+
+void PersistentImageCache::Save()
+{
+	if (m_filePath.empty())
+	{
+		return;
+	}
+
+	auto data = m_store->Serialize(m_byteBudget);
+
+	// The data is written to a temporary file first, so that the existing cache is left intact if
+	// the write fails.
+	std::wstring tempFilePath = m_filePath + L".tmp";
+
+	{
+		wil::unique_hfile tempFile(CreateFile(tempFilePath.c_str(), GENERIC_WRITE, 0, nullptr,
+			CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr));
+
+		if (!tempFile)
+		{
+			return;
+		}
+
+		DWORD numBytesWritten;
+		BOOL res = WriteFile(tempFile.get(), data.data(), static_cast<DWORD>(data.size()),
+			&numBytesWritten, nullptr);
+
+		if (!res || numBytesWritten != data.size())
+		{
+			tempFile.reset();
+			DeleteFile(tempFilePath.c_str());
+			return;
+		}
+	}
+
+	// The existing file can't be replaced while it's mapped.
+	Unload();
+
+	BOOL res = MoveFileEx(tempFilePath.c_str(), m_filePath.c_str(), MOVEFILE_REPLACE_EXISTING);
+
+	if (!res)
+	{
+		// This can happen if another instance of the application has the existing file mapped.
+		LOG(warning) << L"Couldn't replace image cache file \"" << m_filePath
+					 << L"\". Error: " << GetLastError();
+
+		DeleteFile(tempFilePath.c_str());
+	}
+
+	Load();
+}
+
+ImageCacheKey PersistentImageCache::BuildKey(std::wstring_view path,
+	const WIN32_FIND_DATA &findData)
+{
+	ULARGE_INTEGER fileSize = { findData.nFileSizeLow, findData.nFileSizeHigh };
+	ULARGE_INTEGER lastWriteTime = { findData.ftLastWriteTime.dwLowDateTime,
+		findData.ftLastWriteTime.dwHighDateTime };
+
+	return { std::wstring(path), fileSize.QuadPart, lastWriteTime.QuadPart };
+}
@@ -0,0 +1,41 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include "ImageCacheStore.h"
+#include <wil/resource.h>
+#include <memory>
+#include <string>
+
+// Loads an ImageCacheStore from disk and saves it back again, so that cached thumbnails and overlay
+// information are retained between sessions. The file is memory-mapped, so loading the cache
+// doesn't read any of the entries; each entry is only paged in once it's used.
+//
+// This class should only be used from the main thread.
+class PersistentImageCache
+{
+public:
+	// If the file path is empty, the cache will only be held in memory.
+	PersistentImageCache(const std::wstring &filePath, size_t byteBudget);
+
+	ImageCacheStore *GetStore();
+
+	// Writes out all the entries, evicting the least recently used entries if the cache is over
+	// budget. The cache remains usable after this call.
+	void Save();
+
+	static ImageCacheKey BuildKey(std::wstring_view path, const WIN32_FIND_DATA &findData);
+
+private:
+	void Load();
+	void Unload();
+
+	const std::wstring m_filePath;
+	const size_t m_byteBudget;
+	wil::unique_hfile m_file;
+	wil::unique_handle m_fileMapping;
+	wil::unique_mapview_ptr<void> m_view;
+	std::unique_ptr<ImageCacheStore> m_store;
+};
@@ -0,0 +1,267 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "PixelKernels.h"
+
+#ifdef PIXEL_KERNELS_X86
+#include <immintrin.h>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+namespace PixelKernels
+{
+
+namespace
+{
+
+constexpr uint32_t ALPHA_MASK = 0xFF000000;
+
+bool HasAlphaScalar(const uint32_t *pixels, size_t numPixels)
+{
+	for (size_t i = 0; i < numPixels; i++)
+	{
+		if (pixels[i] & ALPHA_MASK)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void ApplyMaskScalar(uint32_t *pixels, const uint32_t *mask, size_t numPixels)
+{
+	for (size_t i = 0; i < numPixels; i++)
+	{
+		pixels[i] = mask[i] ? 0 : (pixels[i] | ALPHA_MASK);
+	}
+}
+
+#ifdef PIXEL_KERNELS_X86
+
+// Icons are small and typically either have an alpha channel, or don't (in which case every pixel
+// has to be checked), so there's little benefit in checking for an early exit more than once every
+// 16 pixels.
+PIXEL_KERNELS_TARGET("sse4.1")
+bool HasAlphaSSE41(const uint32_t *pixels, size_t numPixels)
+{
+	const __m128i alphaMask = _mm_set1_epi32(static_cast<int>(ALPHA_MASK));
+	size_t i = 0;
+
+	for (; i + 16 <= numPixels; i += 16)
+	{
+		auto *block = reinterpret_cast<const __m128i *>(pixels + i);
+		__m128i combined = _mm_or_si128(
+			_mm_or_si128(_mm_loadu_si128(block), _mm_loadu_si128(block + 1)),
+			_mm_or_si128(_mm_loadu_si128(block + 2), _mm_loadu_si128(block + 3)));
+
+		if (!_mm_testz_si128(combined, alphaMask))
+		{
+			return true;
+		}
+	}
+
+	for (; i + 4 <= numPixels; i += 4)
+	{
+		__m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pixels + i));
+
+		if (!_mm_testz_si128(block, alphaMask))
+		{
+			return true;
+		}
+	}
+
+	return HasAlphaScalar(pixels + i, numPixels - i);
+}
+
+PIXEL_KERNELS_TARGET("sse4.1")
+void ApplyMaskSSE41(uint32_t *pixels, const uint32_t *mask, size_t numPixels)
+{
+	const __m128i alphaMask = _mm_set1_epi32(static_cast<int>(ALPHA_MASK));
+	const __m128i zero = _mm_setzero_si128();
+	size_t i = 0;
+
+	for (; i + 4 <= numPixels; i += 4)
+	{
+		auto *pixelBlock = reinterpret_cast<__m128i *>(pixels + i);
+		__m128i maskBlock = _mm_loadu_si128(reinterpret_cast<const __m128i *>(mask + i));
+
+		// Lanes where the mask is clear are set to all ones, which keeps the opaque pixel. All
+		// other lanes are cleared.
+		__m128i keep = _mm_cmpeq_epi32(maskBlock, zero);
+		__m128i opaque = _mm_or_si128(_mm_loadu_si128(pixelBlock), alphaMask);
+		_mm_storeu_si128(pixelBlock, _mm_and_si128(opaque, keep));
+	}
+
+	ApplyMaskScalar(pixels + i, mask + i, numPixels - i);
+}
+
+PIXEL_KERNELS_TARGET("avx2")
+bool HasAlphaAVX2(const uint32_t *pixels, size_t numPixels)
+{
+	const __m256i alphaMask = _mm256_set1_epi32(static_cast<int>(ALPHA_MASK));
+	size_t i = 0;
+
+	for (; i + 32 <= numPixels; i += 32)
+	{
+		auto *block = reinterpret_cast<const __m256i *>(pixels + i);
+		__m256i combined = _mm256_or_si256(
+			_mm256_or_si256(_mm256_loadu_si256(block), _mm256_loadu_si256(block + 1)),
+			_mm256_or_si256(_mm256_loadu_si256(block + 2), _mm256_loadu_si256(block + 3)));
+
+		if (!_mm256_testz_si256(combined, alphaMask))
+		{
+			return true;
+		}
+	}
+
+	for (; i + 8 <= numPixels; i += 8)
+	{
+		__m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(pixels + i));
+
+		if (!_mm256_testz_si256(block, alphaMask))
+		{
+			return true;
+		}
+	}
+
+	return HasAlphaScalar(pixels + i, numPixels - i);
+}
+
+PIXEL_KERNELS_TARGET("avx2")
+void ApplyMaskAVX2(uint32_t *pixels, const uint32_t *mask, size_t numPixels)
+{
+	const __m256i alphaMask = _mm256_set1_epi32(static_cast<int>(ALPHA_MASK));
+	const __m256i zero = _mm256_setzero_si256();
+	size_t i = 0;
+
+	for (; i + 8 <= numPixels; i += 8)
+	{
+		auto *pixelBlock = reinterpret_cast<__m256i *>(pixels + i);
+		__m256i maskBlock = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(mask + i));
+
+		__m256i keep = _mm256_cmpeq_epi32(maskBlock, zero);
+		__m256i opaque = _mm256_or_si256(_mm256_loadu_si256(pixelBlock), alphaMask);
+		_mm256_storeu_si256(pixelBlock, _mm256_and_si256(opaque, keep));
+	}
+
+	ApplyMaskScalar(pixels + i, mask + i, numPixels - i);
+}
+
+#if defined(_MSC_VER)
+
+// AVX2 instructions can only be used if the operating system saves the AVX registers on a context
+// switch, which is indicated by the XMM and YMM state bits in XCR0.
+PIXEL_KERNELS_TARGET("xsave")
+InstructionSet DetectInstructionSet()
+{
+	int info[4];
+	__cpuid(info, 0);
+	int maxLeaf = info[0];
+
+	if (maxLeaf < 1)
+	{
+		return InstructionSet::Scalar;
+	}
+
+	__cpuid(info, 1);
+	bool sse41 = (info[2] & (1 << 19)) != 0;
+	bool osxsave = (info[2] & (1 << 27)) != 0;
+	bool avx = (info[2] & (1 << 28)) != 0;
+
+	if (!sse41)
+	{
+		return InstructionSet::Scalar;
+	}
+
+	if (maxLeaf < 7 || !osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6)
+	{
+		return InstructionSet::SSE41;
+	}
+
+	__cpuidex(info, 7, 0);
+	bool avx2 = (info[1] & (1 << 5)) != 0;
+
+	return avx2 ? InstructionSet::AVX2 : InstructionSet::SSE41;
+}
+
+#else
+
+InstructionSet DetectInstructionSet()
+{
+	if (__builtin_cpu_supports("avx2"))
+	{
+		return InstructionSet::AVX2;
+	}
+
+	if (__builtin_cpu_supports("sse4.1"))
+	{
+		return InstructionSet::SSE41;
+	}
+
+	return InstructionSet::Scalar;
+}
+
+#endif
+
+#else
+
+InstructionSet DetectInstructionSet()
+{
+	return InstructionSet::Scalar;
+}
+
+#endif
+
+}
+
+InstructionSet GetSupportedInstructionSet()
+{
+	static const InstructionSet instructionSet = DetectInstructionSet();
+	return instructionSet;
+}
+
+bool HasAlpha(const uint32_t *pixels, size_t numPixels, InstructionSet instructionSet)
+{
+	switch (instructionSet)
+	{
+#ifdef PIXEL_KERNELS_X86
+	case InstructionSet::AVX2:
+		return HasAlphaAVX2(pixels, numPixels);
+
+	case InstructionSet::SSE41:
+		return HasAlphaSSE41(pixels, numPixels);
+#endif
+
+	default:
+		return HasAlphaScalar(pixels, numPixels);
+	}
+}
+
+void ApplyMask(uint32_t *pixels, const uint32_t *mask, size_t numPixels,
+	InstructionSet instructionSet)
+{
+	switch (instructionSet)
+	{
+#ifdef PIXEL_KERNELS_X86
+	case InstructionSet::AVX2:
+		ApplyMaskAVX2(pixels, mask, numPixels);
+		break;
+
+	case InstructionSet::SSE41:
+		ApplyMaskSSE41(pixels, mask, numPixels);
+		break;
+#endif
+
+	default:
+		ApplyMaskScalar(pixels, mask, numPixels);
+		break;
+	}
+}
+
+}
@@ -0,0 +1,53 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define PIXEL_KERNELS_X86
+#endif
+
+// MSVC allows any intrinsic to be used in any function. Other compilers (including clang-cl) only
+// allow an intrinsic to be used in a function that's explicitly compiled for the corresponding
+// instruction set.
+#if defined(__GNUC__) || defined(__clang__)
+#define PIXEL_KERNELS_TARGET(features) __attribute__((target(features)))
+#else
+#define PIXEL_KERNELS_TARGET(features)
+#endif
+
+// Operations on runs of 32-bit BGRA pixels (with the alpha value in the top eight bits), as used by
+// the icon and bitmap conversion functions in ImageHelper. Each operation has a scalar
+// implementation, along with SSE4.1 and AVX2 implementations on x86. By default, the best
+// implementation the CPU supports is used. An instruction set can also be passed explicitly (e.g.
+// to compare the implementations), though it must be one the CPU supports. These functions don't
+// depend on any platform APIs.
+namespace PixelKernels
+{
+
+enum class InstructionSet
+{
+	Scalar,
+	SSE41,
+	AVX2
+};
+
+// Returns the best instruction set supported by the current CPU (and operating system). This is
+// only determined once.
+InstructionSet GetSupportedInstructionSet();
+
+// Returns true if any of the pixels has a non-zero alpha value.
+bool HasAlpha(const uint32_t *pixels, size_t numPixels,
+	InstructionSet instructionSet = GetSupportedInstructionSet());
+
+// Applies a monochrome mask (as retrieved from an icon) to pixels that don't have an alpha channel.
+// Each pixel where the mask is set becomes fully transparent (i.e. zero, since the output is
+// premultiplied). All other pixels are made fully opaque.
+void ApplyMask(uint32_t *pixels, const uint32_t *mask, size_t numPixels,
+	InstructionSet instructionSet = GetSupportedInstructionSet());
+
+}
@@ -0,0 +1,127 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "StringArena.h"
+#include <cassert>
+
+StringArena::Handle StringArena::Intern(std::wstring_view str)
+{
+	uint32_t hash = HashString(str);
+	size_t slot;
+	auto existingHandle = Find(str, hash, slot);
+
+	if (existingHandle)
+	{
+		return *existingHandle;
+	}
+
+	// The table is kept at most half full, so that probe sequences remain short.
+	if ((m_entries.size() + 1) * 2 > m_slots.size())
+	{
+		Rehash(m_slots.empty() ? 64 : m_slots.size() * 2);
+		Find(str, hash, slot);
+	}
+
+	assert(m_buffer.size() + str.size() + 1 <= UINT32_MAX);
+
+	Entry entry;
+	entry.offset = static_cast<uint32_t>(m_buffer.size());
+	entry.length = static_cast<uint32_t>(str.size());
+	entry.hash = hash;
+
+	m_buffer.insert(m_buffer.end(), str.begin(), str.end());
+	m_buffer.push_back('\0');
+
+	auto handle = static_cast<Handle>(m_entries.size());
+	m_entries.push_back(entry);
+	m_slots[slot] = handle;
+
+	return handle;
+}
+
+std::wstring_view StringArena::Get(Handle handle) const
+{
+	const Entry &entry = m_entries.at(handle);
+	return { m_buffer.data() + entry.offset, entry.length };
+}
+
+void StringArena::Clear()
+{
+	m_buffer.clear();
+	m_entries.clear();
+	m_slots.clear();
+}
+
+size_t StringArena::GetNumStrings() const
+{
+	return m_entries.size();
+}
+
+size_t StringArena::GetMemoryUsage() const
+{
+	return m_buffer.capacity() * sizeof(wchar_t) + m_entries.capacity() * sizeof(Entry)
+		+ m_slots.capacity() * sizeof(Handle);
+}
+
+// FNV-1a.
+uint32_t StringArena::HashString(std::wstring_view str)
+{
+	uint32_t hash = 2166136261u;
+
+	for (wchar_t c : str)
+	{
+		hash ^= static_cast<uint32_t>(c);
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+// If the string is found, its handle will be returned. Otherwise, slot will be set to the empty
+// slot the string can be inserted into.
+std::optional<StringArena::Handle> StringArena::Find(std::wstring_view str, uint32_t hash,
+	size_t &slot) const
+{
+	slot = 0;
+
+	if (m_slots.empty())
+	{
+		return std::nullopt;
+	}
+
+	size_t mask = m_slots.size() - 1;
+
+	for (slot = hash & mask; m_slots[slot] != EMPTY_SLOT; slot = (slot + 1) & mask)
+	{
+		Handle handle = m_slots[slot];
+		const Entry &entry = m_entries[handle];
+
+		if (entry.hash == hash && Get(handle) == str)
+		{
+			return handle;
+		}
+	}
+
+	return std::nullopt;
+}
+
+void StringArena::Rehash(size_t numSlots)
+{
+	m_slots.assign(numSlots, EMPTY_SLOT);
+
+	size_t mask = numSlots - 1;
+
+	for (Handle handle = 0; handle < m_entries.size(); handle++)
+	{
+		size_t slot = m_entries[handle].hash & mask;
+
+		while (m_slots[slot] != EMPTY_SLOT)
+		{
+			slot = (slot + 1) & mask;
+		}
+
+		m_slots[slot] = handle;
+	}
+}
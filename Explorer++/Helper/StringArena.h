@@ -0,0 +1,54 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+// Stores a set of strings within a single contiguous buffer. Strings are interned, so adding a
+// string that's already present will return the handle to the existing copy. Individual strings
+// can't be removed; the arena can only be cleared as a whole.
+class StringArena
+{
+public:
+	using Handle = uint32_t;
+
+	Handle Intern(std::wstring_view str);
+
+	// The returned view is null-terminated. It remains valid until the next call to Intern() or
+	// Clear().
+	std::wstring_view Get(Handle handle) const;
+
+	void Clear();
+
+	size_t GetNumStrings() const;
+
+	// Returns the number of bytes allocated by the arena.
+	size_t GetMemoryUsage() const;
+
+private:
+	static constexpr Handle EMPTY_SLOT = UINT32_MAX;
+
+	struct Entry
+	{
+		uint32_t offset;
+		uint32_t length;
+		uint32_t hash;
+	};
+
+	static uint32_t HashString(std::wstring_view str);
+
+	std::optional<Handle> Find(std::wstring_view str, uint32_t hash, size_t &slot) const;
+	void Rehash(size_t numSlots);
+
+	std::vector<wchar_t> m_buffer;
+	std::vector<Entry> m_entries;
+
+	// An open addressing hash table, mapping from string hashes to entry indexes. The number of
+	// slots is always a power of two.
+	std::vector<Handle> m_slots;
+};
@@ -0,0 +1,415 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "WildcardPattern.h"
+#include <algorithm>
+#include <cwchar>
+
+#if defined(_M_X64) || defined(_M_IX86)
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+
+// Lowercases the string in the same way CheckWildcardMatch() does. The output buffer needs to be
+// the same size as the input string.
+void FoldCase(std::wstring_view str, wchar_t *output)
+{
+	size_t i = 0;
+
+	// Names are typically ASCII, in which case there's no need to call into the locale functions.
+	// LCMAP_LOWERCASE (without LCMAP_LINGUISTIC_CASING) maps ASCII characters in the same way,
+	// regardless of the locale.
+	for (; i < str.size() && str[i] < 0x80; i++)
+	{
+		wchar_t c = str[i];
+		output[i] = (c >= 'A' && c <= 'Z') ? static_cast<wchar_t>(c + ('a' - 'A')) : c;
+	}
+
+	if (i == str.size())
+	{
+		return;
+	}
+
+	int remaining = static_cast<int>(str.size() - i);
+	int res = LCMapString(LOCALE_USER_DEFAULT, LCMAP_LOWERCASE, str.data() + i, remaining,
+		output + i, remaining);
+
+	if (res != remaining)
+	{
+		std::copy(str.begin() + i, str.end(), output + i);
+	}
+}
+
+std::wstring FoldCase(std::wstring_view str)
+{
+	std::wstring output(str.size(), '\0');
+	FoldCase(str, output.data());
+	return output;
+}
+
+bool MatchSegmentAt(std::wstring_view str, size_t position, const std::wstring &segment)
+{
+	for (size_t i = 0; i < segment.size(); i++)
+	{
+		if (segment[i] != '?' && segment[i] != str[position + i])
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// Returns the position of the first occurrence of the literal at or after the specified start
+// position. Candidate positions are found by comparing both the first and last characters of the
+// literal against eight positions at a time. Only the candidates where both characters match
+// then need to be compared in full.
+size_t FindLiteral(std::wstring_view str, std::wstring_view literal, size_t start)
+{
+	if (literal.empty())
+	{
+		return start;
+	}
+
+	if (str.size() < literal.size() || start > str.size() - literal.size())
+	{
+		return std::wstring_view::npos;
+	}
+
+	// The last position at which the literal could start.
+	size_t end = str.size() - literal.size();
+	size_t i = start;
+
+#if defined(_M_X64) || defined(_M_IX86)
+	const __m128i firstChar = _mm_set1_epi16(static_cast<short>(literal.front()));
+	const __m128i lastChar = _mm_set1_epi16(static_cast<short>(literal.back()));
+	size_t lastOffset = literal.size() - 1;
+
+	for (; i <= end && end - i >= 7; i += 8)
+	{
+		__m128i blockFirst = _mm_loadu_si128(reinterpret_cast<const __m128i *>(str.data() + i));
+		__m128i blockLast =
+			_mm_loadu_si128(reinterpret_cast<const __m128i *>(str.data() + i + lastOffset));
+		__m128i matches = _mm_and_si128(_mm_cmpeq_epi16(firstChar, blockFirst),
+			_mm_cmpeq_epi16(lastChar, blockLast));
+
+		// Each 16-bit lane contributes two bits to the mask.
+		auto mask = static_cast<unsigned int>(_mm_movemask_epi8(matches));
+
+		while (mask != 0)
+		{
+			unsigned long bit;
+			_BitScanForward(&bit, mask);
+
+			size_t position = i + bit / 2;
+
+			if (std::wmemcmp(str.data() + position, literal.data(), literal.size()) == 0)
+			{
+				return position;
+			}
+
+			mask &= ~(3u << bit);
+		}
+	}
+#endif
+
+	while (i <= end)
+	{
+		const wchar_t *match = std::wmemchr(str.data() + i, literal.front(), end - i + 1);
+
+		if (!match)
+		{
+			return std::wstring_view::npos;
+		}
+
+		size_t position = match - str.data();
+
+		if (std::wmemcmp(match, literal.data(), literal.size()) == 0)
+		{
+			return position;
+		}
+
+		i = position + 1;
+	}
+
+	return std::wstring_view::npos;
+}
+
+size_t FindSegment(std::wstring_view str, const std::wstring &segment, bool hasSingleWildcard,
+	size_t start)
+{
+	if (!hasSingleWildcard)
+	{
+		return FindLiteral(str, segment, start);
+	}
+
+	for (size_t i = start; i + segment.size() <= str.size(); i++)
+	{
+		if (MatchSegmentAt(str, i, segment))
+		{
+			return i;
+		}
+	}
+
+	return std::wstring_view::npos;
+}
+
+}
+
+WildcardPattern::WildcardPattern() : WildcardPattern(L"", true)
+{
+}
+
+WildcardPattern::WildcardPattern(std::wstring_view pattern, bool caseSensitive) :
+	m_caseSensitive(caseSensitive)
+{
+	if (pattern.find(':') == std::wstring_view::npos)
+	{
+		m_subPatterns.push_back(CompileSubPattern(pattern, caseSensitive));
+		return;
+	}
+
+	// As with CheckWildcardMatch(), empty patterns are skipped and any whitespace around each
+	// pattern is removed.
+	size_t start = 0;
+
+	while (start <= pattern.size())
+	{
+		size_t end = min(pattern.find(':', start), pattern.size());
+
+		if (end > start)
+		{
+			std::wstring subPattern(pattern.substr(start, end - start));
+			PathRemoveBlanks(subPattern.data());
+			subPattern.resize(lstrlen(subPattern.c_str()));
+			m_subPatterns.push_back(CompileSubPattern(subPattern, caseSensitive));
+		}
+
+		start = end + 1;
+	}
+}
+
+WildcardPattern::SubPattern WildcardPattern::CompileSubPattern(std::wstring_view pattern,
+	bool caseSensitive)
+{
+	// The pattern is folded once here, so that only the string being matched needs to be folded
+	// each time.
+	std::wstring text = caseSensitive ? std::wstring(pattern) : FoldCase(pattern);
+
+	auto buildSegment = [](std::wstring_view segmentText)
+	{
+		return Segment{ std::wstring(segmentText), segmentText.find('?') != std::wstring::npos };
+	};
+
+	SubPattern subPattern;
+	size_t firstStar = text.find('*');
+
+	if (firstStar == std::wstring::npos)
+	{
+		subPattern.prefix = buildSegment(text);
+		subPattern.suffix = buildSegment(L"");
+		subPattern.hasSequenceWildcard = false;
+		subPattern.minLength = text.size();
+		subPattern.type = subPattern.prefix.hasSingleWildcard ? Type::General : Type::Exact;
+		return subPattern;
+	}
+
+	size_t lastStar = text.rfind('*');
+	std::wstring_view textView = text;
+
+	subPattern.prefix = buildSegment(textView.substr(0, firstStar));
+	subPattern.suffix = buildSegment(textView.substr(lastStar + 1));
+	subPattern.hasSequenceWildcard = true;
+	subPattern.minLength = subPattern.prefix.text.size() + subPattern.suffix.text.size();
+
+	// Consecutive '*' wildcards are equivalent to a single '*', so any empty segments can be
+	// dropped.
+	size_t start = firstStar + 1;
+
+	while (start <= lastStar)
+	{
+		size_t end = text.find('*', start);
+
+		if (end > start)
+		{
+			subPattern.middle.push_back(buildSegment(textView.substr(start, end - start)));
+			subPattern.minLength += end - start;
+		}
+
+		start = end + 1;
+	}
+
+	bool hasSingleWildcard = subPattern.prefix.hasSingleWildcard
+		|| subPattern.suffix.hasSingleWildcard
+		|| std::any_of(subPattern.middle.begin(), subPattern.middle.end(),
+			[](const Segment &segment)
+			{
+				return segment.hasSingleWildcard;
+			});
+
+	bool hasPrefix = !subPattern.prefix.text.empty();
+	bool hasSuffix = !subPattern.suffix.text.empty();
+
+	if (hasSingleWildcard || subPattern.middle.size() > 1)
+	{
+		subPattern.type = Type::General;
+	}
+	else if (subPattern.middle.size() == 1)
+	{
+		subPattern.type = (!hasPrefix && !hasSuffix) ? Type::Contains : Type::General;
+	}
+	else if (hasPrefix && hasSuffix)
+	{
+		subPattern.type = Type::General;
+	}
+	else if (hasPrefix)
+	{
+		subPattern.type = Type::Prefix;
+	}
+	else if (hasSuffix)
+	{
+		subPattern.type = Type::Suffix;
+	}
+	else
+	{
+		subPattern.type = Type::Any;
+	}
+
+	return subPattern;
+}
+
+bool WildcardPattern::Match(std::wstring_view str) const
+{
+	if (m_caseSensitive)
+	{
+		return MatchFolded(str);
+	}
+
+	// Most strings will fit within the stack buffer, which avoids an allocation for each match.
+	wchar_t stackBuffer[MAX_PATH];
+	std::wstring heapBuffer;
+	wchar_t *buffer = stackBuffer;
+
+	if (str.size() > std::size(stackBuffer))
+	{
+		heapBuffer.resize(str.size());
+		buffer = heapBuffer.data();
+	}
+
+	FoldCase(str, buffer);
+
+	return MatchFolded({ buffer, str.size() });
+}
+
+std::optional<std::vector<std::wstring>> WildcardPattern::GetExtensions() const
+{
+	if (m_subPatterns.empty())
+	{
+		return std::nullopt;
+	}
+
+	std::vector<std::wstring> extensions;
+
+	for (const auto &subPattern : m_subPatterns)
+	{
+		// The extension can't contain a '.', since "*.tar.gz", for example, should only match
+		// names that end in ".tar.gz", not every name with a ".gz" extension.
+		const auto &suffix = subPattern.suffix.text;
+
+		if (subPattern.type != Type::Suffix || suffix.size() < 2 || suffix[0] != '.'
+			|| suffix.find('.', 1) != std::wstring::npos)
+		{
+			return std::nullopt;
+		}
+
+		extensions.push_back(suffix.substr(1));
+	}
+
+	return extensions;
+}
+
+bool WildcardPattern::IsCaseSensitive() const
+{
+	return m_caseSensitive;
+}
+
+bool WildcardPattern::MatchFolded(std::wstring_view str) const
+{
+	return std::any_of(m_subPatterns.begin(), m_subPatterns.end(),
+		[str](const SubPattern &subPattern)
+		{
+			return MatchSubPattern(subPattern, str);
+		});
+}
+
+bool WildcardPattern::MatchSubPattern(const SubPattern &subPattern, std::wstring_view str)
+{
+	switch (subPattern.type)
+	{
+	case Type::Any:
+		return true;
+
+	case Type::Exact:
+		return str == subPattern.prefix.text;
+
+	case Type::Prefix:
+		return str.starts_with(subPattern.prefix.text);
+
+	case Type::Suffix:
+		return str.ends_with(subPattern.suffix.text);
+
+	case Type::Contains:
+		return FindLiteral(str, subPattern.middle[0].text, 0) != std::wstring_view::npos;
+
+	case Type::General:
+		return MatchGeneral(subPattern, str);
+	}
+
+	return false;
+}
+
+// The prefix and suffix are anchored to the start and end of the string. Each of the segments in
+// between can then be matched at the earliest position available, since a later match could never
+// leave more room for the segments that follow.
+bool WildcardPattern::MatchGeneral(const SubPattern &subPattern, std::wstring_view str)
+{
+	if (!subPattern.hasSequenceWildcard)
+	{
+		return str.size() == subPattern.prefix.text.size()
+			&& MatchSegmentAt(str, 0, subPattern.prefix.text);
+	}
+
+	if (str.size() < subPattern.minLength)
+	{
+		return false;
+	}
+
+	size_t suffixStart = str.size() - subPattern.suffix.text.size();
+
+	if (!MatchSegmentAt(str, 0, subPattern.prefix.text)
+		|| !MatchSegmentAt(str, suffixStart, subPattern.suffix.text))
+	{
+		return false;
+	}
+
+	std::wstring_view middle = str.substr(0, suffixStart);
+	size_t position = subPattern.prefix.text.size();
+
+	for (const auto &segment : subPattern.middle)
+	{
+		position = FindSegment(middle, segment.text, segment.hasSingleWildcard, position);
+
+		if (position == std::wstring_view::npos)
+		{
+			return false;
+		}
+
+		position += segment.text.size();
+	}
+
+	return true;
+}
@@ -0,0 +1,92 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// A wildcard pattern that's been compiled ahead of time, so that it can be efficiently matched
+// against a large number of strings. The pattern is interpreted in the same way as it is by
+// CheckWildcardMatch(): '*' matches any sequence of characters, '?' matches any single character
+// and a pattern containing ':' is split into a set of patterns, any of which can match (e.g.
+// "*.h: *.cpp").
+class WildcardPattern
+{
+public:
+	// The default pattern only matches the empty string.
+	WildcardPattern();
+	WildcardPattern(std::wstring_view pattern, bool caseSensitive);
+
+	bool Match(std::wstring_view str) const;
+
+	// If the pattern only consists of extension patterns (e.g. "*.txt" or "*.h: *.cpp"), returns
+	// the extensions, without the leading '.'. The extensions are lowercased if the pattern is
+	// case-insensitive. Returns std::nullopt for any other pattern.
+	std::optional<std::vector<std::wstring>> GetExtensions() const;
+
+	bool IsCaseSensitive() const;
+
+private:
+	// Most patterns are simple enough that they can be matched with a single comparison or search.
+	// Anything else is matched segment by segment.
+	enum class Type
+	{
+		// "*"
+		Any,
+
+		// "abc"
+		Exact,
+
+		// "abc*"
+		Prefix,
+
+		// "*abc" (which includes extension patterns like "*.txt")
+		Suffix,
+
+		// "*abc*"
+		Contains,
+
+		General
+	};
+
+	// A run of characters between '*' wildcards.
+	struct Segment
+	{
+		std::wstring text;
+
+		// Whether the segment contains any '?' wildcards.
+		bool hasSingleWildcard;
+	};
+
+	struct SubPattern
+	{
+		Type type;
+
+		// The text before the first '*' and after the last '*'. If the pattern doesn't contain any
+		// '*' wildcards, the entire pattern is stored in the prefix.
+		Segment prefix;
+		Segment suffix;
+
+		// The non-empty segments between the first and last '*'.
+		std::vector<Segment> middle;
+
+		// Whether the pattern contains any '*' wildcards.
+		bool hasSequenceWildcard;
+
+		// The minimum length of a string matched by the pattern.
+		size_t minLength;
+	};
+
+	static SubPattern CompileSubPattern(std::wstring_view pattern, bool caseSensitive);
+	static bool MatchSubPattern(const SubPattern &subPattern, std::wstring_view str);
+	static bool MatchGeneral(const SubPattern &subPattern, std::wstring_view str);
+
+	bool MatchFolded(std::wstring_view str) const;
+
+	std::vector<SubPattern> m_subPatterns;
+	bool m_caseSensitive;
+};
@@ -0,0 +1,113 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "pch.h"
+#include "ColorRuleMatcher.h"
+#include "ColorRule.h"
+#include "../Helper/StringHelper.h"
+#include <gtest/gtest.h>
+#include <tuple>
+
+namespace
+{
+
+std::vector<std::unique_ptr<ColorRule>> BuildRules(
+	const std::vector<std::tuple<std::wstring, bool, DWORD>> &ruleDefinitions)
+{
+	std::vector<std::unique_ptr<ColorRule>> rules;
+
+	for (const auto &[filterPattern, caseInsensitive, filterAttributes] : ruleDefinitions)
+	{
+		// Each rule is given a distinct color, so that it's possible to tell which rule matched.
+		rules.push_back(std::make_unique<ColorRule>(L"", filterPattern, caseInsensitive,
+			filterAttributes, RGB(rules.size(), 0, 0)));
+	}
+
+	return rules;
+}
+
+// Determines the color in the same way as the rules were originally evaluated, by checking each
+// rule in turn.
+std::optional<COLORREF> GetExpectedColor(const std::vector<std::unique_ptr<ColorRule>> &rules,
+	const std::wstring &displayName, std::optional<DWORD> attributes)
+{
+	for (const auto &rule : rules)
+	{
+		bool matchedFileName = rule->GetFilterPattern().empty()
+			|| CheckWildcardMatch(rule->GetFilterPattern().c_str(), displayName.c_str(),
+				!rule->GetFilterPatternCaseInsensitive());
+		bool matchedAttributes = rule->GetFilterAttributes() == 0
+			|| (attributes && WI_IsAnyFlagSet(*attributes, rule->GetFilterAttributes()));
+
+		if (matchedFileName && matchedAttributes)
+		{
+			return rule->GetColor();
+		}
+	}
+
+	return std::nullopt;
+}
+
+}
+
+TEST(ColorRuleMatcherTest, NoRules)
+{
+	ColorRuleMatcher matcher;
+	EXPECT_EQ(matcher.GetColor(L"file.txt", FILE_ATTRIBUTE_NORMAL), std::nullopt);
+}
+
+TEST(ColorRuleMatcherTest, FirstMatchingRuleWins)
+{
+	auto rules = BuildRules({ { L"*.exe", true, 0 }, { L"file*", true, 0 },
+		{ L"*.txt", true, 0 }, { L"", true, FILE_ATTRIBUTE_HIDDEN } });
+	ColorRuleMatcher matcher(rules);
+
+	EXPECT_EQ(matcher.GetColor(L"program.exe", 0), rules[0]->GetColor());
+
+	// Both the second and third rules match here, but the second rule appears first.
+	EXPECT_EQ(matcher.GetColor(L"file.txt", 0), rules[1]->GetColor());
+
+	EXPECT_EQ(matcher.GetColor(L"notes.TXT", 0), rules[2]->GetColor());
+	EXPECT_EQ(matcher.GetColor(L"image.png", FILE_ATTRIBUTE_HIDDEN), rules[3]->GetColor());
+	EXPECT_EQ(matcher.GetColor(L"image.png", 0), std::nullopt);
+}
+
+TEST(ColorRuleMatcherTest, Attributes)
+{
+	auto rules = BuildRules({ { L"*.txt", true, FILE_ATTRIBUTE_COMPRESSED }, { L"*.txt", true, 0 } });
+	ColorRuleMatcher matcher(rules);
+
+	EXPECT_EQ(matcher.GetColor(L"file.txt", FILE_ATTRIBUTE_COMPRESSED), rules[0]->GetColor());
+	EXPECT_EQ(matcher.GetColor(L"file.txt", FILE_ATTRIBUTE_ARCHIVE), rules[1]->GetColor());
+
+	// If the attributes aren't known, rules that filter on attributes shouldn't match.
+	EXPECT_EQ(matcher.GetColor(L"file.txt", std::nullopt), rules[1]->GetColor());
+}
+
+// Each name is checked against the set of rules, to verify that the result is the same as it would
+// be if each rule were checked in turn.
+TEST(ColorRuleMatcherTest, MatchesSequentialEvaluation)
+{
+	auto rules = BuildRules({ { L"*.TXT", false, 0 }, { L"*.doc: *.docx", true, 0 },
+		{ L"*.tar.gz", true, 0 }, { L"*.log", true, FILE_ATTRIBUTE_HIDDEN }, { L"a*", true, 0 },
+		{ L"*.ТЕКСТ", true, 0 }, { L"*.k", true, 0 }, { L"*.h", false, FILE_ATTRIBUTE_READONLY },
+		{ L"*.h", false, 0 }, { L"", true, FILE_ATTRIBUTE_SYSTEM }, { L"*.?", true, 0 } });
+	ColorRuleMatcher matcher(rules);
+
+	const std::vector<std::wstring> names = { L"", L"file", L"file.", L".txt", L"file.txt",
+		L"FILE.TXT", L"file.txt.bak", L"report.doc", L"report.DOC", L"report.docx",
+		L"archive.tar.gz", L"archive.gz", L"debug.log", L"a.log", L"abc", L"файл.текст",
+		L"файл.ТЕКСТ", L"file.K", L"header.h", L"HEADER.H", L"file.c", L"file.cpp" };
+	const std::vector<std::optional<DWORD>> attributeValues = { std::nullopt, 0,
+		FILE_ATTRIBUTE_HIDDEN, FILE_ATTRIBUTE_READONLY, FILE_ATTRIBUTE_SYSTEM };
+
+	for (const auto &name : names)
+	{
+		for (const auto &attributes : attributeValues)
+		{
+			EXPECT_EQ(matcher.GetColor(name, attributes), GetExpectedColor(rules, name, attributes))
+				<< "Name: \"" << name << "\"";
+		}
+	}
+}
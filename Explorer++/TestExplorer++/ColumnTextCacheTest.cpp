@@ -0,0 +1,76 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "pch.h"
+#include "../Explorer++/ShellBrowser/ColumnTextCache.h"
+#include <gtest/gtest.h>
+
+TEST(ColumnTextCacheTest, PendingRequest)
+{
+	ColumnTextCache cache;
+	EXPECT_FALSE(cache.IsRequestPending(1, ColumnType::Size));
+	EXPECT_EQ(cache.MaybeGetText(1, ColumnType::Size), nullptr);
+
+	cache.SetRequestPending(1, ColumnType::Size, 10);
+	EXPECT_TRUE(cache.IsRequestPending(1, ColumnType::Size));
+	EXPECT_FALSE(cache.IsRequestPending(1, ColumnType::Type));
+	EXPECT_EQ(cache.MaybeGetText(1, ColumnType::Size), nullptr);
+
+	EXPECT_TRUE(cache.SetText(1, ColumnType::Size, 10, L"1 KB"));
+	EXPECT_FALSE(cache.IsRequestPending(1, ColumnType::Size));
+
+	const std::wstring *text = cache.MaybeGetText(1, ColumnType::Size);
+	ASSERT_NE(text, nullptr);
+	EXPECT_EQ(*text, L"1 KB");
+}
+
+TEST(ColumnTextCacheTest, StaleResult)
+{
+	ColumnTextCache cache;
+	cache.SetRequestPending(1, ColumnType::Size, 10);
+	cache.InvalidateItem(1);
+
+	// The item was invalidated after the request was made, so the result should be dropped.
+	EXPECT_FALSE(cache.SetText(1, ColumnType::Size, 10, L"1 KB"));
+	EXPECT_EQ(cache.MaybeGetText(1, ColumnType::Size), nullptr);
+
+	// Only the result for the most recent request should be stored.
+	cache.SetRequestPending(1, ColumnType::Size, 11);
+	EXPECT_FALSE(cache.SetText(1, ColumnType::Size, 10, L"1 KB"));
+	EXPECT_TRUE(cache.SetText(1, ColumnType::Size, 11, L"2 KB"));
+	EXPECT_EQ(*cache.MaybeGetText(1, ColumnType::Size), L"2 KB");
+}
+
+TEST(ColumnTextCacheTest, InvalidateItem)
+{
+	ColumnTextCache cache;
+	cache.SetRequestPending(1, ColumnType::Size, 10);
+	cache.SetText(1, ColumnType::Size, 10, L"1 KB");
+	cache.SetRequestPending(1, ColumnType::Type, 11);
+	cache.SetText(1, ColumnType::Type, 11, L"Text Document");
+	cache.SetRequestPending(2, ColumnType::Size, 12);
+	cache.SetText(2, ColumnType::Size, 12, L"2 KB");
+
+	cache.InvalidateItem(1);
+	EXPECT_EQ(cache.MaybeGetText(1, ColumnType::Size), nullptr);
+	EXPECT_EQ(cache.MaybeGetText(1, ColumnType::Type), nullptr);
+	EXPECT_NE(cache.MaybeGetText(2, ColumnType::Size), nullptr);
+	EXPECT_EQ(cache.GetNumItems(), 1u);
+}
+
+TEST(ColumnTextCacheTest, ClearPendingRequests)
+{
+	ColumnTextCache cache;
+	cache.SetRequestPending(1, ColumnType::Size, 10);
+	cache.SetText(1, ColumnType::Size, 10, L"1 KB");
+	cache.SetRequestPending(1, ColumnType::Type, 11);
+	cache.SetRequestPending(2, ColumnType::Size, 12);
+
+	// Text that's already been retrieved should be retained.
+	cache.ClearPendingRequests();
+	EXPECT_NE(cache.MaybeGetText(1, ColumnType::Size), nullptr);
+	EXPECT_FALSE(cache.IsRequestPending(1, ColumnType::Type));
+	EXPECT_FALSE(cache.IsRequestPending(2, ColumnType::Size));
+	EXPECT_EQ(cache.GetNumItems(), 1u);
+}
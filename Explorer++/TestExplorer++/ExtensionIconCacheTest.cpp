@@ -0,0 +1,51 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "pch.h"
+#include "../Helper/ExtensionIconCache.h"
+#include <gtest/gtest.h>
+
+TEST(ExtensionIconCacheTest, KnownPerFileIconExtensions)
+{
+	EXPECT_TRUE(ExtensionIconCache::IsKnownPerFileIconExtension(L".exe"));
+	EXPECT_TRUE(ExtensionIconCache::IsKnownPerFileIconExtension(L".ico"));
+	EXPECT_TRUE(ExtensionIconCache::IsKnownPerFileIconExtension(L".lnk"));
+	EXPECT_TRUE(ExtensionIconCache::IsKnownPerFileIconExtension(L".url"));
+
+	// The check should be case-insensitive.
+	EXPECT_TRUE(ExtensionIconCache::IsKnownPerFileIconExtension(L".EXE"));
+	EXPECT_TRUE(ExtensionIconCache::IsKnownPerFileIconExtension(L".Lnk"));
+
+	EXPECT_FALSE(ExtensionIconCache::IsKnownPerFileIconExtension(L".txt"));
+	EXPECT_FALSE(ExtensionIconCache::IsKnownPerFileIconExtension(L".log"));
+	EXPECT_FALSE(ExtensionIconCache::IsKnownPerFileIconExtension(L".exe.txt"));
+	EXPECT_FALSE(ExtensionIconCache::IsKnownPerFileIconExtension(L"exe"));
+	EXPECT_FALSE(ExtensionIconCache::IsKnownPerFileIconExtension(L""));
+}
+
+TEST(ExtensionIconCacheTest, PerFileIconExtensionsNotCached)
+{
+	ExtensionIconCache extensionIconCache;
+	EXPECT_EQ(extensionIconCache.GetIconIndex(L".exe"), std::nullopt);
+	EXPECT_EQ(extensionIconCache.GetIconIndex(L".lnk"), std::nullopt);
+}
+
+TEST(ExtensionIconCacheTest, NoExtension)
+{
+	// Files without an extension shouldn't share a single cached icon.
+	ExtensionIconCache extensionIconCache;
+	EXPECT_EQ(extensionIconCache.GetIconIndex(L""), std::nullopt);
+	EXPECT_EQ(extensionIconCache.GetIconIndex(L"."), std::nullopt);
+}
+
+TEST(ExtensionIconCacheTest, SharedIcon)
+{
+	ExtensionIconCache extensionIconCache;
+	auto iconIndex = extensionIconCache.GetIconIndex(L".log");
+	ASSERT_NE(iconIndex, std::nullopt);
+
+	// Extensions are case-insensitive, so the same icon should be returned regardless of case.
+	EXPECT_EQ(extensionIconCache.GetIconIndex(L".LOG"), iconIndex);
+	EXPECT_EQ(extensionIconCache.GetIconIndex(L".log"), iconIndex);
+}
@@ -0,0 +1,216 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "pch.h"
+#include "../Helper/ImageCacheStore.h"
+#include <gtest/gtest.h>
+
+namespace
+{
+
+std::vector<uint32_t> BuildPixels(uint32_t width, uint32_t height, uint32_t seed)
+{
+	std::vector<uint32_t> pixels(static_cast<size_t>(width) * height);
+
+	for (size_t i = 0; i < pixels.size(); i++)
+	{
+		pixels[i] = seed * 0x01000193u + static_cast<uint32_t>(i);
+	}
+
+	return pixels;
+}
+
+std::vector<uint32_t> CopyPixels(const ImageCacheThumbnail &thumbnail)
+{
+	return { thumbnail.pixels.begin(), thumbnail.pixels.end() };
+}
+
+}
+
+TEST(ImageCacheStoreTest, Empty)
+{
+	ImageCacheStore store;
+	ImageCacheKey key = { L"C:\\file.jpg", 100, 200 };
+	EXPECT_EQ(store.GetOverlayIndex(key), std::nullopt);
+	EXPECT_EQ(store.GetThumbnail(key), std::nullopt);
+
+	auto data = store.Serialize(1024);
+
+	ImageCacheStore loadedStore(data);
+	EXPECT_EQ(loadedStore.GetOverlayIndex(key), std::nullopt);
+	EXPECT_EQ(loadedStore.GetThumbnail(key), std::nullopt);
+}
+
+TEST(ImageCacheStoreTest, RoundTrip)
+{
+	ImageCacheKey key1 = { L"C:\\file1.jpg", 100, 200 };
+	ImageCacheKey key2 = { L"C:\\file2.png", 300, 400 };
+	auto pixels = BuildPixels(4, 3, 1);
+
+	ImageCacheStore store;
+	store.SetOverlayIndex(key1, 2);
+	store.SetThumbnail(key1, 4, 3, pixels);
+	store.SetOverlayIndex(key2, 0);
+
+	auto data = store.Serialize(1024 * 1024);
+
+	ImageCacheStore loadedStore(data);
+	EXPECT_EQ(loadedStore.GetOverlayIndex(key1), 2);
+	EXPECT_EQ(loadedStore.GetOverlayIndex(key2), 0);
+	EXPECT_EQ(loadedStore.GetThumbnail(key2), std::nullopt);
+
+	auto thumbnail = loadedStore.GetThumbnail(key1);
+	ASSERT_NE(thumbnail, std::nullopt);
+	EXPECT_EQ(thumbnail->width, 4u);
+	EXPECT_EQ(thumbnail->height, 3u);
+	EXPECT_EQ(CopyPixels(*thumbnail), pixels);
+
+	// The thumbnail should be read directly from the serialized data, rather than being copied.
+	auto *thumbnailData = reinterpret_cast<const std::byte *>(thumbnail->pixels.data());
+	EXPECT_GE(thumbnailData, data.data());
+	EXPECT_LE(thumbnailData + thumbnail->pixels.size_bytes(), data.data() + data.size());
+}
+
+TEST(ImageCacheStoreTest, KeyMismatch)
+{
+	ImageCacheStore store;
+	store.SetOverlayIndex({ L"C:\\file.jpg", 100, 200 }, 1);
+
+	auto data = store.Serialize(1024);
+
+	// If the size or modification time of the file has changed, the cached data should be ignored.
+	ImageCacheStore loadedStore(data);
+	EXPECT_EQ(loadedStore.GetOverlayIndex({ L"C:\\file.jpg", 101, 200 }), std::nullopt);
+	EXPECT_EQ(loadedStore.GetOverlayIndex({ L"C:\\file.jpg", 100, 201 }), std::nullopt);
+	EXPECT_EQ(loadedStore.GetOverlayIndex({ L"C:\\other.jpg", 100, 200 }), std::nullopt);
+	EXPECT_EQ(loadedStore.GetOverlayIndex({ L"C:\\file.jpg", 100, 200 }), 1);
+}
+
+TEST(ImageCacheStoreTest, UpdateExistingEntry)
+{
+	ImageCacheKey key = { L"C:\\file.jpg", 100, 200 };
+	auto pixels = BuildPixels(2, 2, 1);
+
+	ImageCacheStore store;
+	store.SetThumbnail(key, 2, 2, pixels);
+	auto data = store.Serialize(1024);
+
+	// Setting the overlay index shouldn't affect the existing thumbnail.
+	ImageCacheStore updatedStore(data);
+	updatedStore.SetOverlayIndex(key, 3);
+	auto updatedData = updatedStore.Serialize(1024);
+
+	ImageCacheStore loadedStore(updatedData);
+	EXPECT_EQ(loadedStore.GetOverlayIndex(key), 3);
+
+	auto thumbnail = loadedStore.GetThumbnail(key);
+	ASSERT_NE(thumbnail, std::nullopt);
+	EXPECT_EQ(CopyPixels(*thumbnail), pixels);
+}
+
+TEST(ImageCacheStoreTest, ModifiedFileReplacesEntry)
+{
+	ImageCacheKey originalKey = { L"C:\\file.jpg", 100, 200 };
+	ImageCacheKey modifiedKey = { L"C:\\file.jpg", 150, 250 };
+
+	ImageCacheStore store;
+	store.SetOverlayIndex(originalKey, 1);
+	store.SetThumbnail(originalKey, 1, 1, BuildPixels(1, 1, 1));
+	auto data = store.Serialize(1024);
+
+	ImageCacheStore updatedStore(data);
+	updatedStore.SetOverlayIndex(modifiedKey, 2);
+	auto updatedData = updatedStore.Serialize(1024);
+
+	ImageCacheStore loadedStore(updatedData);
+	EXPECT_EQ(loadedStore.GetOverlayIndex(originalKey), std::nullopt);
+	EXPECT_EQ(loadedStore.GetThumbnail(originalKey), std::nullopt);
+	EXPECT_EQ(loadedStore.GetOverlayIndex(modifiedKey), 2);
+
+	// The thumbnail was for the previous version of the file, so it shouldn't be carried over.
+	EXPECT_EQ(loadedStore.GetThumbnail(modifiedKey), std::nullopt);
+}
+
+TEST(ImageCacheStoreTest, LeastRecentlyUsedEntriesEvicted)
+{
+	ImageCacheKey key1 = { L"C:\\file1.jpg", 1, 1 };
+	ImageCacheKey key2 = { L"C:\\file2.jpg", 2, 2 };
+	ImageCacheKey key3 = { L"C:\\file3.jpg", 3, 3 };
+	ImageCacheKey key4 = { L"C:\\file4.jpg", 4, 4 };
+
+	ImageCacheStore store;
+	store.SetThumbnail(key1, 8, 8, BuildPixels(8, 8, 1));
+	store.SetThumbnail(key2, 8, 8, BuildPixels(8, 8, 2));
+	store.SetThumbnail(key3, 8, 8, BuildPixels(8, 8, 3));
+	auto data = store.Serialize(1024 * 1024);
+
+	// Each entry is the same size, so the size of a single entry can be determined from the total
+	// size.
+	ImageCacheStore emptyStore;
+	size_t headerSize = emptyStore.Serialize(1024).size();
+	size_t entrySize = (data.size() - headerSize) / 3;
+
+	ImageCacheStore updatedStore(data);
+	EXPECT_NE(updatedStore.GetThumbnail(key2), std::nullopt);
+	updatedStore.SetThumbnail(key4, 8, 8, BuildPixels(8, 8, 4));
+
+	// There's only room for two entries. The entries that were used or added most recently should
+	// be the ones that are retained.
+	auto updatedData = updatedStore.Serialize(headerSize + 2 * entrySize);
+	EXPECT_EQ(updatedData.size(), headerSize + 2 * entrySize);
+
+	ImageCacheStore loadedStore(updatedData);
+	EXPECT_EQ(loadedStore.GetThumbnail(key1), std::nullopt);
+	EXPECT_NE(loadedStore.GetThumbnail(key2), std::nullopt);
+	EXPECT_EQ(loadedStore.GetThumbnail(key3), std::nullopt);
+	EXPECT_NE(loadedStore.GetThumbnail(key4), std::nullopt);
+}
+
+TEST(ImageCacheStoreTest, PendingThumbnailsLimitedToBudget)
+{
+	ImageCacheKey key1 = { L"C:\\file1.jpg", 1, 1 };
+	ImageCacheKey key2 = { L"C:\\file2.jpg", 2, 2 };
+	ImageCacheKey key3 = { L"C:\\file3.jpg", 3, 3 };
+
+	// There's only room for the pixels of two thumbnails.
+	ImageCacheStore store({}, 2 * 8 * 8 * sizeof(uint32_t));
+	store.SetOverlayIndex(key1, 1);
+	store.SetThumbnail(key1, 8, 8, BuildPixels(8, 8, 1));
+	store.SetThumbnail(key2, 8, 8, BuildPixels(8, 8, 2));
+	EXPECT_NE(store.GetThumbnail(key1), std::nullopt);
+	store.SetThumbnail(key3, 8, 8, BuildPixels(8, 8, 3));
+
+	// The thumbnail for the second item was used least recently, so it should have been discarded.
+	auto thumbnail1 = store.GetThumbnail(key1);
+	ASSERT_NE(thumbnail1, std::nullopt);
+	EXPECT_EQ(CopyPixels(*thumbnail1), BuildPixels(8, 8, 1));
+	EXPECT_EQ(store.GetThumbnail(key2), std::nullopt);
+	EXPECT_NE(store.GetThumbnail(key3), std::nullopt);
+
+	// Only the thumbnail should have been discarded, not any other data for the item.
+	EXPECT_EQ(store.GetOverlayIndex(key1), 1);
+}
+
+TEST(ImageCacheStoreTest, InvalidData)
+{
+	ImageCacheKey key = { L"C:\\file.jpg", 100, 200 };
+
+	ImageCacheStore store;
+	store.SetOverlayIndex(key, 1);
+	auto data = store.Serialize(1024);
+
+	auto truncatedData = data;
+	truncatedData.pop_back();
+	ImageCacheStore truncatedStore(truncatedData);
+	EXPECT_EQ(truncatedStore.GetOverlayIndex(key), std::nullopt);
+
+	auto corruptData = data;
+	corruptData[0] = std::byte{ 0 };
+	ImageCacheStore corruptStore(corruptData);
+	EXPECT_EQ(corruptStore.GetOverlayIndex(key), std::nullopt);
+
+	std::vector<std::byte> shortData(4);
+	ImageCacheStore shortStore(shortData);
+	EXPECT_EQ(shortStore.GetOverlayIndex(key), std::nullopt);
+}
@@ -0,0 +1,411 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "pch.h"
+#include "../Helper/ImageResampler.h"
+#include "ResourceHelper.h"
+#include <gtest/gtest.h>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace ImageResampler;
+using namespace PixelKernels;
+
+namespace
+{
+
+struct Image
+{
+	int width = 0;
+	int height = 0;
+	std::vector<uint32_t> pixels;
+};
+
+std::vector<InstructionSet> GetInstructionSetsToTest()
+{
+	std::vector<InstructionSet> instructionSets = { InstructionSet::Scalar };
+	auto supportedInstructionSet = GetSupportedInstructionSet();
+
+	if (supportedInstructionSet == InstructionSet::SSE41
+		|| supportedInstructionSet == InstructionSet::AVX2)
+	{
+		instructionSets.push_back(InstructionSet::SSE41);
+	}
+
+	if (supportedInstructionSet == InstructionSet::AVX2)
+	{
+		instructionSets.push_back(InstructionSet::AVX2);
+	}
+
+	return instructionSets;
+}
+
+const char *GetInstructionSetName(InstructionSet instructionSet)
+{
+	switch (instructionSet)
+	{
+	case InstructionSet::SSE41:
+		return "SSE4.1";
+
+	case InstructionSet::AVX2:
+		return "AVX2";
+
+	default:
+		return "scalar";
+	}
+}
+
+// Builds an image that contains a mix of smooth gradients (in the blue and green channels), hard
+// edges (in the red channel) and noise (in the alpha channel). The golden images were generated
+// from this pattern.
+Image BuildTestPattern(int width, int height)
+{
+	Image image;
+	image.width = width;
+	image.height = height;
+	image.pixels.resize(static_cast<size_t>(width) * height);
+
+	std::mt19937 generator(1);
+
+	for (int y = 0; y < height; y++)
+	{
+		for (int x = 0; x < width; x++)
+		{
+			uint32_t blue = x * 255 / (width - 1);
+			uint32_t green = y * 255 / (height - 1);
+			uint32_t red = ((x / 5 + y / 5) % 2 == 0) ? 255 : 0;
+			uint32_t alpha = generator() & 0xFF;
+
+			image.pixels[static_cast<size_t>(y) * width + x] =
+				(alpha << 24) | (red << 16) | (green << 8) | blue;
+		}
+	}
+
+	return image;
+}
+
+Image ResizeImage(const Image &source, int width, int height, const Options &options)
+{
+	Image destination;
+	destination.width = width;
+	destination.height = height;
+	destination.pixels.resize(static_cast<size_t>(width) * height);
+
+	Resize(source.pixels.data(), source.width, source.height, source.width,
+		destination.pixels.data(), width, height, width, options);
+
+	return destination;
+}
+
+// Golden images are stored in the PAM format, with 8-bit RGBA channels, so that they can be viewed
+// in a standard image viewer.
+Image LoadGoldenImage(const std::wstring &filename)
+{
+	std::ifstream file(GetResourcePath(filename), std::ios::binary);
+
+	if (!file)
+	{
+		ADD_FAILURE() << "Failed to open golden image";
+		return {};
+	}
+
+	Image image;
+	int depth = 0;
+	std::string line;
+
+	while (std::getline(file, line) && line != "ENDHDR")
+	{
+		std::istringstream stream(line);
+		std::string field;
+		stream >> field;
+
+		if (field == "WIDTH")
+		{
+			stream >> image.width;
+		}
+		else if (field == "HEIGHT")
+		{
+			stream >> image.height;
+		}
+		else if (field == "DEPTH")
+		{
+			stream >> depth;
+		}
+	}
+
+	if (depth != 4 || image.width <= 0 || image.height <= 0)
+	{
+		ADD_FAILURE() << "Golden image is in an unexpected format";
+		return {};
+	}
+
+	image.pixels.resize(static_cast<size_t>(image.width) * image.height);
+
+	for (auto &pixel : image.pixels)
+	{
+		unsigned char rgba[4];
+		file.read(reinterpret_cast<char *>(rgba), sizeof(rgba));
+
+		pixel = (static_cast<uint32_t>(rgba[3]) << 24) | (static_cast<uint32_t>(rgba[0]) << 16)
+			| (static_cast<uint32_t>(rgba[1]) << 8) | rgba[2];
+	}
+
+	if (!file)
+	{
+		ADD_FAILURE() << "Golden image is truncated";
+		return {};
+	}
+
+	return image;
+}
+
+// The SIMD implementations sum the weights in a different order to the scalar implementation, so
+// each channel is allowed to differ by 1.
+void ExpectImagesNear(const Image &image, const Image &expected)
+{
+	ASSERT_EQ(image.width, expected.width);
+	ASSERT_EQ(image.height, expected.height);
+
+	for (size_t i = 0; i < image.pixels.size(); i++)
+	{
+		for (int channel = 0; channel < 4; channel++)
+		{
+			int value = (image.pixels[i] >> (channel * 8)) & 0xFF;
+			int expectedValue = (expected.pixels[i] >> (channel * 8)) & 0xFF;
+			ASSERT_LE(std::abs(value - expectedValue), 1)
+				<< "Pixel " << i << ", channel " << channel;
+		}
+	}
+}
+
+}
+
+class ImageResamplerGoldenTest :
+	public testing::TestWithParam<std::tuple<Filter, int, int, const wchar_t *>>
+{
+};
+
+TEST_P(ImageResamplerGoldenTest, MatchesGoldenImage)
+{
+	auto [filter, width, height, goldenFilename] = GetParam();
+
+	auto source = BuildTestPattern(97, 61);
+	auto golden = LoadGoldenImage(goldenFilename);
+
+	for (auto instructionSet : GetInstructionSetsToTest())
+	{
+		SCOPED_TRACE(GetInstructionSetName(instructionSet));
+
+		Options options;
+		options.filter = filter;
+		options.instructionSet = instructionSet;
+
+		ExpectImagesNear(ResizeImage(source, width, height, options), golden);
+	}
+}
+
+INSTANTIATE_TEST_SUITE_P(Images, ImageResamplerGoldenTest,
+	testing::Values(
+		std::make_tuple(Filter::AreaAverage, 40, 25, L"image-resampler-area-average.pam"),
+		std::make_tuple(Filter::Lanczos3, 31, 17, L"image-resampler-lanczos3.pam"),
+		std::make_tuple(Filter::Lanczos3, 150, 100, L"image-resampler-lanczos3-upscale.pam")));
+
+TEST(ImageResamplerTest, ConstantImage)
+{
+	Image source;
+	source.width = 53;
+	source.height = 37;
+	source.pixels.assign(static_cast<size_t>(source.width) * source.height, 0x80C04020);
+
+	for (auto filter : { Filter::AreaAverage, Filter::Lanczos3 })
+	{
+		for (auto instructionSet : GetInstructionSetsToTest())
+		{
+			SCOPED_TRACE(GetInstructionSetName(instructionSet));
+
+			Options options;
+			options.filter = filter;
+			options.instructionSet = instructionSet;
+
+			// The weights for each output pixel sum to 1, so a constant image should remain
+			// unchanged, regardless of how it's resized.
+			auto resized = ResizeImage(source, 20, 11, options);
+			EXPECT_EQ(resized.pixels, std::vector<uint32_t>(resized.pixels.size(), 0x80C04020));
+
+			resized = ResizeImage(source, 80, 60, options);
+			EXPECT_EQ(resized.pixels, std::vector<uint32_t>(resized.pixels.size(), 0x80C04020));
+		}
+	}
+}
+
+TEST(ImageResamplerTest, AreaAverageHalfSize)
+{
+	Image source;
+	source.width = 4;
+	source.height = 2;
+	source.pixels = { 0x00000000, 0x04040404, 0x10203040, 0x10203040, 0x08080808, 0x0C0C0C0C,
+		0x10203040, 0x10203040 };
+
+	for (auto instructionSet : GetInstructionSetsToTest())
+	{
+		SCOPED_TRACE(GetInstructionSetName(instructionSet));
+
+		Options options;
+		options.filter = Filter::AreaAverage;
+		options.instructionSet = instructionSet;
+
+		// Each output pixel is exactly the average of a 2x2 block of source pixels.
+		auto resized = ResizeImage(source, 2, 1, options);
+		EXPECT_EQ(resized.pixels, (std::vector<uint32_t>{ 0x06060606, 0x10203040 }));
+	}
+}
+
+TEST(ImageResamplerTest, Stride)
+{
+	auto source = BuildTestPattern(40, 30);
+
+	// The source image is embedded in a larger buffer, with each row padded.
+	const int SOURCE_STRIDE = 47;
+	std::vector<uint32_t> paddedSource(static_cast<size_t>(SOURCE_STRIDE) * source.height,
+		0xFFFFFFFF);
+
+	for (int y = 0; y < source.height; y++)
+	{
+		std::copy_n(source.pixels.begin() + static_cast<size_t>(y) * source.width, source.width,
+			paddedSource.begin() + static_cast<size_t>(y) * SOURCE_STRIDE);
+	}
+
+	Options options;
+	options.filter = Filter::Lanczos3;
+	auto expected = ResizeImage(source, 15, 11, options);
+
+	const int DESTINATION_STRIDE = 19;
+	std::vector<uint32_t> destination(static_cast<size_t>(DESTINATION_STRIDE) * 11, 0x12345678);
+	Resize(paddedSource.data(), source.width, source.height, SOURCE_STRIDE, destination.data(),
+		15, 11, DESTINATION_STRIDE, options);
+
+	for (int y = 0; y < 11; y++)
+	{
+		for (int x = 0; x < DESTINATION_STRIDE; x++)
+		{
+			uint32_t pixel = destination[static_cast<size_t>(y) * DESTINATION_STRIDE + x];
+
+			// The padding in the destination should be left untouched.
+			if (x < 15)
+			{
+				EXPECT_EQ(pixel, expected.pixels[static_cast<size_t>(y) * 15 + x]);
+			}
+			else
+			{
+				EXPECT_EQ(pixel, 0x12345678u);
+			}
+		}
+	}
+}
+
+TEST(ImageResamplerTest, MultipleThreads)
+{
+	// This is large enough that the work will be split across threads.
+	auto source = BuildTestPattern(1024, 1024);
+
+	for (auto filter : { Filter::AreaAverage, Filter::Lanczos3 })
+	{
+		Options singleThreadOptions;
+		singleThreadOptions.filter = filter;
+		singleThreadOptions.maxThreads = 1;
+
+		Options multipleThreadOptions;
+		multipleThreadOptions.filter = filter;
+		multipleThreadOptions.maxThreads = 4;
+
+		// Each row is processed in exactly the same way, regardless of which thread it's processed
+		// on, so the results should be identical.
+		EXPECT_EQ(ResizeImage(source, 250, 170, singleThreadOptions).pixels,
+			ResizeImage(source, 250, 170, multipleThreadOptions).pixels);
+	}
+}
+
+TEST(ImageResamplerTest, FitWithin)
+{
+	// Images that already fit shouldn't be enlarged.
+	auto size = FitWithin({ 100, 50 }, { 120, 120 });
+	EXPECT_EQ(size.width, 100);
+	EXPECT_EQ(size.height, 50);
+
+	size = FitWithin({ 1000, 500 }, { 120, 120 });
+	EXPECT_EQ(size.width, 120);
+	EXPECT_EQ(size.height, 60);
+
+	size = FitWithin({ 300, 900 }, { 120, 120 });
+	EXPECT_EQ(size.width, 40);
+	EXPECT_EQ(size.height, 120);
+
+	// Very narrow images should still be at least a pixel wide.
+	size = FitWithin({ 1, 10000 }, { 120, 120 });
+	EXPECT_EQ(size.width, 1);
+	EXPECT_EQ(size.height, 120);
+}
+
+// This is a benchmark, rather than a test, so it's disabled by default. It can be run by passing
+// --gtest_also_run_disabled_tests --gtest_filter=ImageResamplerBenchmark.*
+TEST(ImageResamplerBenchmark, DISABLED_PixelsPerSecond)
+{
+	// Equivalent to scaling a 256x256 cached thumbnail down to the size shown in the listview, as
+	// well as scaling a large photo down to the size shown in the display window.
+	struct Scenario
+	{
+		const char *name;
+		int sourceWidth;
+		int sourceHeight;
+		int destinationWidth;
+		int destinationHeight;
+		Filter filter;
+		int numIterations;
+	};
+
+	const Scenario scenarios[] = {
+		{ "Thumbnail", 256, 256, 120, 120, Filter::AreaAverage, 2000 },
+		{ "Display window", 4000, 3000, 160, 120, Filter::Lanczos3, 10 }
+	};
+
+	for (const auto &scenario : scenarios)
+	{
+		auto source = BuildTestPattern(scenario.sourceWidth, scenario.sourceHeight);
+
+		for (auto instructionSet : GetInstructionSetsToTest())
+		{
+			for (int maxThreads : { 1, 0 })
+			{
+				Options options;
+				options.filter = scenario.filter;
+				options.instructionSet = instructionSet;
+				options.maxThreads = maxThreads;
+
+				auto start = std::chrono::steady_clock::now();
+
+				for (int i = 0; i < scenario.numIterations; i++)
+				{
+					ResizeImage(source, scenario.destinationWidth, scenario.destinationHeight,
+						options);
+				}
+
+				auto duration = std::chrono::steady_clock::now() - start;
+				auto seconds = std::chrono::duration<double>(duration).count();
+				auto numPixels = static_cast<double>(scenario.sourceWidth)
+					* scenario.sourceHeight * scenario.numIterations;
+
+				std::cout << scenario.name << " (" << GetInstructionSetName(instructionSet)
+						  << ", " << (maxThreads == 1 ? "single thread" : "all threads")
+						  << "): " << numPixels / seconds / 1e6 << " source megapixels/s"
+						  << std::endl;
+			}
+		}
+	}
+}
@@ -0,0 +1,246 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "pch.h"
+#include "../Explorer++/ShellBrowser/ItemStore.h"
+#include "../Helper/Macros.h"
+#include <gtest/gtest.h>
+#include <ShlObj.h>
+#include <iostream>
+#include <stdexcept>
+#include <strsafe.h>
+
+namespace
+{
+ItemInfo_t BuildItem(const std::wstring &name, DWORD attributes, uint64_t size,
+	bool createPidls = false)
+{
+	ItemInfo_t itemInfo;
+	std::wstring path = L"C:\\Store\\" + name;
+
+	if (createPidls)
+	{
+		itemInfo.pidlComplete.reset(SHSimpleIDListFromPath(path.c_str()));
+		itemInfo.pridl.reset(ILCloneChild(ILFindLastID(itemInfo.pidlComplete.get())));
+	}
+
+	StringCchCopy(itemInfo.wfd.cFileName, SIZEOF_ARRAY(itemInfo.wfd.cFileName), name.c_str());
+	itemInfo.wfd.dwFileAttributes = attributes;
+	itemInfo.wfd.nFileSizeLow = static_cast<DWORD>(size);
+	itemInfo.wfd.nFileSizeHigh = static_cast<DWORD>(size >> 32);
+	itemInfo.isFindDataValid = true;
+	itemInfo.parsingName = path;
+	itemInfo.displayName = name;
+	itemInfo.editingName = name;
+	return itemInfo;
+}
+}
+
+TEST(ItemStoreTest, Insert)
+{
+	ItemStore store;
+	store.Insert(0, BuildItem(L"file.txt", FILE_ATTRIBUTE_ARCHIVE, 0x100000010));
+	store.Insert(1, BuildItem(L"folder", FILE_ATTRIBUTE_DIRECTORY, 0));
+
+	EXPECT_EQ(store.GetNumItems(), 2u);
+	EXPECT_TRUE(store.Contains(0));
+	EXPECT_TRUE(store.Contains(1));
+	EXPECT_FALSE(store.Contains(2));
+
+	EXPECT_EQ(store.GetDisplayName(0), L"file.txt");
+	EXPECT_EQ(store.GetFileName(0), L"file.txt");
+	EXPECT_EQ(store.GetParsingName(0), L"C:\\Store\\file.txt");
+	EXPECT_EQ(store.GetFileSize(0), 0x100000010u);
+	EXPECT_FALSE(store.IsFolder(0));
+
+	EXPECT_EQ(store.GetDisplayName(1), L"folder");
+	EXPECT_TRUE(store.IsFolder(1));
+}
+
+TEST(ItemStoreTest, FindData)
+{
+	ItemStore store;
+	auto item = BuildItem(L"file.txt", FILE_ATTRIBUTE_HIDDEN, 1234);
+	item.wfd.ftLastWriteTime = { 1, 2 };
+	WIN32_FIND_DATA originalFindData = item.wfd;
+	store.Insert(0, std::move(item));
+
+	WIN32_FIND_DATA wfd = store.GetFindData(0);
+	EXPECT_EQ(wfd.dwFileAttributes, originalFindData.dwFileAttributes);
+	EXPECT_EQ(wfd.nFileSizeLow, originalFindData.nFileSizeLow);
+	EXPECT_EQ(wfd.nFileSizeHigh, originalFindData.nFileSizeHigh);
+	EXPECT_EQ(CompareFileTime(&wfd.ftLastWriteTime, &originalFindData.ftLastWriteTime), 0);
+	EXPECT_STREQ(wfd.cFileName, originalFindData.cFileName);
+}
+
+TEST(ItemStoreTest, Erase)
+{
+	ItemStore store;
+	store.Insert(0, BuildItem(L"a", FILE_ATTRIBUTE_NORMAL, 1));
+	store.Insert(1, BuildItem(L"b", FILE_ATTRIBUTE_NORMAL, 2));
+	store.Insert(2, BuildItem(L"c", FILE_ATTRIBUTE_NORMAL, 3));
+
+	// Erasing an item moves the last item into its place, so the data for the remaining items
+	// should be unaffected.
+	store.Erase(0);
+
+	EXPECT_EQ(store.GetNumItems(), 2u);
+	EXPECT_FALSE(store.Contains(0));
+	EXPECT_EQ(store.GetDisplayName(1), L"b");
+	EXPECT_EQ(store.GetFileSize(1), 2u);
+	EXPECT_EQ(store.GetDisplayName(2), L"c");
+	EXPECT_EQ(store.GetFileSize(2), 3u);
+
+	store.Erase(2);
+
+	EXPECT_EQ(store.GetIds(), std::vector<int>{ 1 });
+
+	// Looking up an item that's been erased shouldn't read past the end of the stored data.
+	EXPECT_FALSE(store.Contains(2));
+	EXPECT_THROW(store.GetFileSize(2), std::out_of_range);
+	EXPECT_THROW(store.GetDisplayName(0), std::out_of_range);
+	EXPECT_THROW(store.GetFileSize(100), std::out_of_range);
+}
+
+TEST(ItemStoreTest, Replace)
+{
+	ItemStore store;
+	store.Insert(0, BuildItem(L"old.txt", FILE_ATTRIBUTE_NORMAL, 1));
+	store.Replace(0, BuildItem(L"new.txt", FILE_ATTRIBUTE_READONLY, 2));
+
+	EXPECT_EQ(store.GetNumItems(), 1u);
+	EXPECT_EQ(store.GetDisplayName(0), L"new.txt");
+	EXPECT_EQ(store.GetAttributes(0), static_cast<DWORD>(FILE_ATTRIBUTE_READONLY));
+	EXPECT_EQ(store.GetFileSize(0), 2u);
+}
+
+TEST(ItemStoreTest, RenameChurn)
+{
+	ItemStore store;
+	store.Insert(0, BuildItem(L"file", FILE_ATTRIBUTE_NORMAL, 0));
+
+	// The names that are no longer used should be discarded at some point, without affecting the
+	// current name.
+	for (int i = 0; i < 10000; i++)
+	{
+		store.SetDisplayName(0, L"file " + std::to_wstring(i));
+	}
+
+	EXPECT_EQ(store.GetDisplayName(0), L"file 9999");
+	EXPECT_EQ(store.GetFileName(0), L"file");
+	EXPECT_LT(store.GetMemoryUsage().strings, 10000 * sizeof(wchar_t) * 10);
+}
+
+TEST(ItemStoreTest, BasicItemInfo)
+{
+	ItemStore store;
+	store.Insert(0, BuildItem(L"file.txt", FILE_ATTRIBUTE_NORMAL, 10, true));
+
+	auto basicItemInfo = store.GetBasicItemInfo(0);
+	EXPECT_STREQ(basicItemInfo.szDisplayName, L"file.txt");
+	EXPECT_TRUE(ArePidlsEquivalent(basicItemInfo.pidlComplete.get(), store.GetPidlComplete(0)));
+
+	auto basicItemInfoWithoutPidls = store.GetBasicItemInfo(0, false);
+	EXPECT_STREQ(basicItemInfoWithoutPidls.szDisplayName, L"file.txt");
+	EXPECT_EQ(basicItemInfoWithoutPidls.pidlComplete.get(), nullptr);
+}
+
+TEST(ItemStoreTest, FindByFileName)
+{
+	ItemStore store;
+	store.Insert(0, BuildItem(L"file.txt", FILE_ATTRIBUTE_NORMAL, 0));
+	store.Insert(1, BuildItem(L"FILE.txt", FILE_ATTRIBUTE_NORMAL, 0));
+	store.Insert(2, BuildItem(L"other.txt", FILE_ATTRIBUTE_NORMAL, 0));
+
+	EXPECT_EQ(store.FindByFileName(L"file.txt"), 0);
+	EXPECT_EQ(store.FindByFileName(L"FILE.txt"), 1);
+	EXPECT_EQ(store.FindByFileName(L"OTHER.TXT"), 2);
+	EXPECT_EQ(store.FindByFileName(L"missing.txt"), std::nullopt);
+
+	store.Replace(2, BuildItem(L"renamed.txt", FILE_ATTRIBUTE_NORMAL, 0));
+	EXPECT_EQ(store.FindByFileName(L"other.txt"), std::nullopt);
+	EXPECT_EQ(store.FindByFileName(L"renamed.txt"), 2);
+
+	store.Erase(0);
+	EXPECT_EQ(store.FindByFileName(L"file.txt"), 1);
+	EXPECT_EQ(store.FindByFileName(L"renamed.txt"), 2);
+}
+
+TEST(ItemStoreTest, FindByPidlChild)
+{
+	ItemStore store;
+	store.Insert(0, BuildItem(L"first", FILE_ATTRIBUTE_NORMAL, 0, true));
+	store.Insert(1, BuildItem(L"second", FILE_ATTRIBUTE_NORMAL, 0, true));
+
+	auto item = BuildItem(L"second", FILE_ATTRIBUTE_NORMAL, 0, true);
+	EXPECT_EQ(store.FindByPidlChild(item.pridl.get()), 1);
+
+	auto missingItem = BuildItem(L"third", FILE_ATTRIBUTE_NORMAL, 0, true);
+	EXPECT_EQ(store.FindByPidlChild(missingItem.pridl.get()), std::nullopt);
+
+	store.Erase(1);
+	EXPECT_EQ(store.FindByPidlChild(item.pridl.get()), std::nullopt);
+	EXPECT_EQ(store.FindByPidlChild(store.GetPidlChild(0)), 0);
+}
+
+// This is a memory report, rather than a test, so it's disabled by default. It can be run by
+// passing --gtest_also_run_disabled_tests --gtest_filter=ItemStoreBenchmark.*
+TEST(ItemStoreBenchmark, DISABLED_BytesPerItem)
+{
+	const int NUM_ITEMS = 500000;
+
+	// The layout of the structure that was previously stored for each item.
+	struct PreviousItemInfo : ItemInfo_t
+	{
+		int iIcon;
+		TCHAR szDrive[4];
+		int iRelativeSort;
+	};
+
+	auto getStringHeapSize = [](const std::wstring &str)
+	{
+		// Strings that fit within the small string buffer don't require a separate allocation.
+		std::wstring emptyString;
+		return (str.capacity() > emptyString.capacity())
+			? (str.capacity() + 1) * sizeof(wchar_t)
+			: 0;
+	};
+
+	size_t previousBytes = 0;
+	ItemStore store;
+
+	for (int i = 0; i < NUM_ITEMS; i++)
+	{
+		auto item = BuildItem(L"File " + std::to_wstring(i) + L".txt", FILE_ATTRIBUTE_ARCHIVE,
+			i, true);
+		ASSERT_TRUE(item.pidlComplete);
+
+		// Each item was previously held in an unordered_map node (containing the key/value pair
+		// and two list pointers), with a bucket entry (another two pointers) per item.
+		previousBytes += sizeof(std::pair<const int, PreviousItemInfo>) + 4 * sizeof(void *);
+		previousBytes += getStringHeapSize(item.parsingName)
+			+ getStringHeapSize(item.displayName) + getStringHeapSize(item.editingName);
+		previousBytes += ILGetSize(item.pidlComplete.get()) + ILGetSize(item.pridl.get());
+
+		store.Insert(i, std::move(item));
+	}
+
+	auto usage = store.GetMemoryUsage();
+
+	auto report = [](const char *description, size_t bytes)
+	{
+		std::cout << description << ": " << (bytes / NUM_ITEMS) << " bytes/item" << std::endl;
+	};
+
+	std::cout << NUM_ITEMS << " items (heap allocator overhead not included)" << std::endl;
+	report("Before (unordered_map<int, ItemInfo_t>)", previousBytes);
+	report("After (ItemStore)", usage.GetTotal());
+	report("  Hot data (attributes, size, times, name handle)", usage.hotData);
+	report("  Cold data (PIDL pointers, name handles)", usage.coldData);
+	report("  PIDLs", usage.pidls);
+	report("  Interned strings", usage.strings);
+	report("  Id index", usage.index);
+
+	EXPECT_LT(usage.GetTotal(), previousBytes);
+}
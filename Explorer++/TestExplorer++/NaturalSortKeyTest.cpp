@@ -0,0 +1,238 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "pch.h"
+#include "../Helper/NaturalSortKey.h"
+#include <gtest/gtest.h>
+#include <Shlwapi.h>
+#include <chrono>
+#include <iostream>
+#include <numeric>
+#include <random>
+
+namespace
+{
+int Sign(int value)
+{
+	return (value > 0) - (value < 0);
+}
+
+int CompareNatural(const std::wstring &text1, const std::wstring &text2)
+{
+	return CompareNaturalSortKeys(BuildNaturalSortKey(text1), BuildNaturalSortKey(text2));
+}
+
+void ExpectMatchesStrCmpLogical(const std::wstring &text1, const std::wstring &text2)
+{
+	EXPECT_EQ(Sign(CompareNatural(text1, text2)),
+		Sign(StrCmpLogicalW(text1.c_str(), text2.c_str())))
+		<< "\"" << text1 << "\" vs \"" << text2 << "\"";
+}
+
+// Generates a name made up of alternating runs of text and numbers. The text includes accented
+// and non-Latin letters, as well as punctuation that's ignored when comparing words (hyphens and
+// apostrophes), since those are the characters most likely to be ordered differently by a naive
+// comparison.
+std::wstring GenerateName(std::mt19937 &generator)
+{
+	static constexpr std::wstring_view textCharacters =
+		L"abcdeABCDEz ._-'\u00e9\u00c9\u00e8\u00fc\u00df\u00f1\u00e5\u00c5\u0436\u0416";
+
+	std::uniform_int_distribution<int> numRunsDistribution(1, 5);
+	std::uniform_int_distribution<int> runLengthDistribution(1, 3);
+	std::uniform_int_distribution<size_t> characterDistribution(0, textCharacters.size() - 1);
+	std::uniform_int_distribution<int> numberDistribution(0, 999999999);
+	std::bernoulli_distribution startWithNumberDistribution(0.3);
+
+	std::wstring name;
+	bool number = startWithNumberDistribution(generator);
+	int numRuns = numRunsDistribution(generator);
+
+	for (int i = 0; i < numRuns; i++)
+	{
+		if (number)
+		{
+			// Smaller numbers are generated more often, so that numbers that are equal (or only
+			// differ slightly) are regularly compared against each other.
+			int value = numberDistribution(generator);
+			value = (i % 2 == 0) ? value % 20 : value;
+			name += std::to_wstring(value);
+		}
+		else
+		{
+			int runLength = runLengthDistribution(generator);
+
+			for (int j = 0; j < runLength; j++)
+			{
+				name += textCharacters[characterDistribution(generator)];
+			}
+		}
+
+		number = !number;
+	}
+
+	return name;
+}
+}
+
+TEST(NaturalSortKeyTest, Numbers)
+{
+	EXPECT_LT(CompareNatural(L"file2", L"file10"), 0);
+	EXPECT_GT(CompareNatural(L"file10", L"file2"), 0);
+	EXPECT_LT(CompareNatural(L"1", L"2"), 0);
+	EXPECT_LT(CompareNatural(L"9", L"10"), 0);
+	EXPECT_LT(CompareNatural(L"a1b2", L"a1b10"), 0);
+	EXPECT_LT(CompareNatural(L"4294967295", L"4294967296"), 0);
+	EXPECT_LT(CompareNatural(L"99999999999999999999", L"100000000000000000000"), 0);
+
+	// Numbers that only differ in their leading zeros should be ordered in the same way as they
+	// are by StrCmpLogicalW().
+	ExpectMatchesStrCmpLogical(L"01", L"1");
+	ExpectMatchesStrCmpLogical(L"file007", L"file7");
+}
+
+TEST(NaturalSortKeyTest, CaseInsensitive)
+{
+	EXPECT_EQ(CompareNatural(L"File", L"file"), 0);
+	EXPECT_EQ(CompareNatural(L"FILE10.TXT", L"file10.txt"), 0);
+	EXPECT_LT(CompareNatural(L"a", L"B"), 0);
+	EXPECT_GT(CompareNatural(L"b", L"A"), 0);
+	EXPECT_EQ(CompareNatural(L"Привет", L"привет"), 0);
+}
+
+TEST(NaturalSortKeyTest, Prefixes)
+{
+	EXPECT_EQ(CompareNatural(L"", L""), 0);
+	EXPECT_LT(CompareNatural(L"", L"a"), 0);
+	EXPECT_LT(CompareNatural(L"file", L"file1"), 0);
+	EXPECT_LT(CompareNatural(L"file", L"file.txt"), 0);
+	EXPECT_LT(CompareNatural(L"1", L"12"), 0);
+}
+
+TEST(NaturalSortKeyTest, CharacterClasses)
+{
+	// Punctuation sorts before numbers, which sort before letters.
+	EXPECT_LT(CompareNatural(L" ", L"1"), 0);
+	EXPECT_LT(CompareNatural(L"_", L"0"), 0);
+	EXPECT_LT(CompareNatural(L"1", L"a"), 0);
+	EXPECT_LT(CompareNatural(L"file_1", L"file1"), 0);
+	EXPECT_LT(CompareNatural(L"file1", L"filea"), 0);
+	EXPECT_LT(CompareNatural(L"z", L"я"), 0);
+}
+
+TEST(NaturalSortKeyTest, Accents)
+{
+	// Accented letters are sorted alongside the unaccented letter, rather than after "z".
+	EXPECT_LT(CompareNatural(L"\u00e9cole", L"zebra"), 0);
+	EXPECT_LT(CompareNatural(L"e", L"\u00e9"), 0);
+	EXPECT_LT(CompareNatural(L"\u00e9", L"f"), 0);
+	EXPECT_EQ(CompareNatural(L"\u00c9cole", L"\u00e9cole"), 0);
+
+	ExpectMatchesStrCmpLogical(L"\u00e9cole", L"ecole");
+	ExpectMatchesStrCmpLogical(L"\u00fcber", L"uber2");
+}
+
+TEST(NaturalSortKeyTest, IgnoredPunctuation)
+{
+	// Hyphens and apostrophes are ignored when comparing words, so these names are ordered as if
+	// the punctuation wasn't there (rather than the punctuation sorting before the letters).
+	EXPECT_GT(CompareNatural(L"co-op", L"cob"), 0);
+	EXPECT_GT(CompareNatural(L"can't", L"cano"), 0);
+
+	ExpectMatchesStrCmpLogical(L"co-op", L"coop");
+	ExpectMatchesStrCmpLogical(L"can't", L"cant");
+	ExpectMatchesStrCmpLogical(L"-file", L"file");
+}
+
+TEST(NaturalSortKeyTest, MatchesStrCmpLogical)
+{
+	std::mt19937 generator(20240717);
+
+	std::vector<std::wstring> names;
+
+	for (int i = 0; i < 500; i++)
+	{
+		names.push_back(GenerateName(generator));
+	}
+
+	std::vector<std::string> keys;
+
+	for (const auto &name : names)
+	{
+		keys.push_back(BuildNaturalSortKey(name));
+	}
+
+	for (size_t i = 0; i < names.size(); i++)
+	{
+		for (size_t j = 0; j < names.size(); j++)
+		{
+			EXPECT_EQ(Sign(CompareNaturalSortKeys(keys[i], keys[j])),
+				Sign(StrCmpLogicalW(names[i].c_str(), names[j].c_str())))
+				<< "\"" << names[i] << "\" vs \"" << names[j] << "\"";
+		}
+	}
+}
+
+// This is a benchmark, rather than a test, so it's disabled by default. It can be run by passing
+// --gtest_also_run_disabled_tests --gtest_filter=NaturalSortKeyBenchmark.*
+TEST(NaturalSortKeyBenchmark, DISABLED_Sort1MNames)
+{
+	const int NUM_NAMES = 1000000;
+
+	std::mt19937 generator(1);
+	std::vector<std::wstring> names;
+	names.reserve(NUM_NAMES);
+
+	for (int i = 0; i < NUM_NAMES; i++)
+	{
+		names.push_back(GenerateName(generator));
+	}
+
+	auto reportResult = [](const char *description, std::chrono::steady_clock::duration duration)
+	{
+		std::cout << description << ": " << std::chrono::duration<double>(duration).count() << "s"
+				  << std::endl;
+	};
+
+	// Before: each comparison parses both names.
+	std::vector<int> orderBefore(NUM_NAMES);
+	std::iota(orderBefore.begin(), orderBefore.end(), 0);
+
+	auto start = std::chrono::steady_clock::now();
+	std::stable_sort(orderBefore.begin(), orderBefore.end(),
+		[&names](int index1, int index2)
+		{
+			return StrCmpLogicalW(names[index1].c_str(), names[index2].c_str()) < 0;
+		});
+	reportResult("StrCmpLogicalW", std::chrono::steady_clock::now() - start);
+
+	// After: a key is built once for each name (which is included in the time taken) and only the
+	// keys are compared.
+	std::vector<int> orderAfter(NUM_NAMES);
+	std::iota(orderAfter.begin(), orderAfter.end(), 0);
+
+	start = std::chrono::steady_clock::now();
+
+	std::vector<std::string> keys;
+	keys.reserve(NUM_NAMES);
+
+	for (const auto &name : names)
+	{
+		keys.push_back(BuildNaturalSortKey(name));
+	}
+
+	std::stable_sort(orderAfter.begin(), orderAfter.end(),
+		[&keys](int index1, int index2)
+		{
+			return CompareNaturalSortKeys(keys[index1], keys[index2]) < 0;
+		});
+	reportResult("Natural sort keys", std::chrono::steady_clock::now() - start);
+
+	// Names that compare as equal may legitimately be ordered differently, so it's the names
+	// themselves that are compared, rather than their indexes.
+	for (int i = 0; i < NUM_NAMES; i++)
+	{
+		ASSERT_EQ(StrCmpLogicalW(names[orderBefore[i]].c_str(), names[orderAfter[i]].c_str()), 0);
+	}
+}
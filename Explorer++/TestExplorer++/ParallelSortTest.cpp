@@ -0,0 +1,73 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "pch.h"
+#include "../Helper/ParallelSort.h"
+#include <gtest/gtest.h>
+#include <random>
+
+using namespace testing;
+
+namespace
+{
+struct Item
+{
+	int key;
+	int originalIndex;
+
+	bool operator==(const Item &) const = default;
+};
+
+std::vector<Item> BuildItems(size_t numItems, int numDistinctKeys)
+{
+	std::mt19937 generator(static_cast<unsigned int>(numItems));
+	std::uniform_int_distribution<int> keyDistribution(0, numDistinctKeys - 1);
+
+	std::vector<Item> items;
+
+	for (size_t i = 0; i < numItems; i++)
+	{
+		items.push_back({ keyDistribution(generator), static_cast<int>(i) });
+	}
+
+	return items;
+}
+
+bool CompareItems(const Item &item1, const Item &item2)
+{
+	return item1.key < item2.key;
+}
+}
+
+class ParallelSortItemCountTest : public TestWithParam<size_t>
+{
+};
+
+TEST_P(ParallelSortItemCountTest, MatchesStableSort)
+{
+	// Many duplicate keys are generated, so that the stability of the sort is tested.
+	auto items = BuildItems(GetParam(), 50);
+
+	auto expectedItems = items;
+	std::stable_sort(expectedItems.begin(), expectedItems.end(), CompareItems);
+
+	// A minimum of 1 item per thread means that the items will be split across as many threads as
+	// are available.
+	ParallelStableSort(items.begin(), items.end(), CompareItems, 1);
+	EXPECT_EQ(items, expectedItems);
+}
+
+INSTANTIATE_TEST_SUITE_P(ItemCounts, ParallelSortItemCountTest,
+	Values(0, 1, 2, 3, 17, 1000, 65537));
+
+TEST(ParallelSortTest, SmallRangeSortedOnCallingThread)
+{
+	auto items = BuildItems(100, 10);
+
+	auto expectedItems = items;
+	std::stable_sort(expectedItems.begin(), expectedItems.end(), CompareItems);
+
+	ParallelStableSort(items.begin(), items.end(), CompareItems);
+	EXPECT_EQ(items, expectedItems);
+}
@@ -0,0 +1,213 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "pch.h"
+#include "../Helper/PixelKernels.h"
+#include <gtest/gtest.h>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <vector>
+
+using namespace PixelKernels;
+
+namespace
+{
+
+std::vector<InstructionSet> GetInstructionSetsToTest()
+{
+	std::vector<InstructionSet> instructionSets = { InstructionSet::Scalar };
+	auto supportedInstructionSet = GetSupportedInstructionSet();
+
+	if (supportedInstructionSet == InstructionSet::SSE41
+		|| supportedInstructionSet == InstructionSet::AVX2)
+	{
+		instructionSets.push_back(InstructionSet::SSE41);
+	}
+
+	if (supportedInstructionSet == InstructionSet::AVX2)
+	{
+		instructionSets.push_back(InstructionSet::AVX2);
+	}
+
+	return instructionSets;
+}
+
+const char *GetInstructionSetName(InstructionSet instructionSet)
+{
+	switch (instructionSet)
+	{
+	case InstructionSet::SSE41:
+		return "SSE4.1";
+
+	case InstructionSet::AVX2:
+		return "AVX2";
+
+	default:
+		return "scalar";
+	}
+}
+
+std::vector<uint32_t> BuildRandomPixels(size_t numPixels, uint32_t seed)
+{
+	std::mt19937 generator(seed);
+	std::vector<uint32_t> pixels(numPixels);
+
+	for (auto &pixel : pixels)
+	{
+		pixel = generator();
+	}
+
+	return pixels;
+}
+
+std::vector<uint32_t> BuildOpaqueMaskResult(const std::vector<uint32_t> &pixels,
+	const std::vector<uint32_t> &mask)
+{
+	std::vector<uint32_t> expected(pixels.size());
+
+	for (size_t i = 0; i < pixels.size(); i++)
+	{
+		expected[i] = mask[i] ? 0 : (pixels[i] | 0xFF000000);
+	}
+
+	return expected;
+}
+
+}
+
+TEST(PixelKernelsTest, HasAlpha)
+{
+	for (auto instructionSet : GetInstructionSetsToTest())
+	{
+		SCOPED_TRACE(GetInstructionSetName(instructionSet));
+
+		// The sizes here cover the main loop of each implementation, as well as the remainder.
+		for (size_t numPixels : { 0, 1, 3, 4, 7, 8, 15, 16, 17, 31, 32, 33, 100, 1024 })
+		{
+			std::vector<uint32_t> pixels(numPixels, 0x00FFFFFF);
+			EXPECT_FALSE(HasAlpha(pixels.data(), pixels.size(), instructionSet));
+
+			// An alpha value at any position should be found.
+			for (size_t i = 0; i < numPixels; i++)
+			{
+				pixels[i] = 0x01000000;
+				EXPECT_TRUE(HasAlpha(pixels.data(), pixels.size(), instructionSet))
+					<< "Size " << numPixels << ", position " << i;
+				pixels[i] = 0x00FFFFFF;
+			}
+		}
+	}
+}
+
+TEST(PixelKernelsTest, HasAlphaUnalignedInput)
+{
+	std::vector<uint32_t> pixels(67, 0);
+	pixels[66] = 0x80000000;
+
+	for (auto instructionSet : GetInstructionSetsToTest())
+	{
+		SCOPED_TRACE(GetInstructionSetName(instructionSet));
+
+		EXPECT_TRUE(HasAlpha(pixels.data() + 1, pixels.size() - 1, instructionSet));
+		EXPECT_FALSE(HasAlpha(pixels.data() + 1, pixels.size() - 2, instructionSet));
+	}
+}
+
+TEST(PixelKernelsTest, ApplyMask)
+{
+	for (auto instructionSet : GetInstructionSetsToTest())
+	{
+		SCOPED_TRACE(GetInstructionSetName(instructionSet));
+
+		for (size_t numPixels : { 0, 1, 3, 4, 5, 8, 9, 16, 33, 1000 })
+		{
+			auto pixels = BuildRandomPixels(numPixels, 1);
+
+			// Icon masks only contain black and white pixels.
+			auto mask = BuildRandomPixels(numPixels, 2);
+
+			for (auto &maskPixel : mask)
+			{
+				maskPixel = (maskPixel & 1) ? 0x00FFFFFF : 0;
+			}
+
+			auto expected = BuildOpaqueMaskResult(pixels, mask);
+
+			ApplyMask(pixels.data(), mask.data(), pixels.size(), instructionSet);
+			EXPECT_EQ(pixels, expected) << "Size " << numPixels;
+		}
+	}
+}
+
+TEST(PixelKernelsTest, ApplyMaskUnalignedInput)
+{
+	auto pixels = BuildRandomPixels(41, 3);
+	auto mask = BuildRandomPixels(41, 4);
+
+	for (auto instructionSet : GetInstructionSetsToTest())
+	{
+		SCOPED_TRACE(GetInstructionSetName(instructionSet));
+
+		auto output = pixels;
+		ApplyMask(output.data() + 1, mask.data() + 1, output.size() - 1, instructionSet);
+
+		auto expected = BuildOpaqueMaskResult(pixels, mask);
+		expected[0] = pixels[0];
+
+		EXPECT_EQ(output, expected);
+	}
+}
+
+// This is a benchmark, rather than a test, so it's disabled by default. It can be run by passing
+// --gtest_also_run_disabled_tests --gtest_filter=PixelKernelsBenchmark.*
+TEST(PixelKernelsBenchmark, DISABLED_PixelsPerSecond)
+{
+	// Equivalent to converting 48x48 icons, which is typical for the large icons shown in the
+	// listview and the icons shown in menus and toolbars (once scaled for high DPI).
+	const size_t ICON_SIZE = 48 * 48;
+	const int NUM_ICONS = 20000;
+
+	auto pixels = BuildRandomPixels(ICON_SIZE, 1);
+	auto mask = BuildRandomPixels(ICON_SIZE, 2);
+
+	// Every pixel has to be checked when there's no alpha channel, which is the worst case.
+	std::vector<uint32_t> opaquePixels(ICON_SIZE, 0x00808080);
+
+	auto reportResult = [](const char *operation, InstructionSet instructionSet,
+							std::chrono::steady_clock::duration duration)
+	{
+		auto seconds = std::chrono::duration<double>(duration).count();
+		std::cout << operation << " (" << GetInstructionSetName(instructionSet)
+				  << "): " << (ICON_SIZE * NUM_ICONS) / seconds / 1e6 << " megapixels/s"
+				  << std::endl;
+	};
+
+	for (auto instructionSet : GetInstructionSetsToTest())
+	{
+		size_t numWithAlpha = 0;
+		auto start = std::chrono::steady_clock::now();
+
+		for (int i = 0; i < NUM_ICONS; i++)
+		{
+			if (HasAlpha(opaquePixels.data(), opaquePixels.size(), instructionSet))
+			{
+				numWithAlpha++;
+			}
+		}
+
+		reportResult("HasAlpha", instructionSet, std::chrono::steady_clock::now() - start);
+		EXPECT_EQ(numWithAlpha, 0u);
+
+		auto output = pixels;
+		start = std::chrono::steady_clock::now();
+
+		for (int i = 0; i < NUM_ICONS; i++)
+		{
+			ApplyMask(output.data(), mask.data(), output.size(), instructionSet);
+		}
+
+		reportResult("ApplyMask", instructionSet, std::chrono::steady_clock::now() - start);
+	}
+}
@@ -0,0 +1,193 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "pch.h"
+#include "../Explorer++/ShellBrowser/ShellChangeCoalescer.h"
+#include "../Helper/ShellHelper.h"
+#include <gtest/gtest.h>
+
+using ChangeType = ShellChangeCoalescer::ChangeType;
+
+namespace
+{
+std::wstring GetPath(PCIDLIST_ABSOLUTE pidl)
+{
+	std::wstring path;
+	HRESULT hr = GetDisplayName(pidl, SHGDN_FORPARSING, path);
+	EXPECT_HRESULT_SUCCEEDED(hr);
+	return path;
+}
+
+class ShellChangeCoalescerTest : public testing::Test
+{
+protected:
+	// Identifies changes by their type and the names of the items involved, so that they can be
+	// easily compared.
+	struct ChangeSummary
+	{
+		ChangeType type;
+		std::wstring name;
+		std::wstring newName;
+
+		bool operator==(const ChangeSummary &) const = default;
+	};
+
+	ShellChangeCoalescerTest() : m_coalescer(GetPath)
+	{
+	}
+
+	unique_pidl_absolute BuildPidl(const std::wstring &name)
+	{
+		unique_pidl_absolute pidl;
+		HRESULT hr = CreateSimplePidl(L"c:\\watched\\" + name, wil::out_param(pidl));
+		EXPECT_HRESULT_SUCCEEDED(hr);
+		return pidl;
+	}
+
+	void Add(const std::wstring &name)
+	{
+		m_coalescer.OnItemAdded(BuildPidl(name).get());
+	}
+
+	void Remove(const std::wstring &name)
+	{
+		m_coalescer.OnItemRemoved(BuildPidl(name).get());
+	}
+
+	void Update(const std::wstring &name)
+	{
+		m_coalescer.OnItemUpdated(BuildPidl(name).get());
+	}
+
+	void Rename(const std::wstring &oldName, const std::wstring &newName)
+	{
+		m_coalescer.OnItemRenamed(BuildPidl(oldName).get(), BuildPidl(newName).get());
+	}
+
+	std::vector<ChangeSummary> TakeChanges()
+	{
+		std::vector<ChangeSummary> summaries;
+
+		for (const auto &change : m_coalescer.TakeChanges())
+		{
+			ChangeSummary summary = { change.type, GetName(change.pidl.get()), L"" };
+
+			if (change.pidlNew)
+			{
+				summary.newName = GetName(change.pidlNew.get());
+			}
+
+			summaries.push_back(summary);
+		}
+
+		return summaries;
+	}
+
+	ShellChangeCoalescer m_coalescer;
+
+private:
+	static std::wstring GetName(PCIDLIST_ABSOLUTE pidl)
+	{
+		std::wstring path = GetPath(pidl);
+		return path.substr(path.find_last_of('\\') + 1);
+	}
+};
+}
+
+TEST_F(ShellChangeCoalescerTest, RepeatedUpdates)
+{
+	Update(L"a");
+	Update(L"b");
+	Update(L"a");
+	Update(L"a");
+
+	EXPECT_EQ(m_coalescer.GetNumChanges(), 2u);
+	EXPECT_EQ(TakeChanges(), (std::vector<ChangeSummary>{ { ChangeType::Updated, L"a", L"" },
+								 { ChangeType::Updated, L"b", L"" } }));
+}
+
+TEST_F(ShellChangeCoalescerTest, CreateThenDelete)
+{
+	Add(L"a");
+	Update(L"a");
+	Rename(L"a", L"b");
+	Remove(L"b");
+
+	EXPECT_EQ(m_coalescer.GetNumChanges(), 0u);
+	EXPECT_TRUE(TakeChanges().empty());
+}
+
+TEST_F(ShellChangeCoalescerTest, DeleteThenCreate)
+{
+	Remove(L"a");
+	Add(L"a");
+
+	EXPECT_EQ(TakeChanges(), (std::vector<ChangeSummary>{ { ChangeType::Updated, L"a", L"" } }));
+}
+
+TEST_F(ShellChangeCoalescerTest, RenameChain)
+{
+	Rename(L"a", L"b");
+	Rename(L"b", L"c");
+	Rename(L"c", L"d");
+
+	EXPECT_EQ(TakeChanges(),
+		(std::vector<ChangeSummary>{ { ChangeType::Renamed, L"a", L"d" } }));
+}
+
+TEST_F(ShellChangeCoalescerTest, RenameBack)
+{
+	Rename(L"a", L"b");
+	Rename(L"b", L"a");
+
+	EXPECT_EQ(TakeChanges(), (std::vector<ChangeSummary>{ { ChangeType::Updated, L"a", L"" } }));
+}
+
+TEST_F(ShellChangeCoalescerTest, RenameOverExistingItem)
+{
+	// This is what happens when a file is saved by writing to a temporary file and then replacing
+	// the original.
+	Add(L"a.tmp");
+	Remove(L"a");
+	Rename(L"a.tmp", L"a");
+
+	EXPECT_EQ(TakeChanges(), (std::vector<ChangeSummary>{ { ChangeType::Updated, L"a", L"" } }));
+
+	Remove(L"b");
+	Rename(L"c", L"b");
+
+	EXPECT_EQ(TakeChanges(), (std::vector<ChangeSummary>{ { ChangeType::Removed, L"c", L"" },
+								 { ChangeType::Updated, L"b", L"" } }));
+}
+
+TEST_F(ShellChangeCoalescerTest, SwappedNames)
+{
+	Rename(L"a", L"temp");
+	Rename(L"b", L"a");
+	Rename(L"temp", L"b");
+
+	// There's no order in which the renames can be applied without two items having the same name,
+	// so each item is removed and added instead.
+	EXPECT_EQ(TakeChanges(), (std::vector<ChangeSummary>{ { ChangeType::Removed, L"a", L"" },
+								 { ChangeType::Removed, L"b", L"" },
+								 { ChangeType::Added, L"b", L"" },
+								 { ChangeType::Added, L"a", L"" } }));
+}
+
+TEST_F(ShellChangeCoalescerTest, Order)
+{
+	Add(L"new");
+	Update(L"updated");
+	Rename(L"old", L"renamed");
+	Remove(L"removed");
+
+	// Removals should come first, followed by renames, updates and additions.
+	EXPECT_EQ(TakeChanges(), (std::vector<ChangeSummary>{ { ChangeType::Removed, L"removed", L"" },
+								 { ChangeType::Renamed, L"old", L"renamed" },
+								 { ChangeType::Updated, L"updated", L"" },
+								 { ChangeType::Added, L"new", L"" } }));
+
+	// The coalescer should be reset once the changes have been taken.
+	EXPECT_EQ(m_coalescer.GetNumChanges(), 0u);
+}
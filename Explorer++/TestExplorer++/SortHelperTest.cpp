@@ -0,0 +1,248 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "pch.h"
+#include "../Explorer++/ShellBrowser/SortHelper.h"
+#include "../Explorer++/ShellBrowser/ItemData.h"
+#include "../Helper/Macros.h"
+#include <gtest/gtest.h>
+#include <ShlObj.h>
+#include <iostream>
+#include <numeric>
+#include <strsafe.h>
+
+namespace
+{
+BasicItemInfo_t BuildItem(const std::wstring &name, bool isFolder, uint64_t size,
+	uint64_t modificationTime = 0)
+{
+	BasicItemInfo_t itemInfo;
+	itemInfo.wfd = {};
+	StringCchCopy(itemInfo.wfd.cFileName, SIZEOF_ARRAY(itemInfo.wfd.cFileName), name.c_str());
+	itemInfo.wfd.dwFileAttributes = isFolder ? FILE_ATTRIBUTE_DIRECTORY : FILE_ATTRIBUTE_NORMAL;
+	itemInfo.wfd.nFileSizeLow = static_cast<DWORD>(size);
+	itemInfo.wfd.nFileSizeHigh = static_cast<DWORD>(size >> 32);
+	itemInfo.wfd.ftLastWriteTime.dwLowDateTime = static_cast<DWORD>(modificationTime);
+	itemInfo.wfd.ftLastWriteTime.dwHighDateTime = static_cast<DWORD>(modificationTime >> 32);
+	itemInfo.isFindDataValid = true;
+	StringCchCopy(itemInfo.szDisplayName, SIZEOF_ARRAY(itemInfo.szDisplayName), name.c_str());
+	itemInfo.isRoot = false;
+	return itemInfo;
+}
+
+GlobalFolderSettings BuildGlobalFolderSettings(bool useNaturalSortOrder)
+{
+	GlobalFolderSettings globalFolderSettings = {};
+	globalFolderSettings.showExtensions = TRUE;
+	globalFolderSettings.useNaturalSortOrder = useNaturalSortOrder;
+	return globalFolderSettings;
+}
+
+std::vector<std::wstring> SortNames(SortMode sortMode, const std::vector<BasicItemInfo_t> &items,
+	const GlobalFolderSettings &globalFolderSettings, bool foldersFirst, bool ascending,
+	std::optional<SortMode> secondarySortMode = std::nullopt)
+{
+	std::vector<SortKey> keys;
+
+	for (const auto &item : items)
+	{
+		keys.push_back(BuildSortKey(sortMode, secondarySortMode, item, globalFolderSettings));
+	}
+
+	auto options = BuildSortKeyOptions(sortMode, globalFolderSettings, foldersFirst, ascending,
+		secondarySortMode);
+
+	std::vector<size_t> order(items.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(),
+		[&keys, &options](size_t index1, size_t index2)
+		{
+			return CompareSortKeys(keys[index1], keys[index2], options) < 0;
+		});
+
+	std::vector<std::wstring> names;
+
+	for (auto index : order)
+	{
+		names.push_back(items[index].szDisplayName);
+	}
+
+	return names;
+}
+}
+
+TEST(SortHelperTest, SortByName)
+{
+	std::vector<BasicItemInfo_t> items;
+	items.push_back(BuildItem(L"file10.txt", false, 0));
+	items.push_back(BuildItem(L"File2.txt", false, 0));
+	items.push_back(BuildItem(L"folder", true, 0));
+	items.push_back(BuildItem(L"file1.txt", false, 0));
+
+	auto names = SortNames(SortMode::Name, items, BuildGlobalFolderSettings(true), true, true);
+	EXPECT_EQ(names,
+		(std::vector<std::wstring>{ L"folder", L"file1.txt", L"File2.txt", L"file10.txt" }));
+
+	names = SortNames(SortMode::Name, items, BuildGlobalFolderSettings(false), true, true);
+	EXPECT_EQ(names,
+		(std::vector<std::wstring>{ L"folder", L"file1.txt", L"file10.txt", L"File2.txt" }));
+
+	names = SortNames(SortMode::Name, items, BuildGlobalFolderSettings(true), false, true);
+	EXPECT_EQ(names,
+		(std::vector<std::wstring>{ L"file1.txt", L"File2.txt", L"file10.txt", L"folder" }));
+
+	// Sorting in descending order reverses the entire order, including the position of folders.
+	names = SortNames(SortMode::Name, items, BuildGlobalFolderSettings(true), true, false);
+	EXPECT_EQ(names,
+		(std::vector<std::wstring>{ L"file10.txt", L"File2.txt", L"file1.txt", L"folder" }));
+}
+
+TEST(SortHelperTest, SortBySize)
+{
+	std::vector<BasicItemInfo_t> items;
+	items.push_back(BuildItem(L"c", false, 300));
+	items.push_back(BuildItem(L"a", false, 0x100000000));
+	items.push_back(BuildItem(L"b", false, 100));
+	items.push_back(BuildItem(L"d", false, 100));
+
+	auto itemWithoutFindData = BuildItem(L"e", false, 500);
+	itemWithoutFindData.isFindDataValid = false;
+	items.push_back(std::move(itemWithoutFindData));
+
+	// Items without a size come first and items with equal sizes are ordered by name.
+	auto names = SortNames(SortMode::Size, items, BuildGlobalFolderSettings(true), true, true);
+	EXPECT_EQ(names, (std::vector<std::wstring>{ L"e", L"b", L"d", L"c", L"a" }));
+}
+
+TEST(SortHelperTest, SortByDateModified)
+{
+	std::vector<BasicItemInfo_t> items;
+	items.push_back(BuildItem(L"a", false, 0, 0x200000000));
+	items.push_back(BuildItem(L"b", false, 0, 0x100000001));
+	items.push_back(BuildItem(L"c", false, 0, 0x100000000));
+
+	auto names =
+		SortNames(SortMode::DateModified, items, BuildGlobalFolderSettings(true), true, true);
+	EXPECT_EQ(names, (std::vector<std::wstring>{ L"c", L"b", L"a" }));
+}
+
+TEST(SortHelperTest, SecondarySortMode)
+{
+	std::vector<BasicItemInfo_t> items;
+	items.push_back(BuildItem(L"a", false, 200, 3));
+	items.push_back(BuildItem(L"b", false, 100, 2));
+	items.push_back(BuildItem(L"c", false, 100, 1));
+	items.push_back(BuildItem(L"d", false, 200, 1));
+
+	// Items with equal sizes are ordered by their modification dates, rather than their names.
+	auto names = SortNames(SortMode::Size, items, BuildGlobalFolderSettings(true), true, true,
+		SortMode::DateModified);
+	EXPECT_EQ(names, (std::vector<std::wstring>{ L"c", L"b", L"d", L"a" }));
+
+	names = SortNames(SortMode::Size, items, BuildGlobalFolderSettings(true), true, false,
+		SortMode::DateModified);
+	EXPECT_EQ(names, (std::vector<std::wstring>{ L"a", L"d", L"b", L"c" }));
+
+	// A secondary sort mode that's the same as the primary sort mode has no effect.
+	names = SortNames(SortMode::Size, items, BuildGlobalFolderSettings(true), true, true,
+		SortMode::Size);
+	EXPECT_EQ(names, (std::vector<std::wstring>{ L"b", L"c", L"a", L"d" }));
+}
+
+// This is a benchmark, rather than a test, so it's disabled by default. It can be run by passing
+// --gtest_also_run_disabled_tests --gtest_filter=SortHelperBenchmark.*
+TEST(SortHelperBenchmark, DISABLED_ComparisonsPerSecond)
+{
+	const int NUM_ITEMS = 100000;
+
+	std::vector<BasicItemInfo_t> items;
+	items.reserve(NUM_ITEMS);
+
+	for (int i = 0; i < NUM_ITEMS; i++)
+	{
+		// Names are generated in a scrambled order, so that the sort has work to do.
+		std::wstring name = L"File " + std::to_wstring((i * 7919) % NUM_ITEMS) + L".txt";
+		auto item = BuildItem(name, false, i);
+
+		std::wstring path = L"C:\\Benchmark\\" + name;
+		item.pidlComplete.reset(SHSimpleIDListFromPath(path.c_str()));
+		ASSERT_TRUE(item.pidlComplete);
+		item.pridl.reset(ILCloneChild(ILFindLastID(item.pidlComplete.get())));
+
+		items.push_back(std::move(item));
+	}
+
+	auto globalFolderSettings = BuildGlobalFolderSettings(true);
+	auto options = BuildSortKeyOptions(SortMode::Name, globalFolderSettings, true, true);
+
+	auto reportResult = [](const char *description, size_t numComparisons,
+							std::chrono::steady_clock::duration duration)
+	{
+		auto seconds = std::chrono::duration<double>(duration).count();
+		std::cout << description << ": " << numComparisons << " comparisons in " << seconds
+				  << "s (" << static_cast<uint64_t>(numComparisons / seconds)
+				  << " comparisons/s)" << std::endl;
+	};
+
+	// Before: each comparison copies both items and then retrieves the data being compared,
+	// which is what the LVM_SORTITEMS comparison callback previously did.
+	std::vector<int> order(NUM_ITEMS);
+	std::iota(order.begin(), order.end(), 0);
+	size_t numComparisons = 0;
+
+	auto start = std::chrono::steady_clock::now();
+	std::stable_sort(order.begin(), order.end(),
+		[&](int index1, int index2)
+		{
+			numComparisons++;
+
+			BasicItemInfo_t item1 = items[index1];
+			BasicItemInfo_t item2 = items[index2];
+
+			return CompareSortKeys(BuildSortKey(SortMode::Name, item1, globalFolderSettings),
+					   BuildSortKey(SortMode::Name, item2, globalFolderSettings), options)
+				< 0;
+		});
+	reportResult("Per-comparison item data", numComparisons,
+		std::chrono::steady_clock::now() - start);
+
+	std::vector<std::wstring> orderBefore;
+
+	for (auto index : order)
+	{
+		orderBefore.push_back(items[index].szDisplayName);
+	}
+
+	// After: a key is built once for each item and only the keys are compared.
+	std::iota(order.begin(), order.end(), 0);
+	numComparisons = 0;
+
+	start = std::chrono::steady_clock::now();
+
+	std::vector<SortKey> keys;
+	keys.reserve(NUM_ITEMS);
+
+	for (const auto &item : items)
+	{
+		keys.push_back(BuildSortKey(SortMode::Name, item, globalFolderSettings));
+	}
+
+	std::stable_sort(order.begin(), order.end(),
+		[&](int index1, int index2)
+		{
+			numComparisons++;
+			return CompareSortKeys(keys[index1], keys[index2], options) < 0;
+		});
+	reportResult("Precomputed sort keys (including key construction)", numComparisons,
+		std::chrono::steady_clock::now() - start);
+
+	std::vector<std::wstring> orderAfter;
+
+	for (auto index : order)
+	{
+		orderAfter.push_back(items[index].szDisplayName);
+	}
+
+	EXPECT_EQ(orderBefore, orderAfter);
+}
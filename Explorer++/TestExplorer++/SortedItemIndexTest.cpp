@@ -0,0 +1,141 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "pch.h"
+#include "../Explorer++/ShellBrowser/SortedItemIndex.h"
+#include <gtest/gtest.h>
+
+namespace
+{
+SortKey BuildKey(uint64_t number)
+{
+	SortKey key;
+	key.number = number;
+	return key;
+}
+
+// Builds an index where item i has the key numbers[i].
+SortedItemIndex BuildIndex(const std::vector<uint64_t> &numbers)
+{
+	std::vector<int> items;
+	std::vector<SortKey> keys;
+
+	for (size_t i = 0; i < numbers.size(); i++)
+	{
+		items.push_back(static_cast<int>(i));
+		keys.push_back(BuildKey(numbers[i]));
+	}
+
+	SortedItemIndex index;
+	index.Reset(std::move(items), std::move(keys), SortMode::Size, {});
+	return index;
+}
+
+std::vector<size_t> FindInsertPositions(const SortedItemIndex &index,
+	const std::vector<uint64_t> &numbers)
+{
+	std::vector<SortKey> keys;
+
+	for (auto number : numbers)
+	{
+		keys.push_back(BuildKey(number));
+	}
+
+	return index.FindInsertPositions(keys);
+}
+}
+
+TEST(SortedItemIndexTest, Validity)
+{
+	SortedItemIndex index;
+	EXPECT_FALSE(index.IsValid(SortMode::Size, {}));
+
+	index = BuildIndex({ 1, 2 });
+	EXPECT_TRUE(index.IsValid(SortMode::Size, {}));
+	EXPECT_FALSE(index.IsValid(SortMode::Name, {}));
+
+	SortKeyOptions options;
+	options.ascending = false;
+	EXPECT_FALSE(index.IsValid(SortMode::Size, options));
+
+	index.Invalidate();
+	EXPECT_FALSE(index.IsValid(SortMode::Size, {}));
+	EXPECT_FALSE(index.Contains(0));
+}
+
+TEST(SortedItemIndexTest, FindInsertPositions)
+{
+	auto index = BuildIndex({ 10, 20, 30 });
+	EXPECT_TRUE(index.IsSorted());
+
+	// The positions are the final positions of the new items, with new items being placed before
+	// existing items they compare equal to.
+	auto positions = FindInsertPositions(index, { 25, 5, 35, 20 });
+	EXPECT_EQ(positions, (std::vector<size_t>{ 4, 0, 6, 2 }));
+}
+
+TEST(SortedItemIndexTest, Insert)
+{
+	auto index = BuildIndex({ 10, 20, 30 });
+
+	std::vector<SortedItemIndex::NewItem> newItems;
+	newItems.push_back({ 0, 3, BuildKey(5) });
+	newItems.push_back({ 2, 4, BuildKey(15) });
+	newItems.push_back({ 5, 5, BuildKey(40) });
+	index.Insert(std::move(newItems));
+
+	EXPECT_EQ(index.GetItems(), (std::vector<int>{ 3, 0, 4, 1, 2, 5 }));
+	EXPECT_TRUE(index.IsSorted());
+	EXPECT_TRUE(index.Contains(4));
+}
+
+TEST(SortedItemIndexTest, InsertOutOfOrder)
+{
+	auto index = BuildIndex({ 10, 20, 30 });
+
+	std::vector<SortedItemIndex::NewItem> newItems;
+	newItems.push_back({ 0, 3, BuildKey(50) });
+	index.Insert(std::move(newItems));
+
+	EXPECT_EQ(index.GetItems(), (std::vector<int>{ 3, 0, 1, 2 }));
+	EXPECT_FALSE(index.IsSorted());
+}
+
+TEST(SortedItemIndexTest, Remove)
+{
+	auto index = BuildIndex({ 10, 20, 20, 30 });
+
+	index.Remove(2);
+	EXPECT_EQ(index.GetItems(), (std::vector<int>{ 0, 1, 3 }));
+	EXPECT_FALSE(index.Contains(2));
+
+	index.Remove(std::unordered_set<int>{ 0, 3 });
+	EXPECT_EQ(index.GetItems(), (std::vector<int>{ 1 }));
+	EXPECT_TRUE(index.IsSorted());
+}
+
+TEST(SortedItemIndexTest, UpdateKey)
+{
+	auto index = BuildIndex({ 10, 20, 30 });
+
+	index.UpdateKey(1, BuildKey(25));
+	EXPECT_TRUE(index.IsSorted());
+
+	index.UpdateKey(1, BuildKey(35));
+	EXPECT_FALSE(index.IsSorted());
+
+	// Once the items are no longer sorted, each new item is placed before the first item it's not
+	// greater than.
+	auto positions = FindInsertPositions(index, { 32 });
+	EXPECT_EQ(positions, (std::vector<size_t>{ 1 }));
+}
+
+TEST(SortedItemIndexTest, Unsorted)
+{
+	auto index = BuildIndex({ 30, 10, 20 });
+	EXPECT_FALSE(index.IsSorted());
+
+	auto positions = FindInsertPositions(index, { 15, 5 });
+	EXPECT_EQ(positions, (std::vector<size_t>{ 1, 0 }));
+}
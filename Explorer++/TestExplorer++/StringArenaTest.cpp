@@ -0,0 +1,79 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "pch.h"
+#include "../Helper/StringArena.h"
+#include <gtest/gtest.h>
+
+TEST(StringArenaTest, InternReturnsString)
+{
+	StringArena arena;
+	auto handle1 = arena.Intern(L"first");
+	auto handle2 = arena.Intern(L"second");
+
+	EXPECT_EQ(arena.Get(handle1), L"first");
+	EXPECT_EQ(arena.Get(handle2), L"second");
+}
+
+TEST(StringArenaTest, DuplicateStringsShared)
+{
+	StringArena arena;
+	auto handle1 = arena.Intern(L"name.txt");
+	auto handle2 = arena.Intern(L"name.txt");
+	auto handle3 = arena.Intern(L"NAME.txt");
+
+	EXPECT_EQ(handle1, handle2);
+	EXPECT_NE(handle1, handle3);
+	EXPECT_EQ(arena.GetNumStrings(), 2u);
+}
+
+TEST(StringArenaTest, EmptyString)
+{
+	StringArena arena;
+	auto handle = arena.Intern(L"");
+
+	EXPECT_EQ(arena.Get(handle), L"");
+	EXPECT_EQ(arena.Get(handle).data()[0], '\0');
+}
+
+TEST(StringArenaTest, NullTerminated)
+{
+	StringArena arena;
+	arena.Intern(L"abc");
+	auto handle = arena.Intern(L"def");
+
+	EXPECT_STREQ(arena.Get(handle).data(), L"def");
+}
+
+TEST(StringArenaTest, ManyStrings)
+{
+	StringArena arena;
+	std::vector<StringArena::Handle> handles;
+
+	// Enough strings to force the hash table to grow several times.
+	for (int i = 0; i < 10000; i++)
+	{
+		handles.push_back(arena.Intern(std::to_wstring(i)));
+	}
+
+	for (int i = 0; i < 10000; i++)
+	{
+		EXPECT_EQ(arena.Get(handles[i]), std::to_wstring(i));
+		EXPECT_EQ(arena.Intern(std::to_wstring(i)), handles[i]);
+	}
+
+	EXPECT_EQ(arena.GetNumStrings(), 10000u);
+}
+
+TEST(StringArenaTest, Clear)
+{
+	StringArena arena;
+	arena.Intern(L"first");
+	arena.Clear();
+
+	EXPECT_EQ(arena.GetNumStrings(), 0u);
+
+	auto handle = arena.Intern(L"second");
+	EXPECT_EQ(arena.Get(handle), L"second");
+}
@@ -0,0 +1,130 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "pch.h"
+#include "../Explorer++/ShellBrowser/ThumbnailImageStore.h"
+#include <gtest/gtest.h>
+
+namespace
+{
+
+constexpr size_t BYTES_PER_IMAGE = 100;
+constexpr size_t MAX_ITEM_SLOTS = ThumbnailImageStore::MIN_ITEM_SLOTS;
+
+ThumbnailImageStore BuildFullStore()
+{
+	ThumbnailImageStore store(MAX_ITEM_SLOTS * BYTES_PER_IMAGE, BYTES_PER_IMAGE);
+
+	for (int i = 0; i < static_cast<int>(MAX_ITEM_SLOTS); i++)
+	{
+		store.AllocateItemSlot(i);
+	}
+
+	return store;
+}
+
+}
+
+TEST(ThumbnailImageStoreTest, AllocateItemSlots)
+{
+	ThumbnailImageStore store(MAX_ITEM_SLOTS * BYTES_PER_IMAGE, BYTES_PER_IMAGE);
+	EXPECT_EQ(store.GetItemSlot(1), std::nullopt);
+
+	auto allocation1 = store.AllocateItemSlot(1);
+	EXPECT_EQ(allocation1.slot, 0);
+	EXPECT_EQ(allocation1.evictedItem, std::nullopt);
+
+	auto allocation2 = store.AllocateItemSlot(2);
+	EXPECT_EQ(allocation2.slot, 1);
+	EXPECT_EQ(store.GetItemSlot(1), 0);
+	EXPECT_EQ(store.GetItemSlot(2), 1);
+
+	// Allocating a slot for an item that already has one should return the existing slot.
+	auto allocation3 = store.AllocateItemSlot(1);
+	EXPECT_EQ(allocation3.slot, 0);
+	EXPECT_EQ(store.GetNumSlots(), 2);
+	EXPECT_EQ(store.GetNumItemThumbnails(), 2u);
+	EXPECT_EQ(store.GetMemoryUsage(), 2 * BYTES_PER_IMAGE);
+}
+
+TEST(ThumbnailImageStoreTest, LeastRecentlyUsedEvicted)
+{
+	auto store = BuildFullStore();
+
+	// Item 0 is the least recently allocated, but using it means that item 1 should be evicted
+	// instead.
+	EXPECT_EQ(store.GetItemSlot(0), 0);
+
+	auto allocation = store.AllocateItemSlot(1000);
+	EXPECT_EQ(allocation.slot, 1);
+	EXPECT_EQ(allocation.evictedItem, 1);
+	EXPECT_EQ(store.GetItemSlot(1), std::nullopt);
+	EXPECT_EQ(store.GetItemSlot(1000), 1);
+	EXPECT_EQ(store.GetNumEvictions(), 1u);
+
+	// The evicted slot is reused, so the memory used shouldn't grow.
+	EXPECT_EQ(store.GetNumSlots(), static_cast<int>(MAX_ITEM_SLOTS));
+	EXPECT_EQ(store.GetMemoryUsage(), MAX_ITEM_SLOTS * BYTES_PER_IMAGE);
+}
+
+TEST(ThumbnailImageStoreTest, MinimumItemSlots)
+{
+	// Even with a very small budget, enough thumbnails to fill the listview should be kept.
+	ThumbnailImageStore store(BYTES_PER_IMAGE, BYTES_PER_IMAGE);
+
+	for (int i = 0; i < static_cast<int>(MAX_ITEM_SLOTS); i++)
+	{
+		EXPECT_EQ(store.AllocateItemSlot(i).evictedItem, std::nullopt);
+	}
+
+	EXPECT_EQ(store.AllocateItemSlot(static_cast<int>(MAX_ITEM_SLOTS)).evictedItem, 0);
+}
+
+TEST(ThumbnailImageStoreTest, RemovedSlotReused)
+{
+	ThumbnailImageStore store(MAX_ITEM_SLOTS * BYTES_PER_IMAGE, BYTES_PER_IMAGE);
+	store.AllocateItemSlot(1);
+	store.AllocateItemSlot(2);
+
+	store.RemoveItem(1);
+	EXPECT_EQ(store.GetItemSlot(1), std::nullopt);
+
+	auto allocation = store.AllocateItemSlot(3);
+	EXPECT_EQ(allocation.slot, 0);
+	EXPECT_EQ(allocation.evictedItem, std::nullopt);
+	EXPECT_EQ(store.GetNumSlots(), 2);
+}
+
+TEST(ThumbnailImageStoreTest, IconSlots)
+{
+	auto store = BuildFullStore();
+
+	int iconSlot = store.AllocateIconSlot(5);
+	EXPECT_EQ(iconSlot, static_cast<int>(MAX_ITEM_SLOTS));
+	EXPECT_EQ(store.AllocateIconSlot(5), iconSlot);
+	EXPECT_EQ(store.GetIconSlot(5), iconSlot);
+	EXPECT_EQ(store.GetIconSlot(6), std::nullopt);
+
+	// Icon slots are shared between items and should never be evicted.
+	for (int i = 0; i < static_cast<int>(MAX_ITEM_SLOTS); i++)
+	{
+		auto allocation = store.AllocateItemSlot(1000 + i);
+		EXPECT_NE(allocation.slot, iconSlot);
+	}
+
+	EXPECT_EQ(store.GetIconSlot(5), iconSlot);
+}
+
+TEST(ThumbnailImageStoreTest, Clear)
+{
+	auto store = BuildFullStore();
+	store.AllocateIconSlot(1);
+
+	store.Clear();
+	EXPECT_EQ(store.GetNumSlots(), 0);
+	EXPECT_EQ(store.GetMemoryUsage(), 0u);
+	EXPECT_EQ(store.GetItemSlot(0), std::nullopt);
+	EXPECT_EQ(store.GetIconSlot(1), std::nullopt);
+	EXPECT_EQ(store.AllocateItemSlot(0).slot, 0);
+}
@@ -0,0 +1,180 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "pch.h"
+#include "../Explorer++/ShellBrowser/ViewportTaskScheduler.h"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <climits>
+#include <future>
+#include <mutex>
+
+namespace
+{
+
+class ViewportTaskSchedulerTest : public testing::Test
+{
+protected:
+	ViewportTaskSchedulerTest() : m_scheduler(1, [] {}, [] {})
+	{
+	}
+
+	// Blocks the worker thread, so that tasks can be queued without any of them being run.
+	void BlockWorker()
+	{
+		std::promise<void> started;
+		auto startedFuture = started.get_future();
+
+		m_scheduler.Push(-1, 0,
+			[this, &started]
+			{
+				started.set_value();
+				m_unblockFuture.wait();
+			});
+
+		startedFuture.wait();
+	}
+
+	void UnblockWorker()
+	{
+		m_unblock.set_value();
+	}
+
+	void PushRecordingTask(int taskId, int itemIndex)
+	{
+		m_scheduler.Push(taskId, itemIndex,
+			[this, taskId]
+			{
+				std::scoped_lock lock(m_mutex);
+				m_runOrder.push_back(taskId);
+			});
+	}
+
+	void WaitForTasks()
+	{
+		std::promise<void> finished;
+		auto finishedFuture = finished.get_future();
+
+		// This is queued at the very end of the visible range, so it will run after all the other
+		// tasks.
+		m_scheduler.Push(-2, INT_MAX,
+			[&finished]
+			{
+				finished.set_value();
+			});
+
+		finishedFuture.wait();
+	}
+
+	std::vector<int> GetRunOrder()
+	{
+		std::scoped_lock lock(m_mutex);
+		return m_runOrder;
+	}
+
+	ViewportTaskScheduler m_scheduler;
+
+private:
+	std::promise<void> m_unblock;
+	std::shared_future<void> m_unblockFuture = m_unblock.get_future().share();
+
+	std::mutex m_mutex;
+	std::vector<int> m_runOrder;
+};
+
+}
+
+TEST_F(ViewportTaskSchedulerTest, FifoWithoutVisibleRange)
+{
+	BlockWorker();
+	PushRecordingTask(1, 50);
+	PushRecordingTask(2, 10);
+	PushRecordingTask(3, 30);
+	UnblockWorker();
+
+	WaitForTasks();
+	EXPECT_EQ(GetRunOrder(), (std::vector<int>{ 1, 2, 3 }));
+}
+
+TEST_F(ViewportTaskSchedulerTest, VisibleItemsFirst)
+{
+	m_scheduler.SetVisibleRange(0, 9);
+
+	BlockWorker();
+	PushRecordingTask(1, 5);
+	PushRecordingTask(2, 12);
+	PushRecordingTask(3, 15);
+
+	// After scrolling, the tasks for the items that are now visible should be run first, followed
+	// by the tasks that are closest to the visible range.
+	auto droppedTaskIds = m_scheduler.SetVisibleRange(14, 23);
+	EXPECT_TRUE(droppedTaskIds.empty());
+
+	UnblockWorker();
+
+	WaitForTasks();
+	EXPECT_EQ(GetRunOrder(), (std::vector<int>{ 3, 2, 1 }));
+}
+
+TEST_F(ViewportTaskSchedulerTest, DistantTasksDropped)
+{
+	m_scheduler.SetVisibleRange(0, 9);
+
+	BlockWorker();
+	PushRecordingTask(1, 5);
+	PushRecordingTask(2, 95);
+	PushRecordingTask(3, 100);
+
+	// Tasks more than a page away from the new visible range should be dropped.
+	auto droppedTaskIds = m_scheduler.SetVisibleRange(100, 109);
+	EXPECT_EQ(droppedTaskIds, (std::vector<int>{ 1 }));
+
+	UnblockWorker();
+
+	WaitForTasks();
+	EXPECT_EQ(GetRunOrder(), (std::vector<int>{ 3, 2 }));
+
+	auto stats = m_scheduler.GetStats();
+	EXPECT_EQ(stats.numTasksDropped, 1u);
+	EXPECT_EQ(stats.queueDepth, 0u);
+	EXPECT_GE(stats.peakQueueDepth, 3u);
+}
+
+TEST_F(ViewportTaskSchedulerTest, ClearQueue)
+{
+	BlockWorker();
+	PushRecordingTask(1, 0);
+	PushRecordingTask(2, 1);
+	EXPECT_EQ(m_scheduler.GetStats().queueDepth, 2u);
+
+	m_scheduler.ClearQueue();
+	EXPECT_EQ(m_scheduler.GetStats().queueDepth, 0u);
+
+	UnblockWorker();
+
+	WaitForTasks();
+	EXPECT_TRUE(GetRunOrder().empty());
+}
+
+TEST(ViewportTaskSchedulerThreadTest, ThreadFunctions)
+{
+	std::atomic<int> numInitialized = 0;
+	std::atomic<int> numExited = 0;
+
+	{
+		ViewportTaskScheduler scheduler(
+			3,
+			[&numInitialized]
+			{
+				numInitialized++;
+			},
+			[&numExited]
+			{
+				numExited++;
+			});
+	}
+
+	EXPECT_EQ(numInitialized, 3);
+	EXPECT_EQ(numExited, 3);
+}
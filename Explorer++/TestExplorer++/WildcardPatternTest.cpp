@@ -0,0 +1,156 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "pch.h"
+#include "../Helper/WildcardPattern.h"
+#include "../Helper/StringHelper.h"
+#include <gtest/gtest.h>
+#include <chrono>
+
+TEST(WildcardPatternTest, SimpleMatches)
+{
+	EXPECT_TRUE(WildcardPattern(L"*.txt", true).Match(L"Test.txt"));
+	EXPECT_TRUE(WildcardPattern(L"?.txt", true).Match(L"1.txt"));
+	EXPECT_TRUE(WildcardPattern(L"?ab*cd.tx?", true).Match(L"1abefghcd.txt"));
+	EXPECT_TRUE(WildcardPattern(L"Test?1*txt", true).Match(L"Test11test.txt"));
+
+	EXPECT_FALSE(WildcardPattern(L"*.txt", true).Match(L"Test.txt.bak"));
+	EXPECT_FALSE(WildcardPattern(L"?.txt", true).Match(L".txt"));
+	EXPECT_FALSE(WildcardPattern(L"ab*b", true).Match(L"ab"));
+}
+
+TEST(WildcardPatternTest, CaseSensitivity)
+{
+	EXPECT_FALSE(WildcardPattern(L"*.TXT", true).Match(L"file.txt"));
+	EXPECT_TRUE(WildcardPattern(L"*.TXT", false).Match(L"file.txt"));
+	EXPECT_TRUE(WildcardPattern(L"привет", false).Match(L"Привет"));
+	EXPECT_FALSE(WildcardPattern(L"привет", true).Match(L"Привет"));
+}
+
+TEST(WildcardPatternTest, MultiplePatterns)
+{
+	WildcardPattern pattern(L"*.h: *.cpp", true);
+	EXPECT_TRUE(pattern.Match(L"file.h"));
+	EXPECT_TRUE(pattern.Match(L"file.cpp"));
+	EXPECT_FALSE(pattern.Match(L"file.txt"));
+}
+
+TEST(WildcardPatternTest, Default)
+{
+	WildcardPattern pattern;
+	EXPECT_TRUE(pattern.Match(L""));
+	EXPECT_FALSE(pattern.Match(L"file.txt"));
+}
+
+TEST(WildcardPatternTest, GetExtensions)
+{
+	EXPECT_EQ(WildcardPattern(L"*.txt", true).GetExtensions(), std::vector<std::wstring>{ L"txt" });
+	EXPECT_EQ(WildcardPattern(L"*.TXT", false).GetExtensions(),
+		std::vector<std::wstring>{ L"txt" });
+	EXPECT_EQ(WildcardPattern(L"*.h: *.cpp", true).GetExtensions(),
+		(std::vector<std::wstring>{ L"h", L"cpp" }));
+
+	EXPECT_EQ(WildcardPattern(L"*.tar.gz", true).GetExtensions(), std::nullopt);
+	EXPECT_EQ(WildcardPattern(L"*.tx?", true).GetExtensions(), std::nullopt);
+	EXPECT_EQ(WildcardPattern(L"file*.txt", true).GetExtensions(), std::nullopt);
+	EXPECT_EQ(WildcardPattern(L"*.", true).GetExtensions(), std::nullopt);
+	EXPECT_EQ(WildcardPattern(L"*.txt: file", true).GetExtensions(), std::nullopt);
+	EXPECT_EQ(WildcardPattern().GetExtensions(), std::nullopt);
+}
+
+// Each pattern is compared against each string, to check that the results are identical to those
+// returned by CheckWildcardMatch().
+TEST(WildcardPatternTest, MatchesCheckWildcardMatch)
+{
+	const std::vector<std::wstring> patterns = { L"", L"*", L"**", L"?", L"abc", L"ABC", L"abc*",
+		L"*abc", L"*abc*", L"a*c", L"a**c", L"*.txt", L"*.TXT", L"?b?", L"*b?", L"?*c", L"a*b*c",
+		L"*a*b*c*", L"a?c*d", L"*??*", L"file ?.txt", L"*.txt: *.doc", L"abc:", L":abc",
+		L" abc : *c", L"*.tar.gz", L"*a*a*a*b", L"тест*", L"*ТЕСТ?" };
+	const std::vector<std::wstring> strings = { L"", L"a", L"abc", L"ABC", L"aBc", L"abcabc",
+		L"abcd", L"xabc", L"xabcx", L"ac", L"abbc", L"file.txt", L"file.TXT", L"file.txt.bak",
+		L"file 1.txt", L"file 10.txt", L"archive.tar.gz", L"aaaaaaaaaaaaaaaaaaaaaaaab",
+		L"aaaaaaaaaaaaaaaaaaaaaaaac", L"a long name that contains abc somewhere after the start",
+		L"Тестовый", L"мой тест1", L"document.doc" };
+
+	for (const auto &patternText : patterns)
+	{
+		for (bool caseSensitive : { true, false })
+		{
+			WildcardPattern pattern(patternText, caseSensitive);
+
+			for (const auto &str : strings)
+			{
+				bool expected =
+					CheckWildcardMatch(patternText.c_str(), str.c_str(), caseSensitive) == TRUE;
+				EXPECT_EQ(pattern.Match(str), expected)
+					<< "Pattern: \"" << patternText << "\", string: \"" << str
+					<< "\", case sensitive: " << caseSensitive;
+			}
+		}
+	}
+}
+
+// This is a benchmark, rather than a test, so it's disabled by default. It can be run by passing
+// --gtest_also_run_disabled_tests --gtest_filter=WildcardPatternBenchmark.*
+TEST(WildcardPatternBenchmark, DISABLED_MatchesPerSecond)
+{
+	const int NUM_NAMES = 100000;
+
+	std::vector<std::wstring> names;
+	names.reserve(NUM_NAMES);
+
+	for (int i = 0; i < NUM_NAMES; i++)
+	{
+		names.push_back(L"Document " + std::to_wstring(i) + (i % 3 == 0 ? L".TXT" : L".docx"));
+	}
+
+	const std::vector<std::wstring> patterns = { L"*.txt", L"doc*", L"*ment 1*", L"*.txt: *.docx",
+		L"d?c*9*.*x" };
+
+	auto reportResult = [](const std::wstring &patternText, const char *description,
+							size_t numMatched, std::chrono::steady_clock::duration duration)
+	{
+		auto seconds = std::chrono::duration<double>(duration).count();
+		std::wcout << patternText.c_str() << L" (" << description << L"): " << NUM_NAMES
+				   << L" names in " << seconds << L"s (" << numMatched << L" matched)"
+				   << std::endl;
+	};
+
+	for (const auto &patternText : patterns)
+	{
+		// Before: the pattern is interpreted from scratch for each name.
+		size_t numMatchedBefore = 0;
+		auto start = std::chrono::steady_clock::now();
+
+		for (const auto &name : names)
+		{
+			if (CheckWildcardMatch(patternText.c_str(), name.c_str(), FALSE))
+			{
+				numMatchedBefore++;
+			}
+		}
+
+		reportResult(patternText, "CheckWildcardMatch", numMatchedBefore,
+			std::chrono::steady_clock::now() - start);
+
+		// After: the pattern is compiled once.
+		size_t numMatchedAfter = 0;
+		start = std::chrono::steady_clock::now();
+
+		WildcardPattern pattern(patternText, false);
+
+		for (const auto &name : names)
+		{
+			if (pattern.Match(name))
+			{
+				numMatchedAfter++;
+			}
+		}
+
+		reportResult(patternText, "WildcardPattern", numMatchedAfter,
+			std::chrono::steady_clock::now() - start);
+
+		EXPECT_EQ(numMatchedAfter, numMatchedBefore);
+	}
+}